@@ -0,0 +1,196 @@
+//System includes
+#include <algorithm>
+
+//Library includes
+
+//Local includes
+#include "AveragingStage.h"
+
+using namespace std;
+
+cAveragingStage::cAveragingStage() :
+    m_u32NextInputIndex(0),
+    m_u32NewestIndex(0)
+{
+}
+
+cAveragingStage::cHistoryEntry& cAveragingStage::nextEntry(uint32_t u32NChannels, uint32_t u32NBins, uint32_t u32Averaging)
+{
+    if(!u32Averaging)
+        u32Averaging = 1;
+
+    //If the shape of the data has changed the history is meaningless. Start again.
+    if(m_qvoHistory.size())
+    {
+        const cHistoryEntry &oNewest = m_qvoHistory[m_u32NewestIndex];
+        uint32_t u32NHistoryChannels = oNewest.m_qvu32ChannelList.empty() ? oNewest.m_oFrame.getNChannels() : oNewest.m_qvu32ChannelList.size();
+
+        if(u32NHistoryChannels != u32NChannels || oNewest.m_oFrame.getNBins() != u32NBins)
+        {
+            clear();
+        }
+    }
+
+    //Update history length
+    //If shortening history simply delete the entries
+    //Otherwise extend onces per sample update using the new history place to store the new data.
+    //Simply resizing on enlarge would result in in signal level droppout until all entries have been used.
+    if((uint32_t)m_qvoHistory.size() > u32Averaging)
+    {
+        m_qvoHistory.resize(u32Averaging);
+    }
+    else if((uint32_t)m_qvoHistory.size() < u32Averaging)
+    {
+        m_qvoHistory.resize(m_qvoHistory.size() + 1);
+        m_u32NextInputIndex = m_qvoHistory.size() - 1;
+    }
+
+    //Wrap history circular buffer as necessary
+    if(m_u32NextInputIndex >= (uint32_t)m_qvoHistory.size())
+    {
+        m_u32NextInputIndex = 0;
+    }
+
+    //Increment index for next data input
+    m_u32NewestIndex = m_u32NextInputIndex++;
+
+    return m_qvoHistory[m_u32NewestIndex];
+}
+
+bool cAveragingStage::isEmpty() const
+{
+    return m_qvoHistory.empty();
+}
+
+const cAveragingStage::cHistoryEntry& cAveragingStage::getNewestEntry() const
+{
+    return m_qvoHistory[m_u32NewestIndex];
+}
+
+void cAveragingStage::clear()
+{
+    m_qvoHistory.clear();
+    m_u32NextInputIndex = 0;
+    m_u32NewestIndex = 0;
+}
+
+void cAveragingStage::process(const QVector<cBinRange> &qvoBinRanges, uint32_t u32NChannels, uint32_t u32NBins, QVector<QVector<float> > &qvvfOutput)
+{
+    if((uint32_t)qvvfOutput.size() != u32NChannels)
+    {
+        qvvfOutput.resize(u32NChannels);
+    }
+
+    //Sum in double precision to limit rounding error for long averages. Store the result as float.
+    m_qvdAccumulator.resize(u32NBins);
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        qvvfOutput[u32ChannelNo].resize(u32NBins);
+
+        //Only the bins in the given ranges are averaged. The full history is retained so that other bins
+        //can be recalculated by a later call.
+        for(uint32_t u32RangeNo = 0; u32RangeNo < (uint32_t)qvoBinRanges.size(); u32RangeNo++)
+        {
+            averageBins(u32ChannelNo, qvoBinRanges[u32RangeNo], qvvfOutput[u32ChannelNo].data());
+        }
+    }
+}
+
+void cAveragingStage::averageBins(uint32_t u32ChannelNo, const cBinRange &oRange, float *pfOutput)
+{
+    double *pdAccumulator = m_qvdAccumulator.data();
+
+    if(oRange.m_u32End <= oRange.m_u32Begin)
+        return;
+
+    //Every bin is summed, strided or not. Pooling afterwards is the only way a coarse bin can represent its whole block.
+    fill(pdAccumulator + oRange.m_u32Begin, pdAccumulator + oRange.m_u32End, 0.0);
+
+    for(uint32_t u32HistoryEntry = 0; u32HistoryEntry < (uint32_t)m_qvoHistory.size(); u32HistoryEntry++)
+    {
+        const cHistoryEntry &oEntry = m_qvoHistory[u32HistoryEntry];
+        const float *pfHistory = oEntry.m_oFrame.getChannel(oEntry.m_qvu32ChannelList.empty() ? u32ChannelNo : oEntry.m_qvu32ChannelList[u32ChannelNo]);
+
+        cPlotKernels::apply<cAccumulateOperation>(pfHistory + oRange.m_u32Begin, pdAccumulator + oRange.m_u32Begin, oRange.m_u32End - oRange.m_u32Begin);
+    }
+
+    //Divide, max pooling each block of a strided range. The division is common to the block so it is done after the maximum.
+    double dNHistoryEntries = m_qvoHistory.size();
+
+    for(uint32_t u32BinNo = oRange.m_u32Begin; u32BinNo < oRange.m_u32End; u32BinNo += oRange.m_u32Stride)
+    {
+        double dMax = pdAccumulator[u32BinNo];
+        uint32_t u32BlockEnd = qMin(u32BinNo + oRange.m_u32Stride, oRange.m_u32End);
+
+        for(uint32_t u32PoolBinNo = u32BinNo + 1; u32PoolBinNo < u32BlockEnd; u32PoolBinNo++)
+        {
+            dMax = qMax(dMax, pdAccumulator[u32PoolBinNo]);
+        }
+
+        pfOutput[u32BinNo] = dMax / dNHistoryEntries;
+    }
+}
+
+cBlockAveragingStage::cBlockAveragingStage() :
+    m_u32NFrames(0)
+{
+}
+
+void cBlockAveragingStage::accumulate(const float *pfInput, uint32_t u32NBins)
+{
+    resize(u32NBins);
+
+    cPlotKernels::apply<cAccumulateOperation>(pfInput, m_qvfSum.data(), u32NBins);
+    m_u32NFrames++;
+}
+
+void cBlockAveragingStage::accumulate(const cRawPlotFrameView &oInput, uint32_t u32ChannelNo)
+{
+    resize(oInput.getNBins());
+
+    oInput.accumulateChannel(u32ChannelNo, m_qvfSum.data());
+    m_u32NFrames++;
+}
+
+void cBlockAveragingStage::resize(uint32_t u32NBins)
+{
+    //Reset the average if the vector length has changed
+    if((uint32_t)m_qvfSum.size() != u32NBins)
+    {
+        m_qvfSum.fill(0.0f, u32NBins);
+        m_u32NFrames = 0;
+    }
+}
+
+void cBlockAveragingStage::takeAverage(QVector<float> &qvfOutput)
+{
+    qvfOutput.resize(m_qvfSum.size());
+
+    float *pfOutput = qvfOutput.data();
+    float *pfSum = m_qvfSum.data();
+
+    for(uint32_t u32BinNo = 0; u32BinNo < (uint32_t)m_qvfSum.size(); u32BinNo++)
+    {
+        pfOutput[u32BinNo] = m_u32NFrames ? pfSum[u32BinNo] / m_u32NFrames : 0.0f;
+        pfSum[u32BinNo] = 0.0f;
+    }
+
+    m_u32NFrames = 0;
+}
+
+const QVector<float>& cBlockAveragingStage::getSum() const
+{
+    return m_qvfSum;
+}
+
+uint32_t cBlockAveragingStage::getNFrames() const
+{
+    return m_u32NFrames;
+}
+
+void cBlockAveragingStage::restore(const QVector<float> &qvfSum, uint32_t u32NFrames)
+{
+    m_qvfSum = qvfSum;
+    m_u32NFrames = u32NFrames;
+}
@@ -0,0 +1,100 @@
+//Averaging of successive frames for the plotting widgets, free of any GUI dependency so that it can be used and tested on its own.
+//cAveragingStage is the moving average of the framed plots over the most recent N frames.
+//cBlockAveragingStage is the average of all frames since the last output, as used for waterfall rows.
+
+#ifndef AVERAGING_STAGE_H
+#define AVERAGING_STAGE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+
+//Local includes
+#include "PlotFrame.h"
+
+class cAveragingStage
+{
+public:
+    //Bins [m_u32Begin, m_u32End) in steps of m_u32Stride
+    struct cBinRange
+    {
+        uint32_t                        m_u32Begin;
+        uint32_t                        m_u32End;
+        uint32_t                        m_u32Stride;
+    };
+
+    struct cHistoryEntry
+    {
+        cSharedPlotFrame                m_oFrame;
+        QVector<uint32_t>               m_qvu32ChannelList; //Empty if the frame contains only the averaged channels in order
+    };
+
+    cAveragingStage();
+
+    //Returns the history slot for the next frame, resizing the history for u32Averaging frames as necessary.
+    //The caller fills in the slot, either by writing into its frame (reusing the buffer) or by assigning a shared frame.
+    //The history is cleared if the number of channels or bins differs from that of the newest entry.
+    cHistoryEntry&                      nextEntry(uint32_t u32NChannels, uint32_t u32NBins, uint32_t u32Averaging);
+
+    bool                                isEmpty() const;
+    const cHistoryEntry&                getNewestEntry() const; //Only valid if not empty
+
+    void                                clear();
+
+    //Writes the mean over the history of the bins in the given ranges of each channel to qvvfOutput, which is resized to
+    //u32NChannels channels of u32NBins bins. Bins outside the ranges are left as they were. For a stride above 1 the first bin
+    //of each block of stride bins receives the maximum mean of the block.
+    void                                process(const QVector<cBinRange> &qvoBinRanges, uint32_t u32NChannels, uint32_t u32NBins,
+                                                QVector<QVector<float> > &qvvfOutput);
+
+private:
+    QVector<cHistoryEntry>              m_qvoHistory;
+    uint32_t                            m_u32NextInputIndex;
+    uint32_t                            m_u32NewestIndex;
+    QVector<double>                     m_qvdAccumulator; //Reused between frames
+
+    void                                averageBins(uint32_t u32ChannelNo, const cBinRange &oRange, float *pfOutput);
+};
+
+class cBlockAveragingStage
+{
+public:
+    cBlockAveragingStage();
+
+    //Adds a frame to the sum. A frame of a different length restarts the average.
+    void                                accumulate(const float *pfInput, uint32_t u32NBins);
+
+    //As above for one channel of raw samples, converted straight into the sum
+    void                                accumulate(const cRawPlotFrameView &oInput, uint32_t u32ChannelNo);
+
+    //Writes the mean of the frames accumulated since the last call to qvfOutput and restarts the average
+    void                                takeAverage(QVector<float> &qvfOutput);
+
+    //State for history checkpoints
+    const QVector<float>&               getSum() const;
+    uint32_t                            getNFrames() const;
+    void                                restore(const QVector<float> &qvfSum, uint32_t u32NFrames);
+
+private:
+    QVector<float>                      m_qvfSum;
+    uint32_t                            m_u32NFrames;
+
+    void                                resize(uint32_t u32NBins);
+};
+
+#endif // AVERAGING_STAGE_H
@@ -0,0 +1,113 @@
+//System includes
+#include <iostream>
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "BackgroundWriter.h"
+
+using namespace std;
+
+void cBackgroundWriter::cWriterThread::run()
+{
+    m_pWriter->writerLoop();
+}
+
+cBackgroundWriter::cBackgroundWriter(uint32_t u32MaxQueuedJobs) :
+    m_pWriterThread(NULL),
+    m_u32MaxQueuedJobs(u32MaxQueuedJobs),
+    m_bWriting(false),
+    m_bShutdown(false)
+{
+}
+
+cBackgroundWriter::~cBackgroundWriter()
+{
+    if(m_pWriterThread)
+    {
+        cout << "cBackgroundWriter::~cBackgroundWriter(): Warning: Writer thread still running. stopWriter() should be called by the derived destructor." << endl;
+        stopWriter();
+    }
+}
+
+bool cBackgroundWriter::isBusy()
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    return m_bWriting || !m_qpJobs.isEmpty();
+}
+
+void cBackgroundWriter::startWriter()
+{
+    if(m_pWriterThread)
+        return;
+
+    m_bShutdown = false;
+
+    m_pWriterThread = new cWriterThread(this);
+    m_pWriterThread->start(QThread::LowPriority);
+}
+
+void cBackgroundWriter::stopWriter()
+{
+    if(!m_pWriterThread)
+        return;
+
+    //Don't lose output on shutdown: the thread only exits once the queue is empty
+    {
+        QMutexLocker oLock(&m_oWriterMutex);
+
+        m_bShutdown = true;
+        m_oCondition.wakeAll();
+    }
+
+    m_pWriterThread->wait();
+    delete m_pWriterThread;
+    m_pWriterThread = NULL;
+}
+
+void cBackgroundWriter::submitJob(cJob *pJob)
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    if(m_u32MaxQueuedJobs && (uint32_t)m_qpJobs.size() >= m_u32MaxQueuedJobs)
+        jobDiscarded(m_qpJobs.dequeue());
+
+    m_qpJobs.enqueue(pJob);
+    m_oCondition.wakeAll();
+}
+
+void cBackgroundWriter::jobDiscarded(cJob *pJob)
+{
+    delete pJob;
+}
+
+void cBackgroundWriter::writerLoop()
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    while(true)
+    {
+        if(m_qpJobs.isEmpty())
+        {
+            if(m_bShutdown)
+                break;
+
+            m_oCondition.wait(&m_oWriterMutex);
+            continue;
+        }
+
+        cJob *pJob = m_qpJobs.dequeue();
+        m_bWriting = true;
+
+        oLock.unlock();
+
+        bool bSuccess = writeJob(pJob);
+
+        oLock.relock();
+
+        m_bWriting = false;
+        jobFinished(pJob, bSuccess);
+    }
+}
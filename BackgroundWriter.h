@@ -0,0 +1,98 @@
+//Background thread writing queued jobs to disk in submission order, shared by the export, snapshot, frame capture and black box writers.
+//
+//Jobs are submitted from any thread and written one at a time by a single low priority thread, without the lock held, so
+//submitters only ever wait for the queue. The queue can be bounded, in which case the oldest waiting job is discarded to make room.
+//A bound of 1 keeps only the newest job waiting, for output where each job supersedes the last.
+//
+//Derived classes implement writeJob() and jobFinished(), call startWriter() at the end of their constructor and stopWriter() at the
+//start of their destructor. The thread calls back into the derived class so it must not outlive it.
+
+#ifndef BACKGROUND_WRITER_H
+#define BACKGROUND_WRITER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+//Local includes
+
+class cBackgroundWriter
+{
+public:
+    struct cJob
+    {
+        virtual                         ~cJob() {}
+    };
+
+    //u32MaxQueuedJobs limits the jobs waiting to be written, not counting the one being written. 0 is unbounded.
+    explicit cBackgroundWriter(uint32_t u32MaxQueuedJobs = 0);
+    virtual ~cBackgroundWriter();
+
+    //True while a job is waiting or being written
+    bool                                isBusy();
+
+protected:
+    //Protects the queue. Derived classes keep their stats and any job bookkeeping under it too.
+    QMutex                              m_oWriterMutex;
+
+    void                                startWriter();
+
+    //Writes everything still queued, then joins the thread
+    void                                stopWriter();
+
+    //Takes ownership of the job until it is passed to jobFinished() or jobDiscarded()
+    void                                submitJob(cJob *pJob);
+
+    //Called on the writer thread without m_oWriterMutex held
+    virtual bool                        writeJob(cJob *pJob) = 0;
+
+    //Called with m_oWriterMutex held once the job has been written. Updates stats and disposes of the job.
+    virtual void                        jobFinished(cJob *pJob, bool bSuccess) = 0;
+
+    //Called with m_oWriterMutex held for a job pushed out of a full queue unwritten. The default deletes it.
+    virtual void                        jobDiscarded(cJob *pJob);
+
+private:
+    class cWriterThread : public QThread
+    {
+    public:
+        explicit cWriterThread(cBackgroundWriter *pWriter) : m_pWriter(pWriter) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cBackgroundWriter               *m_pWriter;
+    };
+
+    cWriterThread                       *m_pWriterThread;
+    uint32_t                            m_u32MaxQueuedJobs;
+
+    //Protected by m_oWriterMutex
+    QWaitCondition                      m_oCondition;
+    QQueue<cJob*>                       m_qpJobs;
+    bool                                m_bWriting;
+    bool                                m_bShutdown;
+
+    void                                writerLoop();
+};
+
+#endif // BACKGROUND_WRITER_H
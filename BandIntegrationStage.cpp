@@ -0,0 +1,132 @@
+//System includes
+
+//Library includes
+#include <QtGlobal>
+
+//Local includes
+#include "BandIntegrationStage.h"
+
+using namespace std;
+
+void cBandIntegrationStage::computePrefixSums(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, QVector<QVector<double> > &qvvdPrefixSums)
+{
+    uint32_t u32NChannels = qvu32ChannelList.size() ? qvu32ChannelList.size() : oYData.getNChannels();
+
+    qvvdPrefixSums.resize(u32NChannels);
+
+    if(qvu32ChannelList.empty())
+        computePrefixSums(oYData, cIdentityChannelSelection(), u32NChannels, qvvdPrefixSums);
+    else
+        computePrefixSums(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels, qvvdPrefixSums);
+}
+
+template<typename tChannelSelection>
+void cBandIntegrationStage::computePrefixSums(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                              QVector<QVector<double> > &qvvdPrefixSums)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        uint32_t u32InputChannelNo = oSelection.getInputChannelNo(u32ChannelNo);
+        uint32_t u32NBins = oYData.getNBins(u32InputChannelNo);
+
+        qvvdPrefixSums[u32ChannelNo].resize(u32NBins + 1);
+
+        cPlotKernels::absPrefixSum(oYData.getChannel(u32InputChannelNo), qvvdPrefixSums[u32ChannelNo].data(), u32NBins);
+    }
+}
+
+void cBandIntegrationStage::integratePrefixSums(const QVector<QVector<double> > &qvvdPrefixSums, QVector<QVector<double> > &qvvdIntegrated, bool bRestart)
+{
+    if(bRestart || qvvdIntegrated.size() != qvvdPrefixSums.size())
+    {
+        qvvdIntegrated = qvvdPrefixSums;
+        return;
+    }
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvdPrefixSums.size(); u32ChannelNo++)
+    {
+        QVector<double> &qvdIntegrated = qvvdIntegrated[u32ChannelNo];
+        const QVector<double> &qvdPrefixSum = qvvdPrefixSums[u32ChannelNo];
+
+        //Restart this channel if the frame length has changed
+        if(qvdIntegrated.size() != qvdPrefixSum.size())
+        {
+            qvdIntegrated = qvdPrefixSum;
+            continue;
+        }
+
+        double *pdIntegrated = qvdIntegrated.data();
+        const double *pdPrefixSum = qvdPrefixSum.constData();
+
+        cPlotKernels::apply<cAccumulateOperation>(pdPrefixSum, pdIntegrated, qvdIntegrated.size());
+    }
+}
+
+cBandIntegrationStage::cBandBins cBandIntegrationStage::getBandBins(double dStart, double dStop, double dMinimum, double dMaximum, uint32_t u32NBins)
+{
+    cBandBins oBins;
+
+    oBins.m_u32StartIndex = 0;
+    oBins.m_u32StopIndex = 0;
+    oBins.m_dWidth = dStop - dStart;
+
+    //Prevent divide by zero
+    if(oBins.m_dWidth == 0.0)
+        oBins.m_dWidth = 1.0;
+
+    //A spectrum spanning no X range (e.g. before the X scale is known) has no meaningful bins
+    if(!(dMaximum > dMinimum))
+        return oBins;
+
+    //Get array indexes from selection frequency band
+    oBins.m_u32StartIndex = getBinIndex( (dStart - dMinimum) / (dMaximum - dMinimum) * u32NBins, u32NBins);
+    oBins.m_u32StopIndex = getBinIndex( (dStop - dMinimum) / (dMaximum - dMinimum) * u32NBins, u32NBins);
+
+    return oBins;
+}
+
+uint32_t cBandIntegrationStage::getBinIndex(double dIndex, uint32_t u32NBins)
+{
+    //Clamp before casting as the conversion of an out of range double is undefined. NaN clamps to 0.
+    if(!(dIndex > 0.0))
+        return 0;
+
+    if(dIndex >= u32NBins)
+        return u32NBins;
+
+    //Truncation is floor for positive values
+    return (uint32_t)dIndex;
+}
+
+void cBandIntegrationStage::computeBandPowers(const QVector<QVector<double> > &qvvdPrefixSums, uint32_t u32NBins, uint32_t u32Decimation,
+                                              const QVector<cBandBins> &qvoBands, QVector<float> &qvfBandPowers)
+{
+    qvfBandPowers.resize(qvvdPrefixSums.size() * qvoBands.size());
+
+    for(uint32_t u32BandNo = 0; u32BandNo < (uint32_t)qvoBands.size(); u32BandNo++)
+    {
+        const cBandBins &oBand = qvoBands[u32BandNo];
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvdPrefixSums.size(); u32ChannelNo++)
+        {
+            const QVector<double> &qvdPrefixSum = qvvdPrefixSums[u32ChannelNo];
+            uint32_t u32LastEntry = qvdPrefixSum.size() - 1;
+
+            //Stop index is inclusive. Clamp to the length of this channel
+            uint32_t u32ChannelNBins = (u32Decimation == 1) ? u32LastEntry : u32NBins;
+            uint32_t u32Begin = qMin(oBand.m_u32StartIndex, u32ChannelNBins);
+            uint32_t u32End = qMin(oBand.m_u32StopIndex + 1, u32ChannelNBins);
+
+            //Round to the nearest retained entry. The last entry is always the full sum.
+            u32Begin = (u32Begin == u32ChannelNBins) ? u32LastEntry : qMin((u32Begin + u32Decimation / 2) / u32Decimation, u32LastEntry);
+            u32End = (u32End == u32ChannelNBins) ? u32LastEntry : qMin((u32End + u32Decimation / 2) / u32Decimation, u32LastEntry);
+
+            float fPower = 0.0f;
+
+            if(u32End > u32Begin)
+                fPower = (qvdPrefixSum[u32End] - qvdPrefixSum[u32Begin]) / oBand.m_dWidth;
+
+            qvfBandPowers[u32ChannelNo * qvoBands.size() + u32BandNo] = fPower;
+        }
+    }
+}
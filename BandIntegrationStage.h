@@ -0,0 +1,68 @@
+//Band power integration for the band power plot, free of any GUI dependency.
+//Each frame is converted once per channel to a prefix sum of |x| so that the power in any band is a single difference.
+//Band sums are linear so prefix sums can be integrated over time in place of band powers and the bands evaluated at the end.
+
+#ifndef BAND_INTEGRATION_STAGE_H
+#define BAND_INTEGRATION_STAGE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+
+//Local includes
+#include "PlotFrame.h"
+
+class cBandIntegrationStage
+{
+public:
+    //Inclusive bin range of a band and the width it is divided by
+    struct cBandBins
+    {
+        uint32_t                        m_u32StartIndex;
+        uint32_t                        m_u32StopIndex;
+        double                          m_dWidth;
+    };
+
+    //Writes per channel prefix sums of |x| for the selected channels (all if the list is empty), N + 1 entries with a leading 0.
+    //Accumulated in double so that differences between large prefix sums stay accurate for narrow bands.
+    static void                         computePrefixSums(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList,
+                                                          QVector<QVector<double> > &qvvdPrefixSums);
+
+    //Adds the prefix sums of a frame to the integrated prefix sums. The integration restarts from this frame if bRestart is set
+    //or the number of channels differs, and for any channel whose length differs.
+    static void                         integratePrefixSums(const QVector<QVector<double> > &qvvdPrefixSums, QVector<QVector<double> > &qvvdIntegrated,
+                                                            bool bRestart);
+
+    //Band edges in X units to bins of a spectrum of u32NBins bins spanning [dMinimum, dMaximum], clamped to [0, u32NBins].
+    //A band of zero width is given a width of 1. If the spectrum spans no range both edges are bin 0.
+    static cBandBins                    getBandBins(double dStart, double dStop, double dMinimum, double dMaximum, uint32_t u32NBins);
+
+    //Band powers for all channels (channel major) divided by band width. Prefix sums of a spectrum of u32NBins bins may be decimated,
+    //holding entries at bins 0, D, 2D, ... and finally N, in which case band edges are rounded to the nearest retained entry.
+    static void                         computeBandPowers(const QVector<QVector<double> > &qvvdPrefixSums, uint32_t u32NBins, uint32_t u32Decimation,
+                                                          const QVector<cBandBins> &qvoBands, QVector<float> &qvfBandPowers);
+
+private:
+    static uint32_t                     getBinIndex(double dIndex, uint32_t u32NBins);
+
+    template<typename tChannelSelection>
+    static void                         computePrefixSums(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                                          QVector<QVector<double> > &qvvdPrefixSums);
+};
+
+#endif // BAND_INTEGRATION_STAGE_H
@@ -1,11 +1,11 @@
 //System includes
 #include <iostream>
 #include <cmath>
+#include <cfloat>
+#include <cstring>
 
 //Library includes
-#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
-#include <boost/math/special_functions/trunc.hpp>
-#endif
+#include <QtConcurrentMap>
 
 //Local includes
 #include "BandPowerQwtLinePlotWidget.h"
@@ -15,23 +15,37 @@ using namespace std;
 
 cBandPowerQwtLinePlot::cBandPowerQwtLinePlot(QWidget *pParent) :
     cScrollingQwtLinePlotWidget(pParent),
+    m_pBandSelectLabel(new QLabel(QString("Band"), this)),
+    m_pBandSelectComboBox(new QComboBox(this)),
     m_pBandStartLabel(new QLabel(QString("Band start"), this)),
     m_pBandStopLabel(new QLabel(QString("Band stop"), this)),
     m_pIntegrationTimeLabel(new QLabel(QString("Integration time"), this)),
     m_pBandStartDoubleSpinBox(new QDoubleSpinBox(this)),
     m_pBandStopDoubleSpinBox(new QDoubleSpinBox(this)),
     m_pIntegrationTimeSpinBox(new QDoubleSpinBox(this)),
+    m_pSlidingIntegrationCheckBox(new QCheckBox(QString("Sliding"), this)),
     m_pTimeScaleDraw(new cWallTimeQwtScaleDraw),
     m_dBandMinimum(0),
     m_dBandMaximum(1),
     m_dIntegrationTimeScalingFactor_s(1.0),
     m_dMaxIntegrationTime(60.0 * 60.0), //default to an our assuming default unit seconds.
     m_qstrIntegrationTimeUnit(QString("s")),
-    m_dSelectedBandStart(0),
-    m_dSelectedBandStop(1),
+    m_i32SelectedBandNo(0),
+    m_bIsDefaultBand(true),
+    m_bBandSetChanged(true),
+    m_bRecomputeBandHistory(false),
+    m_bRetroactiveBandPower(true),
+    m_u32BandHistoryDecimation(1),
     m_i64IntegrationStartTime_us(0),
     m_i64IntegrationTime_us(1000000), //default 1 second
-    m_bNewIntegration(true)
+    m_bNewIntegration(true),
+    m_bRestartIntegration(false),
+    m_bSlidingIntegration(false),
+    m_u32SlidingOutputInterval_nFrames(1),
+    m_u32SlidingWindowOldestIndex(0),
+    m_u32SlidingWindowNFrames(0),
+    m_u32FramesSinceOutput(0),
+    m_u32FramesSinceResync(0)
 {
     //Only have the spinboxes emit a "changed" signal on Enter press. Not as the user types.
     m_pBandStartDoubleSpinBox->setKeyboardTracking(false);
@@ -41,18 +55,31 @@ cBandPowerQwtLinePlot::cBandPowerQwtLinePlot(QWidget *pParent) :
     m_pIntegrationTimeSpinBox->setMinimum(0.0);
     m_pIntegrationTimeSpinBox->setValue(1.0);
 
-    //Add band selection and intergration time selection to the GUI
-    insertWidgetIntoControlFrame(m_pBandStartLabel, 6);
-    insertWidgetIntoControlFrame(m_pBandStartDoubleSpinBox, 7, true);
-    insertWidgetIntoControlFrame(m_pBandStopLabel, 9);
-    insertWidgetIntoControlFrame(m_pBandStopDoubleSpinBox, 10, true);
-    insertWidgetIntoControlFrame(m_pIntegrationTimeLabel, 12);
-    insertWidgetIntoControlFrame(m_pIntegrationTimeSpinBox, 13, true);
-
+    //Start with a single band spanning the full selectable range
+    cBand oDefaultBand;
+    oDefaultBand.m_qstrName = QString("Band");
+    oDefaultBand.m_dStart = m_dBandMinimum;
+    oDefaultBand.m_dStop = m_dBandMaximum;
+    m_qvoBands.push_back(oDefaultBand);
+    m_pBandSelectComboBox->addItem(oDefaultBand.m_qstrName);
 
+    //Add band selection and intergration time selection to the GUI
+    insertWidgetIntoControlFrame(m_pBandSelectLabel, 6);
+    insertWidgetIntoControlFrame(m_pBandSelectComboBox, 7, true);
+    insertWidgetIntoControlFrame(m_pBandStartLabel, 9);
+    insertWidgetIntoControlFrame(m_pBandStartDoubleSpinBox, 10, true);
+    insertWidgetIntoControlFrame(m_pBandStopLabel, 12);
+    insertWidgetIntoControlFrame(m_pBandStopDoubleSpinBox, 13, true);
+    insertWidgetIntoControlFrame(m_pIntegrationTimeLabel, 15);
+    insertWidgetIntoControlFrame(m_pIntegrationTimeSpinBox, 16, true);
+    insertWidgetIntoControlFrame(m_pSlidingIntegrationCheckBox, 18, true);
+
+
+    QObject::connect(m_pBandSelectComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(slotSelectedBandNoChanged(int)));
     QObject::connect(m_pBandStartDoubleSpinBox, SIGNAL(valueChanged(double)), this, SLOT(slotBandStartChanged(double)));
     QObject::connect(m_pBandStopDoubleSpinBox, SIGNAL(valueChanged(double)), this, SLOT(slotBandStopChanged(double)));
     QObject::connect(m_pIntegrationTimeSpinBox, SIGNAL(valueChanged(double)), this, SLOT(slotIntegrationTimeChanged(double)));
+    QObject::connect(m_pSlidingIntegrationCheckBox, SIGNAL(clicked(bool)), this, SLOT(slotSlidingIntegrationToggled(bool)));
 
     m_qvfIntergratedPowerTimestamp_s.resize(1);
 
@@ -67,107 +94,844 @@ cBandPowerQwtLinePlot::~cBandPowerQwtLinePlot()
 
 void cBandPowerQwtLinePlot::addData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
 {
+    addData(cPlotFrameView(qvvfYData), i64Timestamp_us, qvu32ChannelList);
+}
+
+void cBandPowerQwtLinePlot::addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!oYData.getNChannels())
+        return;
+
+    //The input frames are recorded rather than the band powers derived from them
+    recordFrame(NULL, 0, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    cIngestSettings oSettings;
+    takeIngestSettings(oSettings);
+
+    if(!oSettings.m_qvoBands.size())
+        return;
+
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
+
+    prepareCurves(qvu32ChannelList.size() ? qvu32ChannelList.size() : oYData.getNChannels(), oSettings);
+
+    if(!integrateFrame(oYData, i64Timestamp_us, qvu32ChannelList, oSettings))
+        return;
+
+    ingestData(m_qvfIntergratedPowerTimestamp_s.constData(), m_qvfIntergratedPowerTimestamp_s.size(), cPlotFrameView(m_qvvfIntergratedPower), i64Timestamp_us);
+
+    discardScrolledBandHistory();
+}
+
+void cBandPowerQwtLinePlot::addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!oBatch.getNFrames() || !oBatch.getFrame(oBatch.getNFrames() - 1).getNChannels())
+        return;
+
+    recordBatch(oBatch, qvu32ChannelList);
 
-    double dSelectedBandWidth = m_dSelectedBandStop - m_dSelectedBandStart;
+    //Settings are taken once for the batch
+    cIngestSettings oSettings;
+    takeIngestSettings(oSettings);
 
-    //Prevent divide by zero
-    if(dSelectedBandWidth == 0.0)
-        dSelectedBandWidth = 1.0;
+    if(!oSettings.m_qvoBands.size())
+        return;
 
-    //Get array indexes from selection frequency band
-    uint32_t u32StartIndex = boost::math::itrunc( (m_dSelectedBandStart - m_dBandMinimum) / (m_dBandMaximum - m_dBandMinimum) * qvvfYData[0].size()); //trunc = floor
-    uint32_t u32StopIndex = boost::math::itrunc( (m_dSelectedBandStop - m_dBandMinimum) / (m_dBandMaximum - m_dBandMinimum) * qvvfYData[0].size());
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
 
-    //cout << "Start index = " << u32StartIndex << ", stop index = " << u32StopIndex << endl;
+    uint32_t u32NChannels = qvu32ChannelList.size() ? qvu32ChannelList.size() : oBatch.getFrame(oBatch.getNFrames() - 1).getNChannels();
+    uint32_t u32NCurves = u32NChannels * oSettings.m_qvoBands.size();
 
-    //Check that we have correct number of channels
-    //If a channel list is supplied
-    if(qvu32ChannelList.size())
+    prepareCurves(u32NChannels, oSettings);
+
+    //Integrate every frame, collecting output points point-major
+    m_qvfBatchX.resize(0);
+    m_qvfBatchY.resize(0);
+    m_qvi64BatchTimestamps_us.resize(0);
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < oBatch.getNFrames(); u32FrameNo++)
     {
-        if(m_qvvfIntergratedPower.size() != qvu32ChannelList.size())
-        {
-            m_qvvfIntergratedPower.resize(qvu32ChannelList.size());
+        const cPlotFrameView &oFrame = oBatch.getFrame(u32FrameNo);
 
-            for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfIntergratedPower.size(); u32ChannelNo++)
-            {
-                m_qvvfIntergratedPower[u32ChannelNo].resize(1); //Only a single sample of integration output is added per iteration
-            }
+        //Frames of a different shape would not line up with the curves
+        if(!oFrame.getNChannels() || (qvu32ChannelList.empty() && oFrame.getNChannels() != u32NChannels))
+            continue;
+
+        if(!integrateFrame(oFrame, oBatch.getTimestamp_us(u32FrameNo), qvu32ChannelList, oSettings))
+            continue;
+
+        m_qvfBatchX.push_back(m_qvfIntergratedPowerTimestamp_s[0]);
+        m_qvi64BatchTimestamps_us.push_back(oBatch.getTimestamp_us(u32FrameNo));
+
+        for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+        {
+            m_qvfBatchY.push_back(m_qvvfIntergratedPower[u32CurveNo][0]);
         }
     }
-    //Otherwise all channels
-    else
+
+    if(m_qvfBatchX.empty())
+        return;
+
+    //Pass all points to the underlying plotting code in one go
+    cPlotFrameBatch oPoints;
+
+    for(uint32_t u32PointNo = 0; u32PointNo < (uint32_t)m_qvfBatchX.size(); u32PointNo++)
     {
-        if(m_qvvfIntergratedPower.size() != qvvfYData.size())
+        oPoints.addFrame(cPlotFrameView(m_qvfBatchY.constData() + u32PointNo * u32NCurves, u32NCurves, 1, 1), m_qvi64BatchTimestamps_us[u32PointNo],
+                         m_qvfBatchX.constData() + u32PointNo, 1);
+    }
+
+    ingestDataBatch(oPoints);
+
+    discardScrolledBandHistory();
+}
+
+void cBandPowerQwtLinePlot::takeIngestSettings(cIngestSettings &oSettings)
+{
+    //Take a copy of the band settings so that the GUI is free to edit them during the integration
+    QWriteLocker oLock(&m_oMutex);
+
+    oSettings.m_qvoBands = m_qvoBands;
+    oSettings.m_dBandMinimum = m_dBandMinimum;
+    oSettings.m_dBandMaximum = m_dBandMaximum;
+    oSettings.m_bBandSetChanged = m_bBandSetChanged;
+    m_bBandSetChanged = false;
+    oSettings.m_bRecomputeBandHistory = m_bRecomputeBandHistory;
+    m_bRecomputeBandHistory = false;
+    oSettings.m_bRetroactiveBandPower = m_bRetroactiveBandPower && !m_bSlidingIntegration; //Sliding points are not retained
+    oSettings.m_u32BandHistoryDecimation = m_u32BandHistoryDecimation;
+    oSettings.m_bSlidingIntegration = m_bSlidingIntegration;
+    oSettings.m_u32SlidingOutputInterval_nFrames = m_u32SlidingOutputInterval_nFrames;
+    oSettings.m_bRestartIntegration = m_bRestartIntegration;
+    m_bRestartIntegration = false;
+}
+
+void cBandPowerQwtLinePlot::prepareCurves(uint32_t u32NChannels, const cIngestSettings &oSettings)
+{
+    const QVector<cBand> &qvoBands = oSettings.m_qvoBands;
+    uint32_t u32NCurves = u32NChannels * qvoBands.size();
+    bool bRestartIntegration = oSettings.m_bRestartIntegration;
+    bool bHistoryUsable = m_qvoBandHistory.size() && m_qvoBandHistory.first().m_qvvdPrefixSums.size() == (int32_t)u32NChannels;
+    bool bRebuilt = false;
+
+    //Check that we have correct number of curves (channels x bands).
+    if(oSettings.m_bBandSetChanged || m_qvvfIntergratedPower.size() != (int32_t)u32NCurves)
+    {
+        if(bHistoryUsable)
         {
-            m_qvvfIntergratedPower.resize(qvvfYData.size());
+            //Only the bands have changed. Recompute the existing trace for the new bands.
+            rebuildFromBandHistory(oSettings);
+            bRebuilt = true;
+        }
+        else
+        {
+            //The existing history no longer corresponds to the curves so start afresh.
+            m_qvvfIntergratedPower.resize(u32NCurves);
 
-            for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfIntergratedPower.size(); u32ChannelNo++)
+            for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
             {
-                m_qvvfIntergratedPower[u32ChannelNo].resize(1); //Only a single sample of integration output is added per iteration
+                m_qvvfIntergratedPower[u32CurveNo].resize(1); //Only a single sample of integration output is added per iteration
             }
+
+            resetHistory();
+            m_qvoBandHistory.clear();
+            m_bNewIntegration = true;
+        }
+
+        updateBandCurveNames(u32NChannels);
+
+        bRestartIntegration = true;
+    }
+    else if(oSettings.m_bRecomputeBandHistory && oSettings.m_bRetroactiveBandPower && bHistoryUsable)
+    {
+        //The edges of an existing band have been edited. Redraw the existing trace with the new edges.
+        rebuildFromBandHistory(oSettings);
+        bRebuilt = true;
+    }
+
+    //The frame may not complete an integration so show the rebuilt trace now
+    if(bRebuilt)
+    {
+        QReadLocker oLock(&m_oMutex);
+
+        if(!m_bIsPaused)
+            sigUpdatePlotData();
+    }
+
+    //Per frame band powers in the sliding window are for the old bands. (Tumbling integration is band agnostic.)
+    if(bRestartIntegration)
+        resetSlidingWindow();
+}
+
+bool cBandPowerQwtLinePlot::integrateFrame(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList,
+                                           const cIngestSettings &oSettings)
+{
+    const QVector<cBand> &qvoBands = oSettings.m_qvoBands;
+    uint32_t u32NChannels = qvu32ChannelList.size() ? qvu32ChannelList.size() : oYData.getNChannels();
+    uint32_t u32NCurves = u32NChannels * qvoBands.size();
+
+    //Band edges are mapped to bins by the first selected channel. Longer or shorter channels are clamped to their own length.
+    uint32_t u32NBins = oYData.getNBins(qvu32ChannelList.size() ? qvu32ChannelList[0] : 0);
+
+    //Convert each channel to a prefix sum of |x| once. Each band is then a single difference.
+    cBandIntegrationStage::computePrefixSums(oYData, qvu32ChannelList, m_qvvdPrefixSums);
+
+    if(oSettings.m_bSlidingIntegration)
+    {
+        //Retained history would no longer line up with the plotted points
+        m_qvoBandHistory.clear();
+
+        //Start afresh if switching back to tumbling integration
+        m_bNewIntegration = true;
+
+        if(!integrateSliding(oSettings, u32NBins, i64Timestamp_us))
+            return false;
+
+        m_qvfIntergratedPowerTimestamp_s[0] = fmod( (double)i64Timestamp_us / 1e6, 60 * 60 * 24 );
+
+        for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+        {
+            m_qvvfIntergratedPower[u32CurveNo][0] = m_qvdSlidingWindowTotal[u32CurveNo];
         }
+
+        return true;
     }
 
-    //Now for each channel sum the values over the specified frequency range
-    //If a channel list is supplied
-    if(qvu32ChannelList.size())
+    //Integrate the prefix sums themselves. Band sums are linear so the bands can be evaluated at the end of the integration
+    //(and again later from the history if the bands change).
+    cBandIntegrationStage::integratePrefixSums(m_qvvdPrefixSums, m_qvvdIntegratedPrefixSums, m_bNewIntegration);
+
+    if(m_bNewIntegration)
+    {
+        m_i64IntegrationStartTime_us = i64Timestamp_us;
+        m_bNewIntegration = false;
+    }
+
+    if(i64Timestamp_us - m_i64IntegrationStartTime_us < m_i64IntegrationTime_us)
+        return false;
+
+    //Store the timestamp of the last spectrum frame in a float containing "seconds-elapsed-today" along with the bandpower.
+    //This is the X axis for plotting
+
+    m_qvfIntergratedPowerTimestamp_s[0] = fmod( (double)i64Timestamp_us / 1e6, 60 * 60 * 24 );
+
+    QVector<float> qvfBandPowers;
+    computeBandPowers(m_qvvdIntegratedPrefixSums, u32NBins, 1, oSettings, qvfBandPowers);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
     {
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfIntergratedPower.size(); u32ChannelNo++)
+        m_qvvfIntergratedPower[u32CurveNo][0] = qvfBandPowers[u32CurveNo];
+    }
+
+    m_bNewIntegration = true;
+
+    if(oSettings.m_bRetroactiveBandPower)
+    {
+        //Keep a (decimated) copy of the integrated prefix sums for this point
+        cBandHistoryEntry oEntry;
+        oEntry.m_dX = m_qvfIntergratedPowerTimestamp_s[0];
+        oEntry.m_u32NBins = u32NBins;
+        oEntry.m_u32Decimation = oSettings.m_u32BandHistoryDecimation;
+        oEntry.m_qvvdPrefixSums.resize(u32NChannels);
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
         {
-            if(m_bNewIntegration)
+            const QVector<double> &qvdIntegrated = m_qvvdIntegratedPrefixSums[u32ChannelNo];
+            QVector<double> &qvdDecimated = oEntry.m_qvvdPrefixSums[u32ChannelNo];
+
+            if(oSettings.m_u32BandHistoryDecimation == 1)
             {
-                m_qvvfIntergratedPower[u32ChannelNo][0] = 0.0; //Reset integrated power to 0
+                qvdDecimated = qvdIntegrated;
+                continue;
             }
 
-            //Integrate
-            for(uint32_t u32Index = u32StartIndex; u32Index <= u32StopIndex && u32Index < (uint32_t)qvvfYData[ qvu32ChannelList[u32ChannelNo] ].size(); u32Index++)
+            qvdDecimated.reserve(qvdIntegrated.size() / oSettings.m_u32BandHistoryDecimation + 2);
+
+            for(uint32_t u32Index = 0; u32Index < (uint32_t)qvdIntegrated.size() - 1; u32Index += oSettings.m_u32BandHistoryDecimation)
             {
-                m_qvvfIntergratedPower[u32ChannelNo][0] += std::fabs( qvvfYData[ qvu32ChannelList[u32ChannelNo] ][u32Index] );
+                qvdDecimated.push_back(qvdIntegrated[u32Index]);
             }
+            qvdDecimated.push_back(qvdIntegrated.last());
         }
+
+        m_qvoBandHistory.enqueue(oEntry);
     }
-    //Otherwise all channels
     else
     {
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfIntergratedPower.size(); u32ChannelNo++)
+        m_qvoBandHistory.clear();
+    }
+
+    return true;
+}
+
+void cBandPowerQwtLinePlot::discardScrolledBandHistory()
+{
+    //Discard history that has scrolled out of the plot
+    while((uint32_t)m_qvoBandHistory.size() > getNXSamples())
+    {
+        m_qvoBandHistory.dequeue();
+    }
+}
+
+void cBandPowerQwtLinePlot::computeBandPowers(const QVector<QVector<double> > &qvvdPrefixSums, uint32_t u32NBins, uint32_t u32Decimation,
+                                              const cIngestSettings &oSettings, QVector<float> &qvfBandPowers)
+{
+    const QVector<cBand> &qvoBands = oSettings.m_qvoBands;
+    QVector<cBandIntegrationStage::cBandBins> qvoBandBins(qvoBands.size());
+
+    for(uint32_t u32BandNo = 0; u32BandNo < (uint32_t)qvoBands.size(); u32BandNo++)
+    {
+        qvoBandBins[u32BandNo] = cBandIntegrationStage::getBandBins(qvoBands[u32BandNo].m_dStart, qvoBands[u32BandNo].m_dStop,
+                                                                    oSettings.m_dBandMinimum, oSettings.m_dBandMaximum, u32NBins);
+    }
+
+    cBandIntegrationStage::computeBandPowers(qvvdPrefixSums, u32NBins, u32Decimation, qvoBandBins, qvfBandPowers);
+}
+
+bool cBandPowerQwtLinePlot::integrateSliding(const cIngestSettings &oSettings, uint32_t u32NBins, int64_t i64Timestamp_us)
+{
+    //Band powers of this frame only. Being linear the window total is the sum of these over the window.
+    QVector<float> qvfFrameBandPowers;
+    computeBandPowers(m_qvvdPrefixSums, u32NBins, 1, oSettings, qvfFrameBandPowers);
+
+    uint32_t u32NCurves = qvfFrameBandPowers.size();
+
+    if(m_qvdSlidingWindowTotal.size() != (int32_t)u32NCurves)
+        resetSlidingWindow();
+
+    if(!m_u32SlidingWindowNFrames)
+    {
+        m_qvdSlidingWindowTotal.fill(0.0, u32NCurves);
+        m_i64IntegrationStartTime_us = i64Timestamp_us;
+    }
+
+    //Grow the circular buffer as required. Slots are reused thereafter so steady state is allocation free.
+    uint32_t u32Capacity = m_qvi64SlidingWindowTimestamps_us.size();
+
+    if(m_u32SlidingWindowNFrames == u32Capacity)
+    {
+        uint32_t u32NewCapacity = qMax(u32Capacity * 2, (uint32_t)16);
+
+        QVector<QVector<double> > qvvdFrames(u32NewCapacity);
+        QVector<int64_t> qvi64Timestamps_us(u32NewCapacity);
+
+        for(uint32_t u32FrameNo = 0; u32FrameNo < m_u32SlidingWindowNFrames; u32FrameNo++)
         {
-            if(m_bNewIntegration)
+            uint32_t u32OldIndex = (m_u32SlidingWindowOldestIndex + u32FrameNo) % u32Capacity;
+
+            qvvdFrames[u32FrameNo].swap(m_qvvdSlidingWindowFrames[u32OldIndex]);
+            qvi64Timestamps_us[u32FrameNo] = m_qvi64SlidingWindowTimestamps_us[u32OldIndex];
+        }
+
+        m_qvvdSlidingWindowFrames.swap(qvvdFrames);
+        m_qvi64SlidingWindowTimestamps_us.swap(qvi64Timestamps_us);
+        m_u32SlidingWindowOldestIndex = 0;
+        u32Capacity = u32NewCapacity;
+    }
+
+    //Add the new frame
+    uint32_t u32NewIndex = (m_u32SlidingWindowOldestIndex + m_u32SlidingWindowNFrames) % u32Capacity;
+    QVector<double> &qvdNewFrame = m_qvvdSlidingWindowFrames[u32NewIndex];
+    qvdNewFrame.resize(u32NCurves);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+    {
+        qvdNewFrame[u32CurveNo] = qvfFrameBandPowers[u32CurveNo];
+        m_qvdSlidingWindowTotal[u32CurveNo] += qvfFrameBandPowers[u32CurveNo];
+    }
+
+    m_qvi64SlidingWindowTimestamps_us[u32NewIndex] = i64Timestamp_us;
+    m_u32SlidingWindowNFrames++;
+
+    //Remove frames that have fallen out of the window
+    while(m_u32SlidingWindowNFrames > 1 && i64Timestamp_us - m_qvi64SlidingWindowTimestamps_us[m_u32SlidingWindowOldestIndex] > m_i64IntegrationTime_us)
+    {
+        const QVector<double> &qvdOldFrame = m_qvvdSlidingWindowFrames[m_u32SlidingWindowOldestIndex];
+
+        for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+        {
+            m_qvdSlidingWindowTotal[u32CurveNo] -= qvdOldFrame[u32CurveNo];
+        }
+
+        m_u32SlidingWindowOldestIndex = (m_u32SlidingWindowOldestIndex + 1) % u32Capacity;
+        m_u32SlidingWindowNFrames--;
+    }
+
+    //Adding and subtracting accumulates rounding error. Periodically resum the window.
+    if(++m_u32FramesSinceResync >= qMax(m_u32SlidingWindowNFrames, (uint32_t)1024))
+    {
+        m_qvdSlidingWindowTotal.fill(0.0);
+
+        for(uint32_t u32FrameNo = 0; u32FrameNo < m_u32SlidingWindowNFrames; u32FrameNo++)
+        {
+            const QVector<double> &qvdFrame = m_qvvdSlidingWindowFrames[(m_u32SlidingWindowOldestIndex + u32FrameNo) % u32Capacity];
+
+            for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
             {
-                m_qvvfIntergratedPower[u32ChannelNo][0] = 0.0; //Reset integrated power to 0
+                m_qvdSlidingWindowTotal[u32CurveNo] += qvdFrame[u32CurveNo];
             }
+        }
+
+        m_u32FramesSinceResync = 0;
+    }
+
+    //Only output once the window has filled for the first time and then every N frames
+    if(i64Timestamp_us - m_i64IntegrationStartTime_us < m_i64IntegrationTime_us)
+        return false;
+
+    if(++m_u32FramesSinceOutput < oSettings.m_u32SlidingOutputInterval_nFrames)
+        return false;
+
+    m_u32FramesSinceOutput = 0;
+
+    return true;
+}
+
+void cBandPowerQwtLinePlot::resetSlidingWindow()
+{
+    m_u32SlidingWindowOldestIndex = 0;
+    m_u32SlidingWindowNFrames = 0;
+    m_u32FramesSinceOutput = 0;
+    m_u32FramesSinceResync = 0;
+    m_qvdSlidingWindowTotal.clear();
+}
+
+void cBandPowerQwtLinePlot::enableSlidingIntegration(bool bEnable, uint32_t u32OutputInterval_nFrames)
+{
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        if(!u32OutputInterval_nFrames)
+            u32OutputInterval_nFrames = 1;
+
+        m_bSlidingIntegration = bEnable;
+        m_u32SlidingOutputInterval_nFrames = u32OutputInterval_nFrames;
+        m_bRestartIntegration = true;
+    }
+
+    sigUpdateScalesAndLabels();
+}
+
+void cBandPowerQwtLinePlot::slotSlidingIntegrationToggled(bool bEnable)
+{
+    QWriteLocker oLock(&m_oMutex);
+
+    m_bSlidingIntegration = bEnable;
+    m_bRestartIntegration = true;
+}
+
+void cBandPowerQwtLinePlot::recomputeTask(cBandRecomputeTask &oTask)
+{
+    computeBandPowers(oTask.m_pEntry->m_qvvdPrefixSums, oTask.m_pEntry->m_u32NBins, oTask.m_pEntry->m_u32Decimation,
+                      *oTask.m_pSettings, oTask.m_qvfBandPowers);
+}
+
+void cBandPowerQwtLinePlot::rebuildFromBandHistory(const cIngestSettings &oSettings)
+{
+    uint32_t u32NPoints = m_qvoBandHistory.size();
+    uint32_t u32NChannels = u32NPoints ? m_qvoBandHistory.first().m_qvvdPrefixSums.size() : 0;
+    uint32_t u32NCurves = u32NChannels * oSettings.m_qvoBands.size();
+
+    //Evaluate the bands for every retained point in parallel
+    QVector<cBandRecomputeTask> qvoTasks(u32NPoints);
+
+    for(uint32_t u32PointNo = 0; u32PointNo < u32NPoints; u32PointNo++)
+    {
+        qvoTasks[u32PointNo].m_pEntry = &m_qvoBandHistory[u32PointNo];
+        qvoTasks[u32PointNo].m_pSettings = &oSettings;
+    }
+
+    QtConcurrent::blockingMap(qvoTasks, &cBandPowerQwtLinePlot::recomputeTask);
+
+    //Replace the plot data. With uniform X sampling the retained history is always the newest part of the X range.
+    if(m_bImplicitX)
+        trimUniformXHistory(u32NPoints);
+    else
+        m_qvdXDataToPlot.resize(u32NPoints);
+
+    //Every buffer is rewritten from its start
+    m_u32HistoryStart = 0;
+
+    m_qvvfYDataToPlot.resize(u32NCurves);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+    {
+        m_qvvfYDataToPlot[u32CurveNo].resize(u32NPoints);
+    }
+
+    for(uint32_t u32PointNo = 0; u32PointNo < u32NPoints; u32PointNo++)
+    {
+        if(!m_bImplicitX)
+            m_qvdXDataToPlot[u32PointNo] = m_qvoBandHistory[u32PointNo].m_dX;
+
+        for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+        {
+            m_qvvfYDataToPlot[u32CurveNo][u32PointNo] = qvoTasks[u32PointNo].m_qvfBandPowers[u32CurveNo];
+        }
+    }
+
+    m_qvvfIntergratedPower.resize(u32NCurves);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < u32NCurves; u32CurveNo++)
+    {
+        m_qvvfIntergratedPower[u32CurveNo].resize(1);
+    }
+
+    //Everything is linear again so redo the log conversion for all points
+    m_dPreviousLogConversionXIndex = -DBL_MAX;
+
+    if(!u32NPoints)
+        return;
+
+    QReadLocker oLock(&m_oMutex);
+
+    if(m_bDoLogConversion)
+        logConversion();
+
+    if(m_bDoPowerLogConversion)
+        powerLogConversion();
+}
+
+void cBandPowerQwtLinePlot::enableRetroactiveBandPower(bool bEnable)
+{
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
+    QWriteLocker oLock(&m_oMutex);
+
+    m_bRetroactiveBandPower = bEnable;
+
+    if(!m_bRetroactiveBandPower)
+        m_qvoBandHistory.clear();
+}
+
+void cBandPowerQwtLinePlot::setBandHistoryDecimation(uint32_t u32Decimation)
+{
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
+    QWriteLocker oLock(&m_oMutex);
+
+    if(!u32Decimation)
+        u32Decimation = 1;
+
+    m_u32BandHistoryDecimation = u32Decimation;
+}
+
+bool cBandPowerQwtLinePlot::snapshotHistory(cHistorySnapshot &oSnapshot)
+{
+    cScrollingQwtLinePlotWidget::snapshotHistory(oSnapshot);
+
+    cBandPowerSnapshotState oState;
+    memset(&oState, 0, sizeof(oState));
+
+    QVector<double> qvdBandEdges;
+
+    {
+        QReadLocker oLock(&m_oMutex);
+
+        for(uint32_t u32BandNo = 0; u32BandNo < (uint32_t)m_qvoBands.size(); u32BandNo++)
+        {
+            qvdBandEdges.push_back(m_qvoBands[u32BandNo].m_dStart);
+            qvdBandEdges.push_back(m_qvoBands[u32BandNo].m_dStop);
+        }
+
+        oState.m_u8SlidingIntegration = m_bSlidingIntegration;
+    }
+
+    oState.m_i64IntegrationStartTime_us = m_i64IntegrationStartTime_us;
+    oState.m_u32NCurves = m_qvvfIntergratedPower.size();
+    oState.m_u32NSlidingWindowFrames = m_u32SlidingWindowNFrames;
+    oState.m_u32FramesSinceOutput = m_u32FramesSinceOutput;
+    oState.m_u32FramesSinceResync = m_u32FramesSinceResync;
+    oState.m_u8NewIntegration = m_bNewIntegration;
+
+    //The sliding window in chronological order
+    QVector<QVector<double> > qvvdSlidingFrames(m_u32SlidingWindowNFrames);
+    QVector<int64_t> qvi64SlidingTimestamps_us(m_u32SlidingWindowNFrames);
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < m_u32SlidingWindowNFrames; u32FrameNo++)
+    {
+        uint32_t u32Index = (m_u32SlidingWindowOldestIndex + u32FrameNo) % m_qvi64SlidingWindowTimestamps_us.size();
+
+        qvvdSlidingFrames[u32FrameNo] = m_qvvdSlidingWindowFrames[u32Index];
+        qvi64SlidingTimestamps_us[u32FrameNo] = m_qvi64SlidingWindowTimestamps_us[u32Index];
+    }
+
+    //The band history flattened. Entries share their prefix sums with the snapshot.
+    QVector<double> qvdHistoryX;
+    QVector<uint32_t> qvu32HistoryNBins;
+    QVector<uint32_t> qvu32HistoryDecimation;
+    QVector<QVector<double> > qvvdHistoryPrefixSums;
+
+    if(m_qvoBandHistory.size())
+        oState.m_u32NBandHistoryChannels = m_qvoBandHistory.first().m_qvvdPrefixSums.size();
+
+    for(uint32_t u32PointNo = 0; u32PointNo < (uint32_t)m_qvoBandHistory.size(); u32PointNo++)
+    {
+        const cBandHistoryEntry &oEntry = m_qvoBandHistory[u32PointNo];
+
+        if((uint32_t)oEntry.m_qvvdPrefixSums.size() != oState.m_u32NBandHistoryChannels)
+        {
+            //Not expected as the history is cleared when the number of channels changes
+            qvdHistoryX.clear();
+            qvu32HistoryNBins.clear();
+            qvu32HistoryDecimation.clear();
+            qvvdHistoryPrefixSums.clear();
+            break;
+        }
+
+        qvdHistoryX.push_back(oEntry.m_dX);
+        qvu32HistoryNBins.push_back(oEntry.m_u32NBins);
+        qvu32HistoryDecimation.push_back(oEntry.m_u32Decimation);
+        qvvdHistoryPrefixSums += oEntry.m_qvvdPrefixSums;
+    }
+
+    oSnapshot.addValue(SNAPSHOT_BAND_POWER_STATE, oState);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_BAND_EDGES, qvdBandEdges);
+    oSnapshot.addRows(SNAPSHOT_BAND_POWER_INTEGRATED_PREFIX_SUMS, m_qvvdIntegratedPrefixSums);
+    oSnapshot.addRows(SNAPSHOT_BAND_POWER_SLIDING_FRAMES, qvvdSlidingFrames);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_SLIDING_TIMESTAMPS, qvi64SlidingTimestamps_us);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_SLIDING_TOTAL, m_qvdSlidingWindowTotal);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_HISTORY_X, qvdHistoryX);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_HISTORY_N_BINS, qvu32HistoryNBins);
+    oSnapshot.addVector(SNAPSHOT_BAND_POWER_HISTORY_DECIMATION, qvu32HistoryDecimation);
+    oSnapshot.addRows(SNAPSHOT_BAND_POWER_HISTORY_PREFIX_SUMS, qvvdHistoryPrefixSums);
+
+    return true;
+}
+
+bool cBandPowerQwtLinePlot::restoreHistorySnapshot(const cHistorySnapshotReader &oReader)
+{
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
 
-            //Integrate
-            for(uint32_t u32Index = u32StartIndex; u32Index <= u32StopIndex && u32Index < (uint32_t)qvvfYData[u32ChannelNo].size(); u32Index++)
+    cBandPowerSnapshotState oState;
+    QVector<double> qvdBandEdges;
+
+    if(!oReader.getValue(SNAPSHOT_BAND_POWER_STATE, oState) || !oReader.getVector(SNAPSHOT_BAND_POWER_BAND_EDGES, qvdBandEdges))
+    {
+        cout << "cBandPowerQwtLinePlot::restoreHistorySnapshot(): Warning: Snapshot is incomplete." << endl;
+        return false;
+    }
+
+    if(!cScrollingQwtLinePlotWidget::restoreHistorySnapshot(oReader))
+        return false;
+
+    m_qvvfIntergratedPower.resize(oState.m_u32NCurves);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < oState.m_u32NCurves; u32CurveNo++)
+    {
+        m_qvvfIntergratedPower[u32CurveNo].resize(1);
+    }
+
+    bool bSameBands;
+    bool bSlidingIntegration;
+    bool bRetroactiveBandPower;
+    uint32_t u32NBands;
+
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        bSameBands = qvdBandEdges.size() == m_qvoBands.size() * 2;
+
+        for(uint32_t u32BandNo = 0; bSameBands && u32BandNo < (uint32_t)m_qvoBands.size(); u32BandNo++)
+        {
+            bSameBands = qvdBandEdges[2 * u32BandNo] == m_qvoBands[u32BandNo].m_dStart && qvdBandEdges[2 * u32BandNo + 1] == m_qvoBands[u32BandNo].m_dStop;
+        }
+
+        //Otherwise the first frame recomputes the trace from the band history or starts afresh
+        if(bSameBands)
+            m_bBandSetChanged = false;
+
+        bSlidingIntegration = m_bSlidingIntegration;
+        bRetroactiveBandPower = m_bRetroactiveBandPower;
+        u32NBands = m_qvoBands.size();
+    }
+
+    //Continue the integration in progress if the mode is unchanged
+    if((bool)oState.m_u8SlidingIntegration == bSlidingIntegration)
+    {
+        if(bSlidingIntegration)
+        {
+            QVector<QVector<double> > qvvdSlidingFrames;
+            QVector<int64_t> qvi64SlidingTimestamps_us;
+            QVector<double> qvdSlidingTotal;
+
+            if(bSameBands && oReader.getRows(SNAPSHOT_BAND_POWER_SLIDING_FRAMES, qvvdSlidingFrames)
+                    && oReader.getVector(SNAPSHOT_BAND_POWER_SLIDING_TIMESTAMPS, qvi64SlidingTimestamps_us)
+                    && oReader.getVector(SNAPSHOT_BAND_POWER_SLIDING_TOTAL, qvdSlidingTotal)
+                    && qvvdSlidingFrames.size() == (int32_t)oState.m_u32NSlidingWindowFrames && qvi64SlidingTimestamps_us.size() == qvvdSlidingFrames.size())
             {
-                m_qvvfIntergratedPower[u32ChannelNo][0] += std::fabs( qvvfYData[u32ChannelNo][u32Index] );
+                m_qvvdSlidingWindowFrames.swap(qvvdSlidingFrames);
+                m_qvi64SlidingWindowTimestamps_us.swap(qvi64SlidingTimestamps_us);
+                m_qvdSlidingWindowTotal.swap(qvdSlidingTotal);
+                m_u32SlidingWindowOldestIndex = 0;
+                m_u32SlidingWindowNFrames = oState.m_u32NSlidingWindowFrames;
+                m_u32FramesSinceOutput = oState.m_u32FramesSinceOutput;
+                m_u32FramesSinceResync = oState.m_u32FramesSinceResync;
+                m_i64IntegrationStartTime_us = oState.m_i64IntegrationStartTime_us;
             }
         }
+        else if(oReader.getRows(SNAPSHOT_BAND_POWER_INTEGRATED_PREFIX_SUMS, m_qvvdIntegratedPrefixSums))
+        {
+            m_i64IntegrationStartTime_us = oState.m_i64IntegrationStartTime_us;
+            m_bNewIntegration = oState.m_u8NewIntegration;
+        }
     }
 
-    if(m_bNewIntegration)
+    //Band history for retroactive band changes
+    QVector<double> qvdHistoryX;
+    QVector<uint32_t> qvu32HistoryNBins;
+    QVector<uint32_t> qvu32HistoryDecimation;
+    QVector<QVector<double> > qvvdHistoryPrefixSums;
+
+    m_qvoBandHistory.clear();
+
+    if(bRetroactiveBandPower && !bSlidingIntegration && oReader.getVector(SNAPSHOT_BAND_POWER_HISTORY_X, qvdHistoryX)
+            && oReader.getVector(SNAPSHOT_BAND_POWER_HISTORY_N_BINS, qvu32HistoryNBins)
+            && oReader.getVector(SNAPSHOT_BAND_POWER_HISTORY_DECIMATION, qvu32HistoryDecimation)
+            && oReader.getRows(SNAPSHOT_BAND_POWER_HISTORY_PREFIX_SUMS, qvvdHistoryPrefixSums)
+            && qvu32HistoryNBins.size() == qvdHistoryX.size() && qvu32HistoryDecimation.size() == qvdHistoryX.size()
+            && (uint64_t)qvvdHistoryPrefixSums.size() == (uint64_t)qvdHistoryX.size() * oState.m_u32NBandHistoryChannels)
     {
-        m_i64IntegrationStartTime_us = i64Timestamp_us;
-        m_bNewIntegration = false;
+        for(uint32_t u32PointNo = 0; u32PointNo < (uint32_t)qvdHistoryX.size(); u32PointNo++)
+        {
+            cBandHistoryEntry oEntry;
+            oEntry.m_dX = qvdHistoryX[u32PointNo];
+            oEntry.m_u32NBins = qvu32HistoryNBins[u32PointNo];
+            oEntry.m_u32Decimation = qvu32HistoryDecimation[u32PointNo];
+            oEntry.m_qvvdPrefixSums = qvvdHistoryPrefixSums.mid(u32PointNo * oState.m_u32NBandHistoryChannels, oState.m_u32NBandHistoryChannels);
+
+            m_qvoBandHistory.enqueue(oEntry);
+        }
+
+        //Snapshots are taken before the scrolled out history is discarded
+        discardScrolledBandHistory();
     }
 
-    //Pass to the underlying plotting code
-    if(i64Timestamp_us - m_i64IntegrationStartTime_us >= m_i64IntegrationTime_us)
+    if(bSameBands && u32NBands)
+        updateBandCurveNames(oState.m_u32NCurves / u32NBands);
+    else if(!bSameBands)
+        cout << "cBandPowerQwtLinePlot::restoreHistorySnapshot(): Bands have changed since the snapshot. The trace will be "
+             << (m_qvoBandHistory.size() ? "recomputed from the band history." : "discarded.") << endl;
+
+    return true;
+}
+
+void cBandPowerQwtLinePlot::slotUpdatePlotData()
+{
+    //The plot data can be rebuilt wholesale so hold it for the duration of the update
+    QMutexLocker oHistoryLock(&m_oBandHistoryMutex);
+
+    cScrollingQwtLinePlotWidget::slotUpdatePlotData();
+}
+
+uint32_t cBandPowerQwtLinePlot::addBand(const QString &qstrName, double dBandStart, double dBandStop)
+{
+    uint32_t u32BandNo;
+
     {
-        //Store the timestamp of the last spectrum frame in a float containing "seconds-elapsed-today" along with the bandpower.
-        //This is the X axis for plotting
+        QWriteLocker oLock(&m_oMutex);
 
-        m_qvfIntergratedPowerTimestamp_s[0] = fmod( (double)i64Timestamp_us / 1e6, 60 * 60 * 24 );
+        //The first user band replaces the default full span band
+        if(m_bIsDefaultBand)
+        {
+            m_qvoBands.clear();
+            m_i32SelectedBandNo = 0;
+            m_bIsDefaultBand = false;
+        }
+
+        cBand oBand;
+        oBand.m_qstrName = qstrName;
+        oBand.m_dStart = qMin(dBandStart, dBandStop);
+        oBand.m_dStop = qMax(dBandStart, dBandStop);
 
-        //Divide by bandwidth
-        //cout << "Selected bandwidth is " << dSelectedBandWidth << " " << m_qstrXUnit.toStdString() << endl;
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfIntergratedPower.size(); u32ChannelNo++)
+        m_qvoBands.push_back(oBand);
+        m_bBandSetChanged = true;
+
+        u32BandNo = m_qvoBands.size() - 1;
+    }
+
+    sigUpdateScalesAndLabels();
+
+    return u32BandNo;
+}
+
+void cBandPowerQwtLinePlot::removeBand(uint32_t u32BandNo)
+{
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        if(u32BandNo >= (uint32_t)m_qvoBands.size())
         {
-            m_qvvfIntergratedPower[u32ChannelNo][0] /= dSelectedBandWidth;
-            //cout << "Channel " << u32ChannelNo << " band power: " << m_qvvfIntergratedPower[u32ChannelNo][0] << endl;
+            cout << "cBandPowerQwtLinePlot::removeBand(): Warning: Band " << u32BandNo << " does not exist. Ignoring." << endl;
+            return;
         }
-        cScrollingQwtLinePlotWidget::addData(m_qvfIntergratedPowerTimestamp_s, m_qvvfIntergratedPower, i64Timestamp_us);
-        m_bNewIntegration = true;
+
+        m_qvoBands.remove(u32BandNo);
+        m_bIsDefaultBand = false;
+        m_bBandSetChanged = true;
+
+        if(m_i32SelectedBandNo >= m_qvoBands.size())
+            m_i32SelectedBandNo = m_qvoBands.size() - 1;
+    }
+
+    sigUpdateScalesAndLabels();
+}
+
+void cBandPowerQwtLinePlot::clearBands()
+{
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        m_qvoBands.clear();
+        m_i32SelectedBandNo = -1;
+        m_bIsDefaultBand = false;
+        m_bBandSetChanged = true;
     }
+
+    sigUpdateScalesAndLabels();
+}
+
+uint32_t cBandPowerQwtLinePlot::getNBands()
+{
+    QReadLocker oLock(&m_oMutex);
+
+    return m_qvoBands.size();
+}
+
+void cBandPowerQwtLinePlot::setChannelNames(const QVector<QString> &qvqstrChannelNames)
+{
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        m_qvqstrChannelNames = qvqstrChannelNames;
+        m_bBandSetChanged = true; //Regenerate curves with the new names
+    }
+
+    sigUpdateScalesAndLabels();
+}
+
+void cBandPowerQwtLinePlot::updateBandCurveNames(uint32_t u32NChannels)
+{
+    QVector<QString> qvqstrCurveNames;
+
+    {
+        QReadLocker oLock(&m_oMutex);
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+        {
+            QString qstrChannelName;
+
+            if(u32ChannelNo < (uint32_t)m_qvqstrChannelNames.size())
+                qstrChannelName = m_qvqstrChannelNames[u32ChannelNo];
+            else
+                qstrChannelName = QString("Channel %1").arg(u32ChannelNo);
+
+            for(uint32_t u32BandNo = 0; u32BandNo < (uint32_t)m_qvoBands.size(); u32BandNo++)
+            {
+                qvqstrCurveNames.push_back(QString("%1 %2").arg(qstrChannelName).arg(m_qvoBands[u32BandNo].m_qstrName));
+            }
+        }
+    }
+
+    setCurveNames(qvqstrCurveNames);
 }
 
 void cBandPowerQwtLinePlot::setSelectableBand(double dBandMinimum, double dBandMaximum, const QString &qstrUnit)
@@ -178,6 +942,12 @@ void cBandPowerQwtLinePlot::setSelectableBand(double dBandMinimum, double dBandM
     m_dBandMaximum = dBandMaximum;
     m_qstrBandUnit = qstrUnit;
 
+    if(m_bIsDefaultBand)
+    {
+        m_qvoBands[0].m_dStart = m_dBandMinimum;
+        m_qvoBands[0].m_dStop = m_dBandMaximum;
+    }
+
     m_oMutex.unlock();
 
     sigUpdateScalesAndLabels();
@@ -215,31 +985,78 @@ void  cBandPowerQwtLinePlot::slotUpdateScalesAndLabels()
     m_pIntegrationTimeSpinBox->setSuffix(m_qstrIntegrationTimeUnit);
     m_pIntegrationTimeSpinBox->setMaximum(m_dMaxIntegrationTime);
 
+    //Refresh the list of bands without triggering selection changes
+    m_oMutex.lockForRead();
+
+    m_pBandSelectComboBox->blockSignals(true);
+    m_pBandSelectComboBox->clear();
+
+    for(uint32_t u32BandNo = 0; u32BandNo < (uint32_t)m_qvoBands.size(); u32BandNo++)
+    {
+        m_pBandSelectComboBox->addItem(m_qvoBands[u32BandNo].m_qstrName);
+    }
+
+    m_pBandSelectComboBox->setCurrentIndex(m_i32SelectedBandNo);
+    m_pBandSelectComboBox->blockSignals(false);
+
+    m_pSlidingIntegrationCheckBox->blockSignals(true);
+    m_pSlidingIntegrationCheckBox->setChecked(m_bSlidingIntegration);
+    m_pSlidingIntegrationCheckBox->blockSignals(false);
+
+    bool bIsDefaultBand = m_bIsDefaultBand;
+    bool bHasSelectedBand = m_i32SelectedBandNo >= 0;
+
+    m_pBandStartDoubleSpinBox->setEnabled(bHasSelectedBand);
+    m_pBandStopDoubleSpinBox->setEnabled(bHasSelectedBand);
+
+    if(bHasSelectedBand && !bIsDefaultBand)
+        slotSetSelectedBand(m_qvoBands[m_i32SelectedBandNo].m_dStart, m_qvoBands[m_i32SelectedBandNo].m_dStop);
+
+    m_oMutex.unlock();
+
     //Note: outside mutex to prevent recursive lock.
-    //This is just a convenient initial state of setting initial selected band to maximum span so not functionaly critical.
-    m_pBandStartDoubleSpinBox->setValue(m_dBandMinimum);
-    m_pBandStopDoubleSpinBox->setValue(m_dBandMaximum);
+    //This is just a convenient initial state of setting the default band to maximum span so not functionaly critical.
+    if(bIsDefaultBand)
+    {
+        m_pBandStartDoubleSpinBox->setValue(m_dBandMinimum);
+        m_pBandStopDoubleSpinBox->setValue(m_dBandMaximum);
+    }
 }
 
 void cBandPowerQwtLinePlot::slotBandStartChanged(double dBandStart)
 {
     m_oMutex.lockForWrite();
 
-    m_dSelectedBandStart = dBandStart;
+    if(m_i32SelectedBandNo < 0)
+    {
+        m_oMutex.unlock();
+        return;
+    }
+
+    cBand &oBand = m_qvoBands[m_i32SelectedBandNo];
+
+    oBand.m_dStart = dBandStart;
 
-    if(m_dSelectedBandStart > m_dSelectedBandStop)
+    if(oBand.m_dStart > oBand.m_dStop)
     {
-        m_dSelectedBandStop = m_dSelectedBandStart;
-        slotSetSelectedBandStop(m_dSelectedBandStop); //Update spin box
+        oBand.m_dStop = oBand.m_dStart;
+        slotSetSelectedBandStop(oBand.m_dStop); //Update spin box
     }
 
+    double dSelectedBandStart = oBand.m_dStart;
+    double dSelectedBandStop = oBand.m_dStop;
+
+    //Frames already integrated used the old band. The ingest thread redraws the existing trace with the new band.
+    m_bRestartIntegration = true;
+    m_bRecomputeBandHistory = true;
+
     m_oMutex.unlock();
 
-    sigSelectedBandChanged(m_dSelectedBandStart, m_dSelectedBandStop);
+    sigSelectedBandChanged(dSelectedBandStart, dSelectedBandStop);
 
     QVector<double> qvdBandSelection;
-    qvdBandSelection.push_back(m_dSelectedBandStart);
-    qvdBandSelection.push_back(m_dSelectedBandStop);
+    qvdBandSelection.push_back(dSelectedBandStart);
+    qvdBandSelection.push_back(dSelectedBandStop);
 
     sigSelectedBandChanged(qvdBandSelection);
 }
@@ -248,21 +1065,65 @@ void cBandPowerQwtLinePlot::slotBandStopChanged(double dBandStop)
 {
     m_oMutex.lockForWrite();
 
-    m_dSelectedBandStop = dBandStop;
+    if(m_i32SelectedBandNo < 0)
+    {
+        m_oMutex.unlock();
+        return;
+    }
+
+    cBand &oBand = m_qvoBands[m_i32SelectedBandNo];
 
-    if(m_dSelectedBandStart > m_dSelectedBandStop)
+    oBand.m_dStop = dBandStop;
+
+    if(oBand.m_dStart > oBand.m_dStop)
     {
-        m_dSelectedBandStart = m_dSelectedBandStop;
-        slotSetSelectedBandStart(m_dSelectedBandStop); //Update spin box
+        oBand.m_dStart = oBand.m_dStop;
+        slotSetSelectedBandStart(oBand.m_dStop); //Update spin box
     }
 
+    double dSelectedBandStart = oBand.m_dStart;
+    double dSelectedBandStop = oBand.m_dStop;
+
+    //Frames already integrated used the old band. The ingest thread redraws the existing trace with the new band.
+    m_bRestartIntegration = true;
+    m_bRecomputeBandHistory = true;
+
     m_oMutex.unlock();
 
-    sigSelectedBandChanged(m_dSelectedBandStart, m_dSelectedBandStop);
+    sigSelectedBandChanged(dSelectedBandStart, dSelectedBandStop);
+
+    QVector<double> qvdBandSelection;
+    qvdBandSelection.push_back(dSelectedBandStart);
+    qvdBandSelection.push_back(dSelectedBandStop);
+
+    sigSelectedBandChanged(qvdBandSelection);
+}
+
+void cBandPowerQwtLinePlot::slotSelectedBandNoChanged(int iBandNo)
+{
+    m_oMutex.lockForWrite();
+
+    if(iBandNo < 0 || iBandNo >= m_qvoBands.size())
+    {
+        m_oMutex.unlock();
+        return;
+    }
+
+    m_i32SelectedBandNo = iBandNo;
+
+    double dSelectedBandStart = m_qvoBands[m_i32SelectedBandNo].m_dStart;
+    double dSelectedBandStop = m_qvoBands[m_i32SelectedBandNo].m_dStop;
+
+    m_oMutex.unlock();
+
+    //Show the newly selected band in the spin boxes
+    slotSetSelectedBand(dSelectedBandStart, dSelectedBandStop);
+
+    sigSelectedBandChanged(dSelectedBandStart, dSelectedBandStop);
 
     QVector<double> qvdBandSelection;
-    qvdBandSelection.push_back(m_dSelectedBandStart);
-    qvdBandSelection.push_back(m_dSelectedBandStop);
+    qvdBandSelection.push_back(dSelectedBandStart);
+    qvdBandSelection.push_back(dSelectedBandStop);
 
     sigSelectedBandChanged(qvdBandSelection);
 }
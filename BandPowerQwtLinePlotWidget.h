@@ -1,5 +1,7 @@
-//A specific implementation of the scrolling line plot that is used for plotting power over a selected band.
+//A specific implementation of the scrolling line plot that is used for plotting power over a set of named bands.
 //This will normally be paired with an framed line plot of an FFT.
+//Each incoming frame is converted once per channel to a prefix sum of |x| so that any number of bands costs O(1) each.
+//Curves are ordered channel major, i.e. curve index = channel * number of bands + band.
 
 #ifndef BAND_POWER_QWT_LINE_PLOT_WIDGET_H
 #define BAND_POWER_QWT_LINE_PLOT_WIDGET_H
@@ -23,10 +25,15 @@ typedef unsigned __int64 uint64_t;
 //Library includes
 #include <QSpinBox>
 #include <QLabel>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QMutex>
+#include <QQueue>
 
 //Local includes
 #include "ScrollingQwtLinePlotWidget.h"
 #include "WallTimeQwtScaleDraw.h"
+#include "BandIntegrationStage.h"
 
 class cBandPowerQwtLinePlot: public cScrollingQwtLinePlotWidget
 {
@@ -40,11 +47,103 @@ public:
     //Add data should take an array containing the full selectable band as specified by the function below
     virtual void                        addData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
 
+    //Zero copy ingest from a contiguous block or shared frame (see PlotFrame.h)
+    void                                addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Every frame is integrated. The resulting points are appended to the plot in one go.
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
     void                                setSelectableBand(double dBandMinimum, double dBandMaximum, const QString &qstrUnit);
     void                                setIntegrationTimeControlScalingFactor(double dScalingFactor_s, const QString &qstrNewUnit, double dMaxSpinBoxValue);
 
+    //Band management. Initially there is a single band spanning the full selectable band which is replaced by the first call to addBand().
+    //Changing the set of bands changes the number of curves and therefore resets the plot history.
+    uint32_t                            addBand(const QString &qstrName, double dBandStart, double dBandStop);
+    void                                removeBand(uint32_t u32BandNo);
+    void                                clearBands();
+    uint32_t                            getNBands();
+
+    //Used with band names to generate the curve names
+    void                                setChannelNames(const QVector<QString> &qvqstrChannelNames);
+
+    //When enabled the integrated prefix sum spectra of every point in the plot are retained so that a change of bands
+    //recomputes the entire trace on the next frame. Prefix sums can be decimated by an integer factor to save memory in which case band
+    //edges are rounded to the nearest multiple of the factor for historic points.
+    void                                enableRetroactiveBandPower(bool bEnable);
+    void                                setBandHistoryDecimation(uint32_t u32Decimation);
+
+    //In sliding mode a point is output every u32OutputInterval_nFrames frames, each covering the preceding integration time.
+    //The default tumbling mode outputs one point per integration time. Retroactive band changes are only available in tumbling mode.
+    void                                enableSlidingIntegration(bool bEnable, uint32_t u32OutputInterval_nFrames = 1);
+
 protected:
+    struct cBand
+    {
+        QString                         m_qstrName;
+        double                          m_dStart;
+        double                          m_dStop;
+    };
+
+    //Integrated prefix sums of a single plotted point
+    struct cBandHistoryEntry
+    {
+        double                          m_dX;
+        uint32_t                        m_u32NBins;
+        uint32_t                        m_u32Decimation;
+        QVector<QVector<double> >       m_qvvdPrefixSums; //Per channel, entries at bins 0, D, 2D, ... and finally N
+    };
+
+    //Copy of the GUI controlled settings taken once per addData call
+    struct cIngestSettings
+    {
+        QVector<cBand>                  m_qvoBands;
+        double                          m_dBandMinimum;
+        double                          m_dBandMaximum;
+        bool                            m_bBandSetChanged;
+        bool                            m_bRecomputeBandHistory;
+        bool                            m_bRetroactiveBandPower;
+        uint32_t                        m_u32BandHistoryDecimation;
+        bool                            m_bSlidingIntegration;
+        uint32_t                        m_u32SlidingOutputInterval_nFrames;
+        bool                            m_bRestartIntegration;
+    };
+
+    //Work item for the parallel recompute. The settings are the ingest thread's copy so the workers never touch the widget.
+    struct cBandRecomputeTask
+    {
+        const cBandHistoryEntry         *m_pEntry;
+        const cIngestSettings           *m_pSettings;
+        QVector<float>                  m_qvfBandPowers;
+    };
+
+    //History snapshot sections (see HistorySnapshot.h) in addition to those of the scrolling plot
+    static const uint32_t               SNAPSHOT_BAND_POWER_STATE = 0x200;
+    static const uint32_t               SNAPSHOT_BAND_POWER_BAND_EDGES = 0x201;             //Start and stop of each band
+    static const uint32_t               SNAPSHOT_BAND_POWER_INTEGRATED_PREFIX_SUMS = 0x202;
+    static const uint32_t               SNAPSHOT_BAND_POWER_SLIDING_FRAMES = 0x203;         //Oldest first
+    static const uint32_t               SNAPSHOT_BAND_POWER_SLIDING_TIMESTAMPS = 0x204;
+    static const uint32_t               SNAPSHOT_BAND_POWER_SLIDING_TOTAL = 0x205;
+    static const uint32_t               SNAPSHOT_BAND_POWER_HISTORY_X = 0x206;
+    static const uint32_t               SNAPSHOT_BAND_POWER_HISTORY_N_BINS = 0x207;
+    static const uint32_t               SNAPSHOT_BAND_POWER_HISTORY_DECIMATION = 0x208;
+    static const uint32_t               SNAPSHOT_BAND_POWER_HISTORY_PREFIX_SUMS = 0x209;   //Point major, then channel
+
+    struct cBandPowerSnapshotState
+    {
+        int64_t                         m_i64IntegrationStartTime_us;
+        uint32_t                        m_u32NCurves;
+        uint32_t                        m_u32NSlidingWindowFrames;
+        uint32_t                        m_u32FramesSinceOutput;
+        uint32_t                        m_u32FramesSinceResync;
+        uint32_t                        m_u32NBandHistoryChannels;
+        uint8_t                         m_u8NewIntegration;
+        uint8_t                         m_u8SlidingIntegration;
+        uint8_t                         m_au8Padding[2];
+    };
+
     //GUI Widgets
+    QLabel                              *m_pBandSelectLabel;
+    QComboBox                           *m_pBandSelectComboBox;
     QLabel                              *m_pBandStartLabel;
     QLabel                              *m_pBandStopLabel;
     QLabel                              *m_pIntegrationTimeLabel;
@@ -52,6 +151,7 @@ protected:
     QDoubleSpinBox                      *m_pBandStartDoubleSpinBox;
     QDoubleSpinBox                      *m_pBandStopDoubleSpinBox;
     QDoubleSpinBox                      *m_pIntegrationTimeSpinBox;
+    QCheckBox                           *m_pSlidingIntegrationCheckBox;
 
     //Custom Scale drawer
     cWallTimeQwtScaleDraw               *m_pTimeScaleDraw;
@@ -64,9 +164,24 @@ protected:
     double                              m_dMaxIntegrationTime;
     QString                             m_qstrIntegrationTimeUnit;
 
+    //Bands
+    QVector<cBand>                      m_qvoBands;
+    int32_t                             m_i32SelectedBandNo; //Band edited by the start and stop spin boxes
+    bool                                m_bIsDefaultBand;
+    bool                                m_bBandSetChanged; //History is reset by the ingest thread on the next frame
+    bool                                m_bRecomputeBandHistory; //Band edges edited. The ingest thread recomputes the trace on the next frame.
+    QVector<QString>                    m_qvqstrChannelNames;
+
     //Run time values
-    double                              m_dSelectedBandStart;
-    double                              m_dSelectedBandStop;
+    QVector<QVector<double> >          m_qvvdPrefixSums; //Per channel, N + 1 entries with a leading 0
+    QVector<QVector<double> >          m_qvvdIntegratedPrefixSums; //Sum of the above over the current integration
+
+    //Band history for retroactive recomputation. Aligned with the plotted X data.
+    //Only the ingest thread rebuilds the trace from it. Held along with the plot data for the whole of the ingest.
+    QMutex                             m_oBandHistoryMutex;
+    QQueue<cBandHistoryEntry>          m_qvoBandHistory;
+    bool                               m_bRetroactiveBandPower;
+    uint32_t                           m_u32BandHistoryDecimation;
 
     QVector<QVector<float> >           m_qvvfIntergratedPower;
     QVector<float>                     m_qvfIntergratedPowerTimestamp_s;
@@ -74,14 +189,61 @@ protected:
     int64_t                            m_i64IntegrationStartTime_us;
     int64_t                            m_i64IntegrationTime_us;
     bool                               m_bNewIntegration;
+    bool                               m_bRestartIntegration; //Set by the GUI when the bands or mode change. Cleared by the ingest thread.
+
+    //Sliding integration. Per frame band powers are kept in a circular buffer along with a running total.
+    bool                               m_bSlidingIntegration;
+    uint32_t                           m_u32SlidingOutputInterval_nFrames;
+    QVector<QVector<double> >          m_qvvdSlidingWindowFrames; //Per slot, per curve
+    QVector<int64_t>                   m_qvi64SlidingWindowTimestamps_us;
+    uint32_t                           m_u32SlidingWindowOldestIndex;
+    uint32_t                           m_u32SlidingWindowNFrames;
+    QVector<double>                    m_qvdSlidingWindowTotal;
+    uint32_t                           m_u32FramesSinceOutput;
+    uint32_t                           m_u32FramesSinceResync;
+
+    //Output points of a batch, point-major. Reused between batches.
+    QVector<float>                     m_qvfBatchX;
+    QVector<float>                     m_qvfBatchY;
+    QVector<int64_t>                   m_qvi64BatchTimestamps_us;
+
+    //addData() in parts. prepareCurves() and integrateFrame() require m_oBandHistoryMutex.
+    //integrateFrame() returns true if an output point is ready in m_qvfIntergratedPowerTimestamp_s and m_qvvfIntergratedPower.
+    void                               takeIngestSettings(cIngestSettings &oSettings);
+    void                               prepareCurves(uint32_t u32NChannels, const cIngestSettings &oSettings);
+    bool                               integrateFrame(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList,
+                                                      const cIngestSettings &oSettings);
+    void                               discardScrolledBandHistory();
+
+    void                               resetSlidingWindow();
+    bool                               integrateSliding(const cIngestSettings &oSettings, uint32_t u32NBins, int64_t i64Timestamp_us);
+
+    void                               updateBandCurveNames(uint32_t u32NChannels);
+
+    //Band powers for all channels (channel major) divided by bandwidth (see cBandIntegrationStage::computeBandPowers())
+    static void                        computeBandPowers(const QVector<QVector<double> > &qvvdPrefixSums, uint32_t u32NBins, uint32_t u32Decimation,
+                                                         const cIngestSettings &oSettings, QVector<float> &qvfBandPowers);
+
+    //Rebuilds the plot data from the band history. Ingest thread only. Requires m_oBandHistoryMutex.
+    void                               rebuildFromBandHistory(const cIngestSettings &oSettings);
+
+    static void                        recomputeTask(cBandRecomputeTask &oTask);
+
+    //The scrolling history plus the integration state and band history. Snapshots are taken during ingest with m_oBandHistoryMutex held.
+    //If the bands have changed since the snapshot the trace is recomputed from the band history when available and otherwise discarded.
+    virtual bool                       snapshotHistory(cHistorySnapshot &oSnapshot);
+    virtual bool                       restoreHistorySnapshot(const cHistorySnapshotReader &oReader);
 
 protected slots:
+    virtual void                        slotUpdatePlotData();
     virtual void                        slotUpdateScalesAndLabels();
 
     void                                slotBandStartChanged(double dBandStart);
     void                                slotBandStopChanged(double dBandStop);
+    void                                slotSelectedBandNoChanged(int iBandNo);
 
     void                                slotIntegrationTimeChanged(double dIntegrationTime);
+    void                                slotSlidingIntegrationToggled(bool bEnable);
 
 public slots:
     //These change only the spin box value and do not emit subsequent signals
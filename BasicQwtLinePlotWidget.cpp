@@ -9,6 +9,7 @@
 #include <QPrintDialog>
 #include <QDebug>
 #include <QPalette>
+#include <QMutexLocker>
 #include <qwt_scale_engine.h>
 #include <qwt_scale_widget.h>
 #include <qwt_legend.h>
@@ -29,6 +30,12 @@ using namespace std;
 
 cBasicQwtLinePlotWidget::cBasicQwtLinePlotWidget(QWidget *pParent) :
     cQwtPlotWidgetBase(pParent),
+    m_bXIsMonotonic(false),
+    m_bImplicitX(false),
+    m_dImplicitXStart(0.0),
+    m_dImplicitXStep(1.0),
+    m_u32NImplicitXSamples(0),
+    m_u32HistoryStart(0),
     m_bIsGridShown(true),
     m_bShowVerticalLines(true)
 {
@@ -89,19 +96,76 @@ cBasicQwtLinePlotWidget::~cBasicQwtLinePlotWidget()
 }
 
 void cBasicQwtLinePlotWidget::addData(const QVector<float> &qvfXData, const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    addData(qvfXData.constData(), qvfXData.size(), cPlotFrameView(qvvfYData), i64Timestamp_us, qvu32ChannelList);
+}
+
+void cBasicQwtLinePlotWidget::addData(const QVector<float> &qvfXData, const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    addData(qvfXData.constData(), qvfXData.size(), oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cBasicQwtLinePlotWidget::addData(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData)
+        return;
+
+    recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    ingestData(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cBasicQwtLinePlotWidget::ingestData(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
 {
     //Safety flag which can be set by other threads if data is known not to be interpretable
     if(m_bRejectData)
         return;
 
     //Update X data
-    processXData(qvfXData, i64Timestamp_us);
+    processXData(pfXData, u32NXSamples, i64Timestamp_us);
 
     //Update Y data
-    processYData(qvvfYData, i64Timestamp_us, qvu32ChannelList);
+    processYData(oYData, i64Timestamp_us, qvu32ChannelList);
+
+    plotProcessedData(i64Timestamp_us);
+}
+
+void cBasicQwtLinePlotWidget::addData(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData)
+        return;
+
+    recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    //Update X data
+    processXData(pfXData, u32NXSamples, i64Timestamp_us);
+
+    //Update Y data
+    bool bLogConversionDone = processRawYData(oYData, i64Timestamp_us, qvu32ChannelList);
+
+    plotProcessedData(i64Timestamp_us, bLogConversionDone);
+}
+
+void cBasicQwtLinePlotWidget::addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !oBatch.getNFrames())
+        return;
+
+    recordBatch(oBatch, qvu32ChannelList);
+
+    uint32_t u32NewestFrameNo = oBatch.getNFrames() - 1;
+
+    ingestData(oBatch.getXData(u32NewestFrameNo), oBatch.getNXSamples(u32NewestFrameNo), oBatch.getFrame(u32NewestFrameNo),
+               oBatch.getTimestamp_us(u32NewestFrameNo), qvu32ChannelList);
+}
 
+void cBasicQwtLinePlotWidget::plotProcessedData(int64_t i64Timestamp_us, bool bLogConversionDone)
+{
     //Check if number of points to plot is 2 a power of 2 and set the X ticks to base 2 if so
-    autoUpdateXScaleBase( m_qvdXDataToPlot.size() );
+    autoUpdateXScaleBase( getNXSamples() );
 
     m_i64PlotTimestamp_us = i64Timestamp_us;
 
@@ -109,12 +173,12 @@ void cBasicQwtLinePlotWidget::addData(const QVector<float> &qvfXData, const QVec
 
     m_oMutex.lockForRead(); //Ensure the 2 bool flags don't change during these operations
 
-    if(m_bDoLogConversion)
+    if(m_bDoLogConversion && !bLogConversionDone)
     {
         logConversion();
     }
 
-    if(m_bDoPowerLogConversion)
+    if(m_bDoPowerLogConversion && !bLogConversionDone)
     {
         powerLogConversion();
     }
@@ -129,9 +193,79 @@ void cBasicQwtLinePlotWidget::addData(const QVector<float> &qvfXData, const QVec
     }
 
     m_oMutex.unlock();
+
+    checkpointHistoryIfDue();
+}
+
+bool cBasicQwtLinePlotWidget::snapshotData(cPlotDataExport &oExport)
+{
+    return snapshotCurves(oExport, m_qvvfYDataToPlot);
+}
+
+bool cBasicQwtLinePlotWidget::snapshotCurves(cPlotDataExport &oExport, const QVector<QVector<float> > &qvvfYData)
+{
+    addExportAttributes(oExport);
+
+    //Shallow copies. The buffers are only copied if ingest modifies them before the export is written.
+    if(m_bImplicitX)
+        oExport.addImplicitVector(QString("x"), m_dImplicitXStart, m_dImplicitXStep, m_u32NImplicitXSamples);
+    else
+        oExport.addVector(QString("x"), m_qvdXDataToPlot);
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)qvvfYData.size(); u32CurveNo++)
+    {
+        if(u32CurveNo < (uint32_t)m_qvqstrCurveNames.size())
+            oExport.addVector(m_qvqstrCurveNames[u32CurveNo], qvvfYData[u32CurveNo]);
+        else
+            oExport.addVector(QString("Channel %1").arg(u32CurveNo), qvvfYData[u32CurveNo]);
+    }
+
+    return true;
+}
+
+bool cBasicQwtLinePlotWidget::snapshotDisplayedData(cPlotDataExport &oExport)
+{
+    if(m_qvpPlotCurves.isEmpty())
+        return false;
+
+    const cFloatQwtSeriesData *pFirstCurve = dynamic_cast<const cFloatQwtSeriesData*>(m_qvpPlotCurves[0]->data());
+
+    if(!pFirstCurve)
+        return false;
+
+    addExportAttributes(oExport);
+
+    //All curves share the X data of the frame
+    if(pFirstCurve->isXImplicit())
+        oExport.addImplicitVector(QString("x"), pFirstCurve->getXStart(), pFirstCurve->getXStep(), pFirstCurve->getYData().size());
+    else
+        oExport.addVector(QString("x"), pFirstCurve->getXData());
+
+    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)m_qvpPlotCurves.size(); u32CurveNo++)
+    {
+        const cFloatQwtSeriesData *pCurve = dynamic_cast<const cFloatQwtSeriesData*>(m_qvpPlotCurves[u32CurveNo]->data());
+
+        if(pCurve)
+            oExport.addVector(m_qvpPlotCurves[u32CurveNo]->title().text(), pCurve->getYData());
+    }
+
+    return true;
+}
+
+void cBasicQwtLinePlotWidget::addExportAttributes(cPlotDataExport &oExport)
+{
+    oExport.addAttribute(QString("x_label"), m_qstrXLabel);
+    oExport.addAttribute(QString("x_unit"), m_qstrXUnit);
+    oExport.addAttribute(QString("y_label"), m_qstrYLabel);
+    oExport.addAttribute(QString("y_unit"), m_qstrYUnit);
+    oExport.addAttribute(QString("timestamp_us"), QString::number((qlonglong)m_i64PlotTimestamp_us));
+
+    m_oMutex.lockForRead();
+    oExport.addAttribute(QString("log_conversion"), QString(m_bDoLogConversion ? "10log10" : (m_bDoPowerLogConversion ? "20log10" : "none")));
+    m_oMutex.unlock();
 }
 
-void cBasicQwtLinePlotWidget::processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us)
+void cBasicQwtLinePlotWidget::processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us)
 {
     //This function populates the m_qvdXDataToPlot vector
     //In this basic implementation the input data is simply copied to the output array
@@ -139,75 +273,154 @@ void cBasicQwtLinePlotWidget::processXData(const QVector<float> &qvfXData, int64
 
     Q_UNUSED(i64Timestamp_us);
 
+    m_bImplicitX = false;
+
     //Update number of samples in each channel
-    m_qvdXDataToPlot.resize(qvfXData.size());
+    m_qvdXDataToPlot.resize(u32NSamples);
 
     //Copy the input data to plot array
-    for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvfXData.size(); u32SampleNo++)
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
     {
-        m_qvdXDataToPlot[u32SampleNo] = qvfXData[u32SampleNo];
+        m_qvdXDataToPlot[u32SampleNo] = pfXData[u32SampleNo];
     }
 
     cout << "cBasicQwtLinePlotWidget::processXData(): m_qvdXDataToPlot is  " << m_qvdXDataToPlot.size() << " samples long." << endl;
 }
 
+void cBasicQwtLinePlotWidget::setImplicitXData(double dXStart, double dXStep, uint32_t u32NSamples)
+{
+    m_bImplicitX = true;
+    m_dImplicitXStart = dXStart;
+    m_dImplicitXStep = dXStep;
+    m_u32NImplicitXSamples = u32NSamples;
+
+    //Release any explicit X storage
+    if(!m_qvdXDataToPlot.isEmpty())
+        m_qvdXDataToPlot = QVector<double>();
+}
+
+uint32_t cBasicQwtLinePlotWidget::getNXSamples() const
+{
+    if(m_bImplicitX)
+        return m_u32NImplicitXSamples;
+
+    return m_qvdXDataToPlot.size() - m_u32HistoryStart;
+}
+
+double cBasicQwtLinePlotWidget::getXSample(uint32_t u32SampleNo) const
+{
+    if(m_bImplicitX)
+        return m_dImplicitXStart + u32SampleNo * m_dImplicitXStep;
+
+    return m_qvdXDataToPlot[m_u32HistoryStart + u32SampleNo];
+}
 
-void cBasicQwtLinePlotWidget::processYData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+cFloatQwtSeriesData* cBasicQwtLinePlotWidget::createSeriesData(uint32_t u32CurveNo) const
 {
-    //This function populates the m_qvvdYDataToPlot vector
+    if(m_bImplicitX)
+        return new cFloatQwtSeriesData(m_dImplicitXStart, m_dImplicitXStep, m_qvvfYDataToPlot[u32CurveNo], m_u32HistoryStart);
+
+    return new cFloatQwtSeriesData(m_qvdXDataToPlot, m_qvvfYDataToPlot[u32CurveNo], m_bXIsMonotonic, m_u32HistoryStart);
+}
+
+
+void cBasicQwtLinePlotWidget::processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //This function populates the m_qvvfYDataToPlot vector
     //In this basic implementation the input data is simply copied to the output array
     //In derived versions of the class this function should be overloaded
 
     Q_UNUSED(i64Timestamp_us);
 
+    //If there is no channel list use all channels in the input frame. Otherwise use those specified in the list
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+
     //Check that our output array has the right number of channels
-    if(m_qvvdYDataToPlot.size() != qvvfYData.size())
+    if((uint32_t)m_qvvfYDataToPlot.size() != u32NChannels)
     {
-        m_qvvdYDataToPlot.resize(qvvfYData.size());
+        m_qvvfYDataToPlot.resize(u32NChannels);
     }
 
-    //If there is no channel list use all channels in the input vector
     if(qvu32ChannelList.empty())
+        copyYData(oYData, cIdentityChannelSelection(), u32NChannels);
+    else
+        copyYData(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels);
+}
+
+template<typename tChannelSelection>
+void cBasicQwtLinePlotWidget::copyYData(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
     {
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfYData.size(); u32ChannelNo++)
-        {
-            //Update number of samples in each channel
-            m_qvvdYDataToPlot[u32ChannelNo].resize(qvvfYData[u32ChannelNo].size());
+        uint32_t u32InputChannelNo = oSelection.getInputChannelNo(u32ChannelNo);
+        uint32_t u32NSamples = oYData.getNBins(u32InputChannelNo);
 
-            //Copy the input data to plot array
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvvfYData[u32ChannelNo].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = qvvfYData[u32ChannelNo][u32SampleNo];
-            }
-        }
+        //Update number of samples in each channel
+        m_qvvfYDataToPlot[u32ChannelNo].resize(u32NSamples);
+
+        //Copy the input data to plot array
+        cPlotKernels::apply<cCopyOperation>(oYData.getChannel(u32InputChannelNo), m_qvvfYDataToPlot[u32ChannelNo].data(), u32NSamples);
     }
-    else //Otherwise use those specified in the list
+}
+
+bool cBasicQwtLinePlotWidget::processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    Q_UNUSED(i64Timestamp_us);
+
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+
+    if((uint32_t)m_qvvfYDataToPlot.size() != u32NChannels)
     {
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvu32ChannelList.size(); u32ChannelNo++)
-        {
-            //Update number of samples in each channel
-            m_qvvdYDataToPlot[u32ChannelNo].resize(qvvfYData[qvu32ChannelList[u32ChannelNo]].size());
+        m_qvvfYDataToPlot.resize(u32NChannels);
+    }
 
-            //Copy the input data to plot array
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvvfYData[qvu32ChannelList[u32ChannelNo]].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = qvvfYData[qvu32ChannelList[u32ChannelNo]][u32SampleNo];
-            }
-        }
+    //Convert straight into the plot arrays, applying the log conversion in the same pass
+    float fDecibelFactor = getFusedDecibelFactor();
+
+    if(qvu32ChannelList.empty())
+        convertRawYData(oYData, cIdentityChannelSelection(), u32NChannels, fDecibelFactor);
+    else
+        convertRawYData(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels, fDecibelFactor);
+
+    return fDecibelFactor != 0.0f;
+}
+
+template<typename tChannelSelection>
+void cBasicQwtLinePlotWidget::convertRawYData(const cRawPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels, float fDecibelFactor)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        m_qvvfYDataToPlot[u32ChannelNo].resize(oYData.getNBins());
+
+        if(fDecibelFactor != 0.0f)
+            oYData.convertChannelToDecibels(oSelection.getInputChannelNo(u32ChannelNo), m_qvvfYDataToPlot[u32ChannelNo].data(), fDecibelFactor);
+        else
+            oYData.convertChannel(oSelection.getInputChannelNo(u32ChannelNo), m_qvvfYDataToPlot[u32ChannelNo].data());
     }
 }
 
+float cBasicQwtLinePlotWidget::getFusedDecibelFactor()
+{
+    QReadLocker oLock(&m_oMutex);
+
+    //If both conversions are (oddly) enabled leave them to the separate passes
+    if(m_bDoLogConversion && !m_bDoPowerLogConversion)
+        return 10.0f;
+
+    if(m_bDoPowerLogConversion && !m_bDoLogConversion)
+        return 20.0f;
+
+    return 0.0f;
+}
+
 void cBasicQwtLinePlotWidget::logConversion()
 {
     //Assumes input values are already in power domain
     //Simply do 10log10( )  for all values to get dB
 
-    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvfYDataToPlot.size(); u32ChannelNo++)
     {
-        for(uint32_t u32SampleNo = 0; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-        {
-            m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 10 * log10(m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] + 0.001);
-        }
+        cPlotKernels::toDecibels(m_qvvfYDataToPlot[u32ChannelNo].data(), m_qvvfYDataToPlot[u32ChannelNo].data(), m_qvvfYDataToPlot[u32ChannelNo].size(), 10.0);
     }
 }
 
@@ -216,12 +429,9 @@ void cBasicQwtLinePlotWidget::powerLogConversion()
     //Assumes input values are in voltage domain
     //Simply do 10log10( )  for all values to get dB
 
-    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvfYDataToPlot.size(); u32ChannelNo++)
     {
-        for(uint32_t u32SampleNo = 0; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-        {
-            m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 20 * log10(m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo]  + 0.001);
-        }
+        cPlotKernels::toDecibels(m_qvvfYDataToPlot[u32ChannelNo].data(), m_qvvfYDataToPlot[u32ChannelNo].data(), m_qvvfYDataToPlot[u32ChannelNo].size(), 20.0);
     }
 }
 
@@ -353,7 +563,7 @@ void cBasicQwtLinePlotWidget::slotUpdatePlotData()
     //Check that the curves match the source data
     updateCurves();
 
-    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)m_qvvdYDataToPlot.size(); u32CurveNo++)
+    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)m_qvvfYDataToPlot.size(); u32CurveNo++)
     {
 
         if(u32CurveNo >= (unsigned int)m_qvpPlotCurves.size())
@@ -364,15 +574,18 @@ void cBasicQwtLinePlotWidget::slotUpdatePlotData()
             continue;
         }
 
-        m_qvpPlotCurves[u32CurveNo]->setSamples(m_qvdXDataToPlot, m_qvvdYDataToPlot[u32CurveNo]);
+        //The curve takes ownership of the adapter, which shares the plot vectors. The next frame written to them detaches (copies)
+        //the vectors still shared with the adapter.
+        m_qvpPlotCurves[u32CurveNo]->setData(createSeriesData(u32CurveNo));
     }
 
     //Update horizontal scale
+    uint32_t u32NXSamples = getNXSamples();
     QRectF oRect = m_pPlotZoomer->zoomBase();
-    if(oRect.left() != m_qvdXDataToPlot.first() || oRect.right() != m_qvdXDataToPlot.last() )
+    if( u32NXSamples && (oRect.left() != getXSample(0) || oRect.right() != getXSample(u32NXSamples - 1)) )
     {
-        oRect.setLeft(m_qvdXDataToPlot.first() );
-        oRect.setRight(m_qvdXDataToPlot.last() );
+        oRect.setLeft(getXSample(0) );
+        oRect.setRight(getXSample(u32NXSamples - 1) );
 
         m_pPlotZoomer->setZoomBase(oRect);
         m_pPlotZoomer->zoom(oRect);
@@ -423,9 +636,9 @@ void  cBasicQwtLinePlotWidget::showCurve(QwtPlotItem *pItem, bool bShow)
 void cBasicQwtLinePlotWidget::updateCurves()
 {
     //Make sure that there is a curve for each channel
-    if(m_qvpPlotCurves.size() != m_qvvdYDataToPlot.size())
+    if(m_qvpPlotCurves.size() != m_qvvfYDataToPlot.size())
     {
-        cout << "cBasicQwtLinePlotWidget::slotUpdateCurves() Updating to " << m_qvvdYDataToPlot.size() << " plot curves for plot " << m_qstrTitle.toStdString() << endl;
+        cout << "cBasicQwtLinePlotWidget::slotUpdateCurves() Updating to " << m_qvvfYDataToPlot.size() << " plot curves for plot " << m_qstrTitle.toStdString() << endl;
 
         //If not, delete existing curves
         for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvpPlotCurves.size(); u32ChannelNo++)
@@ -435,7 +648,7 @@ void cBasicQwtLinePlotWidget::updateCurves()
         m_qvpPlotCurves.clear();
 
         //Create new curves
-        for(unsigned int u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+        for(unsigned int u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvfYDataToPlot.size(); u32ChannelNo++)
         {
             if(u32ChannelNo < (uint32_t)m_qvqstrCurveNames.size())
             {
@@ -446,11 +659,14 @@ void cBasicQwtLinePlotWidget::updateCurves()
                 m_qvpPlotCurves.push_back(new QwtPlotCurve(QString("Channel %1").arg(u32ChannelNo)));
             }
             m_qvpPlotCurves[u32ChannelNo]->attach(m_pUI->qwtPlot);
+
+            //Cycle through the colours if there are more curves than colours
+            Qt::GlobalColor eCurveColour = m_qveCurveColours[u32ChannelNo % m_qveCurveColours.size()];
 #if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
-            m_qvpPlotCurves[u32ChannelNo]->setPen(QPen(m_qveCurveColours[u32ChannelNo]));
+            m_qvpPlotCurves[u32ChannelNo]->setPen(QPen(eCurveColour));
 #else
-            m_qvpPlotCurves[u32ChannelNo]->setPen(m_qveCurveColours[u32ChannelNo], 1.0, Qt::SolidLine);
-            m_qvpPlotCurves[u32ChannelNo]->setSymbol(new QwtSymbol(QwtSymbol::Cross, Qt::NoBrush, QPen( m_qveCurveColours[u32ChannelNo] ), QSize( 3, 3 ) ));
+            m_qvpPlotCurves[u32ChannelNo]->setPen(eCurveColour, 1.0, Qt::SolidLine);
+            m_qvpPlotCurves[u32ChannelNo]->setSymbol(new QwtSymbol(QwtSymbol::Cross, Qt::NoBrush, QPen( eCurveColour ), QSize( 3, 3 ) ));
 #endif
         }
     }
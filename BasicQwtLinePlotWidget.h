@@ -22,6 +22,7 @@ typedef unsigned __int64 uint64_t;
 #include <QString>
 #include <QVector>
 #include <QReadWriteLock>
+#include <QMutex>
 #include <QFont>
 #include <QTimer>
 #include <QCheckBox>
@@ -33,8 +34,11 @@ typedef unsigned __int64 uint64_t;
 
 //Local includes
 #include "QwtPlotWidgetBase.h"
+#include "PlotFrame.h"
 #include "CursorCentredQwtPlotMagnifier.h"
 #include "AnimatedQwtPlotZoomer.h"
+#include "FloatQwtSeriesData.h"
+#include "PlotKernels.h"
 
 class cBasicQwtLinePlotWidget : public cQwtPlotWidgetBase
 {
@@ -47,6 +51,20 @@ public:
     void                                addData(const QVector<float> &qvfXData, const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us = 0,
                                                 const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
 
+    //Zero copy ingest from a contiguous block or shared frame (see PlotFrame.h)
+    void                                addData(const QVector<float> &qvfXData, const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0,
+                                                const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    void                                addData(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0,
+                                                const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Raw digitiser samples converted to power on ingest (see PlotFrame.h). Where possible the log conversion is done in the same pass.
+    void                                addData(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us = 0,
+                                                const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Many frames in one call for bursty producers. Locks are taken and the GUI is notified once per batch rather than per frame.
+    //Each frame replaces the last in this plot so only the newest frame of the batch is processed.
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
     void                                setCurveNames(const QVector<QString> &qvqstrCurveNames);
 
     void                                showPlotGrid(bool bEnable);
@@ -69,8 +87,20 @@ protected:
     cCursorCentredQwtPlotMagnifier*     m_pPlotMagnifier;
 
     //Data stuctures
-    QVector<QVector<double> >           m_qvvdYDataToPlot;
+    QVector<QVector<float> >            m_qvvfYDataToPlot;
     QVector<double>                     m_qvdXDataToPlot;
+    bool                                m_bXIsMonotonic; //Allows curves to present only the visible X interval to Qwt
+
+    //Implicit X for uniformly sampled data: X = start + index * step. m_qvdXDataToPlot is unused in this case.
+    bool                                m_bImplicitX;
+    double                              m_dImplicitXStart;
+    double                              m_dImplicitXStep;
+    uint32_t                            m_u32NImplicitXSamples;
+
+    //Leading samples of the X and Y buffers that are no longer plotted. The scrolling plot leaves scrolled out samples in place
+    //and compacts its buffers only once these outnumber the plotted samples.
+    uint32_t                            m_u32HistoryStart;
+
     int64_t                             m_i64PlotTimestamp_us;
 
     bool                                m_bIsGridShown;
@@ -80,8 +110,47 @@ protected:
 
     void                                showCurve(QwtPlotItem *pItem, bool bShow);
 
-    virtual void                        processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us = 0);
-    virtual void                        processYData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    virtual void                        processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us = 0);
+    virtual void                        processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //X accessors valid for both explicit and implicit X
+    void                                setImplicitXData(double dXStart, double dXStep, uint32_t u32NSamples);
+    uint32_t                            getNXSamples() const;
+    double                              getXSample(uint32_t u32SampleNo) const;
+
+    //Series adapter for a curve sharing the plot buffers. Ownership passes to the caller (normally a QwtPlotCurve).
+    virtual cFloatQwtSeriesData*        createSeriesData(uint32_t u32CurveNo) const;
+
+    //X and a column per curve, sharing the plot buffers. Also serves the scrolling and band power plots whose history these buffers hold.
+    virtual bool                        snapshotData(cPlotDataExport &oExport);
+
+    //As snapshotData() with the given Y data in place of the plot buffers, one vector per curve
+    bool                                snapshotCurves(cPlotDataExport &oExport, const QVector<QVector<float> > &qvvfYData);
+
+    //From the adapters held by the curves, which share the data last handed to the GUI thread and are never written
+    virtual bool                        snapshotDisplayedData(cPlotDataExport &oExport);
+
+    void                                addExportAttributes(cPlotDataExport &oExport);
+
+    //processYData() for either channel selection
+    template<typename tChannelSelection>
+    void                                copyYData(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels);
+
+    //As processYData() for raw samples. Returns true if the log conversion has already been applied.
+    virtual bool                        processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    template<typename tChannelSelection>
+    void                                convertRawYData(const cRawPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels, float fDecibelFactor);
+
+    //The log conversion factor (10 or 20) to fuse into raw sample conversion or 0 if the conversion cannot be fused
+    float                               getFusedDecibelFactor();
+
+    //addData() without recording, for derived widgets passing on their own output
+    void                                ingestData(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0,
+                                                   const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Common tail of addData once the X and Y data have been processed: log conversion, notifying the GUI thread and any due history checkpoint
+    void                                plotProcessedData(int64_t i64Timestamp_us, bool bLogConversionDone = false);
 
     virtual void                        logConversion();
     virtual void                        powerLogConversion();
@@ -0,0 +1,464 @@
+//System includes
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "BlackBoxRecorder.h"
+#include "StreamRecorder.h"
+
+using namespace std;
+
+cBlackBoxRecorder::cBlackBoxRecorder(uint64_t u64Budget_B, uint32_t u32Window_s, uint32_t u32Quantisation, uint32_t u32NSegments, QObject *pParent) :
+    QObject(pParent),
+    m_u32Quantisation(u32Quantisation),
+    m_u32CurrentSegment(0),
+    m_i64NewestTimestamp_us(0),
+    m_u32Window_s(u32Window_s)
+{
+    if(m_u32Quantisation > QUANTISATION_8_BIT)
+    {
+        cout << "cBlackBoxRecorder::cBlackBoxRecorder(): Warning: Unknown quantisation " << m_u32Quantisation << ". Storing float32 samples." << endl;
+        m_u32Quantisation = QUANTISATION_NONE;
+    }
+
+    if(u32NSegments < 2)
+        u32NSegments = 2;
+
+    //Segments are a multiple of 8 bytes, like the records, and addressable by a QByteArray
+    uint64_t u64SegmentSize_B = u64Budget_B / u32NSegments / 8 * 8;
+
+    if(u64SegmentSize_B > 0x40000000)
+        u64SegmentSize_B = 0x40000000;
+
+    m_u32SegmentSize_B = u64SegmentSize_B;
+
+    //Allocate everything up front
+    m_qvqbaSegments.resize(u32NSegments);
+
+    for(uint32_t u32SegmentNo = 0; u32SegmentNo < u32NSegments; u32SegmentNo++)
+    {
+        m_qvqbaSegments[u32SegmentNo] = QByteArray(m_u32SegmentSize_B, '\0');
+    }
+
+    m_qvu32SegmentUsed_B.fill(0, u32NSegments);
+    m_qvu32SegmentNFrames.fill(0, u32NSegments);
+
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    cout << "cBlackBoxRecorder::cBlackBoxRecorder(): Keeping up to " << m_u32Window_s << " s of frames in " << u32NSegments << " segments of "
+         << m_u32SegmentSize_B << " bytes." << endl;
+
+    startWriter();
+}
+
+cBlackBoxRecorder::~cBlackBoxRecorder()
+{
+    stopWriter();
+}
+
+uint8_t* cBlackBoxRecorder::reserveRecord(uint32_t u32RecordSize_B)
+{
+    if(m_qvu32SegmentUsed_B[m_u32CurrentSegment] + u32RecordSize_B > m_u32SegmentSize_B)
+    {
+        //Move on to the next segment, discarding the oldest frames
+        m_u32CurrentSegment = (m_u32CurrentSegment + 1) % m_qvqbaSegments.size();
+
+        m_oStats.m_u64NFramesDiscarded += m_qvu32SegmentNFrames[m_u32CurrentSegment];
+        m_qvu32SegmentNFrames[m_u32CurrentSegment] = 0;
+        m_qvu32SegmentUsed_B[m_u32CurrentSegment] = 0;
+    }
+
+    //Non-const access detaches the segment if a dump still shares it
+    uint8_t *pu8Record = reinterpret_cast<uint8_t*>(m_qvqbaSegments[m_u32CurrentSegment].data()) + m_qvu32SegmentUsed_B[m_u32CurrentSegment];
+
+    m_qvu32SegmentUsed_B[m_u32CurrentSegment] += u32RecordSize_B;
+    m_qvu32SegmentNFrames[m_u32CurrentSegment]++;
+    m_oStats.m_u64NFramesRecorded++;
+
+    return pu8Record;
+}
+
+void cBlackBoxRecorder::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                    const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!pfXData)
+        u32NXSamples = 0;
+
+    uint32_t u32NChannels = oYData.getNChannels();
+    uint32_t u32NYSamples = 0;
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        u32NYSamples += oYData.getNBins(u32ChannelNo);
+    }
+
+    uint32_t u32BytesPerSample = 4;
+    uint32_t u32QuantisationSize_B = 0;
+
+    if(m_u32Quantisation != QUANTISATION_NONE)
+    {
+        u32BytesPerSample = m_u32Quantisation == QUANTISATION_16_BIT ? 2 : 1;
+        u32QuantisationSize_B = u32NChannels * 2 * sizeof(float);
+    }
+
+    uint64_t u64RecordSize_B = sizeof(cRecordHeader) + (uint64_t)(qvu32ChannelList.size() + u32NChannels + u32NXSamples) * 4 + u32QuantisationSize_B
+            + (uint64_t)u32NYSamples * u32BytesPerSample;
+
+    u64RecordSize_B = (u64RecordSize_B + 7) / 8 * 8;
+
+    //Written under the lock so that a dump never snapshots a partially written record
+    QMutexLocker oLock(&m_oMutex);
+
+    if(u64RecordSize_B > m_u32SegmentSize_B)
+    {
+        m_oStats.m_u64NFramesTooLarge++;
+        return;
+    }
+
+    uint8_t *pu8Record = reserveRecord(u64RecordSize_B);
+
+    cRecordHeader *pHeader = reinterpret_cast<cRecordHeader*>(pu8Record);
+    pHeader->m_u32RecordSize_B = u64RecordSize_B;
+    pHeader->m_u32Quantisation = m_u32Quantisation;
+    pHeader->m_i64Timestamp_us = i64Timestamp_us;
+    pHeader->m_u32NXSamples = u32NXSamples;
+    pHeader->m_u32NChannelListEntries = qvu32ChannelList.size();
+    pHeader->m_u32NChannels = u32NChannels;
+    pHeader->m_u32NYSamples = u32NYSamples;
+
+    uint32_t *pu32ChannelList = reinterpret_cast<uint32_t*>(pHeader + 1);
+    copy(qvu32ChannelList.constBegin(), qvu32ChannelList.constEnd(), pu32ChannelList);
+
+    uint32_t *pu32NBins = pu32ChannelList + qvu32ChannelList.size();
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        pu32NBins[u32ChannelNo] = oYData.getNBins(u32ChannelNo);
+    }
+
+    float *pfX = reinterpret_cast<float*>(pu32NBins + u32NChannels);
+
+    if(u32NXSamples)
+        copy(pfXData, pfXData + u32NXSamples, pfX);
+
+    uint8_t *pu8Samples = reinterpret_cast<uint8_t*>(pfX + u32NXSamples);
+
+    if(m_u32Quantisation == QUANTISATION_NONE)
+    {
+        float *pfY = reinterpret_cast<float*>(pu8Samples);
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+        {
+            copy(oYData.getChannel(u32ChannelNo), oYData.getChannel(u32ChannelNo) + oYData.getNBins(u32ChannelNo), pfY);
+            pfY += oYData.getNBins(u32ChannelNo);
+        }
+    }
+    else
+    {
+        float *pfOffsets = reinterpret_cast<float*>(pu8Samples);
+        float *pfSteps = pfOffsets + u32NChannels;
+        pu8Samples += u32QuantisationSize_B;
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+        {
+            uint32_t u32NBins = oYData.getNBins(u32ChannelNo);
+
+            if(m_u32Quantisation == QUANTISATION_16_BIT)
+                quantise(oYData.getChannel(u32ChannelNo), u32NBins, reinterpret_cast<uint16_t*>(pu8Samples), pfOffsets[u32ChannelNo], pfSteps[u32ChannelNo]);
+            else
+                quantise(oYData.getChannel(u32ChannelNo), u32NBins, pu8Samples, pfOffsets[u32ChannelNo], pfSteps[u32ChannelNo]);
+
+            pu8Samples += u32NBins * u32BytesPerSample;
+        }
+    }
+
+    m_i64NewestTimestamp_us = i64Timestamp_us;
+}
+
+void cBlackBoxRecorder::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                    const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Raw samples are recorded as the converted (linear) values they produce
+    m_qvfConvertedYData.resize(oYData.getNChannels() * oYData.getNBins());
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < oYData.getNChannels(); u32ChannelNo++)
+    {
+        oYData.convertChannel(u32ChannelNo, m_qvfConvertedYData.data() + u32ChannelNo * oYData.getNBins());
+    }
+
+    recordFrame(pfXData, u32NXSamples, cPlotFrameView(m_qvfConvertedYData.constData(), oYData.getNChannels(), oYData.getNBins()), i64Timestamp_us, qvu32ChannelList);
+}
+
+void cBlackBoxRecorder::recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    for(uint32_t u32FrameNo = 0; u32FrameNo < oBatch.getNFrames(); u32FrameNo++)
+    {
+        recordFrame(oBatch.getXData(u32FrameNo), oBatch.getNXSamples(u32FrameNo), oBatch.getFrame(u32FrameNo), oBatch.getTimestamp_us(u32FrameNo), qvu32ChannelList);
+    }
+}
+
+template<typename tCode>
+void cBlackBoxRecorder::quantise(const float *pfInput, uint32_t u32NSamples, tCode *pOutput, float &fOffset, float &fStep)
+{
+    const float fMaxCode = numeric_limits<tCode>::max();
+
+    float fMin = numeric_limits<float>::max();
+    float fMax = -numeric_limits<float>::max();
+
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+    {
+        float fValue = pfInput[u32SampleNo];
+
+        //Non-finite samples (e.g. log of 0) are excluded from the range and clamped to its ends
+        if(fValue != fValue || fabs(fValue) > numeric_limits<float>::max())
+            continue;
+
+        fMin = qMin(fMin, fValue);
+        fMax = qMax(fMax, fValue);
+    }
+
+    if(fMin > fMax)
+    {
+        fMin = 0.0f;
+        fMax = 0.0f;
+    }
+
+    //Linear steps would lose everything more than a few tens of dB below the peak of a power spectrum
+    bool bLog = fMin > 0.0f;
+
+    if(bLog)
+    {
+        fMin = log10f(fMin);
+        fMax = log10f(fMax);
+    }
+
+    fOffset = fMin;
+    fStep = (fMax - fMin) / fMaxCode;
+
+    float fScale = fStep > 0.0f ? 1.0f / fStep : 0.0f;
+
+    if(bLog)
+        fStep = -fStep;
+
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+    {
+        float fValue = bLog ? log10f(pfInput[u32SampleNo]) : pfInput[u32SampleNo];
+        float fCode = (fValue - fMin) * fScale + 0.5f;
+
+        if(fCode != fCode || fCode < 0.0f)
+            fCode = 0.0f;
+        else if(fCode > fMaxCode)
+            fCode = fMaxCode;
+
+        pOutput[u32SampleNo] = (tCode)fCode;
+    }
+}
+
+template<typename tCode>
+void cBlackBoxRecorder::dequantise(const tCode *pInput, uint32_t u32NSamples, float fOffset, float fStep, float *pfOutput)
+{
+    if(signbit(fStep))
+    {
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            pfOutput[u32SampleNo] = powf(10.0f, fOffset - pInput[u32SampleNo] * fStep);
+        }
+
+        return;
+    }
+
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+    {
+        pfOutput[u32SampleNo] = fOffset + pInput[u32SampleNo] * fStep;
+    }
+}
+
+bool cBlackBoxRecorder::dump(const QString &qstrFilename)
+{
+    if(isBusy())
+    {
+        cout << "cBlackBoxRecorder::dump(): Warning: A dump is already in progress. Ignoring request to dump to " << qstrFilename.toStdString() << endl;
+        return false;
+    }
+
+    cDumpJob *pDumpJob = new cDumpJob;
+    pDumpJob->m_qstrFilename = qstrFilename;
+    pDumpJob->m_u32NFrames = 0;
+
+    {
+        QMutexLocker oLock(&m_oMutex);
+
+        //Shallow copies, oldest segment first. The segments are only copied if ingest writes to them during the dump.
+        uint32_t u32NSegments = m_qvqbaSegments.size();
+
+        for(uint32_t u32SegmentNo = 1; u32SegmentNo <= u32NSegments; u32SegmentNo++)
+        {
+            uint32_t u32Index = (m_u32CurrentSegment + u32SegmentNo) % u32NSegments;
+
+            if(!m_qvu32SegmentUsed_B[u32Index])
+                continue;
+
+            pDumpJob->m_qvqbaSegments.push_back(m_qvqbaSegments[u32Index]);
+            pDumpJob->m_qvu32SegmentUsed_B.push_back(m_qvu32SegmentUsed_B[u32Index]);
+        }
+
+        pDumpJob->m_i64Start_us = m_i64NewestTimestamp_us - (int64_t)m_u32Window_s * 1000000;
+        m_oStats.m_u32NDumps++;
+    }
+
+    submitJob(pDumpJob);
+
+    cout << "cBlackBoxRecorder::dump(): Dumping to " << qstrFilename.toStdString() << endl;
+
+    return true;
+}
+
+bool cBlackBoxRecorder::isDumping()
+{
+    return isBusy();
+}
+
+void cBlackBoxRecorder::setWindow_s(uint32_t u32Window_s)
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    m_u32Window_s = u32Window_s;
+}
+
+cBlackBoxRecorder::cStats cBlackBoxRecorder::getStats()
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    return m_oStats;
+}
+
+bool cBlackBoxRecorder::writeJob(cJob *pJob)
+{
+    cDumpJob *pDumpJob = static_cast<cDumpJob*>(pJob);
+
+    //Blocking so that no frames are dropped if the disk is slower than this loop
+    cStreamRecorder oWriter(16 * 1024 * 1024);
+
+    if(!oWriter.open(pDumpJob->m_qstrFilename, false, 64, true))
+    {
+        pDumpJob->m_qvqbaSegments.clear();
+        return false;
+    }
+
+    QVector<uint32_t> qvu32ChannelList;
+    QVector<float> qvfYData;
+    QVector<QVector<float> > qvvfUnequalChannels;
+
+    for(uint32_t u32SegmentNo = 0; u32SegmentNo < (uint32_t)pDumpJob->m_qvqbaSegments.size(); u32SegmentNo++)
+    {
+        const uint8_t *pu8Segment = reinterpret_cast<const uint8_t*>(pDumpJob->m_qvqbaSegments[u32SegmentNo].constData());
+        uint32_t u32Offset_B = 0;
+
+        while(u32Offset_B < pDumpJob->m_qvu32SegmentUsed_B[u32SegmentNo])
+        {
+            const cRecordHeader *pHeader = reinterpret_cast<const cRecordHeader*>(pu8Segment + u32Offset_B);
+            u32Offset_B += pHeader->m_u32RecordSize_B;
+
+            if(pHeader->m_i64Timestamp_us < pDumpJob->m_i64Start_us)
+                continue;
+
+            const uint32_t *pu32ChannelList = reinterpret_cast<const uint32_t*>(pHeader + 1);
+            const uint32_t *pu32NBins = pu32ChannelList + pHeader->m_u32NChannelListEntries;
+            const float *pfXData = reinterpret_cast<const float*>(pu32NBins + pHeader->m_u32NChannels);
+            const uint8_t *pu8Samples = reinterpret_cast<const uint8_t*>(pfXData + pHeader->m_u32NXSamples);
+
+            qvu32ChannelList.resize(pHeader->m_u32NChannelListEntries);
+            copy(pu32ChannelList, pu32ChannelList + pHeader->m_u32NChannelListEntries, qvu32ChannelList.data());
+
+            const float *pfYData;
+
+            if(pHeader->m_u32Quantisation == QUANTISATION_NONE)
+            {
+                pfYData = reinterpret_cast<const float*>(pu8Samples);
+            }
+            else
+            {
+                const float *pfOffsets = reinterpret_cast<const float*>(pu8Samples);
+                const float *pfSteps = pfOffsets + pHeader->m_u32NChannels;
+                pu8Samples += pHeader->m_u32NChannels * 2 * sizeof(float);
+
+                qvfYData.resize(pHeader->m_u32NYSamples);
+                float *pfOutput = qvfYData.data();
+
+                for(uint32_t u32ChannelNo = 0; u32ChannelNo < pHeader->m_u32NChannels; u32ChannelNo++)
+                {
+                    uint32_t u32NBins = pu32NBins[u32ChannelNo];
+
+                    if(pHeader->m_u32Quantisation == QUANTISATION_16_BIT)
+                    {
+                        dequantise(reinterpret_cast<const uint16_t*>(pu8Samples), u32NBins, pfOffsets[u32ChannelNo], pfSteps[u32ChannelNo], pfOutput);
+                        pu8Samples += u32NBins * 2;
+                    }
+                    else
+                    {
+                        dequantise(pu8Samples, u32NBins, pfOffsets[u32ChannelNo], pfSteps[u32ChannelNo], pfOutput);
+                        pu8Samples += u32NBins;
+                    }
+
+                    pfOutput += u32NBins;
+                }
+
+                pfYData = qvfYData.constData();
+            }
+
+            bool bEqualChannels = true;
+
+            for(uint32_t u32ChannelNo = 1; u32ChannelNo < pHeader->m_u32NChannels; u32ChannelNo++)
+            {
+                bEqualChannels &= pu32NBins[u32ChannelNo] == pu32NBins[0];
+            }
+
+            const float *pfX = pHeader->m_u32NXSamples ? pfXData : NULL;
+
+            if(bEqualChannels)
+            {
+                oWriter.recordFrame(pfX, pHeader->m_u32NXSamples, cPlotFrameView(pfYData, pHeader->m_u32NChannels, pHeader->m_u32NChannels ? pu32NBins[0] : 0),
+                                    pHeader->m_i64Timestamp_us, qvu32ChannelList);
+            }
+            else
+            {
+                qvvfUnequalChannels.resize(pHeader->m_u32NChannels);
+
+                for(uint32_t u32ChannelNo = 0; u32ChannelNo < pHeader->m_u32NChannels; u32ChannelNo++)
+                {
+                    qvvfUnequalChannels[u32ChannelNo].resize(pu32NBins[u32ChannelNo]);
+                    copy(pfYData, pfYData + pu32NBins[u32ChannelNo], qvvfUnequalChannels[u32ChannelNo].data());
+                    pfYData += pu32NBins[u32ChannelNo];
+                }
+
+                oWriter.recordFrame(pfX, pHeader->m_u32NXSamples, cPlotFrameView(qvvfUnequalChannels), pHeader->m_i64Timestamp_us, qvu32ChannelList);
+            }
+
+            pDumpJob->m_u32NFrames++;
+        }
+    }
+
+    oWriter.close();
+
+    //Release the snapshot so that ingest no longer detaches segments
+    pDumpJob->m_qvqbaSegments.clear();
+
+    cout << "cBlackBoxRecorder::writeJob(): Dumped " << pDumpJob->m_u32NFrames << " frames to " << pDumpJob->m_qstrFilename.toStdString() << endl;
+
+    return true;
+}
+
+void cBlackBoxRecorder::jobFinished(cJob *pJob, bool bSuccess)
+{
+    cDumpJob *pDumpJob = static_cast<cDumpJob*>(pJob);
+
+    sigDumpFinished(pDumpJob->m_qstrFilename, bSuccess, pDumpJob->m_u32NFrames);
+
+    delete pDumpJob;
+}
@@ -0,0 +1,142 @@
+//Flight recorder for plot input. Keeps the most recent frames passed to a widget in a fixed size, preallocated ring
+//and writes them to disk on demand in the cStreamRecorder file format, so a dump can be replayed with cStreamReplayer.
+//
+//The ring is a number of equally sized segments, each a QByteArray holding whole frame records. When the current segment is
+//full recording continues in the next one, discarding the oldest frames. A dump takes a shallow (implicitly shared) copy of the
+//segments and writes them out on a background thread. Ingest carries on meanwhile: the first write to a segment still shared
+//with a dump detaches it, which copies that one segment. Ingest never waits for the disk.
+//
+//Frames can optionally be quantised to 16 or 8 bits per sample (with a per channel offset and step) to fit more history into the budget.
+//Channels whose samples are all positive, as power is, are quantised in log10 so that the error is a fixed fraction of each sample.
+//Dumps are restored to float32.
+
+#ifndef BLACK_BOX_RECORDER_H
+#define BLACK_BOX_RECORDER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+
+//Local includes
+#include "PlotFrame.h"
+#include "BackgroundWriter.h"
+
+class cBlackBoxRecorder : public QObject, public cBackgroundWriter
+{
+    Q_OBJECT
+
+public:
+    static const uint32_t               QUANTISATION_NONE = 0;
+    static const uint32_t               QUANTISATION_16_BIT = 1;
+    //Log quantised channels resolve their whole range to within 0.5 step, e.g. 0.12 dB for a 60 dB range in 8 bits. Channels with zero
+    //or negative samples are quantised linearly, which only resolves samples down to about 24 dB (8 bit) or 48 dB (16 bit) below the
+    //channel's largest magnitude.
+    static const uint32_t               QUANTISATION_8_BIT = 2;
+
+    struct cStats
+    {
+        uint64_t                        m_u64NFramesRecorded;
+        uint64_t                        m_u64NFramesDiscarded;  //Overwritten by newer frames
+        uint64_t                        m_u64NFramesTooLarge;   //Larger than one segment and so not recorded
+        uint32_t                        m_u32NDumps;
+    };
+
+    //Holds up to u64Budget_B of frames, of which those newer than u32Window_s before the newest frame are dumped.
+    //The budget is split into u32NSegments segments. A frame may be no larger than one segment.
+    explicit cBlackBoxRecorder(uint64_t u64Budget_B = 256 * 1024 * 1024, uint32_t u32Window_s = 600, uint32_t u32Quantisation = QUANTISATION_NONE,
+                               uint32_t u32NSegments = 64, QObject *pParent = 0);
+    ~cBlackBoxRecorder();
+
+    //Called by the widgets on their ingest thread
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList);
+
+    //Starts writing the current contents to the file in the background. Returns false if a dump is already in progress.
+    //sigDumpFinished() is emitted on completion.
+    bool                                dump(const QString &qstrFilename);
+    bool                                isDumping();
+
+    void                                setWindow_s(uint32_t u32Window_s);
+
+    cStats                              getStats();
+
+private:
+    //Shallow copy of the ring taken by dump(). Only accessed by the writer thread once submitted.
+    struct cDumpJob : public cJob
+    {
+        QString                         m_qstrFilename;
+        QVector<QByteArray>             m_qvqbaSegments; //Oldest first
+        QVector<uint32_t>               m_qvu32SegmentUsed_B;
+        int64_t                         m_i64Start_us;
+        uint32_t                        m_u32NFrames;
+    };
+
+    //Followed in the segment by u32 channel list, u32 bins per channel, float32 X data, then for quantised frames
+    //float32 offsets and steps per channel, then the Y samples (float32, uint16 or uint8). Records are padded to a multiple of 8 bytes
+    //so that every header, with its int64 timestamp, is aligned. A negative step (sign bit set) marks a channel quantised in log10.
+    struct cRecordHeader
+    {
+        uint32_t                        m_u32RecordSize_B;
+        uint32_t                        m_u32Quantisation;
+        int64_t                         m_i64Timestamp_us;
+        uint32_t                        m_u32NXSamples;
+        uint32_t                        m_u32NChannelListEntries;
+        uint32_t                        m_u32NChannels;
+        uint32_t                        m_u32NYSamples;
+    };
+
+    uint32_t                            m_u32SegmentSize_B;
+    uint32_t                            m_u32Quantisation;
+
+    //Protected by m_oMutex. The segment contents are only written by the ingest thread.
+    QMutex                              m_oMutex;
+    QVector<QByteArray>                 m_qvqbaSegments;
+    QVector<uint32_t>                   m_qvu32SegmentUsed_B;
+    QVector<uint32_t>                   m_qvu32SegmentNFrames;
+    uint32_t                            m_u32CurrentSegment;
+    int64_t                             m_i64NewestTimestamp_us;
+    uint32_t                            m_u32Window_s;
+    cStats                              m_oStats;
+
+    //Ingest thread only
+    QVector<float>                      m_qvfConvertedYData;
+
+    //Returns where to write a record of the given size (at most one segment), moving to the next segment if necessary. Requires m_oMutex.
+    uint8_t*                            reserveRecord(uint32_t u32RecordSize_B);
+
+    template<typename tCode>
+    static void                         quantise(const float *pfInput, uint32_t u32NSamples, tCode *pOutput, float &fOffset, float &fStep);
+
+    template<typename tCode>
+    static void                         dequantise(const tCode *pInput, uint32_t u32NSamples, float fOffset, float fStep, float *pfOutput);
+
+    virtual bool                        writeJob(cJob *pJob);
+    virtual void                        jobFinished(cJob *pJob, bool bSuccess);
+
+signals:
+    void                                sigDumpFinished(const QString &qstrFilename, bool bSuccess, uint32_t u32NFrames);
+};
+
+#endif // BLACK_BOX_RECORDER_H
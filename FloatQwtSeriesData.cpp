@@ -0,0 +1,408 @@
+//System includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+//Library includes
+
+//Local includes
+#include "FloatQwtSeriesData.h"
+
+using namespace std;
+
+cFloatQwtSeriesData::cFloatQwtSeriesData(const QVector<double> &qvdXData, const QVector<float> &qvfYData, bool bXIsMonotonic, uint32_t u32FirstSample) :
+    m_qvdXData(qvdXData),
+    m_qvfYData(qvfYData),
+    m_u32FirstSample(qMin(u32FirstSample, (uint32_t)qMin(qvdXData.size(), qvfYData.size()))),
+    m_pdXData(m_qvdXData.constData() + m_u32FirstSample),
+    m_pfYData(m_qvfYData.constData() + m_u32FirstSample),
+    m_bXIsMonotonic(bXIsMonotonic),
+    m_u32NTotalSamples(qMin(qvdXData.size(), qvfYData.size()) - m_u32FirstSample),
+    m_bImplicitX(false),
+    m_dXStart(0.0),
+    m_dXStep(0.0),
+    m_u32FullResolutionBegin(0),
+    m_u32FullResolutionEnd(m_u32NTotalSamples),
+    m_u32CoarseStride(1),
+    m_u32Offset(0),
+    m_u32NSamples(m_u32NTotalSamples)
+{
+}
+
+cFloatQwtSeriesData::cFloatQwtSeriesData(double dXStart, double dXStep, const QVector<float> &qvfYData, uint32_t u32FirstSample) :
+    m_qvfYData(qvfYData),
+    m_u32FirstSample(qMin(u32FirstSample, (uint32_t)qvfYData.size())),
+    m_pdXData(NULL),
+    m_pfYData(m_qvfYData.constData() + m_u32FirstSample),
+    m_bXIsMonotonic(dXStep > 0.0),
+    m_u32NTotalSamples(qvfYData.size() - m_u32FirstSample),
+    m_bImplicitX(true),
+    m_dXStart(dXStart),
+    m_dXStep(dXStep),
+    m_u32FullResolutionBegin(0),
+    m_u32FullResolutionEnd(m_u32NTotalSamples),
+    m_u32CoarseStride(1),
+    m_u32Offset(0),
+    m_u32NSamples(m_u32NTotalSamples)
+{
+}
+
+size_t cFloatQwtSeriesData::size() const
+{
+    return m_u32NSamples;
+}
+
+QPointF cFloatQwtSeriesData::sample(size_t i) const
+{
+    return QPointF(getX(m_u32Offset + i), getY(m_u32Offset + i));
+}
+
+QRectF cFloatQwtSeriesData::boundingRect() const
+{
+    //Bounds of the full curve (not just the presented sub range) so that autoscaling behaves as with setSamples().
+    //Cached in the base class member as Qwt does.
+    if(d_boundingRect.width() >= 0.0)
+        return d_boundingRect;
+
+    uint32_t u32NSamples = m_u32NTotalSamples;
+
+    if(!u32NSamples)
+        return QRectF(1.0, 1.0, -2.0, -2.0); //Invalid
+
+    double dXMin;
+    double dXMax;
+
+    if(m_bXIsMonotonic || m_bImplicitX)
+    {
+        dXMin = qMin(getX(0), getX(u32NSamples - 1));
+        dXMax = qMax(getX(0), getX(u32NSamples - 1));
+    }
+    else
+    {
+        dXMin = DBL_MAX;
+        dXMax = -DBL_MAX;
+
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            if(m_pdXData[u32SampleNo] < dXMin)
+                dXMin = m_pdXData[u32SampleNo];
+
+            if(m_pdXData[u32SampleNo] > dXMax)
+                dXMax = m_pdXData[u32SampleNo];
+        }
+    }
+
+    float fYMin;
+    float fYMax;
+    getYBounds(0, u32NSamples, fYMin, fYMax);
+
+    d_boundingRect = QRectF(dXMin, fYMin, dXMax - dXMin, fYMax - fYMin);
+
+    return d_boundingRect;
+}
+
+QRectF cFloatQwtSeriesData::boundingRect(double dXMin, double dXMax) const
+{
+    if(!m_bXIsMonotonic)
+        return boundingRect();
+
+    uint32_t u32Begin;
+    uint32_t u32End;
+    getIndexRange(dXMin, dXMax, u32Begin, u32End);
+
+    if(u32Begin >= u32End)
+        return QRectF(1.0, 1.0, -2.0, -2.0); //Invalid
+
+    float fYMin;
+    float fYMax;
+    getYBounds(u32Begin, u32End, fYMin, fYMax);
+
+    return QRectF(getX(u32Begin), fYMin, getX(u32End - 1) - getX(u32Begin), fYMax - fYMin);
+}
+
+void cFloatQwtSeriesData::setPartialResolution(uint32_t u32FullResolutionBegin, uint32_t u32FullResolutionEnd, uint32_t u32CoarseStride)
+{
+    m_u32FullResolutionBegin = qMin(u32FullResolutionBegin, m_u32NTotalSamples);
+    m_u32FullResolutionEnd = qBound(m_u32FullResolutionBegin, u32FullResolutionEnd, m_u32NTotalSamples);
+    m_u32CoarseStride = qMax(u32CoarseStride, (uint32_t)1);
+
+    //Bounds need to be recalculated without the invalid samples
+    d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+}
+
+bool cFloatQwtSeriesData::getDecimatedSamples(double dXMin, double dXMax, uint32_t u32NColumns, QVector<QPointF> &qvoSamples) const
+{
+    qvoSamples.clear();
+
+    if(!m_bXIsMonotonic || !u32NColumns)
+        return false;
+
+    uint32_t u32Begin;
+    uint32_t u32End;
+    getIndexRange(dXMin, dXMax, u32Begin, u32End);
+
+    qvoSamples.reserve(4 * u32NColumns + 2);
+
+    //The neighbouring samples outside the interval so that line segments crossing the edges are still drawn
+    if(u32Begin > 0)
+        qvoSamples.push_back(QPointF(getX(u32Begin - 1), getY(u32Begin - 1)));
+
+    double dColumnWidth = (dXMax - dXMin) / u32NColumns;
+    uint32_t u32SampleNo = u32Begin;
+
+    for(uint32_t u32ColumnNo = 0; u32ColumnNo < u32NColumns && u32SampleNo < u32End; u32ColumnNo++)
+    {
+        uint32_t u32ColumnEnd = u32End;
+
+        if(u32ColumnNo < u32NColumns - 1)
+        {
+            uint32_t u32Unused;
+            getIndexRange(dXMin, dXMin + (u32ColumnNo + 1) * dColumnWidth, u32Unused, u32ColumnEnd);
+            u32ColumnEnd = qBound(u32SampleNo, u32ColumnEnd, u32End);
+        }
+
+        if(u32ColumnEnd - u32SampleNo <= 4)
+        {
+            for(; u32SampleNo < u32ColumnEnd; u32SampleNo++)
+            {
+                qvoSamples.push_back(QPointF(getX(u32SampleNo), getY(u32SampleNo)));
+            }
+
+            continue;
+        }
+
+        //Within one column the vertical extent is all that shows, so the order of the minimum and maximum does not matter
+        float fYMin;
+        float fYMax;
+        getYBounds(u32SampleNo, u32ColumnEnd, fYMin, fYMax);
+
+        double dXFirst = getX(u32SampleNo);
+        double dXLast = getX(u32ColumnEnd - 1);
+
+        qvoSamples.push_back(QPointF(dXFirst, getY(u32SampleNo)));
+        qvoSamples.push_back(QPointF(dXFirst, fYMin));
+        qvoSamples.push_back(QPointF(dXLast, fYMax));
+        qvoSamples.push_back(QPointF(dXLast, getY(u32ColumnEnd - 1)));
+
+        u32SampleNo = u32ColumnEnd;
+    }
+
+    if(u32End < m_u32NTotalSamples)
+        qvoSamples.push_back(QPointF(getX(u32End), getY(u32End)));
+
+    return true;
+}
+
+void cFloatQwtSeriesData::setRectOfInterest(const QRectF &oRect)
+{
+    //Called by Qwt whenever the axes change. Present only the visible samples plus one either side
+    //so that line segments crossing the edge of the canvas are still drawn.
+
+    uint32_t u32NSamples = m_u32NTotalSamples;
+
+    m_u32Offset = 0;
+    m_u32NSamples = u32NSamples;
+
+    if(!m_bXIsMonotonic || !oRect.isValid() || !u32NSamples)
+        return;
+
+    QRectF oNormalisedRect = oRect.normalized();
+
+    uint32_t u32Begin;
+    uint32_t u32End;
+    getIndexRange(oNormalisedRect.left(), oNormalisedRect.right(), u32Begin, u32End);
+
+    if(u32Begin > 0)
+        u32Begin--;
+
+    if(u32End < u32NSamples)
+        u32End++;
+
+    m_u32Offset = u32Begin;
+    m_u32NSamples = u32End - u32Begin;
+}
+
+bool cFloatQwtSeriesData::isXImplicit() const
+{
+    return m_bImplicitX;
+}
+
+double cFloatQwtSeriesData::getXStart() const
+{
+    return m_dXStart;
+}
+
+double cFloatQwtSeriesData::getXStep() const
+{
+    return m_dXStep;
+}
+
+QVector<double> cFloatQwtSeriesData::getXData() const
+{
+    if(m_u32FirstSample)
+        return m_qvdXData.mid(m_u32FirstSample, m_u32NTotalSamples);
+
+    return m_qvdXData;
+}
+
+QVector<float> cFloatQwtSeriesData::getYData() const
+{
+    if(m_u32CoarseStride <= 1)
+        return m_u32FirstSample ? m_qvfYData.mid(m_u32FirstSample, m_u32NTotalSamples) : m_qvfYData;
+
+    QVector<float> qvfYData(m_u32NTotalSamples);
+
+    for(uint32_t u32SampleNo = 0; u32SampleNo < m_u32NTotalSamples; u32SampleNo++)
+    {
+        qvfYData[u32SampleNo] = getY(u32SampleNo);
+    }
+
+    return qvfYData;
+}
+
+double cFloatQwtSeriesData::getX(uint32_t u32SampleNo) const
+{
+    if(m_bImplicitX)
+        return m_dXStart + u32SampleNo * m_dXStep;
+
+    return m_pdXData[u32SampleNo];
+}
+
+float cFloatQwtSeriesData::getY(uint32_t u32SampleNo) const
+{
+    if(m_u32CoarseStride > 1 && (u32SampleNo < m_u32FullResolutionBegin || u32SampleNo >= m_u32FullResolutionEnd))
+        return m_pfYData[u32SampleNo - u32SampleNo % m_u32CoarseStride];
+
+    return m_pfYData[u32SampleNo];
+}
+
+void cFloatQwtSeriesData::updateBlockBounds() const
+{
+    uint32_t u32NBlocks = m_u32NTotalSamples / BLOCK_SIZE;
+
+    if((uint32_t)m_qvfBlockMin.size() == u32NBlocks)
+        return;
+
+    m_qvfBlockMin.resize(u32NBlocks);
+    m_qvfBlockMax.resize(u32NBlocks);
+
+    const float *pfYData = m_pfYData;
+
+    for(uint32_t u32BlockNo = 0; u32BlockNo < u32NBlocks; u32BlockNo++)
+    {
+        float fMin = FLT_MAX;
+        float fMax = -FLT_MAX;
+
+        for(uint32_t u32SampleNo = u32BlockNo * BLOCK_SIZE; u32SampleNo < (u32BlockNo + 1) * BLOCK_SIZE; u32SampleNo++)
+        {
+            if(pfYData[u32SampleNo] < fMin)
+                fMin = pfYData[u32SampleNo];
+
+            if(pfYData[u32SampleNo] > fMax)
+                fMax = pfYData[u32SampleNo];
+        }
+
+        m_qvfBlockMin[u32BlockNo] = fMin;
+        m_qvfBlockMax[u32BlockNo] = fMax;
+    }
+}
+
+void cFloatQwtSeriesData::getYBounds(uint32_t u32Begin, uint32_t u32End, float &fMin, float &fMax) const
+{
+    //Y bounds of samples [u32Begin, u32End). Whole blocks come from the block table, partial blocks are scanned.
+    const float *pfYData = m_pfYData;
+
+    fMin = FLT_MAX;
+    fMax = -FLT_MAX;
+
+    uint32_t u32SampleNo = u32Begin;
+
+    if(m_u32CoarseStride > 1)
+    {
+        //The block table would include invalid samples. Scan the valid ones only.
+        while(u32SampleNo < u32End)
+        {
+            float fValue = getY(u32SampleNo);
+
+            if(fValue < fMin)
+                fMin = fValue;
+
+            if(fValue > fMax)
+                fMax = fValue;
+
+            if(u32SampleNo >= m_u32FullResolutionBegin && u32SampleNo < m_u32FullResolutionEnd)
+            {
+                u32SampleNo++;
+                continue;
+            }
+
+            //Skip to the next valid sample without stepping over the start of the full resolution window
+            uint32_t u32NextSampleNo = u32SampleNo - u32SampleNo % m_u32CoarseStride + m_u32CoarseStride;
+
+            if(u32SampleNo < m_u32FullResolutionBegin && u32NextSampleNo > m_u32FullResolutionBegin)
+                u32NextSampleNo = m_u32FullResolutionBegin;
+
+            u32SampleNo = u32NextSampleNo;
+        }
+    }
+
+    if(u32SampleNo < u32End)
+        updateBlockBounds();
+
+    while(u32SampleNo < u32End)
+    {
+        if(u32SampleNo % BLOCK_SIZE == 0 && u32SampleNo + BLOCK_SIZE <= u32End)
+        {
+            uint32_t u32BlockNo = u32SampleNo / BLOCK_SIZE;
+
+            if(m_qvfBlockMin[u32BlockNo] < fMin)
+                fMin = m_qvfBlockMin[u32BlockNo];
+
+            if(m_qvfBlockMax[u32BlockNo] > fMax)
+                fMax = m_qvfBlockMax[u32BlockNo];
+
+            u32SampleNo += BLOCK_SIZE;
+            continue;
+        }
+
+        if(pfYData[u32SampleNo] < fMin)
+            fMin = pfYData[u32SampleNo];
+
+        if(pfYData[u32SampleNo] > fMax)
+            fMax = pfYData[u32SampleNo];
+
+        u32SampleNo++;
+    }
+
+    //All samples non-finite or empty range
+    if(fMin > fMax)
+    {
+        fMin = 0.0f;
+        fMax = 0.0f;
+    }
+}
+
+void cFloatQwtSeriesData::getIndexRange(double dXMin, double dXMax, uint32_t &u32Begin, uint32_t &u32End) const
+{
+    //Indices [u32Begin, u32End) of samples with X in [dXMin, dXMax]. X must be monotonically increasing.
+    if(m_bImplicitX)
+    {
+        //Closed form for uniform sampling. Clamp in double before converting to avoid overflow far outside the data.
+        double dBegin = ceil((dXMin - m_dXStart) / m_dXStep);
+        double dEnd = floor((dXMax - m_dXStart) / m_dXStep) + 1.0;
+
+        u32Begin = (uint32_t)qBound(0.0, dBegin, (double)m_u32NTotalSamples);
+        u32End = (uint32_t)qBound(0.0, dEnd, (double)m_u32NTotalSamples);
+    }
+    else
+    {
+        const double *pdXBegin = m_pdXData;
+        const double *pdXEnd = pdXBegin + m_u32NTotalSamples;
+
+        u32Begin = lower_bound(pdXBegin, pdXEnd, dXMin) - pdXBegin;
+        u32End = upper_bound(pdXBegin, pdXEnd, dXMax) - pdXBegin;
+    }
+
+    if(u32End < u32Begin)
+        u32End = u32Begin;
+}
@@ -0,0 +1,113 @@
+//Curve data adapter that lets Qwt read directly from the float sample storage of the line plot widgets.
+//The vectors are held by implicit sharing so constructing an adapter does not copy any samples. The hand-off is not copy free
+//overall though: while a curve still holds the adapter the widget's next write to its buffers detaches them, which copies each
+//buffer once per frame. setSamples(QVector<double>, QVector<double>) would share its vectors in the same way, so the saving over
+//it is the float storage: the buffers and that detach copy are half the size of double ones and no double conversion is needed.
+//The Y bounds are summarised per block of samples on first use so that bounding rectangle queries
+//for the whole curve or any X interval need only touch the blocks and the partial blocks at the ends.
+//When X is monotonic only the samples in the rectangle of interest set by Qwt (the visible interval) are presented for drawing.
+//X can also be implicit (start + index * step) for uniformly sampled data in which case no X vector is needed at all
+//and the visible interval is found in closed form. The curve may start part way into the vectors, which lets the scrolling
+//plots leave scrolled out samples in place until they next compact their buffers.
+//Data may also be only partially valid: full resolution inside a window of samples and every Nth sample elsewhere.
+//For export the visible samples can be reduced to the first, minimum, maximum and last sample per output pixel column which
+//draws identically at that resolution. The block bounds keep this proportional to the number of columns rather than samples.
+
+#ifndef FLOAT_QWT_SERIES_DATA_H
+#define FLOAT_QWT_SERIES_DATA_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <qwt_series_data.h>
+
+//Local includes
+
+class cFloatQwtSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    //Samples before u32FirstSample are not part of the curve. For implicit X, dXStart is the X of sample u32FirstSample.
+    cFloatQwtSeriesData(const QVector<double> &qvdXData, const QVector<float> &qvfYData, bool bXIsMonotonic = false, uint32_t u32FirstSample = 0);
+    cFloatQwtSeriesData(double dXStart, double dXStep, const QVector<float> &qvfYData, uint32_t u32FirstSample = 0);
+
+    virtual size_t                      size() const;
+    virtual QPointF                     sample(size_t i) const;
+    virtual QRectF                      boundingRect() const;
+    virtual void                        setRectOfInterest(const QRectF &oRect);
+
+    //Bounds of the samples with X in [dXMin, dXMax]. Requires monotonic X.
+    QRectF                              boundingRect(double dXMin, double dXMax) const;
+
+    //Outside samples [u32FullResolutionBegin, u32FullResolutionEnd) only every u32CoarseStride'th sample is valid.
+    //Other samples there are presented with the value of the preceding valid sample.
+    void                                setPartialResolution(uint32_t u32FullResolutionBegin, uint32_t u32FullResolutionEnd, uint32_t u32CoarseStride);
+
+    //Min/max decimation of the samples with X in [dXMin, dXMax] into u32NColumns columns of equal width, plus the samples either side.
+    //Returns false, leaving qvoSamples empty, if X is not monotonic.
+    bool                                getDecimatedSamples(double dXMin, double dXMax, uint32_t u32NColumns, QVector<QPointF> &qvoSamples) const;
+
+    //The whole curve for export, regardless of the presented sub range. X is empty if implicit. Shallow copies unless the curve has
+    //partial resolution in which case the Y samples outside the full resolution window are filled in as presented.
+    bool                                isXImplicit() const;
+    double                              getXStart() const;
+    double                              getXStep() const;
+    QVector<double>                     getXData() const;
+    QVector<float>                      getYData() const;
+
+private:
+    static const uint32_t               BLOCK_SIZE = 1024;
+
+    QVector<double>                     m_qvdXData;
+    QVector<float>                      m_qvfYData;
+    uint32_t                            m_u32FirstSample;
+
+    //Sample u32FirstSample of each vector. The adapter never writes to its copies so these stay valid.
+    const double                        *m_pdXData;
+    const float                         *m_pfYData;
+
+    bool                                m_bXIsMonotonic;
+    uint32_t                            m_u32NTotalSamples;
+
+    //Implicit X
+    bool                                m_bImplicitX;
+    double                              m_dXStart;
+    double                              m_dXStep;
+
+    //Partial resolution
+    uint32_t                            m_u32FullResolutionBegin;
+    uint32_t                            m_u32FullResolutionEnd;
+    uint32_t                            m_u32CoarseStride;
+
+    //Sub range presented to Qwt
+    uint32_t                            m_u32Offset;
+    uint32_t                            m_u32NSamples;
+
+    //Per block Y minima and maxima, built on first use
+    mutable QVector<float>              m_qvfBlockMin;
+    mutable QVector<float>              m_qvfBlockMax;
+
+    double                              getX(uint32_t u32SampleNo) const;
+    float                               getY(uint32_t u32SampleNo) const;
+    void                                updateBlockBounds() const;
+    void                                getYBounds(uint32_t u32Begin, uint32_t u32End, float &fMin, float &fMax) const;
+    void                                getIndexRange(double dXMin, double dXMax, uint32_t &u32Begin, uint32_t &u32End) const;
+};
+
+#endif // FLOAT_QWT_SERIES_DATA_H
@@ -0,0 +1,311 @@
+//System includes
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "FrameAssembler.h"
+
+using namespace std;
+
+void cFrameAssembler::cAssemblerThread::run()
+{
+    m_pAssembler->assemblerLoop();
+}
+
+cFrameAssembler::cFrameAssembler(uint32_t u32NChannels, uint32_t u32Timeout_ms, uint32_t u32NSlotsPerChannel, QObject *pParent) :
+    QObject(pParent),
+    m_u32NChannels(u32NChannels),
+    m_u32Timeout_ms(u32Timeout_ms),
+    m_oiShutdown(0),
+    m_oiNDroppedChannels(0),
+    m_bFrameFlushed(false),
+    m_i64NewestFlushedTimestamp_us(0),
+    m_pTarget(NULL)
+{
+    //Power of 2 so that the wrapping indices map consistently to slots
+    uint32_t u32NSlots = 1;
+
+    while(u32NSlots < u32NSlotsPerChannel)
+        u32NSlots <<= 1;
+
+    m_u32SlotMask = u32NSlots - 1;
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < m_u32NChannels; u32ChannelNo++)
+    {
+        m_qvpChannelRings.push_back(new cChannelRing);
+        m_qvpChannelRings.last()->m_qvoSlots.resize(u32NSlots);
+    }
+
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    m_oClock.start();
+
+    m_pAssemblerThread = new cAssemblerThread(this);
+    m_pAssemblerThread->start();
+
+    cout << "cFrameAssembler::cFrameAssembler(): Assembling " << m_u32NChannels << " channels with " << u32NSlots
+         << " slots per channel and a timeout of " << m_u32Timeout_ms << " ms." << endl;
+}
+
+cFrameAssembler::~cFrameAssembler()
+{
+    m_oiShutdown.storeRelease(1);
+    m_oDataAvailable.release();
+
+    m_pAssemblerThread->wait();
+    delete m_pAssemblerThread;
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvpChannelRings.size(); u32ChannelNo++)
+    {
+        delete m_qvpChannelRings[u32ChannelNo];
+    }
+}
+
+void cFrameAssembler::setTarget(cQwtPlotWidgetBase *pTarget)
+{
+    QMutexLocker oLock(&m_oTargetMutex);
+
+    m_pTarget = pTarget;
+}
+
+bool cFrameAssembler::pushChannel(uint32_t u32ChannelNo, const float *pfData, uint32_t u32NBins, int64_t i64Timestamp_us)
+{
+    if(u32ChannelNo >= m_u32NChannels)
+    {
+        cout << "cFrameAssembler::pushChannel(): Warning: Channel " << u32ChannelNo << " out of range for " << m_u32NChannels << " channels. Ignoring." << endl;
+        return false;
+    }
+
+    cChannelRing *pRing = m_qvpChannelRings[u32ChannelNo];
+
+    uint32_t u32WriteIndex = pRing->m_oiWriteIndex.load();
+    uint32_t u32ReadIndex = pRing->m_oiReadIndex.loadAcquire();
+
+    if(u32WriteIndex - u32ReadIndex > m_u32SlotMask)
+    {
+        m_oiNDroppedChannels.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    //The slot is owned by this producer until the write index is published. Its buffer only reallocates if the length changes.
+    cSlot &oSlot = pRing->m_qvoSlots[u32WriteIndex & m_u32SlotMask];
+
+    oSlot.m_qvfData.resize(u32NBins);
+    copy(pfData, pfData + u32NBins, oSlot.m_qvfData.data());
+    oSlot.m_i64Timestamp_us = i64Timestamp_us;
+
+    pRing->m_oiWriteIndex.storeRelease(u32WriteIndex + 1);
+
+    m_oDataAvailable.release();
+
+    return true;
+}
+
+cFrameAssembler::cStats cFrameAssembler::getStats()
+{
+    QMutexLocker oLock(&m_oStatsMutex);
+
+    collectDroppedChannels();
+
+    return m_oStats;
+}
+
+void cFrameAssembler::resetStats()
+{
+    QMutexLocker oLock(&m_oStatsMutex);
+
+    memset(&m_oStats, 0, sizeof(m_oStats));
+    m_oiNDroppedChannels.fetchAndStoreRelaxed(0);
+}
+
+void cFrameAssembler::collectDroppedChannels()
+{
+    //Producers count into a 32 bit atomic. Moving the count into the 64 bit total regularly keeps it from wrapping.
+    m_oStats.m_u64NDroppedChannels += (uint32_t)m_oiNDroppedChannels.fetchAndStoreRelaxed(0);
+}
+
+void cFrameAssembler::assemblerLoop()
+{
+    //Wake at least a few times per timeout period to flush timed out frames
+    int iWait_ms = qMax((int)m_u32Timeout_ms / 4, 1);
+
+    while(!m_oiShutdown.loadAcquire())
+    {
+        m_oDataAvailable.tryAcquire(1, iWait_ms);
+
+        //Each push releases the semaphore once but all available data is drained here. Discard the surplus wake ups.
+        m_oDataAvailable.tryAcquire(m_oDataAvailable.available());
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < m_u32NChannels; u32ChannelNo++)
+        {
+            cChannelRing *pRing = m_qvpChannelRings[u32ChannelNo];
+
+            uint32_t u32ReadIndex = pRing->m_oiReadIndex.load();
+            uint32_t u32WriteIndex = pRing->m_oiWriteIndex.loadAcquire();
+
+            while(u32ReadIndex != u32WriteIndex)
+            {
+                placeChannel(u32ChannelNo, pRing->m_qvoSlots[u32ReadIndex & m_u32SlotMask]);
+
+                u32ReadIndex++;
+                pRing->m_oiReadIndex.storeRelease(u32ReadIndex);
+            }
+        }
+
+        deliverReadyFrames();
+    }
+}
+
+void cFrameAssembler::placeChannel(uint32_t u32ChannelNo, const cSlot &oSlot)
+{
+    //Too late to be part of a frame if a frame at or after this time has already been delivered or dropped
+    if(m_bFrameFlushed && oSlot.m_i64Timestamp_us <= m_i64NewestFlushedTimestamp_us)
+    {
+        QMutexLocker oLock(&m_oStatsMutex);
+        m_oStats.m_u64NLateChannels++;
+
+        return;
+    }
+
+    QMap<int64_t, cPendingFrame>::iterator it = m_qmoPendingFrames.find(oSlot.m_i64Timestamp_us);
+
+    if(it == m_qmoPendingFrames.end())
+    {
+        //New frame. Its length is set by the first channel to arrive.
+        cPendingFrame oFrame;
+
+        if(m_qvqvfSpareBuffers.size())
+        {
+            oFrame.m_qvfData = m_qvqvfSpareBuffers.last();
+            m_qvqvfSpareBuffers.pop_back();
+        }
+
+        oFrame.m_u32NBins = oSlot.m_qvfData.size();
+        oFrame.m_qvfData.resize(m_u32NChannels * oFrame.m_u32NBins);
+        oFrame.m_qvbReceived.fill(false, m_u32NChannels);
+        oFrame.m_u32NReceived = 0;
+        oFrame.m_i64FirstArrival_ms = m_oClock.elapsed();
+
+        it = m_qmoPendingFrames.insert(oSlot.m_i64Timestamp_us, oFrame);
+    }
+
+    cPendingFrame &oFrame = it.value();
+
+    if(oFrame.m_qvbReceived[u32ChannelNo])
+        return; //Duplicate
+
+    //Channels of a different length are truncated or zero padded
+    uint32_t u32NBins = qMin((uint32_t)oSlot.m_qvfData.size(), oFrame.m_u32NBins);
+    QVector<float>::iterator itChannel = oFrame.m_qvfData.begin() + u32ChannelNo * oFrame.m_u32NBins;
+
+    copy(oSlot.m_qvfData.constBegin(), oSlot.m_qvfData.constBegin() + u32NBins, itChannel);
+    fill(itChannel + u32NBins, itChannel + oFrame.m_u32NBins, 0.0f);
+
+    oFrame.m_qvbReceived[u32ChannelNo] = true;
+    oFrame.m_u32NReceived++;
+}
+
+void cFrameAssembler::deliverReadyFrames()
+{
+    if(m_qmoPendingFrames.empty())
+        return;
+
+    //Everything up to the newest complete frame is flushed, as is any leading run of timed out frames. Only complete frames are delivered.
+    int64_t i64NewestComplete_us = 0;
+    bool bComplete = false;
+
+    for(QMap<int64_t, cPendingFrame>::const_iterator it = m_qmoPendingFrames.constBegin(); it != m_qmoPendingFrames.constEnd(); ++it)
+    {
+        if(it.value().m_u32NReceived == m_u32NChannels)
+        {
+            i64NewestComplete_us = it.key();
+            bComplete = true;
+        }
+    }
+
+    int64_t i64Now_ms = m_oClock.elapsed();
+
+    QVector<int64_t> qvi64Timestamps_us;
+    m_qvoReadyFrames.resize(0);
+
+    uint64_t u64NIncompleteFrames = 0;
+    uint64_t u64NMissingChannels = 0;
+    bool bFlushed = false;
+
+    while(!m_qmoPendingFrames.empty())
+    {
+        QMap<int64_t, cPendingFrame>::iterator it = m_qmoPendingFrames.begin();
+
+        bool bTimedOut = i64Now_ms - it.value().m_i64FirstArrival_ms >= (int64_t)m_u32Timeout_ms;
+
+        if(!(bComplete && it.key() <= i64NewestComplete_us) && !bTimedOut)
+            break;
+
+        bFlushed = true;
+        m_i64NewestFlushedTimestamp_us = it.key();
+
+        if(it.value().m_u32NReceived == m_u32NChannels)
+        {
+            qvi64Timestamps_us.push_back(it.key());
+            m_qvoReadyFrames.push_back(it.value());
+        }
+        else
+        {
+            u64NIncompleteFrames++;
+            u64NMissingChannels += m_u32NChannels - it.value().m_u32NReceived;
+
+            m_qvqvfSpareBuffers.push_back(it.value().m_qvfData);
+        }
+
+        m_qmoPendingFrames.erase(it);
+    }
+
+    if(!bFlushed)
+        return;
+
+    m_bFrameFlushed = true;
+
+    //Stats
+    {
+        QMutexLocker oLock(&m_oStatsMutex);
+
+        collectDroppedChannels();
+
+        m_oStats.m_u64NCompleteFrames += m_qvoReadyFrames.size();
+        m_oStats.m_u64NIncompleteFrames += u64NIncompleteFrames;
+        m_oStats.m_u64NMissingChannels += u64NMissingChannels;
+    }
+
+    //Pass to the existing processing path as a single batch
+    cPlotFrameBatch oBatch;
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < (uint32_t)m_qvoReadyFrames.size(); u32FrameNo++)
+    {
+        const cPendingFrame &oFrame = m_qvoReadyFrames[u32FrameNo];
+        oBatch.addFrame(cPlotFrameView(oFrame.m_qvfData.constData(), m_u32NChannels, oFrame.m_u32NBins), qvi64Timestamps_us[u32FrameNo]);
+    }
+
+    if(oBatch.getNFrames())
+    {
+        QMutexLocker oLock(&m_oTargetMutex);
+
+        if(m_pTarget)
+            m_pTarget->addDataBatch(oBatch, QVector<uint32_t>());
+    }
+
+    //Recycle the buffers
+    for(uint32_t u32FrameNo = 0; u32FrameNo < (uint32_t)m_qvoReadyFrames.size(); u32FrameNo++)
+    {
+        m_qvqvfSpareBuffers.push_back(m_qvoReadyFrames[u32FrameNo].m_qvfData);
+    }
+
+    m_qvoReadyFrames.resize(0);
+
+    //Bound the spare pool
+    if(m_qvqvfSpareBuffers.size() > 16)
+        m_qvqvfSpareBuffers.resize(16);
+}
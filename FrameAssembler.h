@@ -0,0 +1,138 @@
+//Assembles multi-channel frames from channels pushed independently by several producer threads (e.g. one per polarisation or beam).
+//Each channel has its own lock free single producer / single consumer ring of slots. An assembler thread matches channels by
+//timestamp and passes each frame to the target widget's addDataBatch() once every channel has arrived.
+//Frames are always delivered in timestamp order. A frame still incomplete at the timeout, or when a newer frame completes, is dropped
+//rather than delivered with made up channels. Dropped frames, their missing channels and dropped and late channels are counted in the stats.
+//Intended for framed type data (spectra etc.) where the X scale is implicit.
+
+#ifndef FRAME_ASSEMBLER_H
+#define FRAME_ASSEMBLER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QMap>
+
+//Local includes
+#include "QwtPlotWidgetBase.h"
+
+class cFrameAssembler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NCompleteFrames;
+        uint64_t                        m_u64NIncompleteFrames; //Dropped for missing channels
+        uint64_t                        m_u64NMissingChannels;  //Summed over incomplete frames
+        uint64_t                        m_u64NDroppedChannels;  //Producer found its ring full
+        uint64_t                        m_u64NLateChannels;     //Arrived after their frame (or a newer one) had been delivered or dropped
+    };
+
+    //The number of slots per channel is rounded up to a power of 2
+    explicit cFrameAssembler(uint32_t u32NChannels, uint32_t u32Timeout_ms = 100, uint32_t u32NSlotsPerChannel = 16, QObject *pParent = 0);
+    ~cFrameAssembler();
+
+    //Widget to pass assembled frames to, called on the assembler thread. Set to NULL before deleting the widget.
+    void                                setTarget(cQwtPlotWidgetBase *pTarget);
+
+    //Lock free. There must be only one producer thread per channel. Returns false if the channel's ring is full and the data was dropped.
+    bool                                pushChannel(uint32_t u32ChannelNo, const float *pfData, uint32_t u32NBins, int64_t i64Timestamp_us);
+
+    uint32_t                            getNChannels() const {return m_u32NChannels;}
+
+    cStats                              getStats();
+    void                                resetStats();
+
+private:
+    class cAssemblerThread : public QThread
+    {
+    public:
+        explicit cAssemblerThread(cFrameAssembler *pAssembler) : m_pAssembler(pAssembler) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cFrameAssembler                 *m_pAssembler;
+    };
+
+    struct cSlot
+    {
+        QVector<float>                  m_qvfData;
+        int64_t                         m_i64Timestamp_us;
+    };
+
+    //Write index is only modified by the producer, read index only by the assembler thread. Indices increase monotonically and wrap.
+    struct cChannelRing
+    {
+        QVector<cSlot>                  m_qvoSlots;
+        QAtomicInt                      m_oiWriteIndex;
+        QAtomicInt                      m_oiReadIndex;
+    };
+
+    struct cPendingFrame
+    {
+        QVector<float>                  m_qvfData; //Channel-major
+        uint32_t                        m_u32NBins;
+        QVector<bool>                   m_qvbReceived;
+        uint32_t                        m_u32NReceived;
+        int64_t                         m_i64FirstArrival_ms;
+    };
+
+    uint32_t                            m_u32NChannels;
+    uint32_t                            m_u32Timeout_ms;
+    uint32_t                            m_u32SlotMask;
+
+    QVector<cChannelRing*>              m_qvpChannelRings;
+    QSemaphore                          m_oDataAvailable;
+    QAtomicInt                          m_oiShutdown;
+    QAtomicInt                          m_oiNDroppedChannels;
+
+    cAssemblerThread                    *m_pAssemblerThread;
+
+    //Assembler thread only
+    QMap<int64_t, cPendingFrame>        m_qmoPendingFrames;
+    QVector<cPendingFrame>              m_qvoReadyFrames;
+    QVector<QVector<float> >            m_qvqvfSpareBuffers; //Recycled frame buffers
+    QElapsedTimer                       m_oClock;
+    bool                                m_bFrameFlushed;
+    int64_t                             m_i64NewestFlushedTimestamp_us; //Newest frame delivered or dropped
+
+    QMutex                              m_oTargetMutex;
+    cQwtPlotWidgetBase                  *m_pTarget;
+
+    QMutex                              m_oStatsMutex;
+    cStats                              m_oStats;
+
+    void                                assemblerLoop();
+
+    //Adds m_oiNDroppedChannels to m_oStats. Requires m_oStatsMutex.
+    void                                collectDroppedChannels();
+    void                                placeChannel(uint32_t u32ChannelNo, const cSlot &oSlot);
+    void                                deliverReadyFrames();
+};
+
+#endif // FRAME_ASSEMBLER_H
@@ -0,0 +1,153 @@
+//System includes
+#include <iostream>
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+#include <QPainter>
+#include <QFile>
+#include <QFileInfo>
+#include <QChar>
+
+//Local includes
+#include "FrameCapture.h"
+
+using namespace std;
+
+cFrameCaptureWriter::cFrameCaptureWriter(const QString &qstrFilenamePattern, const QSize &oFrameSize, uint32_t u32NBuffers, QObject *pParent) :
+    QObject(pParent),
+    m_qstrFilenamePattern(qstrFilenamePattern),
+    m_bRaw(false)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    QFileInfo oFileInfo(qstrFilenamePattern);
+
+    m_bRaw = (oFileInfo.suffix().toLower() == QString("raw"));
+
+    //Number the frames before the suffix if the pattern does not say where
+    if(!m_qstrFilenamePattern.contains(QString("%1")))
+    {
+        if(oFileInfo.suffix().isEmpty())
+            m_qstrFilenamePattern += QString("_%1.png");
+        else
+            m_qstrFilenamePattern = m_qstrFilenamePattern.left(m_qstrFilenamePattern.length() - oFileInfo.suffix().length() - 1) + QString("_%1.")
+                    + oFileInfo.suffix();
+    }
+
+    if(!u32NBuffers)
+        u32NBuffers = 1;
+
+    m_qvoBuffers.resize(u32NBuffers);
+    m_qvoFrameJobs.resize(u32NBuffers);
+
+    for(uint32_t u32BufferNo = 0; u32BufferNo < u32NBuffers; u32BufferNo++)
+    {
+        if(!oFrameSize.isEmpty())
+            m_qvoBuffers[u32BufferNo] = QImage(oFrameSize, QImage::Format_ARGB32_Premultiplied);
+
+        m_qvoFrameJobs[u32BufferNo].m_u32BufferNo = u32BufferNo;
+        m_qu32FreeBuffers.enqueue(u32BufferNo);
+    }
+
+    startWriter();
+}
+
+cFrameCaptureWriter::~cFrameCaptureWriter()
+{
+    stopWriter();
+
+    cout << "cFrameCaptureWriter::~cFrameCaptureWriter(): Captured " << m_oStats.m_u64NFramesCaptured << " frames to " << m_qstrFilenamePattern.toStdString()
+         << ", dropped " << m_oStats.m_u64NFramesDropped << ", failed to write " << m_oStats.m_u64NWriteFailures << endl;
+}
+
+bool cFrameCaptureWriter::captureFrame(const QPixmap &oFrame)
+{
+    cFrameJob *pFrameJob;
+
+    {
+        QMutexLocker oLock(&m_oWriterMutex);
+
+        if(m_qu32FreeBuffers.isEmpty())
+        {
+            m_oStats.m_u64NFramesDropped++;
+            return false;
+        }
+
+        pFrameJob = &m_qvoFrameJobs[m_qu32FreeBuffers.dequeue()];
+        pFrameJob->m_u64FrameNo = m_oStats.m_u64NFramesCaptured++;
+    }
+
+    //The buffer is ours until it is queued so it is filled without holding the lock
+    QImage &oBuffer = m_qvoBuffers[pFrameJob->m_u32BufferNo];
+
+    if(oBuffer.size() != oFrame.size())
+        oBuffer = QImage(oFrame.size(), QImage::Format_ARGB32_Premultiplied);
+
+    QPainter oPainter(&oBuffer);
+    oPainter.setCompositionMode(QPainter::CompositionMode_Source);
+    oPainter.drawPixmap(0, 0, oFrame);
+    oPainter.end();
+
+    submitJob(pFrameJob);
+
+    return true;
+}
+
+cFrameCaptureWriter::cStats cFrameCaptureWriter::getStats()
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    return m_oStats;
+}
+
+bool cFrameCaptureWriter::writeJob(cJob *pJob)
+{
+    cFrameJob *pFrameJob = static_cast<cFrameJob*>(pJob);
+
+    return writeFrame(m_qvoBuffers[pFrameJob->m_u32BufferNo], m_qstrFilenamePattern.arg((qulonglong)pFrameJob->m_u64FrameNo, 6, 10, QChar('0')));
+}
+
+void cFrameCaptureWriter::jobFinished(cJob *pJob, bool bSuccess)
+{
+    //The jobs belong to the buffers so they are recycled rather than deleted
+    if(bSuccess)
+        m_oStats.m_u64NFramesWritten++;
+    else
+        m_oStats.m_u64NWriteFailures++;
+
+    m_qu32FreeBuffers.enqueue(static_cast<cFrameJob*>(pJob)->m_u32BufferNo);
+}
+
+bool cFrameCaptureWriter::writeFrame(const QImage &oImage, const QString &qstrFilename)
+{
+    if(!m_bRaw)
+    {
+        if(!oImage.save(qstrFilename))
+        {
+            cout << "cFrameCaptureWriter::writeFrame(): Warning: Unable to write " << qstrFilename.toStdString() << endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    QFile oFile(qstrFilename);
+
+    if(!oFile.open(QIODevice::WriteOnly))
+    {
+        cout << "cFrameCaptureWriter::writeFrame(): Warning: Unable to open " << qstrFilename.toStdString() << " for writing." << endl;
+        return false;
+    }
+
+    //32 bit pixels so rows are never padded
+    qint64 i64Size_B = (qint64)oImage.bytesPerLine() * oImage.height();
+
+    if(oFile.write(reinterpret_cast<const char*>(oImage.constBits()), i64Size_B) != i64Size_B)
+    {
+        cout << "cFrameCaptureWriter::writeFrame(): Warning: Unable to write " << qstrFilename.toStdString() << endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,90 @@
+//Capture of every frame drawn by a plot to a numbered image sequence (see cQwtPlotWidgetBase::enableFrameCapture()).
+//
+//The GUI thread copies each frame into one of a fixed pool of preallocated images, which is a single blit, and queues it.
+//A writer thread encodes queued frames to files and hands the images back to the pool. If the writer falls behind and the
+//pool runs dry, frames are dropped and counted rather than blocking the GUI thread or allocating more memory.
+//
+//Files are named by replacing "%1" in the filename pattern with the zero padded frame number (counting only frames kept).
+//A "raw" suffix writes the bare pixels (32 bit ARGB premultiplied, native byte order, rows without padding) for lossless video
+//encoding at speed, e.g. ffmpeg -f rawvideo -pix_fmt bgra -s WxH -i frame_%06d.raw on little endian hosts. Any other suffix
+//is written in that image format.
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QQueue>
+#include <QVector>
+#include <QString>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+
+//Local includes
+#include "BackgroundWriter.h"
+
+class cFrameCaptureWriter : public QObject, public cBackgroundWriter
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NFramesCaptured;
+        uint64_t                        m_u64NFramesDropped;    //No free buffer as the writer was behind
+        uint64_t                        m_u64NFramesWritten;
+        uint64_t                        m_u64NWriteFailures;
+    };
+
+    //Buffers are allocated up front at the given frame size. A frame of a different size reallocates the buffer it is copied into.
+    cFrameCaptureWriter(const QString &qstrFilenamePattern, const QSize &oFrameSize, uint32_t u32NBuffers = 8, QObject *pParent = 0);
+    ~cFrameCaptureWriter(); //Writes out any queued frames
+
+    //Copies the frame into a free buffer and queues it for writing. Returns false, counting a dropped frame, if no buffer is free.
+    bool                                captureFrame(const QPixmap &oFrame);
+
+    cStats                              getStats();
+
+private:
+    //One per buffer, submitted while its buffer is queued and otherwise idle
+    struct cFrameJob : public cJob
+    {
+        uint32_t                        m_u32BufferNo;
+        uint64_t                        m_u64FrameNo;
+    };
+
+    QString                             m_qstrFilenamePattern;
+    bool                                m_bRaw;
+
+    //Each buffer is only touched by the thread that holds its number: the GUI thread while it is free, the writer while it is queued
+    QVector<QImage>                     m_qvoBuffers;
+    QVector<cFrameJob>                  m_qvoFrameJobs;
+
+    //Protected by m_oWriterMutex
+    QQueue<uint32_t>                    m_qu32FreeBuffers;
+    cStats                              m_oStats;
+
+    virtual bool                        writeJob(cJob *pJob);
+    virtual void                        jobFinished(cJob *pJob, bool bSuccess);
+
+    bool                                writeFrame(const QImage &oImage, const QString &qstrFilename);
+};
+
+#endif // FRAME_CAPTURE_H
@@ -1,6 +1,8 @@
 //System includes
 #include <cmath>
 #include <iostream>
+#include <algorithm>
+#include <cfloat>
 
 //Library includes
 #include <qwt_scale_widget.h>
@@ -13,11 +15,15 @@ using namespace std;
 
 cFramedQwtLinePlotWidget::cFramedQwtLinePlotWidget(QWidget *pParent) :
     cBasicQwtLinePlotWidget(pParent),
-    m_u32NextHistoryInputIndex(0),
     m_u32Averaging(1),
     m_dXBegin(0.0),
     m_dXEnd(1.0),
-    m_bXSpanChanged(true)
+    m_bVisibleRangeProcessing(true),
+    m_dVisibleXBegin(-DBL_MAX),
+    m_dVisibleXEnd(DBL_MAX),
+    m_oResolution(),
+    m_oPublishedResolution(),
+    m_oDisplayedResolution()
 {
     //Add averaging control to GUI
     m_pAveragingLabel = new QLabel(QString("Averaging"), this);
@@ -51,197 +57,473 @@ cFramedQwtLinePlotWidget::~cFramedQwtLinePlotWidget()
 
 void cFramedQwtLinePlotWidget::addData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
 {
-    //Pass the first channel of the Y data as the X array.
+    addData(cPlotFrameView(qvvfYData), i64Timestamp_us, qvu32ChannelList);
+}
+
+void cFramedQwtLinePlotWidget::addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!oYData.getNChannels())
+        return;
+
     //Only the length information is needed to update the X scale.
-    cBasicQwtLinePlotWidget::addData(qvvfYData[0], qvvfYData, i64Timestamp_us, qvu32ChannelList);
+    uint32_t u32NBins = oYData.getNBins(qvu32ChannelList.empty() ? 0 : qvu32ChannelList[0]);
+
+    cBasicQwtLinePlotWidget::addData(NULL, u32NBins, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    addDataToWaterfallPlots(i64Timestamp_us);
+}
+
+void cFramedQwtLinePlotWidget::addData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!oYData.getNChannels())
+        return;
+
+    cBasicQwtLinePlotWidget::addData(NULL, oYData.getNBins(), oYData, i64Timestamp_us, qvu32ChannelList);
+
+    addDataToWaterfallPlots(i64Timestamp_us);
+}
+
+void cFramedQwtLinePlotWidget::addData(const cSharedPlotFrame &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !oYData.getNChannels())
+        return;
+
+    recordFrame(NULL, 0, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+
+    processXData(NULL, oYData.getNBins(), i64Timestamp_us);
+
+    //Keep a reference to the frame in the history instead of copying it
+    cAveragingStage::cHistoryEntry &oEntry = nextAverageHistoryEntry(u32NChannels, oYData.getNBins());
+
+    oEntry.m_oFrame = oYData;
+    oEntry.m_qvu32ChannelList = qvu32ChannelList;
+
+    updateAverage(u32NChannels, oYData.getNBins());
+
+    plotProcessedData(i64Timestamp_us);
+
+    addDataToWaterfallPlots(i64Timestamp_us);
+}
+
+void cFramedQwtLinePlotWidget::addTimeDomainData(const cPlotFrameView &oTimeData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !oTimeData.getNChannels())
+        return;
+
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oTimeData.getNChannels() : qvu32ChannelList.size();
+    uint32_t u32NSamples = oTimeData.getNBins(qvu32ChannelList.empty() ? 0 : qvu32ChannelList[0]);
+    uint32_t u32NBins = cSpectrumStage::getNBins(u32NSamples);
+
+    processXData(NULL, u32NBins, i64Timestamp_us);
 
+    //Transform straight into the history slot
+    cAveragingStage::cHistoryEntry &oEntry = nextAverageHistoryEntry(u32NChannels, u32NBins);
+
+    oEntry.m_qvu32ChannelList.clear();
+    oEntry.m_oFrame.reshape(u32NChannels, u32NBins);
+
+    m_oSpectrumStage.process(oTimeData, qvu32ChannelList, u32NSamples, oEntry.m_oFrame.getWritableData());
+
+    //Recorded as the spectra which entered the plot
+    recordFrame(NULL, 0, oEntry.m_oFrame, i64Timestamp_us, oEntry.m_qvu32ChannelList);
+
+    updateAverage(u32NChannels, u32NBins);
+
+    plotProcessedData(i64Timestamp_us);
+
+    addDataToWaterfallPlots(i64Timestamp_us);
+}
+
+void cFramedQwtLinePlotWidget::setFFTWindow(uint32_t u32Window)
+{
+    m_oSpectrumStage.setWindow(u32Window);
+}
+
+void cFramedQwtLinePlotWidget::addPolarisationData(const float *pfX, const float *pfY, uint32_t u32NBins, uint32_t u32BinStride, int64_t i64Timestamp_us)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !u32NBins)
+        return;
+
+    QVector<uint32_t> qvu32Products = m_oStokesStage.getProducts();
+    uint32_t u32NChannels = qvu32Products.size();
+
+    if(!u32NChannels)
+        return;
+
+    processXData(NULL, u32NBins, i64Timestamp_us);
+
+    QVector<bool> qvbSignedChannels(u32NChannels);
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
     {
-        QReadLocker oLock(&m_oWaterfallPlotMutex);
+        qvbSignedChannels[u32ChannelNo] = cStokesStage::isSigned(qvu32Products[u32ChannelNo]);
+    }
 
-        //Also pass data to any existing waterfall plots
-        for(uint32_t ui = 0; ui < (uint32_t)m_qvpWaterfallPlots.size(); ui++)
-        {
-            m_qvpWaterfallPlots[ui]->addData(qvvfYData[ qvu32ChannelList[m_qvpWaterfallPlots[ui]->getChannelNo()] ], i64Timestamp_us);
-        }
+    //Products are written straight into the history slot
+    cAveragingStage::cHistoryEntry &oEntry = nextAverageHistoryEntry(u32NChannels, u32NBins, qvbSignedChannels);
+
+    oEntry.m_qvu32ChannelList.clear();
+    oEntry.m_oFrame.reshape(u32NChannels, u32NBins);
+
+    cStokesStage::process(pfX, pfY, u32NBins, u32BinStride, qvu32Products, oEntry.m_oFrame.getWritableData());
+
+    //Recorded as the products which entered the plot
+    recordFrame(NULL, 0, oEntry.m_oFrame, i64Timestamp_us, oEntry.m_qvu32ChannelList);
+
+    updateAverage(u32NChannels, u32NBins);
+
+    plotProcessedData(i64Timestamp_us);
+
+    addDataToWaterfallPlots(i64Timestamp_us);
+}
+
+void cFramedQwtLinePlotWidget::setStokesProducts(const QVector<uint32_t> &qvu32Products)
+{
+    m_oStokesStage.setProducts(qvu32Products);
+}
+
+void cFramedQwtLinePlotWidget::addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !oBatch.getNFrames())
+        return;
+
+    recordBatch(oBatch, qvu32ChannelList);
+
+    uint32_t u32NFrames = oBatch.getNFrames();
+    const cPlotFrameView &oNewest = oBatch.getFrame(u32NFrames - 1);
+
+    if(!oNewest.getNChannels())
+        return;
+
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oNewest.getNChannels() : qvu32ChannelList.size();
+    uint32_t u32NBins = oNewest.getNBins(qvu32ChannelList.empty() ? 0 : qvu32ChannelList[0]);
+    int64_t i64Timestamp_us = oBatch.getTimestamp_us(u32NFrames - 1);
+
+    processXData(NULL, u32NBins, i64Timestamp_us);
+
+    m_oMutex.lockForRead(); //Ensure averaging doesn't change during this section
+    uint32_t u32Averaging = m_u32Averaging;
+    m_oMutex.unlock();
+
+    //Older frames would be overwritten within this batch so only the newest u32Averaging frames enter the history.
+    //The average is then computed once for the whole batch.
+    uint32_t u32FirstFrameNo = u32NFrames > u32Averaging ? u32NFrames - u32Averaging : 0;
+
+    for(uint32_t u32FrameNo = u32FirstFrameNo; u32FrameNo < u32NFrames; u32FrameNo++)
+    {
+        copyFrameToHistory(oBatch.getFrame(u32FrameNo), qvu32ChannelList, u32NChannels, u32NBins,
+                           m_oAveragingStage.nextEntry(u32NChannels, u32NBins, u32Averaging));
+    }
+
+    updateAverage(u32NChannels, u32NBins);
+
+    plotProcessedData(i64Timestamp_us);
+
+    //Waterfalls average over time themselves and so receive every frame
+    QReadLocker oLock(&m_oWaterfallPlotMutex);
+
+    for(uint32_t ui = 0; ui < (uint32_t)m_qvpWaterfallPlots.size(); ui++)
+    {
+        uint32_t u32CurveNo = m_qvpWaterfallPlots[ui]->getChannelNo();
+
+        if(u32CurveNo >= u32NChannels)
+            continue;
+
+        m_qvpWaterfallPlots[ui]->addDataBatch(oBatch, qvu32ChannelList.empty() ? u32CurveNo : qvu32ChannelList[u32CurveNo]);
     }
 }
 
-void cFramedQwtLinePlotWidget::processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us)
+void cFramedQwtLinePlotWidget::addDataToWaterfallPlots(int64_t i64Timestamp_us)
 {
+    QReadLocker oLock(&m_oWaterfallPlotMutex);
+
+    if(m_oAveragingStage.isEmpty())
+        return;
+
+    //Pass the newest (unaveraged) frame to any existing waterfall plots. Waterfall channel numbers are plot curve indices.
+    const cAveragingStage::cHistoryEntry &oNewest = m_oAveragingStage.getNewestEntry();
+
+    for(uint32_t ui = 0; ui < (uint32_t)m_qvpWaterfallPlots.size(); ui++)
+    {
+        uint32_t u32CurveNo = m_qvpWaterfallPlots[ui]->getChannelNo();
+
+        if(u32CurveNo >= (uint32_t)m_qvvfYDataToPlot.size())
+            continue;
+
+        uint32_t u32ChannelNo = oNewest.m_qvu32ChannelList.empty() ? u32CurveNo : oNewest.m_qvu32ChannelList[u32CurveNo];
+
+        m_qvpWaterfallPlots[ui]->addData(oNewest.m_oFrame.getChannel(u32ChannelNo), oNewest.m_oFrame.getNBins(), i64Timestamp_us);
+    }
+}
+
+void cFramedQwtLinePlotWidget::processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us)
+{
+    Q_UNUSED(pfXData);
     Q_UNUSED(i64Timestamp_us);
 
     //Update X data
     //Generate our own scale based on the span member values. Only use the size of passed array. Not the data.
+    //The scale is uniform so it is stored implicitly as a start and step rather than as a vector of X values.
 
     m_oMutex.lockForRead(); //Ensure span doesn't change during this section
 
-    if((uint32_t)m_qvdXDataToPlot.size() != (uint32_t)qvfXData.size() || m_bXSpanChanged)
-    {
-        m_qvdXDataToPlot.resize(qvfXData.size());
+    double dInterval = u32NSamples > 1 ? (m_dXEnd - m_dXBegin) / (double)(u32NSamples - 1) : 0.0;
 
-        double dInterval = (m_dXEnd - m_dXBegin) / (double)(m_qvdXDataToPlot.size() - 1);
+    setImplicitXData(m_dXBegin, dInterval, u32NSamples);
 
-        for(uint32_t u32XTick = 0; u32XTick < (uint32_t)m_qvdXDataToPlot.size(); u32XTick++)
-        {
-            m_qvdXDataToPlot[u32XTick] = m_dXBegin + u32XTick * dInterval;
-        }
-    }
+    updateProcessedBinRanges(u32NSamples);
 
     m_oMutex.unlock();
 }
 
-void cFramedQwtLinePlotWidget::processYData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+void cFramedQwtLinePlotWidget::processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
 {
     Q_UNUSED(i64Timestamp_us);
 
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+    uint32_t u32NBins = oYData.getNBins(qvu32ChannelList.empty() ? 0 : qvu32ChannelList[0]);
+
+    copyFrameToHistory(oYData, qvu32ChannelList, u32NChannels, u32NBins, nextAverageHistoryEntry(u32NChannels, u32NBins));
+
+    updateAverage(u32NChannels, u32NBins);
+}
+
+void cFramedQwtLinePlotWidget::copyFrameToHistory(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, uint32_t u32NChannels, uint32_t u32NBins,
+                                                  cAveragingStage::cHistoryEntry &oEntry)
+{
+    //Copy the selected channels into the history slot. The slot's buffer is reused unless it is still referenced elsewhere.
+    oEntry.m_qvu32ChannelList.clear();
+    oEntry.m_oFrame.reshape(u32NChannels, u32NBins);
+
     if(qvu32ChannelList.empty())
+        copyYDataToHistory(oYData, cIdentityChannelSelection(), u32NChannels, u32NBins, oEntry.m_oFrame.getWritableData());
+    else
+        copyYDataToHistory(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels, u32NBins, oEntry.m_oFrame.getWritableData());
+}
+
+template<typename tChannelSelection>
+void cFramedQwtLinePlotWidget::copyYDataToHistory(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels, uint32_t u32NBins, float *pfHistory)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
     {
-        //Check that our history and output array has the right number of channels
-        if(m_qvvvfAverageHistory.size() != qvvfYData.size())
-        {
-            m_qvvvfAverageHistory.resize(qvvfYData.size());
-            m_qvvdYDataToPlot.resize(qvvfYData.size());
-        }
+        uint32_t u32InputChannelNo = oSelection.getInputChannelNo(u32ChannelNo);
+        uint32_t u32NInputBins = qMin(oYData.getNBins(u32InputChannelNo), u32NBins);
 
-        //Update history length
-        m_oMutex.lockForRead(); //Ensure averaging doesn't change during this section
+        cPlotKernels::apply<cCopyOperation>(oYData.getChannel(u32InputChannelNo), pfHistory + u32ChannelNo * u32NBins, u32NInputBins);
 
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvvfAverageHistory.size(); u32ChannelNo++)
-        {
-            //If shortening history simply delete the entries
-            //Otherwise extend onces per sample update using the new history place to store the new data.
-            //Simply resizing on enlarge would result in in signal level droppout until all entries have been used.
-            if((uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size() > m_u32Averaging)
-            {
-                m_qvvvfAverageHistory[u32ChannelNo].resize(m_u32Averaging);
-            }
-            else if((uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size() < m_u32Averaging)
-            {
-                m_qvvvfAverageHistory[u32ChannelNo].resize(m_qvvvfAverageHistory[u32ChannelNo].size() + 1);
-                m_u32NextHistoryInputIndex = m_qvvvfAverageHistory[u32ChannelNo].size() - 1;
-            }
+        //Pad short channels
+        std::fill(pfHistory + u32ChannelNo * u32NBins + u32NInputBins, pfHistory + (u32ChannelNo + 1) * u32NBins, 0.0f);
+    }
+}
 
-            //Also ensure that all new history frames are the same size as the input data
-            for(uint32_t u32HistoryEntry = 0; u32HistoryEntry < (uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size(); u32HistoryEntry++)
-            {
-                m_qvvvfAverageHistory[u32ChannelNo][u32HistoryEntry].resize(qvvfYData[u32ChannelNo].size());
-            }
+bool cFramedQwtLinePlotWidget::processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    Q_UNUSED(i64Timestamp_us);
 
-            //Update number of samples in the array sent to the plotting widget too
-            m_qvvdYDataToPlot[u32ChannelNo].resize(qvvfYData[u32ChannelNo].size());
-        }
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+    uint32_t u32NBins = oYData.getNBins();
 
-        m_oMutex.unlock();
+    //Convert the selected channels straight into the history slot. Averaging is done on linear values
+    //so the log conversion cannot be fused here and is left to plotProcessedData().
+    cAveragingStage::cHistoryEntry &oEntry = nextAverageHistoryEntry(u32NChannels, u32NBins);
 
-        //Wrap history circular buffer as necessary
-        if(m_u32NextHistoryInputIndex >= (uint32_t)m_qvvvfAverageHistory[0].size())
-        {
-            m_u32NextHistoryInputIndex = 0;
-        }
+    oEntry.m_qvu32ChannelList.clear();
+    oEntry.m_oFrame.reshape(u32NChannels, u32NBins);
 
-        //Copy data into history
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvvfAverageHistory.size(); u32ChannelNo++)
-        {
-            std::copy(qvvfYData[u32ChannelNo].begin(), qvvfYData[u32ChannelNo].end(), m_qvvvfAverageHistory[u32ChannelNo][m_u32NextHistoryInputIndex].begin());
-        }
+    float *pfHistory = oEntry.m_oFrame.getWritableData();
 
-        //Increment index for next data input
-        m_u32NextHistoryInputIndex++;
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        uint32_t u32InputChannelNo = qvu32ChannelList.empty() ? u32ChannelNo : qvu32ChannelList[u32ChannelNo];
 
-        //Calculate Y data average to plot
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvdYDataToPlot.size(); u32ChannelNo++)
-        {
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 0.0;
+        oYData.convertChannel(u32InputChannelNo, pfHistory + u32ChannelNo * u32NBins);
+    }
 
-                //Sum
-                for(uint32_t u32HistoryEntry = 0; u32HistoryEntry < (uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size(); u32HistoryEntry++)
-                {
-                    m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] += m_qvvvfAverageHistory[u32ChannelNo][u32HistoryEntry][u32SampleNo];
-                }
+    updateAverage(u32NChannels, u32NBins);
 
-                //Divide
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] /= m_qvvvfAverageHistory[u32ChannelNo].size();
+    return false;
+}
 
-                //cout << "m_qvvdYDataToPlot[" << u32ChannelNo << "][" << u32SampleNo << "] = " << m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] << endl;
-            }
-        }
+cAveragingStage::cHistoryEntry& cFramedQwtLinePlotWidget::nextAverageHistoryEntry(uint32_t u32NChannels, uint32_t u32NBins, const QVector<bool> &qvbSignedChannels)
+{
+    //Only the ingest thread writes the flags so they can be compared without the lock
+    if(qvbSignedChannels != m_qvbSignedChannels)
+    {
+        QWriteLocker oLock(&m_oMutex);
+        m_qvbSignedChannels = qvbSignedChannels;
     }
-    else
+
+    m_oMutex.lockForRead(); //Ensure averaging doesn't change during this section
+    uint32_t u32Averaging = m_u32Averaging;
+    m_oMutex.unlock();
+
+    return m_oAveragingStage.nextEntry(u32NChannels, u32NBins, u32Averaging);
+}
+
+bool cFramedQwtLinePlotWidget::isSignedChannel(uint32_t u32ChannelNo) const
+{
+    return u32ChannelNo < (uint32_t)m_qvbSignedChannels.size() && m_qvbSignedChannels[u32ChannelNo];
+}
+
+void cFramedQwtLinePlotWidget::updateAverage(uint32_t u32NChannels, uint32_t u32NBins)
+{
+    //Calculate Y data average to plot. Only the bins selected for this frame are averaged.
+    //The full history is retained so that other bins are recalculated as soon as they are next in view.
+    m_oAveragingStage.process(m_qvoProcessedBinRanges, u32NChannels, u32NBins, m_qvvfYDataToPlot);
+
+    //The GUI thread presents the curves by the resolution of the data last written
+    QWriteLocker oLock(&m_oMutex);
+    m_oPublishedResolution = m_oResolution;
+}
+
+void cFramedQwtLinePlotWidget::updateProcessedBinRanges(uint32_t u32NBins)
+{
+    //Called with m_oMutex held for reading.
+
+    m_oResolution.m_u32FullResolutionBegin = 0;
+    m_oResolution.m_u32FullResolutionEnd = u32NBins;
+    m_oResolution.m_u32CoarseStride = 1;
+
+    if(m_bVisibleRangeProcessing && u32NBins > COARSE_RESOLUTION_N_BINS && m_dImplicitXStep > 0.0)
     {
-        //Check that our history and output array has the right number of channels
-        if(m_qvvvfAverageHistory.size() != qvu32ChannelList.size())
+        //Visible bins plus half the visible width either side so that small pans stay at full resolution
+        double dBegin = (m_dVisibleXBegin - m_dImplicitXStart) / m_dImplicitXStep;
+        double dEnd = (m_dVisibleXEnd - m_dImplicitXStart) / m_dImplicitXStep;
+        double dMargin = (dEnd - dBegin) / 2.0;
+
+        uint32_t u32Begin = (uint32_t)qBound(0.0, floor(dBegin - dMargin), (double)u32NBins);
+        uint32_t u32End = (uint32_t)qBound(0.0, ceil(dEnd + dMargin) + 1.0, (double)u32NBins);
+
+        //Only worthwhile if most of the spectrum is out of view
+        if((uint64_t)(u32End - u32Begin) * 2 < u32NBins)
         {
-            m_qvvvfAverageHistory.resize(qvu32ChannelList.size());
-            m_qvvdYDataToPlot.resize(qvu32ChannelList.size());
+            m_oResolution.m_u32FullResolutionBegin = u32Begin;
+            m_oResolution.m_u32FullResolutionEnd = u32End;
+            m_oResolution.m_u32CoarseStride = u32NBins / COARSE_RESOLUTION_N_BINS;
         }
+    }
+
+    m_qvoProcessedBinRanges.resize(0);
 
-        //Update history length
-        m_oMutex.lockForRead(); //Ensure averaging doesn't change during this section
+    cAveragingStage::cBinRange oRange;
+
+    if(m_oResolution.m_u32CoarseStride == 1)
+    {
+        oRange.m_u32Begin = 0;
+        oRange.m_u32End = u32NBins;
+        oRange.m_u32Stride = 1;
+        m_qvoProcessedBinRanges.push_back(oRange);
+
+        return;
+    }
+
+    //Coarse bins below the window
+    oRange.m_u32Begin = 0;
+    oRange.m_u32End = m_oResolution.m_u32FullResolutionBegin;
+    oRange.m_u32Stride = m_oResolution.m_u32CoarseStride;
+    m_qvoProcessedBinRanges.push_back(oRange);
+
+    //Full resolution window
+    oRange.m_u32Begin = m_oResolution.m_u32FullResolutionBegin;
+    oRange.m_u32End = m_oResolution.m_u32FullResolutionEnd;
+    oRange.m_u32Stride = 1;
+    m_qvoProcessedBinRanges.push_back(oRange);
+
+    //Coarse bins above the window. These stay on the same grid as those below.
+    oRange.m_u32Begin = (m_oResolution.m_u32FullResolutionEnd + m_oResolution.m_u32CoarseStride - 1) / m_oResolution.m_u32CoarseStride * m_oResolution.m_u32CoarseStride;
+    oRange.m_u32End = u32NBins;
+    oRange.m_u32Stride = m_oResolution.m_u32CoarseStride;
+    m_qvoProcessedBinRanges.push_back(oRange);
+}
 
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvvfAverageHistory.size(); u32ChannelNo++)
+void cFramedQwtLinePlotWidget::logConversion()
+{
+    logConvertProcessedBins(10.0);
+}
+
+void cFramedQwtLinePlotWidget::powerLogConversion()
+{
+    logConvertProcessedBins(20.0);
+}
+
+void cFramedQwtLinePlotWidget::logConvertProcessedBins(double dFactor)
+{
+    //As for the base implementation but only for bins that were averaged for this frame.
+    //The others already hold converted values from earlier frames.
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfYDataToPlot.size(); u32ChannelNo++)
+    {
+        if(isSignedChannel(u32ChannelNo))
+            continue;
+
+        float *pfYDataToPlot = m_qvvfYDataToPlot[u32ChannelNo].data();
+        uint32_t u32NBins = m_qvvfYDataToPlot[u32ChannelNo].size();
+
+        for(uint32_t u32RangeNo = 0; u32RangeNo < (uint32_t)m_qvoProcessedBinRanges.size(); u32RangeNo++)
         {
-            //If shortening history simply delete the entries
-            //Otherwise extend onces per sample update using the new history place to store the new data.
-            //Simply resizing on enlarge would result in in signal level droppout until all entries have been used.
-            if((uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size() > m_u32Averaging)
-            {
-                m_qvvvfAverageHistory[u32ChannelNo].resize(m_u32Averaging);
-            }
-            else if((uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size() < m_u32Averaging)
-            {
-                m_qvvvfAverageHistory[u32ChannelNo].resize(m_qvvvfAverageHistory[u32ChannelNo].size() + 1);
-                m_u32NextHistoryInputIndex = m_qvvvfAverageHistory[u32ChannelNo].size() - 1;
-            }
+            const cAveragingStage::cBinRange &oRange = m_qvoProcessedBinRanges[u32RangeNo];
 
-            //Also ensure that all new history frames are the same size as the input data
-            for(uint32_t u32HistoryEntry = 0; u32HistoryEntry < (uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size(); u32HistoryEntry++)
+            for(uint32_t u32BinNo = oRange.m_u32Begin; u32BinNo < oRange.m_u32End && u32BinNo < u32NBins; u32BinNo += oRange.m_u32Stride)
             {
-                m_qvvvfAverageHistory[u32ChannelNo][u32HistoryEntry].resize(qvvfYData[qvu32ChannelList[u32ChannelNo]].size());
+                pfYDataToPlot[u32BinNo] = cPlotKernels::toDecibels(pfYDataToPlot[u32BinNo], dFactor);
             }
-
-            //Update number of samples in the array sent to the plotting widget too
-            m_qvvdYDataToPlot[u32ChannelNo].resize(qvvfYData[qvu32ChannelList[u32ChannelNo]].size());
         }
+    }
+}
 
-        m_oMutex.unlock();
+cFloatQwtSeriesData* cFramedQwtLinePlotWidget::createSeriesData(uint32_t u32CurveNo) const
+{
+    cFloatQwtSeriesData *pSeriesData = cBasicQwtLinePlotWidget::createSeriesData(u32CurveNo);
 
-        //Wrap history circular buffer as necessary
-        if(m_u32NextHistoryInputIndex >= (uint32_t)m_qvvvfAverageHistory[0].size())
-        {
-            m_u32NextHistoryInputIndex = 0;
-        }
+    if(m_oDisplayedResolution.m_u32CoarseStride > 1)
+    {
+        pSeriesData->setPartialResolution(m_oDisplayedResolution.m_u32FullResolutionBegin, m_oDisplayedResolution.m_u32FullResolutionEnd,
+                                          m_oDisplayedResolution.m_u32CoarseStride);
+    }
 
-        //Copy data into history
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvvfAverageHistory.size(); u32ChannelNo++)
-        {
-            std::copy(qvvfYData[qvu32ChannelList[u32ChannelNo]].begin(), qvvfYData[qvu32ChannelList[u32ChannelNo]].end(), m_qvvvfAverageHistory[u32ChannelNo][m_u32NextHistoryInputIndex].begin());
-        }
+    return pSeriesData;
+}
 
-        //Increment index for next data input
-        m_u32NextHistoryInputIndex++;
+bool cFramedQwtLinePlotWidget::snapshotData(cPlotDataExport &oExport)
+{
+    //Called on the ingest thread. The plot buffers are complete unless only part of the spectrum was processed for this frame.
+    if(m_oResolution.m_u32CoarseStride == 1 || m_oAveragingStage.isEmpty())
+        return cBasicQwtLinePlotWidget::snapshotData(oExport);
 
-        //Calculate Y data average to plot
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvdYDataToPlot.size(); u32ChannelNo++)
-        {
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 0.0;
+    uint32_t u32NChannels = m_qvvfYDataToPlot.size();
+    uint32_t u32NBins = m_oAveragingStage.getNewestEntry().m_oFrame.getNBins();
 
-                //Sum
-                for(uint32_t u32HistoryEntry = 0; u32HistoryEntry < (uint32_t)m_qvvvfAverageHistory[u32ChannelNo].size(); u32HistoryEntry++)
-                {
-                    m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] += m_qvvvfAverageHistory[u32ChannelNo][u32HistoryEntry][u32SampleNo];
-                }
+    QVector<cAveragingStage::cBinRange> qvoAllBins(1);
+    qvoAllBins[0].m_u32Begin = 0;
+    qvoAllBins[0].m_u32End = u32NBins;
+    qvoAllBins[0].m_u32Stride = 1;
 
-                //Divide
-                m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] /= m_qvvvfAverageHistory[u32ChannelNo].size();
+    QVector<QVector<float> > qvvfYData;
+    m_oAveragingStage.process(qvoAllBins, u32NChannels, u32NBins, qvvfYData);
 
-                //cout << "m_qvvdYDataToPlot[" << u32ChannelNo << "][" << u32SampleNo << "] = " << m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] << endl;
-            }
+    m_oMutex.lockForRead();
+    double dFactor = m_bDoLogConversion ? 10.0 : (m_bDoPowerLogConversion ? 20.0 : 0.0);
+    m_oMutex.unlock();
+
+    if(dFactor != 0.0)
+    {
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+        {
+            if(isSignedChannel(u32ChannelNo))
+                continue;
+
+            float *pfYData = qvvfYData[u32ChannelNo].data();
+            cPlotKernels::toDecibels(pfYData, pfYData, u32NBins, dFactor);
         }
     }
+
+    return snapshotCurves(oExport, qvvfYData);
 }
 
 void cFramedQwtLinePlotWidget::showAveragingControl(bool bEnable)
@@ -250,6 +532,13 @@ void cFramedQwtLinePlotWidget::showAveragingControl(bool bEnable)
     m_pAveragingLabel->setVisible(bEnable);
 }
 
+void cFramedQwtLinePlotWidget::enableVisibleRangeProcessing(bool bEnable)
+{
+    QWriteLocker oWriteLock(&m_oMutex);
+
+    m_bVisibleRangeProcessing = bEnable;
+}
+
 void cFramedQwtLinePlotWidget::setXSpan(double dXBegin, double dXEnd)
 {
     QWriteLocker oWriteLock(&m_oMutex);
@@ -268,10 +557,6 @@ void cFramedQwtLinePlotWidget::setXSpan(double dXBegin, double dXEnd)
     }
 
     sigSetXScaleExtent(dXBegin, dXEnd); //Execute in GUI thread
-
-
-    //Flag for ploting code to update
-    m_bXSpanChanged = true;
 }
 
 void cFramedQwtLinePlotWidget::slotSetXScaleExtent(double dBegin, double dEnd)
@@ -291,16 +576,21 @@ void cFramedQwtLinePlotWidget::updateCurves()
     //Do what the base function does
     cBasicQwtLinePlotWidget::updateCurves();
 
+    //For createSeriesData()
+    m_oMutex.lockForRead();
+    m_oDisplayedResolution = m_oPublishedResolution;
+    m_oMutex.unlock();
+
     //But also populated the waterfall menu with the correct number of curves.
-    if(m_pWaterfallMenu->actions().size() != m_qvvdYDataToPlot.size())
+    if(m_pWaterfallMenu->actions().size() != m_qvvfYDataToPlot.size())
     {
-        cout << "cFramedQwtLinePlotWidget::slotUpdateCurves() Updating to " << m_qvvdYDataToPlot.size() << " plot menu entries for waterfall plot " << m_qstrTitle.toStdString() << endl;
+        cout << "cFramedQwtLinePlotWidget::slotUpdateCurves() Updating to " << m_qvvfYDataToPlot.size() << " plot menu entries for waterfall plot " << m_qstrTitle.toStdString() << endl;
 
         removeAllWaterfallPlots();
         m_pWaterfallMenu->clear();
 
         //Create new entries
-        for(unsigned int u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+        for(unsigned int u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvfYDataToPlot.size(); u32ChannelNo++)
         {
             cIndexedCheckableQAction *pAction;
             if(u32ChannelNo < (uint32_t)m_qvqstrCurveNames.size())
@@ -360,12 +650,16 @@ void cFramedQwtLinePlotWidget::addWaterfallPlot(uint32_t u32ChannelNo, const QSt
         cout << "Setting Z unit to " << m_qstrYUnit.toStdString() << endl;
         pWaterfallPlot->setTitle(qstrChannelName);
 
-        //Use the same scale dB / linear as the frame plot
-        if(m_bDoLogConversion)
+        //Use the same scale dB / linear as the frame plot. Signed channels are always linear.
+        m_oMutex.lockForRead();
+        bool bSigned = isSignedChannel(u32ChannelNo);
+        m_oMutex.unlock();
+
+        if(!bSigned && m_bDoLogConversion)
         {
             pWaterfallPlot->enableLogConversion(true);
         }
-        else if(m_bDoPowerLogConversion)
+        else if(!bSigned && m_bDoPowerLogConversion)
         {
             pWaterfallPlot->enablePowerLogConversion(true);
         }
@@ -417,6 +711,16 @@ void cFramedQwtLinePlotWidget::slotScaleDivChanged()
 {
     cBasicQwtLinePlotWidget::slotScaleDivChanged();
 
+    {
+        //Used by the data thread to decide which bins to process at full resolution
+        QwtInterval oInterval = m_pUI->qwtPlot->axisInterval(QwtPlot::xBottom);
+
+        QWriteLocker oWriteLock(&m_oMutex);
+
+        m_dVisibleXBegin = qMin(oInterval.minValue(), oInterval.maxValue());
+        m_dVisibleXEnd = qMax(oInterval.minValue(), oInterval.maxValue());
+    }
+
     QReadLocker oLock(&m_oWaterfallPlotMutex);
 
     for(uint32_t ui = 0; ui < (uint32_t)m_qvpWaterfallPlots.size(); ui++)
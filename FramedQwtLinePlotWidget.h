@@ -30,6 +30,9 @@ typedef unsigned __int64 uint64_t;
 //Local includes
 #include "BasicQwtLinePlotWidget.h"
 #include "WaterfallQwtPlotWidget.h"
+#include "AveragingStage.h"
+#include "SpectrumStage.h"
+#include "StokesStage.h"
 
 class cIndexedCheckableQAction : public QAction
 {
@@ -59,10 +62,38 @@ public:
 
     void                                addData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
 
+    //Zero copy ingest. Data from a view is copied once into a recycled history frame.
+    //A shared frame is kept in the averaging history as is without copying.
+    void                                addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    void                                addData(const cSharedPlotFrame &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Only the newest frames that fit in the averaging history are stored and the average is computed once per batch. Waterfalls receive every frame.
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Raw digitiser samples converted to power directly into the averaging history (see PlotFrame.h)
+    void                                addData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Time domain frames transformed to power spectra in-library and then averaged as any other spectrum.
+    //A frame of N samples produces N / 2 + 1 bins. setXSpan() should be given the frequency span, e.g. 0 to fs / 2.
+    void                                addTimeDomainData(const cPlotFrameView &oTimeData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //One of cSpectrumStage::WINDOW_*. Hann by default.
+    void                                setFFTWindow(uint32_t u32Window);
+
+    //Complex dual polarisation spectra (see StokesStage.h for the layout). Each selected Stokes product or power is plotted as a channel.
+    void                                addPolarisationData(const float *pfX, const float *pfY, uint32_t u32NBins, uint32_t u32BinStride = 1, int64_t i64Timestamp_us = 0);
+
+    //cStokesStage::STOKES_* and POWER_* products to plot, in channel order. I, Q, U, V by default.
+    void                                setStokesProducts(const QVector<uint32_t> &qvu32Products);
+
     void                                setXSpan(double dXBegin, double dXEnd);
 
     void                                showAveragingControl(bool bEnable);
 
+    //When zoomed in only the visible bins plus a margin are averaged and converted at full resolution.
+    //The rest of the spectrum is processed at a reduced resolution until it is next in view. Enabled by default.
+    void                                enableVisibleRangeProcessing(bool bEnable);
+
 protected:
     //GUI Widgets
     QSpinBox                            *m_pAveragingSpinBox;
@@ -70,9 +101,10 @@ protected:
     QToolButton                         *m_pWaterfallMenuButton;
     QMenu                               *m_pWaterfallMenu;
 
-    //Data stuctures
-    QVector<QVector<QVector<float> >  > m_qvvvfAverageHistory;
-    uint32_t                            m_u32NextHistoryInputIndex;
+    //Processing stages
+    cAveragingStage                     m_oAveragingStage;
+    cSpectrumStage                      m_oSpectrumStage;
+    cStokesStage                        m_oStokesStage;
 
     //Controls
     uint32_t                            m_u32Averaging;
@@ -80,7 +112,33 @@ protected:
     //Span of X scale
     double                              m_dXBegin;
     double                              m_dXEnd;
-    bool                                m_bXSpanChanged;
+
+    //Visible range processing. The visible X interval is updated from the GUI thread.
+    static const uint32_t               COARSE_RESOLUTION_N_BINS = 4096;
+
+    bool                                m_bVisibleRangeProcessing;
+    double                              m_dVisibleXBegin;
+    double                              m_dVisibleXEnd;
+
+    //Bins processed for the current frame. Outside the full resolution window the bins are max pooled in blocks of
+    //m_u32CoarseStride into the first bin of each block so that narrow peaks out of view are not lost.
+    struct cResolution
+    {
+        uint32_t                        m_u32FullResolutionBegin;
+        uint32_t                        m_u32FullResolutionEnd;
+        uint32_t                        m_u32CoarseStride;
+
+        cResolution() : m_u32FullResolutionBegin(0), m_u32FullResolutionEnd(0), m_u32CoarseStride(1) {}
+    };
+
+    cResolution                         m_oResolution; //Ingest thread
+    cResolution                         m_oPublishedResolution; //Written with each averaged frame under m_oMutex
+    cResolution                         m_oDisplayedResolution; //GUI thread. Taken by updateCurves() for createSeriesData()
+    QVector<cAveragingStage::cBinRange> m_qvoProcessedBinRanges;
+
+    //Channels holding a signed Stokes product, which are never log converted. Empty for other input.
+    //Written by the ingest thread under m_oMutex when it changes.
+    QVector<bool>                       m_qvbSignedChannels;
 
     //Callback handling
     QVector<cWaterfallQwtPlotWidget*>   m_qvpWaterfallPlots;
@@ -91,8 +149,38 @@ protected:
 
     void                                updateCurves();
 
-    virtual void                        processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us = 0);
-    virtual void                        processYData(const QVector<QVector<float> > &qvvfXData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    virtual void                        processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us = 0);
+    virtual void                        processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //processYData() for either channel selection
+    template<typename tChannelSelection>
+    void                                copyYDataToHistory(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels, uint32_t u32NBins, float *pfHistory);
+
+    virtual bool                        processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Returns the history slot for the next frame with the current averaging (see cAveragingStage::nextEntry())
+    //and records which of its channels are signed
+    cAveragingStage::cHistoryEntry&     nextAverageHistoryEntry(uint32_t u32NChannels, uint32_t u32NBins,
+                                                                const QVector<bool> &qvbSignedChannels = QVector<bool>());
+    bool                                isSignedChannel(uint32_t u32ChannelNo) const;
+    void                                copyFrameToHistory(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, uint32_t u32NChannels, uint32_t u32NBins,
+                                                           cAveragingStage::cHistoryEntry &oEntry);
+    void                                updateAverage(uint32_t u32NChannels, uint32_t u32NBins);
+
+    //Chooses the bins to process for this frame from the visible X interval
+    void                                updateProcessedBinRanges(uint32_t u32NBins);
+
+    virtual void                        logConversion();
+    virtual void                        powerLogConversion();
+    void                                logConvertProcessedBins(double dFactor);
+
+    virtual cFloatQwtSeriesData*        createSeriesData(uint32_t u32CurveNo) const;
+
+    //Out of view bins may be coarse or stale with visible range processing so the export is averaged again at full resolution
+    virtual bool                        snapshotData(cPlotDataExport &oExport);
+
+    //Passes the newest frame to any waterfall plots
+    void                                addDataToWaterfallPlots(int64_t i64Timestamp_us);
 
 public slots:
     void                                slotSetAverage(int iAveraging);
@@ -0,0 +1,345 @@
+//System includes
+#include <iostream>
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QByteArray>
+
+//Local includes
+#include "HistorySnapshot.h"
+
+using namespace std;
+
+cHistorySnapshot::cHistorySnapshot(const QString &qstrClassName) :
+    m_qstrClassName(qstrClassName)
+{
+}
+
+cHistorySnapshot::~cHistorySnapshot()
+{
+    for(int32_t i32SectionNo = 0; i32SectionNo < m_qlpSections.size(); i32SectionNo++)
+    {
+        delete m_qlpSections[i32SectionNo];
+    }
+}
+
+uint64_t cHistorySnapshot::align(uint64_t u64Offset_B, uint64_t u64Alignment_B)
+{
+    return (u64Offset_B + u64Alignment_B - 1) / u64Alignment_B * u64Alignment_B;
+}
+
+uint64_t cHistorySnapshot::getSectionSize_B(const cSection &oSection)
+{
+    uint64_t u64NElements = 0;
+
+    for(uint32_t u32RowNo = 0; u32RowNo < oSection.getNRows(); u32RowNo++)
+    {
+        u64NElements += oSection.getRowLength(u32RowNo);
+    }
+
+    return align((uint64_t)oSection.getNRows() * sizeof(uint32_t), 8) + u64NElements * oSection.getElementSize_B();
+}
+
+bool cHistorySnapshot::write(const QString &qstrFilename) const
+{
+    //Lay out the sections
+    QVector<cHistorySnapshotSectionHeader> qvoSectionHeaders(m_qlpSections.size());
+
+    uint64_t u64Offset_B = align(sizeof(cHistorySnapshotFileHeader) + (uint64_t)m_qlpSections.size() * sizeof(cHistorySnapshotSectionHeader), 64);
+
+    for(int32_t i32SectionNo = 0; i32SectionNo < m_qlpSections.size(); i32SectionNo++)
+    {
+        const cSection &oSection = *m_qlpSections[i32SectionNo];
+        cHistorySnapshotSectionHeader &oHeader = qvoSectionHeaders[i32SectionNo];
+
+        uint64_t u64NElements = 0;
+
+        for(uint32_t u32RowNo = 0; u32RowNo < oSection.getNRows(); u32RowNo++)
+        {
+            u64NElements += oSection.getRowLength(u32RowNo);
+        }
+
+        if(u64NElements > 0xffffffff)
+        {
+            cout << "cHistorySnapshot::write(): Error: Section " << oSection.getId() << " is too large for the snapshot format." << endl;
+            return false;
+        }
+
+        oHeader.m_u32Id = oSection.getId();
+        oHeader.m_u32ElementSize_B = oSection.getElementSize_B();
+        oHeader.m_u32NRows = oSection.getNRows();
+        oHeader.m_u32NElements = u64NElements;
+        oHeader.m_u64Offset_B = u64Offset_B;
+        oHeader.m_u64Size_B = getSectionSize_B(oSection);
+
+        u64Offset_B = align(u64Offset_B + oHeader.m_u64Size_B, 64);
+    }
+
+    cHistorySnapshotFileHeader oFileHeader;
+    memset(&oFileHeader, 0, sizeof(oFileHeader));
+    oFileHeader.m_u32Magic = cHistorySnapshotFileHeader::MAGIC;
+    oFileHeader.m_u32Version = cHistorySnapshotFileHeader::VERSION;
+    oFileHeader.m_u32HeaderSize_B = sizeof(cHistorySnapshotFileHeader);
+    oFileHeader.m_u32NSections = m_qlpSections.size();
+    oFileHeader.m_u64FileSize_B = u64Offset_B;
+
+    QByteArray qbaClassName = m_qstrClassName.toLatin1();
+    strncpy(oFileHeader.m_acClassName, qbaClassName.constData(), sizeof(oFileHeader.m_acClassName) - 1);
+
+    //Written to a temporary file which replaces the old snapshot on commit()
+    QSaveFile oFile(qstrFilename);
+
+    if(!oFile.open(QIODevice::WriteOnly))
+    {
+        cout << "cHistorySnapshot::write(): Error: Unable to open " << qstrFilename.toStdString() << " for writing: "
+             << oFile.errorString().toStdString() << endl;
+        return false;
+    }
+
+    QByteArray qbaPadding(64, 0);
+    uint64_t u64Written_B = 0;
+
+    u64Written_B += oFile.write(reinterpret_cast<const char*>(&oFileHeader), sizeof(oFileHeader));
+    u64Written_B += oFile.write(reinterpret_cast<const char*>(qvoSectionHeaders.constData()), qvoSectionHeaders.size() * sizeof(cHistorySnapshotSectionHeader));
+
+    for(int32_t i32SectionNo = 0; i32SectionNo < m_qlpSections.size(); i32SectionNo++)
+    {
+        const cSection &oSection = *m_qlpSections[i32SectionNo];
+        const cHistorySnapshotSectionHeader &oHeader = qvoSectionHeaders[i32SectionNo];
+
+        u64Written_B += oFile.write(qbaPadding.constData(), oHeader.m_u64Offset_B - u64Written_B);
+
+        for(uint32_t u32RowNo = 0; u32RowNo < oSection.getNRows(); u32RowNo++)
+        {
+            uint32_t u32RowLength = oSection.getRowLength(u32RowNo);
+            u64Written_B += oFile.write(reinterpret_cast<const char*>(&u32RowLength), sizeof(u32RowLength));
+        }
+
+        u64Written_B += oFile.write(qbaPadding.constData(), align(u64Written_B, 8) - u64Written_B);
+
+        for(uint32_t u32RowNo = 0; u32RowNo < oSection.getNRows(); u32RowNo++)
+        {
+            u64Written_B += oFile.write(oSection.getRowData(u32RowNo), (uint64_t)oSection.getRowLength(u32RowNo) * oSection.getElementSize_B());
+        }
+    }
+
+    u64Written_B += oFile.write(qbaPadding.constData(), oFileHeader.m_u64FileSize_B - u64Written_B);
+
+    if(u64Written_B != oFileHeader.m_u64FileSize_B || !oFile.commit())
+    {
+        cout << "cHistorySnapshot::write(): Error: Writing " << qstrFilename.toStdString() << " failed: " << oFile.errorString().toStdString() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+cHistorySnapshotReader::cHistorySnapshotReader() :
+    m_pu8Mapping(NULL),
+    m_u64MappingSize_B(0),
+    m_pSections(NULL),
+    m_u32NSections(0)
+{
+}
+
+cHistorySnapshotReader::~cHistorySnapshotReader()
+{
+    close();
+}
+
+bool cHistorySnapshotReader::open(const QString &qstrFilename, const QString &qstrClassName)
+{
+    close();
+
+    m_oFile.setFileName(qstrFilename);
+
+    if(!m_oFile.open(QIODevice::ReadOnly))
+    {
+        cout << "cHistorySnapshotReader::open(): Warning: Unable to open " << qstrFilename.toStdString() << ": " << m_oFile.errorString().toStdString() << endl;
+        return false;
+    }
+
+    m_u64MappingSize_B = m_oFile.size();
+
+    if(m_u64MappingSize_B < sizeof(cHistorySnapshotFileHeader))
+    {
+        cout << "cHistorySnapshotReader::open(): Error: " << qstrFilename.toStdString() << " is too short to be a history snapshot." << endl;
+        close();
+        return false;
+    }
+
+    m_pu8Mapping = m_oFile.map(0, m_u64MappingSize_B);
+
+    if(!m_pu8Mapping)
+    {
+        cout << "cHistorySnapshotReader::open(): Error: Unable to map " << qstrFilename.toStdString() << ": " << m_oFile.errorString().toStdString() << endl;
+        close();
+        return false;
+    }
+
+    const cHistorySnapshotFileHeader *pFileHeader = reinterpret_cast<const cHistorySnapshotFileHeader*>(m_pu8Mapping);
+
+    if(pFileHeader->m_u32Magic != cHistorySnapshotFileHeader::MAGIC || pFileHeader->m_u32Version != cHistorySnapshotFileHeader::VERSION
+            || pFileHeader->m_u32HeaderSize_B != sizeof(cHistorySnapshotFileHeader) || pFileHeader->m_u64FileSize_B != m_u64MappingSize_B
+            || sizeof(cHistorySnapshotFileHeader) + (uint64_t)pFileHeader->m_u32NSections * sizeof(cHistorySnapshotSectionHeader) > m_u64MappingSize_B)
+    {
+        cout << "cHistorySnapshotReader::open(): Error: " << qstrFilename.toStdString() << " is not a complete version "
+             << cHistorySnapshotFileHeader::VERSION << " history snapshot." << endl;
+        close();
+        return false;
+    }
+
+    if(qstrClassName != QString::fromLatin1(pFileHeader->m_acClassName, strnlen(pFileHeader->m_acClassName, sizeof(pFileHeader->m_acClassName))))
+    {
+        cout << "cHistorySnapshotReader::open(): Error: " << qstrFilename.toStdString() << " was written by a " << pFileHeader->m_acClassName
+             << " rather than a " << qstrClassName.toStdString() << "." << endl;
+        close();
+        return false;
+    }
+
+    m_pSections = reinterpret_cast<const cHistorySnapshotSectionHeader*>(m_pu8Mapping + sizeof(cHistorySnapshotFileHeader));
+    m_u32NSections = pFileHeader->m_u32NSections;
+
+    //Check that every section lies within the file so that the accessors need not
+    for(uint32_t u32SectionNo = 0; u32SectionNo < m_u32NSections; u32SectionNo++)
+    {
+        const cHistorySnapshotSectionHeader &oSection = m_pSections[u32SectionNo];
+
+        uint64_t u64RowLengthsSize_B = ((uint64_t)oSection.m_u32NRows * sizeof(uint32_t) + 7) / 8 * 8;
+        bool bValid = oSection.m_u64Offset_B % 8 == 0 && oSection.m_u64Offset_B <= m_u64MappingSize_B
+                && oSection.m_u64Size_B <= m_u64MappingSize_B - oSection.m_u64Offset_B
+                && u64RowLengthsSize_B + (uint64_t)oSection.m_u32NElements * oSection.m_u32ElementSize_B == oSection.m_u64Size_B;
+
+        if(bValid)
+        {
+            const uint32_t *pu32RowLengths = reinterpret_cast<const uint32_t*>(m_pu8Mapping + oSection.m_u64Offset_B);
+            uint64_t u64NElements = 0;
+
+            for(uint32_t u32RowNo = 0; u32RowNo < oSection.m_u32NRows; u32RowNo++)
+            {
+                u64NElements += pu32RowLengths[u32RowNo];
+            }
+
+            bValid = u64NElements == oSection.m_u32NElements;
+        }
+
+        if(!bValid)
+        {
+            cout << "cHistorySnapshotReader::open(): Error: Section " << oSection.m_u32Id << " of " << qstrFilename.toStdString() << " is corrupt." << endl;
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void cHistorySnapshotReader::close()
+{
+    if(m_pu8Mapping)
+        m_oFile.unmap(const_cast<uint8_t*>(m_pu8Mapping));
+
+    m_pu8Mapping = NULL;
+    m_u64MappingSize_B = 0;
+    m_pSections = NULL;
+    m_u32NSections = 0;
+    m_oFile.close();
+}
+
+bool cHistorySnapshotReader::hasSection(uint32_t u32Id) const
+{
+    for(uint32_t u32SectionNo = 0; u32SectionNo < m_u32NSections; u32SectionNo++)
+    {
+        if(m_pSections[u32SectionNo].m_u32Id == u32Id)
+            return true;
+    }
+
+    return false;
+}
+
+const cHistorySnapshotSectionHeader* cHistorySnapshotReader::findSection(uint32_t u32Id, uint32_t u32ElementSize_B, const uint32_t* &pu32RowLengths,
+                                                                        const uint8_t* &pu8Data) const
+{
+    for(uint32_t u32SectionNo = 0; u32SectionNo < m_u32NSections; u32SectionNo++)
+    {
+        const cHistorySnapshotSectionHeader &oSection = m_pSections[u32SectionNo];
+
+        if(oSection.m_u32Id != u32Id)
+            continue;
+
+        if(oSection.m_u32ElementSize_B != u32ElementSize_B)
+        {
+            cout << "cHistorySnapshotReader::findSection(): Warning: Section " << u32Id << " has " << oSection.m_u32ElementSize_B
+                 << " byte elements, expected " << u32ElementSize_B << "." << endl;
+            return NULL;
+        }
+
+        pu32RowLengths = reinterpret_cast<const uint32_t*>(m_pu8Mapping + oSection.m_u64Offset_B);
+        pu8Data = m_pu8Mapping + oSection.m_u64Offset_B + ((uint64_t)oSection.m_u32NRows * sizeof(uint32_t) + 7) / 8 * 8;
+
+        return &oSection;
+    }
+
+    return NULL;
+}
+
+cHistorySnapshotWriter::cHistorySnapshotWriter(QObject *pParent) :
+    QObject(pParent),
+    cBackgroundWriter(1)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    startWriter();
+}
+
+cHistorySnapshotWriter::~cHistorySnapshotWriter()
+{
+    stopWriter();
+}
+
+void cHistorySnapshotWriter::submit(cHistorySnapshot *pSnapshot, const QString &qstrFilename)
+{
+    submitJob(new cSnapshotJob(pSnapshot, qstrFilename));
+}
+
+cHistorySnapshotWriter::cStats cHistorySnapshotWriter::getStats()
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    return m_oStats;
+}
+
+bool cHistorySnapshotWriter::writeJob(cJob *pJob)
+{
+    cSnapshotJob *pSnapshotJob = static_cast<cSnapshotJob*>(pJob);
+
+    bool bSuccess = pSnapshotJob->m_pSnapshot->write(pSnapshotJob->m_qstrFilename);
+
+    delete pSnapshotJob->m_pSnapshot;
+    pSnapshotJob->m_pSnapshot = NULL;
+
+    return bSuccess;
+}
+
+void cHistorySnapshotWriter::jobFinished(cJob *pJob, bool bSuccess)
+{
+    cSnapshotJob *pSnapshotJob = static_cast<cSnapshotJob*>(pJob);
+
+    if(bSuccess)
+        m_oStats.m_u64NSnapshotsWritten++;
+    else
+        m_oStats.m_u64NWriteFailures++;
+
+    sigSnapshotWritten(pSnapshotJob->m_qstrFilename, bSuccess);
+
+    delete pSnapshotJob;
+}
+
+void cHistorySnapshotWriter::jobDiscarded(cJob *pJob)
+{
+    m_oStats.m_u64NSnapshotsSuperseded++;
+
+    delete pJob;
+}
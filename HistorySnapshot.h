@@ -0,0 +1,284 @@
+//Checkpoints of plot widget history for a warm start after a restart (see cQwtPlotWidgetBase::enableHistoryCheckpoints()).
+//
+//A snapshot is a set of numbered sections, each a list of rows of fixed size elements (a single value or vector is one row).
+//The ingest thread builds a cHistorySnapshot from shallow (implicitly shared) copies of its buffers, which costs a reference count
+//per row rather than a copy of the history. cHistorySnapshotWriter then writes it on a background thread to a temporary file
+//that replaces the previous snapshot atomically, so a crash mid-write leaves the last complete snapshot in place.
+//
+//On restore cHistorySnapshotReader maps the file in one go. The header and section table are used in place and each row is a
+//single block copy out of the mapping into the widget's buffers, so there is no per sample parsing and only the pages holding
+//the history are read.
+//
+//File layout (native byte order):
+//
+//  cHistorySnapshotFileHeader (64 bytes)
+//  cHistorySnapshotSectionHeader (32 bytes) [m_u32NSections]
+//  Sections, each starting on a 64 byte boundary:
+//      u32 row lengths in elements [m_u32NRows], zero padded to a multiple of 8 bytes
+//      Rows of elements concatenated
+
+#ifndef HISTORY_SNAPSHOT_H
+#define HISTORY_SNAPSHOT_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <cstring>
+
+//Library includes
+#include <QObject>
+#include <QFile>
+#include <QIODevice>
+#include <QList>
+#include <QVector>
+#include <QString>
+
+//Local includes
+#include "BackgroundWriter.h"
+
+struct cHistorySnapshotFileHeader
+{
+    static const uint32_t               MAGIC = 0x53485051; //"QPHS" in little endian
+    static const uint32_t               VERSION = 1;
+
+    uint32_t                            m_u32Magic;
+    uint32_t                            m_u32Version;
+    uint32_t                            m_u32HeaderSize_B;
+    uint32_t                            m_u32NSections;
+    uint64_t                            m_u64FileSize_B;
+    char                                m_acClassName[40];  //Of the widget that wrote it, null terminated
+};
+
+struct cHistorySnapshotSectionHeader
+{
+    uint32_t                            m_u32Id;
+    uint32_t                            m_u32ElementSize_B;
+    uint32_t                            m_u32NRows;
+    uint32_t                            m_u32NElements;     //Summed over rows
+    uint64_t                            m_u64Offset_B;      //From the start of the file
+    uint64_t                            m_u64Size_B;
+};
+
+class cHistorySnapshot
+{
+public:
+    explicit cHistorySnapshot(const QString &qstrClassName);
+    ~cHistorySnapshot();
+
+    //Sections hold shallow copies of the data. Each section number may only be added once.
+    template<typename tElement>
+    void                                addValue(uint32_t u32Id, const tElement &tValue);
+
+    template<typename tElement>
+    void                                addVector(uint32_t u32Id, const QVector<tElement> &qvData);
+
+    template<typename tElement>
+    void                                addRows(uint32_t u32Id, const QVector<QVector<tElement> > &qvvData);
+
+    //Replaces the file atomically
+    bool                                write(const QString &qstrFilename) const;
+
+private:
+    class cSection
+    {
+    public:
+        explicit cSection(uint32_t u32Id) : m_u32Id(u32Id) {}
+        virtual ~cSection() {}
+
+        uint32_t                        getId() const {return m_u32Id;}
+
+        virtual uint32_t                getElementSize_B() const = 0;
+        virtual uint32_t                getNRows() const = 0;
+        virtual uint32_t                getRowLength(uint32_t u32RowNo) const = 0;
+        virtual const char*             getRowData(uint32_t u32RowNo) const = 0;
+
+    private:
+        uint32_t                        m_u32Id;
+    };
+
+    template<typename tElement>
+    class cRowsSection : public cSection
+    {
+    public:
+        cRowsSection(uint32_t u32Id, const QVector<QVector<tElement> > &qvvData) : cSection(u32Id), m_qvvData(qvvData) {}
+
+        virtual uint32_t                getElementSize_B() const {return sizeof(tElement);}
+        virtual uint32_t                getNRows() const {return m_qvvData.size();}
+        virtual uint32_t                getRowLength(uint32_t u32RowNo) const {return m_qvvData[u32RowNo].size();}
+        virtual const char*             getRowData(uint32_t u32RowNo) const {return reinterpret_cast<const char*>(m_qvvData[u32RowNo].constData());}
+
+    private:
+        QVector<QVector<tElement> >     m_qvvData;
+    };
+
+    QString                             m_qstrClassName;
+    QList<cSection*>                    m_qlpSections;
+
+    static uint64_t                     getSectionSize_B(const cSection &oSection);
+    static uint64_t                     align(uint64_t u64Offset_B, uint64_t u64Alignment_B);
+};
+
+class cHistorySnapshotReader
+{
+public:
+    cHistorySnapshotReader();
+    ~cHistorySnapshotReader();
+
+    //Maps the file and checks that it was written by a widget of the given class
+    bool                                open(const QString &qstrFilename, const QString &qstrClassName);
+    void                                close();
+
+    bool                                hasSection(uint32_t u32Id) const;
+
+    //Each returns false if the section is missing or of a different element type or shape
+    template<typename tElement>
+    bool                                getValue(uint32_t u32Id, tElement &tValue) const;
+
+    template<typename tElement>
+    bool                                getVector(uint32_t u32Id, QVector<tElement> &qvData) const;
+
+    template<typename tElement>
+    bool                                getRows(uint32_t u32Id, QVector<QVector<tElement> > &qvvData) const;
+
+private:
+    QFile                               m_oFile;
+    const uint8_t                       *m_pu8Mapping;
+    uint64_t                            m_u64MappingSize_B;
+    const cHistorySnapshotSectionHeader *m_pSections;
+    uint32_t                            m_u32NSections;
+
+    //Returns the section with the given element size or NULL. pu32RowLengths and pu8Data point into the mapping.
+    const cHistorySnapshotSectionHeader* findSection(uint32_t u32Id, uint32_t u32ElementSize_B, const uint32_t* &pu32RowLengths, const uint8_t* &pu8Data) const;
+};
+
+class cHistorySnapshotWriter : public QObject, public cBackgroundWriter
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NSnapshotsWritten;
+        uint64_t                        m_u64NSnapshotsSuperseded;  //Replaced by a newer snapshot before the writer got to them
+        uint64_t                        m_u64NWriteFailures;
+    };
+
+    explicit cHistorySnapshotWriter(QObject *pParent = 0);
+    ~cHistorySnapshotWriter(); //Writes any pending snapshot
+
+    //Takes ownership of the snapshot. Only the newest submitted snapshot waits for the writer.
+    void                                submit(cHistorySnapshot *pSnapshot, const QString &qstrFilename);
+
+    cStats                              getStats();
+
+private:
+    struct cSnapshotJob : public cJob
+    {
+        cSnapshotJob(cHistorySnapshot *pSnapshot, const QString &qstrFilename) : m_pSnapshot(pSnapshot), m_qstrFilename(qstrFilename) {}
+        ~cSnapshotJob() { delete m_pSnapshot; }
+
+        cHistorySnapshot                *m_pSnapshot;
+        QString                         m_qstrFilename;
+    };
+
+    //Protected by m_oWriterMutex
+    cStats                              m_oStats;
+
+    virtual bool                        writeJob(cJob *pJob);
+    virtual void                        jobFinished(cJob *pJob, bool bSuccess);
+    virtual void                        jobDiscarded(cJob *pJob);
+
+signals:
+    void                                sigSnapshotWritten(const QString &qstrFilename, bool bSuccess);
+};
+
+template<typename tElement>
+void cHistorySnapshot::addValue(uint32_t u32Id, const tElement &tValue)
+{
+    addVector(u32Id, QVector<tElement>(1, tValue));
+}
+
+template<typename tElement>
+void cHistorySnapshot::addVector(uint32_t u32Id, const QVector<tElement> &qvData)
+{
+    addRows(u32Id, QVector<QVector<tElement> >(1, qvData));
+}
+
+template<typename tElement>
+void cHistorySnapshot::addRows(uint32_t u32Id, const QVector<QVector<tElement> > &qvvData)
+{
+    m_qlpSections.push_back(new cRowsSection<tElement>(u32Id, qvvData));
+}
+
+template<typename tElement>
+bool cHistorySnapshotReader::getValue(uint32_t u32Id, tElement &tValue) const
+{
+    const uint32_t *pu32RowLengths;
+    const uint8_t *pu8Data;
+    const cHistorySnapshotSectionHeader *pSection = findSection(u32Id, sizeof(tElement), pu32RowLengths, pu8Data);
+
+    if(!pSection || pSection->m_u32NRows != 1 || pSection->m_u32NElements != 1)
+        return false;
+
+    memcpy(&tValue, pu8Data, sizeof(tElement));
+
+    return true;
+}
+
+template<typename tElement>
+bool cHistorySnapshotReader::getVector(uint32_t u32Id, QVector<tElement> &qvData) const
+{
+    const uint32_t *pu32RowLengths;
+    const uint8_t *pu8Data;
+    const cHistorySnapshotSectionHeader *pSection = findSection(u32Id, sizeof(tElement), pu32RowLengths, pu8Data);
+
+    if(!pSection || pSection->m_u32NRows != 1)
+        return false;
+
+    qvData.resize(pSection->m_u32NElements);
+
+    if(pSection->m_u32NElements)
+        memcpy(qvData.data(), pu8Data, (uint64_t)pSection->m_u32NElements * sizeof(tElement));
+
+    return true;
+}
+
+template<typename tElement>
+bool cHistorySnapshotReader::getRows(uint32_t u32Id, QVector<QVector<tElement> > &qvvData) const
+{
+    const uint32_t *pu32RowLengths;
+    const uint8_t *pu8Data;
+    const cHistorySnapshotSectionHeader *pSection = findSection(u32Id, sizeof(tElement), pu32RowLengths, pu8Data);
+
+    if(!pSection)
+        return false;
+
+    qvvData.resize(pSection->m_u32NRows);
+
+    for(uint32_t u32RowNo = 0; u32RowNo < pSection->m_u32NRows; u32RowNo++)
+    {
+        qvvData[u32RowNo].resize(pu32RowLengths[u32RowNo]);
+
+        if(pu32RowLengths[u32RowNo])
+            memcpy(qvvData[u32RowNo].data(), pu8Data, (uint64_t)pu32RowLengths[u32RowNo] * sizeof(tElement));
+
+        pu8Data += (uint64_t)pu32RowLengths[u32RowNo] * sizeof(tElement);
+    }
+
+    return true;
+}
+
+#endif // HISTORY_SNAPSHOT_H
@@ -0,0 +1,352 @@
+//System includes
+#include <iostream>
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSysInfo>
+
+//Local includes
+#include "PlotDataExport.h"
+
+using namespace std;
+
+cPlotDataExport::cPlotDataExport(const QString &qstrTitle, const QString &qstrClassName) :
+    m_qstrTitle(qstrTitle),
+    m_qstrClassName(qstrClassName)
+{
+}
+
+cPlotDataExport::~cPlotDataExport()
+{
+    for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+    {
+        delete m_qlpColumns[i32ColumnNo];
+    }
+}
+
+void cPlotDataExport::addAttribute(const QString &qstrKey, const QString &qstrValue)
+{
+    m_qstrlAttributeKeys.push_back(qstrKey);
+    m_qstrlAttributeValues.push_back(qstrValue);
+}
+
+void cPlotDataExport::addImplicitVector(const QString &qstrName, double dStart, double dStep, uint32_t u32Length)
+{
+    m_qlpColumns.push_back(new cImplicitVectorColumn(qstrName, dStart, dStep, u32Length));
+}
+
+bool cPlotDataExport::write(const QString &qstrFilename) const
+{
+    //Written to a temporary file which replaces any previous file on commit so readers never see a partial export
+    QSaveFile oFile(qstrFilename);
+
+    if(!oFile.open(QIODevice::WriteOnly))
+    {
+        cout << "cPlotDataExport::write(): Warning: Unable to open " << qstrFilename.toStdString() << " for writing." << endl;
+        return false;
+    }
+
+    bool bSuccess;
+
+    if(QFileInfo(qstrFilename).suffix().toLower() == QString("csv"))
+        bSuccess = writeCsv(oFile);
+    else
+        bSuccess = writeBinary(oFile);
+
+    if(!bSuccess || !oFile.commit())
+    {
+        cout << "cPlotDataExport::write(): Warning: Unable to write " << qstrFilename.toStdString() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool cPlotDataExport::writeCsv(QIODevice &oDevice) const
+{
+    //Lines are gathered into chunks so that the file is written in large blocks
+    QByteArray qbaChunk;
+    qbaChunk.reserve(CHUNK_SIZE_B + CHUNK_SIZE_B / 4);
+
+    qbaChunk += "# title: ";
+    qbaChunk += m_qstrTitle.toUtf8();
+    qbaChunk += '\n';
+
+    for(int32_t i32AttributeNo = 0; i32AttributeNo < m_qstrlAttributeKeys.size(); i32AttributeNo++)
+    {
+        qbaChunk += "# ";
+        qbaChunk += m_qstrlAttributeKeys[i32AttributeNo].toUtf8();
+        qbaChunk += ": ";
+        qbaChunk += m_qstrlAttributeValues[i32AttributeNo].toUtf8();
+        qbaChunk += '\n';
+    }
+
+    if(m_qlpColumns.isEmpty())
+        return writeBlock(oDevice, qbaChunk.constData(), qbaChunk.size());
+
+    for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+    {
+        m_qlpColumns[i32ColumnNo]->appendHeaderFields(qbaChunk);
+    }
+
+    //Each field is followed by a comma. The last on the line is replaced by the line end.
+    qbaChunk[qbaChunk.size() - 1] = '\n';
+
+    uint32_t u32NLines = getNLines();
+
+    for(uint32_t u32LineNo = 0; u32LineNo < u32NLines; u32LineNo++)
+    {
+        for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+        {
+            m_qlpColumns[i32ColumnNo]->appendFields(u32LineNo, qbaChunk);
+        }
+
+        qbaChunk[qbaChunk.size() - 1] = '\n';
+
+        if((uint32_t)qbaChunk.size() >= CHUNK_SIZE_B)
+        {
+            if(!writeBlock(oDevice, qbaChunk.constData(), qbaChunk.size()))
+                return false;
+
+            qbaChunk.resize(0);
+        }
+    }
+
+    return writeBlock(oDevice, qbaChunk.constData(), qbaChunk.size());
+}
+
+bool cPlotDataExport::writeBinary(QIODevice &oDevice) const
+{
+    //Describe the columns, placing each one's data on an aligned offset from the start of the data
+    QJsonArray oColumns;
+    QVector<uint64_t> qvu64Offsets_B(m_qlpColumns.size());
+    uint64_t u64DataSize_B = 0;
+
+    for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+    {
+        QJsonObject oDescription = m_qlpColumns[i32ColumnNo]->describe();
+        uint64_t u64ColumnSize_B = m_qlpColumns[i32ColumnNo]->getDataSize_B();
+
+        qvu64Offsets_B[i32ColumnNo] = u64DataSize_B;
+
+        if(u64ColumnSize_B)
+        {
+            //Offsets beyond 2^53 bytes would not survive as JSON numbers but no plot holds that much
+            oDescription.insert(QString("offset"), (double)u64DataSize_B);
+            oDescription.insert(QString("size"), (double)u64ColumnSize_B);
+
+            u64DataSize_B += (u64ColumnSize_B + ALIGNMENT_B - 1) / ALIGNMENT_B * ALIGNMENT_B;
+        }
+
+        oColumns.append(oDescription);
+    }
+
+    QJsonObject oAttributes;
+
+    for(int32_t i32AttributeNo = 0; i32AttributeNo < m_qstrlAttributeKeys.size(); i32AttributeNo++)
+    {
+        oAttributes.insert(m_qstrlAttributeKeys[i32AttributeNo], m_qstrlAttributeValues[i32AttributeNo]);
+    }
+
+    QJsonObject oDescription;
+    oDescription.insert(QString("title"), m_qstrTitle);
+    oDescription.insert(QString("class"), m_qstrClassName);
+    oDescription.insert(QString("byte_order"), QString(QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "little" : "big"));
+    oDescription.insert(QString("lines"), (double)getNLines());
+    oDescription.insert(QString("attributes"), oAttributes);
+    oDescription.insert(QString("columns"), oColumns);
+
+    QByteArray qbaDescription = QJsonDocument(oDescription).toJson(QJsonDocument::Compact);
+
+    cPlotDataExportFileHeader oHeader;
+    memset(&oHeader, 0, sizeof(oHeader));
+    oHeader.m_u32Magic = cPlotDataExportFileHeader::MAGIC;
+    oHeader.m_u32Version = cPlotDataExportFileHeader::VERSION;
+    oHeader.m_u64DescriptionSize_B = qbaDescription.size();
+
+    //Pad the description so the data starts aligned
+    uint64_t u64HeaderSize_B = sizeof(oHeader) + qbaDescription.size();
+    qbaDescription += QByteArray((int32_t)((ALIGNMENT_B - u64HeaderSize_B % ALIGNMENT_B) % ALIGNMENT_B), '\0');
+
+    if(!writeBlock(oDevice, reinterpret_cast<const char*>(&oHeader), sizeof(oHeader)) || !writeBlock(oDevice, qbaDescription.constData(), qbaDescription.size()))
+        return false;
+
+    uint64_t u64Written_B = 0;
+
+    for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+    {
+        uint64_t u64ColumnSize_B = m_qlpColumns[i32ColumnNo]->getDataSize_B();
+
+        if(!u64ColumnSize_B)
+            continue;
+
+        //Zero padding up to the column's offset
+        if(qvu64Offsets_B[i32ColumnNo] > u64Written_B)
+        {
+            QByteArray qbaPadding((int32_t)(qvu64Offsets_B[i32ColumnNo] - u64Written_B), '\0');
+
+            if(!writeBlock(oDevice, qbaPadding.constData(), qbaPadding.size()))
+                return false;
+        }
+
+        if(!m_qlpColumns[i32ColumnNo]->writeData(oDevice))
+            return false;
+
+        u64Written_B = qvu64Offsets_B[i32ColumnNo] + u64ColumnSize_B;
+    }
+
+    return true;
+}
+
+uint32_t cPlotDataExport::getNLines() const
+{
+    uint32_t u32NLines = 0;
+
+    for(int32_t i32ColumnNo = 0; i32ColumnNo < m_qlpColumns.size(); i32ColumnNo++)
+    {
+        u32NLines = qMax(u32NLines, m_qlpColumns[i32ColumnNo]->getNLines());
+    }
+
+    return u32NLines;
+}
+
+bool cPlotDataExport::writeBlock(QIODevice &oDevice, const char *pcData, uint64_t u64Size_B)
+{
+    //In chunks so that no single write has to be buffered in full by the device
+    while(u64Size_B)
+    {
+        qint64 i64ChunkSize_B = (qint64)qMin(u64Size_B, (uint64_t)CHUNK_SIZE_B);
+
+        if(oDevice.write(pcData, i64ChunkSize_B) != i64ChunkSize_B)
+            return false;
+
+        pcData += i64ChunkSize_B;
+        u64Size_B -= i64ChunkSize_B;
+    }
+
+    return true;
+}
+
+QByteArray cPlotDataExport::quoteCsvField(const QString &qstrField)
+{
+    QByteArray qbaField = qstrField.toUtf8();
+
+    if(!qbaField.contains(',') && !qbaField.contains('"') && !qbaField.contains('\n'))
+        return qbaField;
+
+    qbaField.replace("\"", "\"\"");
+
+    return QByteArray("\"") + qbaField + QByteArray("\"");
+}
+
+void cPlotDataExport::appendNumber(QByteArray &qbaLine, float fValue)
+{
+    //Enough digits to read back the same value
+    qbaLine += QByteArray::number((double)fValue, 'g', 9);
+}
+
+void cPlotDataExport::appendNumber(QByteArray &qbaLine, double dValue)
+{
+    qbaLine += QByteArray::number(dValue, 'g', 17);
+}
+
+void cPlotDataExport::appendNumber(QByteArray &qbaLine, int64_t i64Value)
+{
+    qbaLine += QByteArray::number((qlonglong)i64Value);
+}
+
+void cPlotDataExport::appendNumber(QByteArray &qbaLine, uint32_t u32Value)
+{
+    qbaLine += QByteArray::number(u32Value);
+}
+
+QJsonObject cPlotDataExport::cImplicitVectorColumn::describe() const
+{
+    QJsonObject oDescription;
+    oDescription.insert(QString("name"), getName());
+    oDescription.insert(QString("kind"), QString("implicit"));
+    oDescription.insert(QString("type"), QString("float64"));
+    oDescription.insert(QString("length"), (double)m_u32Length);
+    oDescription.insert(QString("start"), m_dStart);
+    oDescription.insert(QString("step"), m_dStep);
+
+    return oDescription;
+}
+
+void cPlotDataExport::cImplicitVectorColumn::appendHeaderFields(QByteArray &qbaLine) const
+{
+    qbaLine += quoteCsvField(getName());
+    qbaLine += ',';
+}
+
+void cPlotDataExport::cImplicitVectorColumn::appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const
+{
+    if(u32LineNo < m_u32Length)
+        appendNumber(qbaLine, m_dStart + u32LineNo * m_dStep);
+
+    qbaLine += ',';
+}
+
+bool cPlotDataExport::cImplicitVectorColumn::writeData(QIODevice &oDevice) const
+{
+    //Described by its start and step alone
+    Q_UNUSED(oDevice);
+
+    return true;
+}
+
+cPlotDataExportWriter::cPlotDataExportWriter(QObject *pParent) :
+    QObject(pParent)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    startWriter();
+}
+
+cPlotDataExportWriter::~cPlotDataExportWriter()
+{
+    stopWriter();
+}
+
+void cPlotDataExportWriter::submit(cPlotDataExport *pExport, const QString &qstrFilename)
+{
+    submitJob(new cExportJob(pExport, qstrFilename));
+}
+
+cPlotDataExportWriter::cStats cPlotDataExportWriter::getStats()
+{
+    QMutexLocker oLock(&m_oWriterMutex);
+
+    return m_oStats;
+}
+
+bool cPlotDataExportWriter::writeJob(cJob *pJob)
+{
+    cExportJob *pExportJob = static_cast<cExportJob*>(pJob);
+
+    bool bSuccess = pExportJob->m_pExport->write(pExportJob->m_qstrFilename);
+
+    //Release the buffers here rather than under the lock
+    delete pExportJob->m_pExport;
+    pExportJob->m_pExport = NULL;
+
+    return bSuccess;
+}
+
+void cPlotDataExportWriter::jobFinished(cJob *pJob, bool bSuccess)
+{
+    cExportJob *pExportJob = static_cast<cExportJob*>(pJob);
+
+    if(bSuccess)
+        m_oStats.m_u64NExportsWritten++;
+    else
+        m_oStats.m_u64NWriteFailures++;
+
+    sigExportWritten(pExportJob->m_qstrFilename, bSuccess);
+
+    delete pExportJob;
+}
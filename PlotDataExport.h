@@ -0,0 +1,383 @@
+//Export of the data behind a plot (see cQwtPlotWidgetBase::exportData()).
+//
+//A cPlotDataExport is a table of named columns. Each is either a vector with one value per line, an implicit (uniformly sampled)
+//vector given by its start and step, or a set of rows with one row per line (the waterfall), and each holds shallow
+//(implicitly shared) copies of the plot buffers. Taking an export therefore costs the ingest thread a reference count per buffer,
+//and the buffers are only copied if ingest writes to them before the export is written out. cPlotDataExportWriter writes exports on a
+//background thread, streaming them to the file in chunks.
+//
+//CSV: attributes as leading "# key: value" lines, a header line of column names (rows expand to one field per value, named
+//"name[axis value]") and one line per sample or row. Shorter columns are padded with empty fields.
+//
+//Binary (any suffix other than csv, conventionally .qpdx), native byte order:
+//
+//  cPlotDataExportFileHeader (16 bytes)
+//  UTF-8 JSON description of m_u64DescriptionSize_B bytes, e.g.
+//      {"title": ..., "class": ..., "byte_order": "little", "lines": N, "attributes": {...}, "columns": [
+//          {"name": "x", "kind": "vector", "type": "float64", "length": N, "offset": 0, "size": 8N},
+//          {"name": "x", "kind": "implicit", "type": "float64", "length": N, "start": x0, "step": dx},
+//          {"name": "power", "kind": "rows", "type": "float32", "rows": R, "row_length": M, "axis_start": f0, "axis_step": df,
+//           "offset": ..., "size": 4RM}]}
+//      Rows of differing lengths list them in "row_lengths" instead of "row_length".
+//  Zero padding to a 64 byte boundary, where the data starts. Each column's data begins "offset" bytes into it on a 64 byte boundary,
+//  rows concatenated.
+
+#ifndef PLOT_DATA_EXPORT_H
+#define PLOT_DATA_EXPORT_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QJsonArray>
+
+//Local includes
+#include "BackgroundWriter.h"
+
+struct cPlotDataExportFileHeader
+{
+    static const uint32_t               MAGIC = 0x58445051; //"QPDX" in little endian
+    static const uint32_t               VERSION = 1;
+
+    uint32_t                            m_u32Magic;
+    uint32_t                            m_u32Version;
+    uint64_t                            m_u64DescriptionSize_B;
+};
+
+class cPlotDataExport
+{
+public:
+    cPlotDataExport(const QString &qstrTitle, const QString &qstrClassName);
+    ~cPlotDataExport();
+
+    //Free text such as labels, units and the plot timestamp
+    void                                addAttribute(const QString &qstrKey, const QString &qstrValue);
+
+    //Columns hold shallow copies of the data and appear in the order added
+    template<typename tElement>
+    void                                addVector(const QString &qstrName, const QVector<tElement> &qvData);
+
+    void                                addImplicitVector(const QString &qstrName, double dStart, double dStep, uint32_t u32Length);
+
+    //One row per line. The axis gives the value (e.g. frequency) of each element in a row.
+    template<typename tElement>
+    void                                addRows(const QString &qstrName, const QVector<QVector<tElement> > &qvvData, double dAxisStart = 0.0, double dAxisStep = 1.0);
+
+    //CSV for a "csv" suffix, otherwise binary. Replaces the file atomically.
+    bool                                write(const QString &qstrFilename) const;
+
+private:
+    static const uint32_t               CHUNK_SIZE_B = 1 << 20;
+    static const uint32_t               ALIGNMENT_B = 64;
+
+    class cColumn
+    {
+    public:
+        explicit cColumn(const QString &qstrName) : m_qstrName(qstrName) {}
+        virtual ~cColumn() {}
+
+        const QString&                  getName() const {return m_qstrName;}
+
+        virtual uint32_t                getNLines() const = 0;
+        virtual uint32_t                getNFields() const = 0;     //CSV fields per line
+        virtual uint64_t                getDataSize_B() const = 0;  //0 if nothing is stored
+
+        //Type, shape and axis. The offset of the data is added by the caller.
+        virtual QJsonObject             describe() const = 0;
+        virtual void                    appendHeaderFields(QByteArray &qbaLine) const = 0;
+
+        //Each field is followed by a comma. Lines past the end of the column give empty fields.
+        virtual void                    appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const = 0;
+
+        virtual bool                    writeData(QIODevice &oDevice) const = 0;
+
+    private:
+        QString                         m_qstrName;
+    };
+
+    template<typename tElement>
+    class cVectorColumn : public cColumn
+    {
+    public:
+        cVectorColumn(const QString &qstrName, const QVector<tElement> &qvData) : cColumn(qstrName), m_qvData(qvData) {}
+
+        virtual uint32_t                getNLines() const {return m_qvData.size();}
+        virtual uint32_t                getNFields() const {return 1;}
+        virtual uint64_t                getDataSize_B() const {return (uint64_t)m_qvData.size() * sizeof(tElement);}
+        virtual QJsonObject             describe() const;
+        virtual void                    appendHeaderFields(QByteArray &qbaLine) const;
+        virtual void                    appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const;
+        virtual bool                    writeData(QIODevice &oDevice) const;
+
+    private:
+        QVector<tElement>               m_qvData;
+    };
+
+    class cImplicitVectorColumn : public cColumn
+    {
+    public:
+        cImplicitVectorColumn(const QString &qstrName, double dStart, double dStep, uint32_t u32Length) :
+            cColumn(qstrName), m_dStart(dStart), m_dStep(dStep), m_u32Length(u32Length) {}
+
+        virtual uint32_t                getNLines() const {return m_u32Length;}
+        virtual uint32_t                getNFields() const {return 1;}
+        virtual uint64_t                getDataSize_B() const {return 0;}
+        virtual QJsonObject             describe() const;
+        virtual void                    appendHeaderFields(QByteArray &qbaLine) const;
+        virtual void                    appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const;
+        virtual bool                    writeData(QIODevice &oDevice) const;
+
+    private:
+        double                          m_dStart;
+        double                          m_dStep;
+        uint32_t                        m_u32Length;
+    };
+
+    template<typename tElement>
+    class cRowsColumn : public cColumn
+    {
+    public:
+        cRowsColumn(const QString &qstrName, const QVector<QVector<tElement> > &qvvData, double dAxisStart, double dAxisStep) :
+            cColumn(qstrName), m_qvvData(qvvData), m_dAxisStart(dAxisStart), m_dAxisStep(dAxisStep), m_u32NFields(0)
+        {
+            for(uint32_t u32RowNo = 0; u32RowNo < (uint32_t)m_qvvData.size(); u32RowNo++)
+            {
+                m_u32NFields = qMax(m_u32NFields, (uint32_t)m_qvvData[u32RowNo].size());
+            }
+        }
+
+        virtual uint32_t                getNLines() const {return m_qvvData.size();}
+        virtual uint32_t                getNFields() const {return m_u32NFields;} //The longest row
+        virtual uint64_t                getDataSize_B() const;
+        virtual QJsonObject             describe() const;
+        virtual void                    appendHeaderFields(QByteArray &qbaLine) const;
+        virtual void                    appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const;
+        virtual bool                    writeData(QIODevice &oDevice) const;
+
+    private:
+        QVector<QVector<tElement> >     m_qvvData;
+        double                          m_dAxisStart;
+        double                          m_dAxisStep;
+        uint32_t                        m_u32NFields;
+    };
+
+    QString                             m_qstrTitle;
+    QString                             m_qstrClassName;
+    QStringList                         m_qstrlAttributeKeys;
+    QStringList                         m_qstrlAttributeValues;
+    QList<cColumn*>                     m_qlpColumns;
+
+    bool                                writeCsv(QIODevice &oDevice) const;
+    bool                                writeBinary(QIODevice &oDevice) const;
+
+    uint32_t                            getNLines() const;
+
+    static bool                         writeBlock(QIODevice &oDevice, const char *pcData, uint64_t u64Size_B);
+    static QByteArray                   quoteCsvField(const QString &qstrField);
+
+    //Per element type names and CSV formatting
+    static const char*                  getTypeName(const float*) {return "float32";}
+    static const char*                  getTypeName(const double*) {return "float64";}
+    static const char*                  getTypeName(const int64_t*) {return "int64";}
+    static const char*                  getTypeName(const uint32_t*) {return "uint32";}
+
+    static void                         appendNumber(QByteArray &qbaLine, float fValue);
+    static void                         appendNumber(QByteArray &qbaLine, double dValue);
+    static void                         appendNumber(QByteArray &qbaLine, int64_t i64Value);
+    static void                         appendNumber(QByteArray &qbaLine, uint32_t u32Value);
+};
+
+class cPlotDataExportWriter : public QObject, public cBackgroundWriter
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NExportsWritten;
+        uint64_t                        m_u64NWriteFailures;
+    };
+
+    explicit cPlotDataExportWriter(QObject *pParent = 0);
+    ~cPlotDataExportWriter(); //Writes any queued exports
+
+    //Takes ownership of the export. Exports are written in the order submitted.
+    void                                submit(cPlotDataExport *pExport, const QString &qstrFilename);
+
+    cStats                              getStats();
+
+private:
+    struct cExportJob : public cJob
+    {
+        cExportJob(cPlotDataExport *pExport, const QString &qstrFilename) : m_pExport(pExport), m_qstrFilename(qstrFilename) {}
+        ~cExportJob() { delete m_pExport; }
+
+        cPlotDataExport                 *m_pExport;
+        QString                         m_qstrFilename;
+    };
+
+    //Protected by m_oWriterMutex
+    cStats                              m_oStats;
+
+    virtual bool                        writeJob(cJob *pJob);
+    virtual void                        jobFinished(cJob *pJob, bool bSuccess);
+
+signals:
+    void                                sigExportWritten(const QString &qstrFilename, bool bSuccess);
+};
+
+template<typename tElement>
+void cPlotDataExport::addVector(const QString &qstrName, const QVector<tElement> &qvData)
+{
+    m_qlpColumns.push_back(new cVectorColumn<tElement>(qstrName, qvData));
+}
+
+template<typename tElement>
+void cPlotDataExport::addRows(const QString &qstrName, const QVector<QVector<tElement> > &qvvData, double dAxisStart, double dAxisStep)
+{
+    m_qlpColumns.push_back(new cRowsColumn<tElement>(qstrName, qvvData, dAxisStart, dAxisStep));
+}
+
+template<typename tElement>
+QJsonObject cPlotDataExport::cVectorColumn<tElement>::describe() const
+{
+    QJsonObject oDescription;
+    oDescription.insert(QString("name"), getName());
+    oDescription.insert(QString("kind"), QString("vector"));
+    oDescription.insert(QString("type"), QString(getTypeName((const tElement*)NULL)));
+    oDescription.insert(QString("length"), (double)m_qvData.size());
+
+    return oDescription;
+}
+
+template<typename tElement>
+void cPlotDataExport::cVectorColumn<tElement>::appendHeaderFields(QByteArray &qbaLine) const
+{
+    qbaLine += quoteCsvField(getName());
+    qbaLine += ',';
+}
+
+template<typename tElement>
+void cPlotDataExport::cVectorColumn<tElement>::appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const
+{
+    if(u32LineNo < (uint32_t)m_qvData.size())
+        appendNumber(qbaLine, m_qvData[u32LineNo]);
+
+    qbaLine += ',';
+}
+
+template<typename tElement>
+bool cPlotDataExport::cVectorColumn<tElement>::writeData(QIODevice &oDevice) const
+{
+    return writeBlock(oDevice, reinterpret_cast<const char*>(m_qvData.constData()), getDataSize_B());
+}
+
+template<typename tElement>
+uint64_t cPlotDataExport::cRowsColumn<tElement>::getDataSize_B() const
+{
+    uint64_t u64Size_B = 0;
+
+    for(uint32_t u32RowNo = 0; u32RowNo < (uint32_t)m_qvvData.size(); u32RowNo++)
+    {
+        u64Size_B += (uint64_t)m_qvvData[u32RowNo].size() * sizeof(tElement);
+    }
+
+    return u64Size_B;
+}
+
+template<typename tElement>
+QJsonObject cPlotDataExport::cRowsColumn<tElement>::describe() const
+{
+    QJsonObject oDescription;
+    oDescription.insert(QString("name"), getName());
+    oDescription.insert(QString("kind"), QString("rows"));
+    oDescription.insert(QString("type"), QString(getTypeName((const tElement*)NULL)));
+    oDescription.insert(QString("rows"), (double)m_qvvData.size());
+
+    bool bUniform = true;
+
+    for(uint32_t u32RowNo = 1; u32RowNo < (uint32_t)m_qvvData.size() && bUniform; u32RowNo++)
+    {
+        bUniform = (m_qvvData[u32RowNo].size() == m_qvvData[0].size());
+    }
+
+    if(bUniform)
+    {
+        oDescription.insert(QString("row_length"), (double)(m_qvvData.isEmpty() ? 0 : m_qvvData[0].size()));
+    }
+    else
+    {
+        QJsonArray oRowLengths;
+
+        for(uint32_t u32RowNo = 0; u32RowNo < (uint32_t)m_qvvData.size(); u32RowNo++)
+        {
+            oRowLengths.append((double)m_qvvData[u32RowNo].size());
+        }
+
+        oDescription.insert(QString("row_lengths"), oRowLengths);
+    }
+
+    oDescription.insert(QString("axis_start"), m_dAxisStart);
+    oDescription.insert(QString("axis_step"), m_dAxisStep);
+
+    return oDescription;
+}
+
+template<typename tElement>
+void cPlotDataExport::cRowsColumn<tElement>::appendHeaderFields(QByteArray &qbaLine) const
+{
+    for(uint32_t u32FieldNo = 0; u32FieldNo < m_u32NFields; u32FieldNo++)
+    {
+        qbaLine += quoteCsvField(QString("%1[%2]").arg(getName()).arg(m_dAxisStart + u32FieldNo * m_dAxisStep, 0, 'g', 12));
+        qbaLine += ',';
+    }
+}
+
+template<typename tElement>
+void cPlotDataExport::cRowsColumn<tElement>::appendFields(uint32_t u32LineNo, QByteArray &qbaLine) const
+{
+    uint32_t u32NValues = (u32LineNo < (uint32_t)m_qvvData.size()) ? m_qvvData[u32LineNo].size() : 0;
+
+    for(uint32_t u32FieldNo = 0; u32FieldNo < m_u32NFields; u32FieldNo++)
+    {
+        if(u32FieldNo < u32NValues)
+            appendNumber(qbaLine, m_qvvData[u32LineNo][u32FieldNo]);
+
+        qbaLine += ',';
+    }
+}
+
+template<typename tElement>
+bool cPlotDataExport::cRowsColumn<tElement>::writeData(QIODevice &oDevice) const
+{
+    for(uint32_t u32RowNo = 0; u32RowNo < (uint32_t)m_qvvData.size(); u32RowNo++)
+    {
+        if(!writeBlock(oDevice, reinterpret_cast<const char*>(m_qvvData[u32RowNo].constData()), (uint64_t)m_qvvData[u32RowNo].size() * sizeof(tElement)))
+            return false;
+    }
+
+    return true;
+}
+
+#endif // PLOT_DATA_EXPORT_H
@@ -0,0 +1,125 @@
+//System includes
+#include <utility>
+
+//Library includes
+
+//Local includes
+#include "PlotFrame.h"
+
+using namespace std;
+
+cSharedPlotFrame::cSharedPlotFrame() :
+    m_u32NChannels(0),
+    m_u32NBins(0)
+{
+}
+
+cSharedPlotFrame::cSharedPlotFrame(const QVector<float> &qvfData, uint32_t u32NChannels, uint32_t u32NBins) :
+    m_qvfData(qvfData),
+    m_u32NChannels(u32NChannels),
+    m_u32NBins(u32NBins)
+{
+    //Guard against a short vector
+    if((uint64_t)m_qvfData.size() < (uint64_t)m_u32NChannels * m_u32NBins)
+        m_qvfData.resize(m_u32NChannels * m_u32NBins);
+}
+
+#ifdef Q_COMPILER_RVALUE_REFS
+cSharedPlotFrame::cSharedPlotFrame(QVector<float> &&qvfData, uint32_t u32NChannels, uint32_t u32NBins) :
+    m_qvfData(std::move(qvfData)),
+    m_u32NChannels(u32NChannels),
+    m_u32NBins(u32NBins)
+{
+    if((uint64_t)m_qvfData.size() < (uint64_t)m_u32NChannels * m_u32NBins)
+        m_qvfData.resize(m_u32NChannels * m_u32NBins);
+}
+#endif
+
+void cSharedPlotFrame::reshape(uint32_t u32NChannels, uint32_t u32NBins)
+{
+    m_u32NChannels = u32NChannels;
+    m_u32NBins = u32NBins;
+
+    if(m_qvfData.size() != (int32_t)(m_u32NChannels * m_u32NBins))
+        m_qvfData.resize(m_u32NChannels * m_u32NBins);
+}
+
+float* cSharedPlotFrame::getWritableData()
+{
+    return m_qvfData.data();
+}
+
+cPlotFrameView::cPlotFrameView()
+{
+}
+
+cPlotFrameView::cPlotFrameView(const float *pfData, uint32_t u32NChannels, uint32_t u32NBins, uint32_t u32ChannelStride)
+{
+    if(!u32ChannelStride)
+        u32ChannelStride = u32NBins;
+
+    m_qvlapfChannels.resize(u32NChannels);
+    m_qvlau32NBins.resize(u32NChannels);
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        m_qvlapfChannels[u32ChannelNo] = pfData + (uint64_t)u32ChannelNo * u32ChannelStride;
+        m_qvlau32NBins[u32ChannelNo] = u32NBins;
+    }
+}
+
+cPlotFrameView::cPlotFrameView(const QVector<QVector<float> > &qvvfData)
+{
+    m_qvlapfChannels.resize(qvvfData.size());
+    m_qvlau32NBins.resize(qvvfData.size());
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfData.size(); u32ChannelNo++)
+    {
+        m_qvlapfChannels[u32ChannelNo] = qvvfData[u32ChannelNo].constData();
+        m_qvlau32NBins[u32ChannelNo] = qvvfData[u32ChannelNo].size();
+    }
+}
+
+cPlotFrameView::cPlotFrameView(const cSharedPlotFrame &oFrame)
+{
+    m_qvlapfChannels.resize(oFrame.getNChannels());
+    m_qvlau32NBins.resize(oFrame.getNChannels());
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < oFrame.getNChannels(); u32ChannelNo++)
+    {
+        m_qvlapfChannels[u32ChannelNo] = oFrame.getChannel(u32ChannelNo);
+        m_qvlau32NBins[u32ChannelNo] = oFrame.getNBins();
+    }
+}
+
+void cPlotFrameBatch::addFrame(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const float *pfXData, uint32_t u32NXSamples)
+{
+    m_qvoFrames.push_back(oYData);
+    m_qvi64Timestamps_us.push_back(i64Timestamp_us);
+    m_qvpfXData.push_back(pfXData);
+    m_qvu32NXSamples.push_back(u32NXSamples);
+}
+
+void cPlotFrameBatch::clear()
+{
+    //Retains capacity so that a batch object can be refilled without allocating
+    m_qvoFrames.resize(0);
+    m_qvi64Timestamps_us.resize(0);
+    m_qvpfXData.resize(0);
+    m_qvu32NXSamples.resize(0);
+}
+
+void cRawPlotFrameView::convertChannel(uint32_t u32ChannelNo, float *pfOutput) const
+{
+    m_pfnConvert(m_pu8Samples + (uint64_t)u32ChannelNo * m_u32ChannelStride_B, pfOutput, m_u32NBins, m_fScale, 0.0f);
+}
+
+void cRawPlotFrameView::convertChannelToDecibels(uint32_t u32ChannelNo, float *pfOutput, float fDecibelFactor) const
+{
+    m_pfnConvertToDecibels(m_pu8Samples + (uint64_t)u32ChannelNo * m_u32ChannelStride_B, pfOutput, m_u32NBins, m_fScale, fDecibelFactor);
+}
+
+void cRawPlotFrameView::accumulateChannel(uint32_t u32ChannelNo, float *pfOutput) const
+{
+    m_pfnAccumulate(m_pu8Samples + (uint64_t)u32ChannelNo * m_u32ChannelStride_B, pfOutput, m_u32NBins, m_fScale, 0.0f);
+}
@@ -0,0 +1,172 @@
+//Lightweight frame types used to pass data to the plotting widgets without building nested QVectors.
+//cPlotFrameView is a non-owning description of channel data already in memory (valid only for the duration of an addData call).
+//cSharedPlotFrame is a reference counted, channel-major block of data which widgets can retain without copying.
+//cRawPlotFrameView is a non-owning description of raw digitiser samples (integer or float, real or interleaved complex)
+//which the widgets convert to power as they ingest it, without an intermediate float frame.
+//cPlotFrameBatch is a run of timestamped frame views for the widgets' batch ingest functions.
+
+#ifndef PLOT_FRAME_H
+#define PLOT_FRAME_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+#include <QVarLengthArray>
+
+//Local includes
+#include "PlotKernels.h"
+
+class cSharedPlotFrame
+{
+public:
+    cSharedPlotFrame();
+
+    //Shares the vector through Qt's implicit sharing. No data is copied unless either side is subsequently modified.
+    cSharedPlotFrame(const QVector<float> &qvfData, uint32_t u32NChannels, uint32_t u32NBins);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //Takes ownership of the vector
+    cSharedPlotFrame(QVector<float> &&qvfData, uint32_t u32NChannels, uint32_t u32NBins);
+#endif
+
+    uint32_t                            getNChannels() const {return m_u32NChannels;}
+    uint32_t                            getNBins() const {return m_u32NBins;}
+    const float*                        getChannel(uint32_t u32ChannelNo) const {return m_qvfData.constData() + u32ChannelNo * m_u32NBins;}
+
+    //For refilling a frame in place. Only allocates if the size changes or the data is shared with another frame.
+    void                                reshape(uint32_t u32NChannels, uint32_t u32NBins);
+    float*                              getWritableData();
+
+private:
+    QVector<float>                      m_qvfData;
+    uint32_t                            m_u32NChannels;
+    uint32_t                            m_u32NBins;
+};
+
+class cPlotFrameView
+{
+public:
+    //Empty view of no channels
+    cPlotFrameView();
+
+    //Contiguous channel-major block. A channel stride of 0 means channels are packed (stride = number of bins).
+    cPlotFrameView(const float *pfData, uint32_t u32NChannels, uint32_t u32NBins, uint32_t u32ChannelStride = 0);
+
+    //Legacy nested vector data. Channels may differ in length.
+    explicit cPlotFrameView(const QVector<QVector<float> > &qvvfData);
+
+    cPlotFrameView(const cSharedPlotFrame &oFrame);
+
+    uint32_t                            getNChannels() const {return m_qvlapfChannels.size();}
+    uint32_t                            getNBins(uint32_t u32ChannelNo) const {return m_qvlau32NBins[u32ChannelNo];}
+    const float*                        getChannel(uint32_t u32ChannelNo) const {return m_qvlapfChannels[u32ChannelNo];}
+
+private:
+    //Stack storage for typical channel counts so that constructing a view does not allocate
+    QVarLengthArray<const float*, 16>   m_qvlapfChannels;
+    QVarLengthArray<uint32_t, 16>       m_qvlau32NBins;
+};
+
+class cPlotFrameBatch
+{
+public:
+    //X data is only used by the basic and scrolling plots. Frame views and X data must remain valid until the batch has been passed to a widget.
+    void                                addFrame(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const float *pfXData = NULL, uint32_t u32NXSamples = 0);
+    void                                clear();
+
+    uint32_t                            getNFrames() const {return m_qvoFrames.size();}
+    const cPlotFrameView&               getFrame(uint32_t u32FrameNo) const {return m_qvoFrames[u32FrameNo];}
+    int64_t                             getTimestamp_us(uint32_t u32FrameNo) const {return m_qvi64Timestamps_us[u32FrameNo];}
+    const float*                        getXData(uint32_t u32FrameNo) const {return m_qvpfXData[u32FrameNo];}
+    uint32_t                            getNXSamples(uint32_t u32FrameNo) const {return m_qvu32NXSamples[u32FrameNo];}
+
+private:
+    QVector<cPlotFrameView>             m_qvoFrames;
+    QVector<int64_t>                    m_qvi64Timestamps_us;
+    QVector<const float*>               m_qvpfXData;
+    QVector<uint32_t>                   m_qvu32NXSamples;
+};
+
+class cRawPlotFrameView
+{
+public:
+    //Contiguous channel-major block. For complex data samples are interleaved (re, im) and u32NBins counts complex values.
+    //Samples are multiplied by fScale. The output is |z|^2 (x^2 for real data) if bPower is set, otherwise |z| (x for real data).
+    //tSample is any integer or floating point type, typically int8_t or int16_t from a digitiser.
+    template<typename tSample>
+    cRawPlotFrameView(const tSample *pSamples, uint32_t u32NChannels, uint32_t u32NBins, bool bComplex, bool bPower = true, float fScale = 1.0f);
+
+    uint32_t                            getNChannels() const {return m_u32NChannels;}
+    uint32_t                            getNBins() const {return m_u32NBins;}
+
+    //Converted channel data written to, or accumulated into, u32NBins floats at pfOutput
+    void                                convertChannel(uint32_t u32ChannelNo, float *pfOutput) const;
+    void                                convertChannelToDecibels(uint32_t u32ChannelNo, float *pfOutput, float fDecibelFactor) const;
+    void                                accumulateChannel(uint32_t u32ChannelNo, float *pfOutput) const;
+
+private:
+    typedef void (*tConversionFunction)(const void *pvInput, float *pfOutput, uint32_t u32NSamples, float fScale, float fDecibelFactor);
+
+    const uint8_t                       *m_pu8Samples;
+    uint32_t                            m_u32NChannels;
+    uint32_t                            m_u32NBins;
+    uint32_t                            m_u32ChannelStride_B;
+    float                               m_fScale;
+
+    //Kernel instantiations for the sample type and format chosen at construction
+    tConversionFunction                 m_pfnConvert;
+    tConversionFunction                 m_pfnConvertToDecibels;
+    tConversionFunction                 m_pfnAccumulate;
+
+    template<typename tSample, bool bComplex, bool bPower>
+    void                                setConversionFunctions();
+};
+
+template<typename tSample>
+cRawPlotFrameView::cRawPlotFrameView(const tSample *pSamples, uint32_t u32NChannels, uint32_t u32NBins, bool bComplex, bool bPower, float fScale) :
+    m_pu8Samples(reinterpret_cast<const uint8_t*>(pSamples)),
+    m_u32NChannels(u32NChannels),
+    m_u32NBins(u32NBins),
+    m_u32ChannelStride_B(u32NBins * (bComplex ? 2 : 1) * sizeof(tSample)),
+    m_fScale(fScale)
+{
+    if(bComplex)
+    {
+        if(bPower)
+            setConversionFunctions<tSample, true, true>();
+        else
+            setConversionFunctions<tSample, true, false>();
+    }
+    else
+    {
+        if(bPower)
+            setConversionFunctions<tSample, false, true>();
+        else
+            setConversionFunctions<tSample, false, false>();
+    }
+}
+
+template<typename tSample, bool bComplex, bool bPower>
+void cRawPlotFrameView::setConversionFunctions()
+{
+    m_pfnConvert = &cPlotKernels::convertRawSamples<tSample, bComplex, bPower, false, cCopyOperation>;
+    m_pfnConvertToDecibels = &cPlotKernels::convertRawSamples<tSample, bComplex, bPower, true, cCopyOperation>;
+    m_pfnAccumulate = &cPlotKernels::convertRawSamples<tSample, bComplex, bPower, false, cAccumulateOperation>;
+}
+
+#endif // PLOT_FRAME_H
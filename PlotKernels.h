@@ -0,0 +1,174 @@
+//Inner loops shared by the plotting widgets.
+//Channel selection (all channels in order or through a channel list) is a compile time policy so that both cases
+//share one implementation without a per-channel branch. The sample loops run over raw pointers with the length
+//hoisted out of the loop so that the compiler can vectorise them. Input and output sample types are template parameters.
+
+#ifndef PLOT_KERNELS_H
+#define PLOT_KERNELS_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <cmath>
+#include <limits>
+
+//Library includes
+#include <QVector>
+
+//Local includes
+
+//Channel selection policies. Map an output channel number to an input channel number.
+
+class cIdentityChannelSelection
+{
+public:
+    uint32_t                            getInputChannelNo(uint32_t u32ChannelNo) const {return u32ChannelNo;}
+};
+
+class cIndexedChannelSelection
+{
+public:
+    explicit cIndexedChannelSelection(const QVector<uint32_t> &qvu32ChannelList) : m_pu32ChannelList(qvu32ChannelList.constData()) {}
+
+    uint32_t                            getInputChannelNo(uint32_t u32ChannelNo) const {return m_pu32ChannelList[u32ChannelNo];}
+
+private:
+    const uint32_t                      *m_pu32ChannelList;
+};
+
+//Per sample operations
+
+class cCopyOperation
+{
+public:
+    template<typename tOutput, typename tInput>
+    static void                         apply(tOutput &oOutput, tInput oInput) {oOutput = (tOutput)oInput;}
+};
+
+class cAccumulateOperation
+{
+public:
+    template<typename tOutput, typename tInput>
+    static void                         apply(tOutput &oOutput, tInput oInput) {oOutput += (tOutput)oInput;}
+};
+
+//cAbsCopyOperation by signedness of the input. Unsigned samples are copied as is rather than compared against 0, which is always false.
+template<bool bSigned>
+class cAbsCopyBySignedness
+{
+public:
+    //Written as a comparison rather than with std::abs so that it is defined for all sample types (incl. int8_t) and vectorises
+    template<typename tOutput, typename tInput>
+    static void                         apply(tOutput &oOutput, tInput oInput) {oOutput = oInput < 0 ? -(tOutput)oInput : (tOutput)oInput;}
+};
+
+template<>
+class cAbsCopyBySignedness<false>
+{
+public:
+    template<typename tOutput, typename tInput>
+    static void                         apply(tOutput &oOutput, tInput oInput) {oOutput = (tOutput)oInput;}
+};
+
+class cAbsCopyOperation
+{
+public:
+    template<typename tOutput, typename tInput>
+    static void                         apply(tOutput &oOutput, tInput oInput) {cAbsCopyBySignedness<std::numeric_limits<tInput>::is_signed>::apply(oOutput, oInput);}
+};
+
+class cPlotKernels
+{
+public:
+    //pOutput[i] op= pInput[i] for i in [0, u32NSamples)
+    template<typename tOperation, typename tInput, typename tOutput>
+    static void                         apply(const tInput *pInput, tOutput *pOutput, uint32_t u32NSamples)
+    {
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            tOperation::apply(pOutput[u32SampleNo], pInput[u32SampleNo]);
+        }
+    }
+
+    //pOutput[0] = 0, pOutput[i + 1] = sum of |pInput[0..i]|. pOutput must hold u32NSamples + 1 values.
+    template<typename tInput, typename tOutput>
+    static void                         absPrefixSum(const tInput *pInput, tOutput *pOutput, uint32_t u32NSamples)
+    {
+        //First pass is independent per element and vectorises. The running sum in the second pass is inherently serial.
+        pOutput[0] = 0;
+        apply<cAbsCopyOperation>(pInput, pOutput + 1, u32NSamples);
+
+        for(uint32_t u32SampleNo = 1; u32SampleNo <= u32NSamples; u32SampleNo++)
+        {
+            pOutput[u32SampleNo] += pOutput[u32SampleNo - 1];
+        }
+    }
+
+    //The widgets' log conversion: dFactor * log10(x + 0.001), i.e. 10 for power and 20 for voltage to dB.
+    //The offset keeps zeros finite. pfOutput may equal pfInput for an in place conversion.
+    static float                        toDecibels(float fValue, double dFactor)
+    {
+        return dFactor * std::log10(fValue + 0.001);
+    }
+
+    static void                         toDecibels(const float *pfInput, float *pfOutput, uint32_t u32NSamples, double dFactor)
+    {
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            pfOutput[u32SampleNo] = toDecibels(pfInput[u32SampleNo], dFactor);
+        }
+    }
+
+    //Fused conversion of raw digitiser samples: scale, then |z|^2 or |z| for interleaved complex (re, im) input, or x^2 or x
+    //for real input, then optionally fDecibelFactor * log10( + 0.001) as in the widgets' log conversion, then the output operation.
+    //The flags are compile time constants so each instantiation is a single branch free loop.
+    //The input is untyped so that instantiations can be stored as function pointers by cRawPlotFrameView.
+    template<typename tSample, bool bComplex, bool bPower, bool bDecibels, typename tOperation>
+    static void                         convertRawSamples(const void *pvInput, float *pfOutput, uint32_t u32NSamples, float fScale, float fDecibelFactor)
+    {
+        const tSample *pInput = static_cast<const tSample*>(pvInput);
+
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            float fValue;
+
+            if(bComplex)
+            {
+                float fReal = pInput[2 * u32SampleNo] * fScale;
+                float fImag = pInput[2 * u32SampleNo + 1] * fScale;
+
+                fValue = fReal * fReal + fImag * fImag;
+
+                if(!bPower)
+                    fValue = std::sqrt(fValue);
+            }
+            else
+            {
+                fValue = pInput[u32SampleNo] * fScale;
+
+                if(bPower)
+                    fValue *= fValue;
+            }
+
+            if(bDecibels)
+                fValue = fDecibelFactor * std::log10(fValue + 0.001f);
+
+            tOperation::apply(pfOutput[u32SampleNo], fValue);
+        }
+    }
+};
+
+#endif // PLOT_KERNELS_H
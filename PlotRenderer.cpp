@@ -0,0 +1,876 @@
+//System includes
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+//Library includes
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QPalette>
+#include <QPen>
+#include <QVector>
+#include <QPointF>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QMarginsF>
+#ifndef QWT_NO_SVG
+#include <QSvgGenerator>
+#endif
+#include <qwt_plot_curve.h>
+#include <qwt_plot_marker.h>
+#include <qwt_plot_grid.h>
+#include <qwt_symbol.h>
+#include <qwt_scale_draw.h>
+#include <qwt_scale_map.h>
+#include <qwt_painter.h>
+
+//Local includes
+#include "PlotRenderer.h"
+#include "FloatQwtSeriesData.h"
+#include "WallTimeQwtScaleDraw.h"
+
+using namespace std;
+
+const double cPlotRenderer::LAYOUT_DPI = 96.0;
+const double cPlotRenderer::MARGIN_PX = 10.0;
+const double cPlotRenderer::SPACING_PX = 4.0;
+const double cPlotRenderer::COLOUR_BAR_WIDTH_PX = 10.0;
+const double cPlotRenderer::LEGEND_ICON_WIDTH_PX = 20.0;
+
+static bool itemZLessThan(const QwtPlotItem *pItem1, const QwtPlotItem *pItem2)
+{
+    return pItem1->z() < pItem2->z();
+}
+
+cPlotRenderSnapshot::cPlotRenderSnapshot() :
+    m_i64Timestamp_us(0),
+    m_pColourBarMap(NULL)
+{
+    for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+    {
+        m_aoAxes[i32Axis].m_bEnabled = false;
+        m_aoAxes[i32Axis].m_bIsWallTime = false;
+        m_aoAxes[i32Axis].m_dMinimumExtent = 0.0;
+    }
+}
+
+cPlotRenderSnapshot::~cPlotRenderSnapshot()
+{
+    for(int32_t i32ItemNo = 0; i32ItemNo < m_qlpItems.size(); i32ItemNo++)
+    {
+        delete m_qlpItems[i32ItemNo];
+    }
+
+    delete m_pColourBarMap;
+}
+
+void cPlotRenderSnapshot::addItem(QwtPlotItem *pItem)
+{
+    m_qlpItems.push_back(pItem);
+}
+
+const QList<QwtPlotItem*>& cPlotRenderSnapshot::getItems() const
+{
+    return m_qlpItems;
+}
+
+void cPlotRenderSnapshot::setColourBar(const QwtInterval &oInterval, QwtColorMap *pColourMap)
+{
+    delete m_pColourBarMap;
+
+    m_pColourBarMap = pColourMap;
+    m_oColourBarInterval = oInterval;
+}
+
+const QwtColorMap* cPlotRenderSnapshot::getColourBarMap() const
+{
+    return m_pColourBarMap;
+}
+
+QwtInterval cPlotRenderSnapshot::getColourBarInterval() const
+{
+    return m_oColourBarInterval;
+}
+
+QwtPlotItem* cPlotRenderSnapshot::copyItem(const QwtPlotItem *pItem)
+{
+    QwtPlotItem *pCopy = NULL;
+
+    if(pItem->rtti() == QwtPlotItem::Rtti_PlotCurve)
+    {
+        const QwtPlotCurve *pCurve = static_cast<const QwtPlotCurve*>(pItem);
+        QwtPlotCurve *pCurveCopy = new QwtPlotCurve(pCurve->title());
+
+        pCurveCopy->setPen(pCurve->pen());
+        pCurveCopy->setBrush(pCurve->brush());
+        pCurveCopy->setStyle(pCurve->style());
+        pCurveCopy->setBaseline(pCurve->baseline());
+
+        const QwtSymbol *pSymbol = pCurve->symbol();
+        if(pSymbol)
+            pCurveCopy->setSymbol(new QwtSymbol(pSymbol->style(), pSymbol->brush(), pSymbol->pen(), pSymbol->size()));
+
+        //The widgets' own series adapter shares the plot vectors. Anything else is copied sample by sample.
+        const cFloatQwtSeriesData *pData = dynamic_cast<const cFloatQwtSeriesData*>(pCurve->data());
+
+        if(pData)
+        {
+            pCurveCopy->setData(new cFloatQwtSeriesData(*pData));
+        }
+        else
+        {
+            QVector<QPointF> qvoSamples((int32_t)pCurve->dataSize());
+
+            for(int32_t i32SampleNo = 0; i32SampleNo < qvoSamples.size(); i32SampleNo++)
+            {
+                qvoSamples[i32SampleNo] = pCurve->sample(i32SampleNo);
+            }
+
+            pCurveCopy->setSamples(qvoSamples);
+        }
+
+        pCopy = pCurveCopy;
+    }
+    else if(pItem->rtti() == QwtPlotItem::Rtti_PlotMarker)
+    {
+        const QwtPlotMarker *pMarker = static_cast<const QwtPlotMarker*>(pItem);
+        QwtPlotMarker *pMarkerCopy = new QwtPlotMarker;
+
+        pMarkerCopy->setTitle(pMarker->title());
+        pMarkerCopy->setValue(pMarker->xValue(), pMarker->yValue());
+        pMarkerCopy->setLineStyle(pMarker->lineStyle());
+        pMarkerCopy->setLinePen(pMarker->linePen());
+        pMarkerCopy->setLabel(pMarker->label());
+        pMarkerCopy->setLabelAlignment(pMarker->labelAlignment());
+        pMarkerCopy->setLabelOrientation(pMarker->labelOrientation());
+        pMarkerCopy->setSpacing(pMarker->spacing());
+
+        pCopy = pMarkerCopy;
+    }
+    else if(pItem->rtti() == QwtPlotItem::Rtti_PlotGrid)
+    {
+        const QwtPlotGrid *pGrid = static_cast<const QwtPlotGrid*>(pItem);
+        QwtPlotGrid *pGridCopy = new QwtPlotGrid;
+
+#if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
+        pGridCopy->setMajPen(pGrid->majPen());
+        pGridCopy->setMinPen(pGrid->minPen());
+#else
+        pGridCopy->setMajorPen(pGrid->majorPen());
+        pGridCopy->setMinorPen(pGrid->minorPen());
+#endif
+        pGridCopy->enableX(pGrid->xEnabled());
+        pGridCopy->enableY(pGrid->yEnabled());
+        pGridCopy->enableXMin(pGrid->xMinEnabled());
+        pGridCopy->enableYMin(pGrid->yMinEnabled());
+
+        pCopy = pGridCopy;
+    }
+
+    if(pCopy)
+    {
+        pCopy->setAxes(pItem->xAxis(), pItem->yAxis());
+        pCopy->setZ(pItem->z());
+        pCopy->setRenderHint(QwtPlotItem::RenderAntialiased, pItem->testRenderHint(QwtPlotItem::RenderAntialiased));
+    }
+
+    return pCopy;
+}
+
+void cPlotRenderer::render(const cPlotRenderSnapshot &oSnapshot, QPainter *pPainter, const QRectF &oRect, cPlotRenderProgress *pProgress)
+{
+    if(oRect.isEmpty())
+        return;
+
+    pPainter->save();
+
+    //Lay out in 96 dpi pixels and let the painter scale to the device
+    double dScaleX = pPainter->device()->logicalDpiX() / LAYOUT_DPI;
+    double dScaleY = pPainter->device()->logicalDpiY() / LAYOUT_DPI;
+
+    pPainter->translate(oRect.left(), oRect.top());
+    pPainter->scale(dScaleX, dScaleY);
+
+    QRectF oLayoutRect(0.0, 0.0, oRect.width() / dScaleX, oRect.height() / dScaleY);
+    QRectF oFreeRect(oLayoutRect.left() + MARGIN_PX, oLayoutRect.top() + MARGIN_PX, oLayoutRect.width() - 2 * MARGIN_PX, oLayoutRect.height() - 2 * MARGIN_PX);
+
+    pPainter->fillRect(oLayoutRect, QColor(Qt::white));
+
+    //Title across the top
+    if(!oSnapshot.m_oTitle.isEmpty())
+    {
+        QwtText oTitle(oSnapshot.m_oTitle);
+        oTitle.setFont(getLayoutFont(oTitle.font()));
+
+        double dTitleHeight = oTitle.heightForWidth(oFreeRect.width());
+        oTitle.draw(pPainter, QRectF(oFreeRect.left(), oFreeRect.top(), oFreeRect.width(), dTitleHeight));
+
+        oFreeRect.setTop(oFreeRect.top() + dTitleHeight + SPACING_PX);
+    }
+
+    //Legend down the right hand side
+    double dLegendWidth = qMin(getLegendWidth(oSnapshot), oFreeRect.width() / 3.0);
+
+    if(dLegendWidth > 0.0)
+    {
+        drawLegend(oSnapshot, pPainter, QRectF(oFreeRect.right() - dLegendWidth, oFreeRect.top(), dLegendWidth, oFreeRect.height()));
+
+        oFreeRect.setRight(oFreeRect.right() - dLegendWidth - SPACING_PX);
+    }
+
+    //Size the axes. Each takes its scale (with labels) and title from the free space on its side of the canvas.
+    QwtScaleDraw *apScaleDraws[QwtPlot::axisCnt];
+    QwtText aoAxisTitles[QwtPlot::axisCnt];
+    QFont aoAxisFonts[QwtPlot::axisCnt];
+    double adAxisTitleExtents[QwtPlot::axisCnt];
+    double adAxisExtents[QwtPlot::axisCnt];
+
+    for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+    {
+        const cPlotRenderSnapshot::cAxis &oAxis = oSnapshot.m_aoAxes[i32Axis];
+
+        apScaleDraws[i32Axis] = NULL;
+        adAxisTitleExtents[i32Axis] = 0.0;
+        adAxisExtents[i32Axis] = 0.0;
+
+        if(!oAxis.m_bEnabled)
+            continue;
+
+        if(oAxis.m_bIsWallTime)
+            apScaleDraws[i32Axis] = new cWallTimeQwtScaleDraw;
+        else
+            apScaleDraws[i32Axis] = new QwtScaleDraw;
+
+        if(i32Axis == QwtPlot::yLeft)
+            apScaleDraws[i32Axis]->setAlignment(QwtScaleDraw::LeftScale);
+        else if(i32Axis == QwtPlot::yRight)
+            apScaleDraws[i32Axis]->setAlignment(QwtScaleDraw::RightScale);
+        else if(i32Axis == QwtPlot::xBottom)
+            apScaleDraws[i32Axis]->setAlignment(QwtScaleDraw::BottomScale);
+        else
+            apScaleDraws[i32Axis]->setAlignment(QwtScaleDraw::TopScale);
+
+        apScaleDraws[i32Axis]->setScaleDiv(oAxis.m_oScaleDiv);
+        apScaleDraws[i32Axis]->setMinimumExtent(oAxis.m_dMinimumExtent);
+
+        aoAxisFonts[i32Axis] = getLayoutFont(oAxis.m_oFont);
+
+#if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
+        adAxisExtents[i32Axis] = apScaleDraws[i32Axis]->extent(QPen(), aoAxisFonts[i32Axis]);
+#else
+        adAxisExtents[i32Axis] = apScaleDraws[i32Axis]->extent(aoAxisFonts[i32Axis]);
+#endif
+
+        aoAxisTitles[i32Axis] = oAxis.m_oTitle;
+
+        if(!aoAxisTitles[i32Axis].isEmpty())
+        {
+            aoAxisTitles[i32Axis].setFont(getLayoutFont(aoAxisTitles[i32Axis].font()));
+
+            //Titles of vertical axes are rotated so their height is across the page either way
+            adAxisTitleExtents[i32Axis] = aoAxisTitles[i32Axis].textSize().height();
+            adAxisExtents[i32Axis] += adAxisTitleExtents[i32Axis] + SPACING_PX;
+        }
+    }
+
+    //The colour bar sits between the canvas and the right axis
+    double dColourBarExtent = 0.0;
+
+    if(oSnapshot.getColourBarMap())
+        dColourBarExtent = COLOUR_BAR_WIDTH_PX + SPACING_PX;
+
+    QRectF oCanvasRect(QPointF(oFreeRect.left() + adAxisExtents[QwtPlot::yLeft], oFreeRect.top() + adAxisExtents[QwtPlot::xTop]),
+                       QPointF(oFreeRect.right() - adAxisExtents[QwtPlot::yRight] - dColourBarExtent, oFreeRect.bottom() - adAxisExtents[QwtPlot::xBottom]));
+
+    //Leave room for the labels at the ends of each scale to overhang the canvas
+    for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+    {
+        if(!apScaleDraws[i32Axis])
+            continue;
+
+        int iStartDistance;
+        int iEndDistance;
+        apScaleDraws[i32Axis]->getBorderDistHint(aoAxisFonts[i32Axis], iStartDistance, iEndDistance);
+
+        if(i32Axis == QwtPlot::xBottom || i32Axis == QwtPlot::xTop)
+        {
+            oCanvasRect.setLeft(qMax(oCanvasRect.left(), oFreeRect.left() + iStartDistance));
+            oCanvasRect.setRight(qMin(oCanvasRect.right(), oFreeRect.right() - iEndDistance));
+        }
+        else
+        {
+            //Vertical scales run upwards so their start is at the bottom
+            oCanvasRect.setBottom(qMin(oCanvasRect.bottom(), oFreeRect.bottom() - iStartDistance));
+            oCanvasRect.setTop(qMax(oCanvasRect.top(), oFreeRect.top() + iEndDistance));
+        }
+    }
+
+    if(oCanvasRect.width() > 1.0 && oCanvasRect.height() > 1.0)
+    {
+        //Scales and their titles
+        QPalette oPalette;
+        oPalette.setColor(QPalette::WindowText, QColor(Qt::black));
+        oPalette.setColor(QPalette::Text, QColor(Qt::black));
+
+        for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+        {
+            if(!apScaleDraws[i32Axis])
+                continue;
+
+            QRectF oTitleRect;
+
+            if(i32Axis == QwtPlot::yLeft)
+            {
+                apScaleDraws[i32Axis]->move(oCanvasRect.left(), oCanvasRect.top());
+                apScaleDraws[i32Axis]->setLength(oCanvasRect.height());
+                oTitleRect = QRectF(oFreeRect.left(), oCanvasRect.top(), adAxisTitleExtents[i32Axis], oCanvasRect.height());
+            }
+            else if(i32Axis == QwtPlot::yRight)
+            {
+                apScaleDraws[i32Axis]->move(oCanvasRect.right() + dColourBarExtent, oCanvasRect.top());
+                apScaleDraws[i32Axis]->setLength(oCanvasRect.height());
+                oTitleRect = QRectF(oFreeRect.right() - adAxisTitleExtents[i32Axis], oCanvasRect.top(), adAxisTitleExtents[i32Axis], oCanvasRect.height());
+            }
+            else if(i32Axis == QwtPlot::xBottom)
+            {
+                apScaleDraws[i32Axis]->move(oCanvasRect.left(), oCanvasRect.bottom());
+                apScaleDraws[i32Axis]->setLength(oCanvasRect.width());
+                oTitleRect = QRectF(oCanvasRect.left(), oFreeRect.bottom() - adAxisTitleExtents[i32Axis], oCanvasRect.width(), adAxisTitleExtents[i32Axis]);
+            }
+            else
+            {
+                apScaleDraws[i32Axis]->move(oCanvasRect.left(), oCanvasRect.top());
+                apScaleDraws[i32Axis]->setLength(oCanvasRect.width());
+                oTitleRect = QRectF(oCanvasRect.left(), oFreeRect.top(), oCanvasRect.width(), adAxisTitleExtents[i32Axis]);
+            }
+
+            //Tick labels are drawn in the painter's font
+            pPainter->setFont(aoAxisFonts[i32Axis]);
+            apScaleDraws[i32Axis]->draw(pPainter, oPalette);
+
+            if(aoAxisTitles[i32Axis].isEmpty())
+                continue;
+
+            pPainter->save();
+
+            if(i32Axis == QwtPlot::yLeft)
+            {
+                pPainter->translate(oTitleRect.left(), oTitleRect.bottom());
+                pPainter->rotate(-90.0);
+                aoAxisTitles[i32Axis].draw(pPainter, QRectF(0.0, 0.0, oTitleRect.height(), oTitleRect.width()));
+            }
+            else if(i32Axis == QwtPlot::yRight)
+            {
+                pPainter->translate(oTitleRect.right(), oTitleRect.top());
+                pPainter->rotate(90.0);
+                aoAxisTitles[i32Axis].draw(pPainter, QRectF(0.0, 0.0, oTitleRect.height(), oTitleRect.width()));
+            }
+            else
+            {
+                aoAxisTitles[i32Axis].draw(pPainter, oTitleRect);
+            }
+
+            pPainter->restore();
+        }
+
+        if(oSnapshot.getColourBarMap())
+        {
+            QwtScaleMap oColourBarMap;
+            oColourBarMap.setPaintInterval(oCanvasRect.bottom(), oCanvasRect.top());
+            oColourBarMap.setScaleInterval(oSnapshot.getColourBarInterval().minValue(), oSnapshot.getColourBarInterval().maxValue());
+
+            QwtPainter::drawColorBar(pPainter, *oSnapshot.getColourBarMap(), oSnapshot.getColourBarInterval(), oColourBarMap, Qt::Vertical,
+                                     QRectF(oCanvasRect.right() + SPACING_PX, oCanvasRect.top(), COLOUR_BAR_WIDTH_PX, oCanvasRect.height()));
+        }
+
+        //Canvas
+        QwtScaleMap aoMaps[QwtPlot::axisCnt];
+
+        for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+        {
+            const QwtScaleDiv &oScaleDiv = oSnapshot.m_aoAxes[i32Axis].m_oScaleDiv;
+
+            aoMaps[i32Axis].setScaleInterval(oScaleDiv.lowerBound(), oScaleDiv.upperBound());
+
+            if(i32Axis == QwtPlot::xBottom || i32Axis == QwtPlot::xTop)
+                aoMaps[i32Axis].setPaintInterval(oCanvasRect.left(), oCanvasRect.right());
+            else
+                aoMaps[i32Axis].setPaintInterval(oCanvasRect.bottom(), oCanvasRect.top());
+        }
+
+        pPainter->fillRect(oCanvasRect, oSnapshot.m_oCanvasBackground);
+
+        pPainter->save();
+        pPainter->setClipRect(oCanvasRect);
+
+        //Drawn in Z order as QwtPlot does. The snapshot is only ever rendered by one thread at a time so its items can be updated here.
+        QList<QwtPlotItem*> qlpItems = oSnapshot.getItems();
+        stable_sort(qlpItems.begin(), qlpItems.end(), itemZLessThan);
+
+        //Curves are decimated to the pixel columns of the canvas on the device
+        uint32_t u32NCanvasColumns = (uint32_t)ceil(oCanvasRect.width() * dScaleX);
+
+        for(int32_t i32ItemNo = 0; i32ItemNo < qlpItems.size(); i32ItemNo++)
+        {
+            QwtPlotItem *pItem = qlpItems[i32ItemNo];
+
+            if(pItem->isVisible())
+            {
+                //Lets series items restrict themselves to the visible interval
+                pItem->updateScaleDiv(oSnapshot.m_aoAxes[pItem->xAxis()].m_oScaleDiv, oSnapshot.m_aoAxes[pItem->yAxis()].m_oScaleDiv);
+
+                pPainter->setRenderHint(QPainter::Antialiasing, pItem->testRenderHint(QwtPlotItem::RenderAntialiased));
+
+                QwtPlotCurve *pDecimatedCurve = NULL;
+
+                if(pItem->rtti() == QwtPlotItem::Rtti_PlotCurve)
+                    pDecimatedCurve = decimateCurve(static_cast<const QwtPlotCurve*>(pItem), oSnapshot.m_aoAxes[pItem->xAxis()].m_oScaleDiv, u32NCanvasColumns);
+
+                if(pDecimatedCurve)
+                {
+                    pDecimatedCurve->draw(pPainter, aoMaps[pItem->xAxis()], aoMaps[pItem->yAxis()], oCanvasRect);
+                    delete pDecimatedCurve;
+                }
+                else if(pItem->rtti() == QwtPlotItem::Rtti_PlotSpectrogram)
+                {
+                    drawRasterItem(pItem, pPainter, aoMaps[pItem->xAxis()], aoMaps[pItem->yAxis()], oCanvasRect, dScaleX, dScaleY);
+                }
+                else
+                {
+                    pItem->draw(pPainter, aoMaps[pItem->xAxis()], aoMaps[pItem->yAxis()], oCanvasRect);
+                }
+            }
+
+            if(pProgress)
+                pProgress->plotItemRendered(i32ItemNo + 1, qlpItems.size());
+        }
+
+        pPainter->restore();
+
+        //Canvas frame
+        pPainter->setPen(QPen(QColor(Qt::black), 0.0));
+        pPainter->setBrush(Qt::NoBrush);
+        pPainter->drawRect(oCanvasRect);
+    }
+
+    for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+    {
+        delete apScaleDraws[i32Axis];
+    }
+
+    pPainter->restore();
+}
+
+double cPlotRenderer::getLegendWidth(const cPlotRenderSnapshot &oSnapshot)
+{
+    double dTitleWidth = 0.0;
+
+    for(int32_t i32EntryNo = 0; i32EntryNo < oSnapshot.m_qoLegendEntries.size(); i32EntryNo++)
+    {
+        QwtText oTitle(oSnapshot.m_qoLegendEntries[i32EntryNo].m_oTitle);
+        oTitle.setFont(getLayoutFont(oTitle.font()));
+
+        dTitleWidth = qMax(dTitleWidth, oTitle.textSize().width());
+    }
+
+    if(oSnapshot.m_qoLegendEntries.empty())
+        return 0.0;
+
+    return LEGEND_ICON_WIDTH_PX + SPACING_PX + dTitleWidth;
+}
+
+void cPlotRenderer::drawLegend(const cPlotRenderSnapshot &oSnapshot, QPainter *pPainter, const QRectF &oLegendRect)
+{
+    //Each row is as high as the larger of its title and symbol
+    QVector<QwtText> qvoTitles(oSnapshot.m_qoLegendEntries.size());
+    QVector<double> qvdRowHeights(oSnapshot.m_qoLegendEntries.size());
+    double dTotalHeight = 0.0;
+
+    for(int32_t i32EntryNo = 0; i32EntryNo < oSnapshot.m_qoLegendEntries.size(); i32EntryNo++)
+    {
+        const cPlotRenderSnapshot::cLegendEntry &oEntry = oSnapshot.m_qoLegendEntries[i32EntryNo];
+
+        qvoTitles[i32EntryNo] = oEntry.m_oTitle;
+        qvoTitles[i32EntryNo].setFont(getLayoutFont(oEntry.m_oTitle.font()));
+
+        qvdRowHeights[i32EntryNo] = qMax(qvoTitles[i32EntryNo].textSize().height(), (double)oEntry.m_oSymbolSize.height());
+        dTotalHeight += qvdRowHeights[i32EntryNo] + SPACING_PX;
+    }
+
+    //Centred vertically as QwtLegend is in the plot layout
+    double dTop = oLegendRect.top() + qMax(0.0, (oLegendRect.height() - dTotalHeight) / 2.0);
+    double dTitleLeft = oLegendRect.left() + LEGEND_ICON_WIDTH_PX + SPACING_PX;
+
+    pPainter->save();
+    pPainter->setRenderHint(QPainter::Antialiasing, true);
+
+    for(int32_t i32EntryNo = 0; i32EntryNo < oSnapshot.m_qoLegendEntries.size(); i32EntryNo++)
+    {
+        const cPlotRenderSnapshot::cLegendEntry &oEntry = oSnapshot.m_qoLegendEntries[i32EntryNo];
+        QPointF oIconCentre(oLegendRect.left() + LEGEND_ICON_WIDTH_PX / 2.0, dTop + qvdRowHeights[i32EntryNo] / 2.0);
+
+        if(oEntry.m_oPen.style() != Qt::NoPen)
+        {
+            pPainter->setPen(oEntry.m_oPen);
+            pPainter->drawLine(QPointF(oLegendRect.left(), oIconCentre.y()), QPointF(oLegendRect.left() + LEGEND_ICON_WIDTH_PX, oIconCentre.y()));
+        }
+
+        if(oEntry.m_eSymbolStyle != QwtSymbol::NoSymbol)
+        {
+            QwtSymbol oSymbol(oEntry.m_eSymbolStyle, oEntry.m_oSymbolBrush, oEntry.m_oSymbolPen, oEntry.m_oSymbolSize);
+            oSymbol.drawSymbols(pPainter, &oIconCentre, 1);
+        }
+
+        qvoTitles[i32EntryNo].draw(pPainter, QRectF(dTitleLeft, dTop, oLegendRect.right() - dTitleLeft, qvdRowHeights[i32EntryNo]));
+
+        dTop += qvdRowHeights[i32EntryNo] + SPACING_PX;
+    }
+
+    pPainter->restore();
+}
+
+QImage cPlotRenderer::renderImage(const cPlotRenderSnapshot &oSnapshot, const QSize &oImageSize, uint32_t u32Resolution_dpi, cPlotRenderProgress *pProgress)
+{
+    QImage oImage(oImageSize, QImage::Format_ARGB32_Premultiplied);
+
+    if(oImage.isNull() || !u32Resolution_dpi)
+        return QImage();
+
+    //The painter scales the layout by the image's resolution
+    oImage.setDotsPerMeterX(qRound(u32Resolution_dpi / 0.0254));
+    oImage.setDotsPerMeterY(qRound(u32Resolution_dpi / 0.0254));
+    oImage.fill(Qt::white);
+
+    QPainter oPainter(&oImage);
+    render(oSnapshot, &oPainter, QRectF(0.0, 0.0, oImageSize.width(), oImageSize.height()), pProgress);
+    oPainter.end();
+
+    return oImage;
+}
+
+QFont cPlotRenderer::getLayoutFont(const QFont &oFont)
+{
+    //Point sizes would otherwise be resolved against the device's resolution on top of the layout scaling
+    QFont oLayoutFont(oFont);
+
+    if(oFont.pointSizeF() > 0.0)
+        oLayoutFont.setPixelSize(qMax(1, qRound(oFont.pointSizeF() * LAYOUT_DPI / 72.0)));
+
+    return oLayoutFont;
+}
+
+QwtPlotCurve* cPlotRenderer::decimateCurve(const QwtPlotCurve *pCurve, const QwtScaleDiv &oXScaleDiv, uint32_t u32NColumns)
+{
+    //Other styles and symbols show individual samples so must be drawn in full
+    if(pCurve->style() != QwtPlotCurve::Lines || pCurve->symbol())
+        return NULL;
+
+    const cFloatQwtSeriesData *pData = dynamic_cast<const cFloatQwtSeriesData*>(pCurve->data());
+
+    //At most 4 samples per column are kept so there is nothing to gain below that
+    if(!pData || !u32NColumns || pData->size() <= 4 * (size_t)u32NColumns)
+        return NULL;
+
+    QVector<QPointF> qvoSamples;
+
+    if(!pData->getDecimatedSamples(qMin(oXScaleDiv.lowerBound(), oXScaleDiv.upperBound()), qMax(oXScaleDiv.lowerBound(), oXScaleDiv.upperBound()),
+                                   u32NColumns, qvoSamples))
+        return NULL;
+
+    QwtPlotCurve *pDecimatedCurve = static_cast<QwtPlotCurve*>(cPlotRenderSnapshot::copyItem(pCurve));
+    pDecimatedCurve->setSamples(qvoSamples);
+
+    return pDecimatedCurve;
+}
+
+void cPlotRenderer::drawRasterItem(const QwtPlotItem *pItem, QPainter *pPainter, const QwtScaleMap &oXMap, const QwtScaleMap &oYMap,
+                                   const QRectF &oCanvasRect, double dScaleX, double dScaleY)
+{
+    //Left to itself a raster item renders at the resolution of its data on vector devices, which for a long waterfall can be far more
+    //than the page can show. One pixel per device pixel of the canvas is all that can be printed.
+    QSize oImageSize((int)ceil(oCanvasRect.width() * dScaleX), (int)ceil(oCanvasRect.height() * dScaleY));
+    QImage oImage(oImageSize, QImage::Format_ARGB32_Premultiplied);
+
+    if(oImage.isNull())
+    {
+        cout << "cPlotRenderer::drawRasterItem(): Warning: Unable to allocate a " << oImageSize.width() << " x " << oImageSize.height()
+             << " image. Drawing the item directly." << endl;
+        pItem->draw(pPainter, oXMap, oYMap, oCanvasRect);
+        return;
+    }
+
+    oImage.fill(Qt::transparent);
+
+    //The same scales mapped onto the image
+    QwtScaleMap oImageXMap;
+    oImageXMap.setScaleInterval(oXMap.s1(), oXMap.s2());
+    oImageXMap.setPaintInterval(0.0, oImageSize.width());
+
+    QwtScaleMap oImageYMap;
+    oImageYMap.setScaleInterval(oYMap.s1(), oYMap.s2());
+    oImageYMap.setPaintInterval(oImageSize.height(), 0.0);
+
+    QPainter oImagePainter(&oImage);
+    pItem->draw(&oImagePainter, oImageXMap, oImageYMap, QRectF(0.0, 0.0, oImageSize.width(), oImageSize.height()));
+    oImagePainter.end();
+
+    pPainter->drawImage(oCanvasRect, oImage);
+}
+
+void cPlotRenderWorker::cRenderThread::run()
+{
+    m_pWorker->renderLoop();
+}
+
+cPlotRenderWorker::cPlotRenderWorker(QObject *pParent) :
+    QObject(pParent),
+    m_pRenderThread(NULL),
+    m_bShutdown(false),
+    m_bRendering(false)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+
+    m_pRenderThread = new cRenderThread(this);
+    m_pRenderThread->start(QThread::LowPriority);
+}
+
+cPlotRenderWorker::~cPlotRenderWorker()
+{
+    //Queued jobs are completed before the thread exits
+    {
+        QMutexLocker oLock(&m_oMutex);
+
+        m_bShutdown = true;
+        m_oCondition.wakeAll();
+    }
+
+    m_pRenderThread->wait();
+    delete m_pRenderThread;
+}
+
+bool cPlotRenderWorker::submitImage(cPlotRenderSnapshot *pSnapshot, const QSize &oImageSize, cPlotImageHandler *pHandler,
+                                    const QString &qstrFilename, bool bSkipIfBusy)
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    if(bSkipIfBusy && !m_qoJobs.isEmpty())
+    {
+        delete pSnapshot;
+        m_oStats.m_u64NImagesSkipped++;
+
+        return false;
+    }
+
+    cRenderJob oJob;
+    oJob.m_u32Type = JOB_IMAGE;
+    oJob.m_pSnapshot = pSnapshot;
+    oJob.m_qstrFilename = qstrFilename;
+    oJob.m_oImageSize = oImageSize;
+    oJob.m_pHandler = pHandler;
+    oJob.m_u32Resolution_dpi = 96;
+
+    m_qoJobs.enqueue(oJob);
+    m_oCondition.wakeAll();
+
+    return true;
+}
+
+void cPlotRenderWorker::submitDocument(cPlotRenderSnapshot *pSnapshot, const QString &qstrFilename, const QSizeF &oSize_mm, uint32_t u32Resolution_dpi)
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    cRenderJob oJob;
+    oJob.m_u32Type = JOB_DOCUMENT;
+    oJob.m_pSnapshot = pSnapshot;
+    oJob.m_qstrFilename = qstrFilename;
+    oJob.m_pHandler = NULL;
+    oJob.m_oDocumentSize_mm = oSize_mm;
+    oJob.m_u32Resolution_dpi = u32Resolution_dpi;
+
+    m_qoJobs.enqueue(oJob);
+    m_oCondition.wakeAll();
+}
+
+uint32_t cPlotRenderWorker::getNPendingJobs()
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    return m_qoJobs.size() + (m_bRendering ? 1 : 0);
+}
+
+cPlotRenderWorker::cStats cPlotRenderWorker::getStats()
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    return m_oStats;
+}
+
+void cPlotRenderWorker::renderLoop()
+{
+    QMutexLocker oLock(&m_oMutex);
+
+    while(true)
+    {
+        if(m_qoJobs.isEmpty())
+        {
+            if(m_bShutdown)
+                break;
+
+            m_oCondition.wait(&m_oMutex);
+            continue;
+        }
+
+        cRenderJob oJob = m_qoJobs.dequeue();
+        m_bRendering = true;
+
+        oLock.unlock();
+
+        bool bSuccess;
+
+        if(oJob.m_u32Type == JOB_DOCUMENT)
+        {
+            m_qstrCurrentDocument = oJob.m_qstrFilename;
+            sigDocumentProgress(oJob.m_qstrFilename, 0);
+
+            bSuccess = renderDocument(oJob);
+
+            m_qstrCurrentDocument.clear();
+        }
+        else
+        {
+            QImage oImage = cPlotRenderer::renderImage(*oJob.m_pSnapshot, oJob.m_oImageSize);
+
+            if(oJob.m_pHandler)
+                oJob.m_pHandler->plotImageRendered(oImage, oJob.m_pSnapshot->m_i64Timestamp_us);
+
+            bSuccess = !oImage.isNull();
+
+            if(bSuccess && !oJob.m_qstrFilename.isEmpty())
+                bSuccess = writeImage(oImage, oJob.m_qstrFilename);
+        }
+
+        delete oJob.m_pSnapshot;
+
+        oLock.relock();
+
+        m_bRendering = false;
+
+        if(oJob.m_u32Type == JOB_DOCUMENT)
+        {
+            if(bSuccess)
+                m_oStats.m_u64NDocumentsWritten++;
+            else
+                m_oStats.m_u64NFailures++;
+
+            sigDocumentWritten(oJob.m_qstrFilename, bSuccess);
+        }
+        else
+        {
+            m_oStats.m_u64NImagesRendered++;
+
+            if(!bSuccess)
+                m_oStats.m_u64NFailures++;
+
+            sigImageRendered(oJob.m_qstrFilename, bSuccess);
+        }
+    }
+}
+
+bool cPlotRenderWorker::renderDocument(const cRenderJob &oJob)
+{
+    //Page size in device pixels at the requested resolution
+    QRectF oPageRect(0.0, 0.0, oJob.m_oDocumentSize_mm.width() / 25.4 * oJob.m_u32Resolution_dpi,
+                     oJob.m_oDocumentSize_mm.height() / 25.4 * oJob.m_u32Resolution_dpi);
+
+    QString qstrFormat = QFileInfo(oJob.m_qstrFilename).suffix().toLower();
+
+    if(qstrFormat == QString("pdf"))
+    {
+        QPdfWriter oPdfWriter(oJob.m_qstrFilename);
+        oPdfWriter.setResolution(oJob.m_u32Resolution_dpi);
+        oPdfWriter.setPageSize(QPageSize(oJob.m_oDocumentSize_mm, QPageSize::Millimeter));
+        oPdfWriter.setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+        oPdfWriter.setTitle(oJob.m_pSnapshot->m_oTitle.text());
+
+        QPainter oPainter;
+
+        if(!oPainter.begin(&oPdfWriter))
+        {
+            cout << "cPlotRenderWorker::renderDocument(): Warning: Unable to open " << oJob.m_qstrFilename.toStdString() << " for writing." << endl;
+            return false;
+        }
+
+        cPlotRenderer::render(*oJob.m_pSnapshot, &oPainter, oPageRect, this);
+
+        //The document is written out as the painter ends
+        return oPainter.end();
+    }
+
+#ifndef QWT_NO_SVG
+    if(qstrFormat == QString("svg"))
+    {
+        QSvgGenerator oSvgGenerator;
+        oSvgGenerator.setFileName(oJob.m_qstrFilename);
+        oSvgGenerator.setTitle(oJob.m_pSnapshot->m_oTitle.text());
+        oSvgGenerator.setResolution(oJob.m_u32Resolution_dpi);
+        oSvgGenerator.setSize(oPageRect.size().toSize());
+        oSvgGenerator.setViewBox(oPageRect);
+
+        QPainter oPainter;
+
+        if(!oPainter.begin(&oSvgGenerator))
+        {
+            cout << "cPlotRenderWorker::renderDocument(): Warning: Unable to open " << oJob.m_qstrFilename.toStdString() << " for writing." << endl;
+            return false;
+        }
+
+        cPlotRenderer::render(*oJob.m_pSnapshot, &oPainter, oPageRect, this);
+
+        return oPainter.end();
+    }
+#endif
+
+    //Anything else is an image format
+    QImage oImage = cPlotRenderer::renderImage(*oJob.m_pSnapshot, oPageRect.size().toSize(), oJob.m_u32Resolution_dpi, this);
+
+    if(oImage.isNull())
+    {
+        cout << "cPlotRenderWorker::renderDocument(): Warning: Unable to allocate a " << oPageRect.width() << " x " << oPageRect.height()
+             << " image for " << oJob.m_qstrFilename.toStdString() << endl;
+        return false;
+    }
+
+    return writeImage(oImage, oJob.m_qstrFilename);
+}
+
+void cPlotRenderWorker::plotItemRendered(uint32_t u32NItemsRendered, uint32_t u32NItems)
+{
+    if(m_qstrCurrentDocument.isEmpty())
+        return;
+
+    //The remainder is left for writing the document out
+    sigDocumentProgress(m_qstrCurrentDocument, 90 * u32NItemsRendered / u32NItems);
+}
+
+bool cPlotRenderWorker::writeImage(const QImage &oImage, const QString &qstrFilename)
+{
+    //Written to a temporary file which replaces the previous image on commit so readers never see a partial file
+    QSaveFile oFile(qstrFilename);
+
+    if(!oFile.open(QIODevice::WriteOnly))
+    {
+        cout << "cPlotRenderWorker::writeImage(): Warning: Unable to open " << qstrFilename.toStdString() << " for writing." << endl;
+        return false;
+    }
+
+    //The format follows the suffix as for QImage::save()
+    if(!oImage.save(&oFile, QFileInfo(qstrFilename).suffix().toLatin1().constData()) || !oFile.commit())
+    {
+        cout << "cPlotRenderWorker::writeImage(): Warning: Unable to write image to " << qstrFilename.toStdString() << endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,261 @@
+//Rendering of plots away from the GUI thread, for headless nodes and background export.
+//
+//QwtPlotRenderer draws from the QwtPlot widget itself, which may only be touched by the GUI thread. Instead the widget takes a
+//cPlotRenderSnapshot on the GUI thread (see cQwtPlotWidgetBase::takeRenderSnapshot()): the title, axis scale divisions and titles
+//and detached copies of its plot items, which share the plot buffers implicitly rather than copying them. cPlotRenderer lays out and
+//paints a snapshot onto any paint device much as QwtPlotRenderer would, and cPlotRenderWorker does so on its own thread so that
+//rendering and encoding never hold up the GUI or ingest threads. Nothing here needs a display, so this works with the widget hidden
+//and under the offscreen platform plugin (QT_QPA_PLATFORM=offscreen).
+//
+//The output is bounded by the resolution of the target rather than the size of the data: curves are min/max decimated to the
+//device pixel columns of the canvas and raster items (the waterfall) are drawn as one image at device resolution, so a PDF or SVG of
+//a huge plot looks the same at print resolution as a full render but its size and export time depend only on the page.
+
+#ifndef PLOT_RENDERER_H
+#define PLOT_RENDERER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QImage>
+#include <QSize>
+#include <QSizeF>
+#include <QRectF>
+#include <QBrush>
+#include <QFont>
+#include <QPainter>
+#include <QPen>
+#include <qwt_plot.h>
+#include <qwt_plot_item.h>
+#include <qwt_plot_curve.h>
+#include <qwt_text.h>
+#include <qwt_symbol.h>
+#include <qwt_scale_div.h>
+#include <qwt_scale_map.h>
+#include <qwt_interval.h>
+#include <qwt_color_map.h>
+
+//Local includes
+
+class cPlotRenderSnapshot
+{
+public:
+    struct cAxis
+    {
+        bool                            m_bEnabled;
+        bool                            m_bIsWallTime;      //Labels drawn by cWallTimeQwtScaleDraw
+        QwtText                         m_oTitle;
+        QwtScaleDiv                     m_oScaleDiv;
+        QFont                           m_oFont;
+        double                          m_dMinimumExtent;
+    };
+
+    //Legend entry of a curve, drawn as a line of its pen with its symbol (if any) beside its title
+    struct cLegendEntry
+    {
+        QwtText                         m_oTitle;
+        QPen                            m_oPen;
+        QwtSymbol::Style                m_eSymbolStyle;
+        QBrush                          m_oSymbolBrush;
+        QPen                            m_oSymbolPen;
+        QSize                           m_oSymbolSize;
+    };
+
+    cPlotRenderSnapshot();
+    ~cPlotRenderSnapshot();
+
+    //Takes ownership. The item must not be attached to a plot.
+    void                                addItem(QwtPlotItem *pItem);
+    const QList<QwtPlotItem*>&          getItems() const;
+
+    //Draws a colour bar beside the right axis. Takes ownership of the colour map.
+    void                                setColourBar(const QwtInterval &oInterval, QwtColorMap *pColourMap);
+    const QwtColorMap*                  getColourBarMap() const;
+    QwtInterval                         getColourBarInterval() const;
+
+    //Returns a detached copy of a curve, marker or grid sharing the item's data, or NULL for other item types
+    static QwtPlotItem*                 copyItem(const QwtPlotItem *pItem);
+
+    QwtText                             m_oTitle;
+    cAxis                               m_aoAxes[QwtPlot::axisCnt];
+    QBrush                              m_oCanvasBackground;
+    QList<cLegendEntry>                 m_qoLegendEntries;  //Empty unless the plot shows a legend. Drawn right of the plot as QwtPlot::RightLegend.
+    int64_t                             m_i64Timestamp_us;
+
+private:
+    QList<QwtPlotItem*>                 m_qlpItems;
+
+    QwtColorMap                         *m_pColourBarMap;
+    QwtInterval                         m_oColourBarInterval;
+
+    //Owns its items
+    cPlotRenderSnapshot(const cPlotRenderSnapshot &oOther);
+    cPlotRenderSnapshot&                operator=(const cPlotRenderSnapshot &oOther);
+};
+
+//Receives progress from cPlotRenderer as the plot items are drawn
+class cPlotRenderProgress
+{
+public:
+    virtual ~cPlotRenderProgress(){}
+
+    //Called on the rendering thread after each item
+    virtual void                        plotItemRendered(uint32_t u32NItemsRendered, uint32_t u32NItems) = 0;
+};
+
+class cPlotRenderer
+{
+public:
+    //Paints the snapshot into the rectangle. Layout is in 96 dpi pixels scaled to the resolution of the painter's device,
+    //so a document at 300 dpi matches what an image of the same physical size shows. Safe to call from any thread.
+    static void                         render(const cPlotRenderSnapshot &oSnapshot, QPainter *pPainter, const QRectF &oRect,
+                                               cPlotRenderProgress *pProgress = NULL);
+
+    //At 96 dpi the layout is drawn one to one in image pixels. Higher resolutions scale it up as for a printed page.
+    static QImage                       renderImage(const cPlotRenderSnapshot &oSnapshot, const QSize &oImageSize, uint32_t u32Resolution_dpi = 96,
+                                                    cPlotRenderProgress *pProgress = NULL);
+
+private:
+    static const double                 LAYOUT_DPI;
+    static const double                 MARGIN_PX;
+    static const double                 SPACING_PX;
+    static const double                 COLOUR_BAR_WIDTH_PX;
+    static const double                 LEGEND_ICON_WIDTH_PX;
+
+    //Returns the width the legend needs or 0 if there is none
+    static double                       getLegendWidth(const cPlotRenderSnapshot &oSnapshot);
+    static void                         drawLegend(const cPlotRenderSnapshot &oSnapshot, QPainter *pPainter, const QRectF &oLegendRect);
+
+    static QFont                        getLayoutFont(const QFont &oFont);
+
+    //Returns a copy of a line curve reduced to the first, minimum, maximum and last sample per column or NULL if it cannot be
+    //decimated (symbols, other styles or data other than cFloatQwtSeriesData) or already has few enough samples
+    static QwtPlotCurve*                decimateCurve(const QwtPlotCurve *pCurve, const QwtScaleDiv &oXScaleDiv, uint32_t u32NColumns);
+
+    //Renders the item into an image of the canvas at device resolution and paints that in place of the item
+    static void                         drawRasterItem(const QwtPlotItem *pItem, QPainter *pPainter, const QwtScaleMap &oXMap, const QwtScaleMap &oYMap,
+                                                       const QRectF &oCanvasRect, double dScaleX, double dScaleY);
+};
+
+//Receives images rendered by cPlotRenderWorker
+class cPlotImageHandler
+{
+public:
+    virtual ~cPlotImageHandler(){}
+
+    //Called on the render thread for each finished image
+    virtual void                        plotImageRendered(const QImage &oImage, int64_t i64Timestamp_us) = 0;
+};
+
+class cPlotRenderWorker : public QObject, private cPlotRenderProgress
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NImagesRendered;
+        uint64_t                        m_u64NImagesSkipped;    //Submitted while the previous image was still waiting for the worker
+        uint64_t                        m_u64NDocumentsWritten;
+        uint64_t                        m_u64NFailures;         //Images or documents that could not be rendered or written
+    };
+
+    explicit cPlotRenderWorker(QObject *pParent = 0);
+    ~cPlotRenderWorker(); //Finishes any queued jobs
+
+    //Takes ownership of the snapshot. The rendered image is passed to the handler (if not NULL) and written to the file (if given)
+    //in the format of its suffix, replacing any previous file atomically. With bSkipIfBusy the job is dropped, and false returned,
+    //if another job is still waiting, so that periodic rendering sheds frames rather than queueing them.
+    bool                                submitImage(cPlotRenderSnapshot *pSnapshot, const QSize &oImageSize, cPlotImageHandler *pHandler,
+                                                    const QString &qstrFilename = QString(), bool bSkipIfBusy = false);
+
+    //Takes ownership of the snapshot. Renders a page of the given size and resolution to a PDF or SVG document or an image file,
+    //by the suffix of the filename. Documents are never skipped. Progress is reported with sigDocumentProgress() and completion
+    //with sigDocumentWritten().
+    void                                submitDocument(cPlotRenderSnapshot *pSnapshot, const QString &qstrFilename, const QSizeF &oSize_mm,
+                                                       uint32_t u32Resolution_dpi);
+
+    //Jobs submitted and not yet completed
+    uint32_t                            getNPendingJobs();
+
+    cStats                              getStats();
+
+private:
+    class cRenderThread : public QThread
+    {
+    public:
+        explicit cRenderThread(cPlotRenderWorker *pWorker) : m_pWorker(pWorker) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cPlotRenderWorker               *m_pWorker;
+    };
+
+    static const uint32_t               JOB_IMAGE = 0;
+    static const uint32_t               JOB_DOCUMENT = 1;
+
+    struct cRenderJob
+    {
+        uint32_t                        m_u32Type;
+        cPlotRenderSnapshot             *m_pSnapshot;
+        QString                         m_qstrFilename;
+
+        //Image jobs
+        QSize                           m_oImageSize;
+        cPlotImageHandler               *m_pHandler;
+
+        //Document jobs
+        QSizeF                          m_oDocumentSize_mm;
+        uint32_t                        m_u32Resolution_dpi;
+    };
+
+    cRenderThread                       *m_pRenderThread;
+
+    //Protected by m_oMutex
+    QMutex                              m_oMutex;
+    QWaitCondition                      m_oCondition;
+    QQueue<cRenderJob>                  m_qoJobs;
+    bool                                m_bShutdown;
+    bool                                m_bRendering;
+    cStats                              m_oStats;
+
+    //Render thread only
+    QString                             m_qstrCurrentDocument;  //Empty unless rendering a document
+
+    void                                renderLoop();
+
+    bool                                renderDocument(const cRenderJob &oJob);
+    virtual void                        plotItemRendered(uint32_t u32NItemsRendered, uint32_t u32NItems);
+
+    static bool                         writeImage(const QImage &oImage, const QString &qstrFilename);
+
+signals:
+    void                                sigImageRendered(const QString &qstrFilename, bool bSuccess);
+    void                                sigDocumentProgress(const QString &qstrFilename, unsigned int u32Percent);
+    void                                sigDocumentWritten(const QString &qstrFilename, bool bSuccess);
+};
+
+#endif // PLOT_RENDERER_H
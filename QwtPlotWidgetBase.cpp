@@ -1,24 +1,31 @@
 //System includes
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 //Library includes
 #include <QPen>
-#include <QPrinter>
-#if QWT_VERSION < 0x060100 //For implementation of plot exporting in old versions of Qwt
 #include <QFileDialog>
 #include <QImageWriter>
-#endif
 #include <QDebug>
+#include <QDateTime>
+#include <QRegExp>
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QEvent>
+#include <QPixmap>
+#include <qwt_plot_canvas.h>
 #include <qwt_scale_engine.h>
-#include <qwt_plot_renderer.h>
 #include <qwt_text_label.h>
 #include <qwt_scale_widget.h>
+#include <qwt_plot_curve.h>
+#include <qwt_symbol.h>
 
 //Local includes
 #include "ui_QwtPlotWidgetBase.h"
 #include "AVNUtilLibs/Timestamp/Timestamp.h"
 #include "QwtPlotWidgetBase.h"
+#include "WallTimeQwtScaleDraw.h"
 
 using namespace std;
 
@@ -31,6 +38,18 @@ cQwtPlotWidgetBase::cQwtPlotWidgetBase(QWidget *pParent) :
     m_bDoLogConversion(false),
     m_bDoPowerLogConversion(false),
     m_bRejectData(true),
+    m_pBlackBox(NULL),
+    m_pBlackBoxDumpButton(NULL),
+    m_pRecorder(NULL),
+    m_oiCheckpointDue(0),
+    m_pHistorySnapshotWriter(NULL),
+    m_oiDataExportDue(0),
+    m_pDataExportWriter(NULL),
+    m_pRenderImageHandler(NULL),
+    m_pRenderWorker(NULL),
+    m_pExportWorker(NULL),
+    m_pFrameCaptureWriter(NULL),
+    m_bFrameCapturePending(false),
     m_bMousePositionValid(false),
     m_bVSharedMousePositionValid(false),
     m_bHSharedMousePositionValid(false)
@@ -107,6 +126,13 @@ cQwtPlotWidgetBase::cQwtPlotWidgetBase(QWidget *pParent) :
     QObject::connect(m_pUI->qwtPlot->axisWidget(QwtPlot::xBottom), SIGNAL(scaleDivChanged()), this, SLOT(slotScaleDivChanged()) );
 
     QObject::connect(m_pUI->dockWidget, SIGNAL(topLevelChanged(bool)), this, SLOT(slotPlotUndocked(bool) ) );
+
+    QObject::connect(&m_oCheckpointTimer, SIGNAL(timeout()), this, SLOT(slotCheckpointDue()));
+    QObject::connect(&m_oRenderTimer, SIGNAL(timeout()), this, SLOT(slotPeriodicRender()));
+
+    m_oDataExportTimer.setSingleShot(true);
+    m_oDataExportTimer.setInterval(DATA_EXPORT_TIMEOUT_MS);
+    QObject::connect(&m_oDataExportTimer, SIGNAL(timeout()), this, SLOT(slotDataExportTimeout()));
 }
 
 cQwtPlotWidgetBase::~cQwtPlotWidgetBase()
@@ -119,9 +145,449 @@ cQwtPlotWidgetBase::~cQwtPlotWidgetBase()
     if(!m_bVSharedMousePositionValid)
         delete m_pVSharedMousePosition;
 
+    //Finishes any snapshot still being written
+    delete m_pHistorySnapshotWriter;
+
+    //Writes out any exports already taken. Requests the ingest thread has not got to are abandoned.
+    delete m_pDataExportWriter;
+
+    //Finishes any queued render. The copied plot items it holds do not refer to this widget.
+    delete m_pRenderWorker;
+    delete m_pExportWorker;
+
+    //Writes out any queued frames
+    delete m_pFrameCaptureWriter;
+
     delete m_pUI;
 }
 
+void cQwtPlotWidgetBase::setBlackBox(cBlackBoxRecorder *pBlackBox)
+{
+    {
+        QMutexLocker oLock(&m_oBlackBoxMutex);
+
+        m_pBlackBox = pBlackBox;
+    }
+
+    //The dump button is created on first use so that it does not shift the control indices used by derived classes' constructors
+    if(!m_pBlackBoxDumpButton)
+    {
+        m_pBlackBoxDumpButton = new QPushButton(QString("Dump black box"), this);
+
+        QHBoxLayout* pLayout = qobject_cast<QHBoxLayout*>(m_pUI->frame_controls->layout());
+        insertWidgetIntoControlFrame(m_pBlackBoxDumpButton, pLayout->indexOf(m_pUI->pushButton_grabFrame) + 1);
+
+        QObject::connect(m_pBlackBoxDumpButton, SIGNAL(clicked()), this, SLOT(slotDumpBlackBox()));
+    }
+
+    m_pBlackBoxDumpButton->setVisible(pBlackBox != NULL);
+}
+
+void cQwtPlotWidgetBase::setRecorder(cStreamRecorder *pRecorder)
+{
+    QMutexLocker oLock(&m_oRecorderMutex);
+
+    m_pRecorder = pRecorder;
+}
+
+void cQwtPlotWidgetBase::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                     const QVector<uint32_t> &qvu32ChannelList)
+{
+    recordToBlackBox(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    QMutexLocker oLock(&m_oRecorderMutex);
+
+    if(m_pRecorder)
+        m_pRecorder->recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cQwtPlotWidgetBase::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                     const QVector<uint32_t> &qvu32ChannelList)
+{
+    recordToBlackBox(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+
+    QMutexLocker oLock(&m_oRecorderMutex);
+
+    if(m_pRecorder)
+        m_pRecorder->recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cQwtPlotWidgetBase::recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    {
+        QMutexLocker oLock(&m_oBlackBoxMutex);
+
+        if(m_pBlackBox)
+            m_pBlackBox->recordBatch(oBatch, qvu32ChannelList);
+    }
+
+    QMutexLocker oLock(&m_oRecorderMutex);
+
+    if(m_pRecorder)
+        m_pRecorder->recordBatch(oBatch, qvu32ChannelList);
+}
+
+void cQwtPlotWidgetBase::recordToBlackBox(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                          const QVector<uint32_t> &qvu32ChannelList)
+{
+    QMutexLocker oLock(&m_oBlackBoxMutex);
+
+    if(m_pBlackBox)
+        m_pBlackBox->recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cQwtPlotWidgetBase::recordToBlackBox(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                          const QVector<uint32_t> &qvu32ChannelList)
+{
+    QMutexLocker oLock(&m_oBlackBoxMutex);
+
+    if(m_pBlackBox)
+        m_pBlackBox->recordFrame(pfXData, u32NXSamples, oYData, i64Timestamp_us, qvu32ChannelList);
+}
+
+void cQwtPlotWidgetBase::slotDumpBlackBox()
+{
+    QMutexLocker oLock(&m_oBlackBoxMutex);
+
+    if(!m_pBlackBox)
+        return;
+
+    //Named after the plot and the time of the request. Written in the background without pausing the plot.
+    QString qstrTitle = m_qstrTitle;
+    qstrTitle.replace(QRegExp("[^A-Za-z0-9_-]"), QString("_"));
+
+    m_pBlackBox->dump(QString("%1_blackbox_%2.qprs").arg(qstrTitle).arg(QDateTime::currentDateTimeUtc().toString("yyyyMMdd_hhmmss")));
+}
+
+void cQwtPlotWidgetBase::enableHistoryCheckpoints(const QString &qstrFilename, uint32_t u32Interval_s)
+{
+    m_oCheckpointTimer.stop();
+
+    {
+        QMutexLocker oLock(&m_oCheckpointMutex);
+
+        m_qstrCheckpointFilename = qstrFilename;
+    }
+
+    if(qstrFilename.isEmpty() || !u32Interval_s)
+        return;
+
+    //Created before the first checkpoint falls due so the ingest thread never sees it change
+    if(!m_pHistorySnapshotWriter)
+        m_pHistorySnapshotWriter = new cHistorySnapshotWriter;
+
+    m_oCheckpointTimer.start(u32Interval_s * 1000);
+}
+
+bool cQwtPlotWidgetBase::restoreHistory(const QString &qstrFilename)
+{
+    cHistorySnapshotReader oReader;
+
+    if(!oReader.open(qstrFilename, metaObject()->className()))
+        return false;
+
+    if(!restoreHistorySnapshot(oReader))
+    {
+        cout << "cQwtPlotWidgetBase::restoreHistory(): Warning: Unable to restore plot \"" << m_qstrTitle.toStdString() << "\" from "
+             << qstrFilename.toStdString() << ". Starting with an empty history." << endl;
+        return false;
+    }
+
+    cout << "cQwtPlotWidgetBase::restoreHistory(): Restored plot \"" << m_qstrTitle.toStdString() << "\" from " << qstrFilename.toStdString() << endl;
+
+    return true;
+}
+
+void cQwtPlotWidgetBase::slotCheckpointDue()
+{
+    m_oiCheckpointDue.storeRelease(1);
+}
+
+void cQwtPlotWidgetBase::checkpointHistoryIfDue()
+{
+    //Data exports are taken at the same consistent point of the frame
+    exportDataIfDue();
+
+    //Checkpoints are minutes apart, so this is almost always a single atomic load
+    if(!m_oiCheckpointDue.loadAcquire() || !m_oiCheckpointDue.fetchAndStoreOrdered(0))
+        return;
+
+    QString qstrFilename;
+
+    {
+        QMutexLocker oLock(&m_oCheckpointMutex);
+
+        qstrFilename = m_qstrCheckpointFilename;
+    }
+
+    if(qstrFilename.isEmpty() || !m_pHistorySnapshotWriter)
+        return;
+
+    cHistorySnapshot *pSnapshot = new cHistorySnapshot(metaObject()->className());
+
+    if(!snapshotHistory(*pSnapshot))
+    {
+        delete pSnapshot;
+        return;
+    }
+
+    m_pHistorySnapshotWriter->submit(pSnapshot, qstrFilename);
+}
+
+void cQwtPlotWidgetBase::exportData(const QString &qstrFilename)
+{
+    //As with the snapshot writer, the pointer is set before ingest can first read it
+    if(!m_pDataExportWriter)
+    {
+        m_pDataExportWriter = new cPlotDataExportWriter;
+
+        QObject::connect(m_pDataExportWriter, SIGNAL(sigExportWritten(QString,bool)), this, SLOT(slotDataExportFinished(QString,bool)), Qt::QueuedConnection);
+    }
+
+    {
+        QMutexLocker oLock(&m_oDataExportMutex);
+
+        m_qstrlPendingDataExports.push_back(qstrFilename);
+    }
+
+    m_oiDataExportDue.storeRelease(1);
+
+    //In case no frame arrives to take it
+    m_oDataExportTimer.start();
+
+    cout << "cQwtPlotWidgetBase::exportData(): Exporting data of plot \"" << m_qstrTitle.toStdString() << "\" to " << qstrFilename.toStdString()
+         << " with the next frame." << endl;
+}
+
+void cQwtPlotWidgetBase::exportDataIfDue()
+{
+    if(!m_oiDataExportDue.loadAcquire() || !m_oiDataExportDue.fetchAndStoreOrdered(0))
+        return;
+
+    QStringList qstrlFilenames;
+
+    {
+        QMutexLocker oLock(&m_oDataExportMutex);
+
+        qstrlFilenames.swap(m_qstrlPendingDataExports);
+    }
+
+    submitDataExports(qstrlFilenames);
+}
+
+void cQwtPlotWidgetBase::submitDataExports(const QStringList &qstrlFilenames)
+{
+    for(int32_t i32ExportNo = 0; i32ExportNo < qstrlFilenames.size(); i32ExportNo++)
+    {
+        cPlotDataExport *pExport = new cPlotDataExport(m_qstrTitle, metaObject()->className());
+
+        if(!snapshotData(*pExport))
+        {
+            cout << "cQwtPlotWidgetBase::submitDataExports(): Warning: Plot \"" << m_qstrTitle.toStdString() << "\" has no data to export." << endl;
+
+            delete pExport;
+            sigDataExportFinished(qstrlFilenames[i32ExportNo], false);
+            continue;
+        }
+
+        m_pDataExportWriter->submit(pExport, qstrlFilenames[i32ExportNo]);
+    }
+}
+
+void cQwtPlotWidgetBase::slotDataExportTimeout()
+{
+    //No frame has arrived since the last request. Take back any exports still pending. If the ingest thread has just taken them
+    //the list is empty.
+    m_oiDataExportDue.storeRelease(0);
+
+    QStringList qstrlFilenames;
+
+    {
+        QMutexLocker oLock(&m_oDataExportMutex);
+
+        qstrlFilenames.swap(m_qstrlPendingDataExports);
+    }
+
+    if(qstrlFilenames.empty())
+        return;
+
+    //The stream may resume at any moment so the ingest buffers cannot be read here. Export what is on screen instead.
+    for(int32_t i32ExportNo = 0; i32ExportNo < qstrlFilenames.size(); i32ExportNo++)
+    {
+        cPlotDataExport *pExport = new cPlotDataExport(m_qstrTitle, metaObject()->className());
+
+        if(!snapshotDisplayedData(*pExport))
+        {
+            cout << "cQwtPlotWidgetBase::slotDataExportTimeout(): Warning: No data arrived for plot \"" << m_qstrTitle.toStdString() << "\" within "
+                 << DATA_EXPORT_TIMEOUT_MS << " ms and none is displayed. Not exporting to " << qstrlFilenames[i32ExportNo].toStdString() << endl;
+
+            delete pExport;
+            sigDataExportFinished(qstrlFilenames[i32ExportNo], false);
+            continue;
+        }
+
+        cout << "cQwtPlotWidgetBase::slotDataExportTimeout(): No data arrived for plot \"" << m_qstrTitle.toStdString() << "\" within "
+             << DATA_EXPORT_TIMEOUT_MS << " ms. Exporting the displayed data to " << qstrlFilenames[i32ExportNo].toStdString() << endl;
+
+        m_pDataExportWriter->submit(pExport, qstrlFilenames[i32ExportNo]);
+    }
+}
+
+bool cQwtPlotWidgetBase::snapshotData(cPlotDataExport &oExport)
+{
+    Q_UNUSED(oExport);
+
+    return false;
+}
+
+bool cQwtPlotWidgetBase::snapshotDisplayedData(cPlotDataExport &oExport)
+{
+    Q_UNUSED(oExport);
+
+    return false;
+}
+
+void cQwtPlotWidgetBase::slotDataExportFinished(const QString &qstrFilename, bool bSuccess)
+{
+    if(bSuccess)
+        cout << "cQwtPlotWidgetBase::slotDataExportFinished(): Exported data of plot \"" << m_qstrTitle.toStdString() << "\" to " << qstrFilename.toStdString() << endl;
+    else
+        cout << "cQwtPlotWidgetBase::slotDataExportFinished(): Warning: Unable to export data of plot \"" << m_qstrTitle.toStdString() << "\" to "
+             << qstrFilename.toStdString() << endl;
+
+    sigDataExportFinished(qstrFilename, bSuccess);
+}
+
+bool cQwtPlotWidgetBase::snapshotHistory(cHistorySnapshot &oSnapshot)
+{
+    Q_UNUSED(oSnapshot);
+
+    return false;
+}
+
+bool cQwtPlotWidgetBase::restoreHistorySnapshot(const cHistorySnapshotReader &oReader)
+{
+    Q_UNUSED(oReader);
+
+    return false;
+}
+
+void cQwtPlotWidgetBase::enablePeriodicRender(const QSize &oImageSize, uint32_t u32Interval_ms, cPlotImageHandler *pHandler, const QString &qstrFilename)
+{
+    disablePeriodicRender();
+
+    if(oImageSize.isEmpty() || !u32Interval_ms || (!pHandler && qstrFilename.isEmpty()))
+        return;
+
+    m_oRenderImageSize = oImageSize;
+    m_pRenderImageHandler = pHandler;
+    m_qstrRenderFilename = qstrFilename;
+
+    m_pRenderWorker = new cPlotRenderWorker;
+
+    m_oRenderTimer.start(u32Interval_ms);
+}
+
+void cQwtPlotWidgetBase::disablePeriodicRender()
+{
+    m_oRenderTimer.stop();
+
+    //Waits for the queued render so that the handler is no longer called once this returns
+    delete m_pRenderWorker;
+    m_pRenderWorker = NULL;
+
+    m_pRenderImageHandler = NULL;
+}
+
+void cQwtPlotWidgetBase::slotPeriodicRender()
+{
+    if(!m_pRenderWorker)
+        return;
+
+    QString qstrFilename = m_qstrRenderFilename;
+
+    if(qstrFilename.contains(QString("%1")))
+        qstrFilename = qstrFilename.arg(QDateTime::currentDateTimeUtc().toString("yyyyMMdd_hhmmss_zzz"));
+
+    m_pRenderWorker->submitImage(takeRenderSnapshot(), m_oRenderImageSize, m_pRenderImageHandler, qstrFilename, true);
+}
+
+cPlotRenderSnapshot* cQwtPlotWidgetBase::takeRenderSnapshot()
+{
+    QwtPlot *pPlot = m_pUI->qwtPlot;
+
+    //Scale divisions are otherwise only brought up to date by a replot, which a hidden plot may not have done
+    pPlot->updateAxes();
+
+    cPlotRenderSnapshot *pSnapshot = new cPlotRenderSnapshot;
+
+    pSnapshot->m_oTitle = pPlot->title();
+    pSnapshot->m_oCanvasBackground = pPlot->canvasBackground();
+    pSnapshot->m_i64Timestamp_us = AVN::getTimeNow_us();
+
+    for(int32_t i32Axis = 0; i32Axis < QwtPlot::axisCnt; i32Axis++)
+    {
+        cPlotRenderSnapshot::cAxis &oAxis = pSnapshot->m_aoAxes[i32Axis];
+
+        //Axes only kept for alignment with other plots are drawn in transparent text
+        oAxis.m_bEnabled = pPlot->axisEnabled(i32Axis) && pPlot->axisWidget(i32Axis)->palette().color(QPalette::Text).alpha();
+        oAxis.m_bIsWallTime = dynamic_cast<const cWallTimeQwtScaleDraw*>(pPlot->axisScaleDraw(i32Axis)) != NULL;
+        oAxis.m_oTitle = pPlot->axisTitle(i32Axis);
+        oAxis.m_oFont = pPlot->axisFont(i32Axis);
+        oAxis.m_dMinimumExtent = pPlot->axisScaleDraw(i32Axis)->minimumExtent();
+
+#if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
+        oAxis.m_oScaleDiv = *pPlot->axisScaleDiv(i32Axis);
+#else
+        oAxis.m_oScaleDiv = pPlot->axisScaleDiv(i32Axis);
+#endif
+    }
+
+    //Curves, markers and the grid share their data with the plot. The shared mouse position markers are left out.
+    const QwtPlotItemList &qlpItems = pPlot->itemList();
+
+    for(int32_t i32ItemNo = 0; i32ItemNo < qlpItems.size(); i32ItemNo++)
+    {
+        if(!qlpItems[i32ItemNo]->isVisible() || qlpItems[i32ItemNo] == m_pVSharedMousePosition || qlpItems[i32ItemNo] == m_pHSharedMousePosition)
+            continue;
+
+        QwtPlotItem *pCopy = cPlotRenderSnapshot::copyItem(qlpItems[i32ItemNo]);
+
+        if(pCopy)
+            pSnapshot->addItem(pCopy);
+
+        //The renderer draws the legend itself from the entries of the curves shown
+        if(pPlot->legend() && qlpItems[i32ItemNo]->rtti() == QwtPlotItem::Rtti_PlotCurve && qlpItems[i32ItemNo]->testItemAttribute(QwtPlotItem::Legend))
+        {
+            const QwtPlotCurve *pCurve = static_cast<const QwtPlotCurve*>(qlpItems[i32ItemNo]);
+
+            cPlotRenderSnapshot::cLegendEntry oEntry;
+            oEntry.m_oTitle = pCurve->title();
+            oEntry.m_oPen = pCurve->pen();
+            oEntry.m_eSymbolStyle = QwtSymbol::NoSymbol;
+
+            if(pCurve->symbol())
+            {
+                oEntry.m_eSymbolStyle = pCurve->symbol()->style();
+                oEntry.m_oSymbolBrush = pCurve->symbol()->brush();
+                oEntry.m_oSymbolPen = pCurve->symbol()->pen();
+                oEntry.m_oSymbolSize = pCurve->symbol()->size();
+            }
+
+            pSnapshot->m_qoLegendEntries.push_back(oEntry);
+        }
+    }
+
+    addItemsToRenderSnapshot(*pSnapshot);
+
+    return pSnapshot;
+}
+
+void cQwtPlotWidgetBase::addItemsToRenderSnapshot(cPlotRenderSnapshot &oSnapshot)
+{
+    Q_UNUSED(oSnapshot);
+}
+
 void cQwtPlotWidgetBase::insertWidgetIntoControlFrame(QWidget* pNewWidget, uint32_t u32Index, bool bAddSpacerAfter)
 {
     QHBoxLayout* pLayout = qobject_cast<QHBoxLayout*>(m_pUI->frame_controls->layout());
@@ -255,34 +721,19 @@ void cQwtPlotWidgetBase::enableRejectData(bool bEnable)
 
 void cQwtPlotWidgetBase::slotGrabFrame()
 {
-    slotPause(true);
-
-    QwtPlotRenderer oRenderer;
-
-#if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
+    //Only choosing the file happens here. The plot is snapshotted as shown and rendered in the background while it carries on updating.
 
-    //Implement Qwt's new exportTo function (copied and adapted from Qwt source):
-
-    if ( m_pUI->qwtPlot == NULL )
-        return;
-
-    QString qstrFileName = QString("%1").arg(m_pUI->qwtPlot->title().text());
-
-    // What about translation
+    //File type list adapted from QwtPlotRenderer::exportTo()
+    QString qstrFileName = QString("%1").arg(m_qstrTitle);
 
 #ifndef QT_NO_FILEDIALOG
     const QList<QByteArray> qlImageFormats = QImageWriter::supportedImageFormats();
 
     QStringList oFilter;
-#ifndef QT_NO_PRINTER
     oFilter += QString( "PDF " ) + tr( "Documents" ) + " (*.pdf)";
-#endif
 #ifndef QWT_NO_SVG
     oFilter += QString( "SVG " ) + tr( "Documents" ) + " (*.svg)";
 #endif
-#ifndef QT_NO_PRINTER
-    oFilter += QString( "Postscript " ) + tr( "Documents" ) + " (*.ps)";
-#endif
 
     if ( qlImageFormats.size() > 0 )
     {
@@ -300,20 +751,125 @@ void cQwtPlotWidgetBase::slotGrabFrame()
         oFilter += qstrImageFilter;
     }
 
+    oFilter += tr( "Plot data" ) + " (*.csv *.qpdx)";
+
     qstrFileName = QFileDialog::getSaveFileName(NULL, tr( "Export File Name" ), qstrFileName, oFilter.join( ";;" ), NULL, QFileDialog::DontConfirmOverwrite );
 #endif
     if ( qstrFileName.isEmpty() )
         return;
 
-    QSizeF oSize(297.0, 210.0);
-    oRenderer.renderDocument( m_pUI->qwtPlot, qstrFileName, oSize, 300 );
+    //The data itself rather than a picture of it
+    QString qstrSuffix = QFileInfo(qstrFileName).suffix().toLower();
+
+    if(qstrSuffix == QString("csv") || qstrSuffix == QString("qpdx"))
+    {
+        exportData(qstrFileName);
+        return;
+    }
+
+    exportPlot(qstrFileName);
+}
+
+void cQwtPlotWidgetBase::exportPlot(const QString &qstrFilename, const QSizeF &oSize_mm, uint32_t u32Resolution_dpi)
+{
+    //Created on first use. Exports queue up in order on its thread.
+    if(!m_pExportWorker)
+    {
+        m_pExportWorker = new cPlotRenderWorker;
+
+        QObject::connect(m_pExportWorker, SIGNAL(sigDocumentProgress(QString,unsigned int)), this, SIGNAL(sigExportProgress(QString,unsigned int)), Qt::QueuedConnection);
+        QObject::connect(m_pExportWorker, SIGNAL(sigDocumentWritten(QString,bool)), this, SLOT(slotExportFinished(QString,bool)), Qt::QueuedConnection);
+    }
+
+    m_pExportWorker->submitDocument(takeRenderSnapshot(), qstrFilename, oSize_mm, u32Resolution_dpi);
+
+    cout << "cQwtPlotWidgetBase::exportPlot(): Exporting plot \"" << m_qstrTitle.toStdString() << "\" to " << qstrFilename.toStdString()
+         << ". " << m_pExportWorker->getNPendingJobs() << " export(s) pending." << endl;
+}
+
+void cQwtPlotWidgetBase::slotExportFinished(const QString &qstrFilename, bool bSuccess)
+{
+    if(bSuccess)
+        cout << "cQwtPlotWidgetBase::slotExportFinished(): Exported plot \"" << m_qstrTitle.toStdString() << "\" to " << qstrFilename.toStdString() << endl;
+    else
+        cout << "cQwtPlotWidgetBase::slotExportFinished(): Warning: Export of plot \"" << m_qstrTitle.toStdString() << "\" to " << qstrFilename.toStdString() << " failed." << endl;
+
+    sigExportFinished(qstrFilename, bSuccess);
+}
+
+void cQwtPlotWidgetBase::enableFrameCapture(const QString &qstrFilenamePattern, uint32_t u32NBuffers)
+{
+    disableFrameCapture();
+
+    if(qstrFilenamePattern.isEmpty())
+        return;
+
+    //Buffers are allocated up front at the current canvas size
+    m_pFrameCaptureWriter = new cFrameCaptureWriter(qstrFilenamePattern, m_pUI->qwtPlot->canvas()->size(), u32NBuffers);
+
+    m_pUI->qwtPlot->canvas()->installEventFilter(this);
+}
+
+void cQwtPlotWidgetBase::disableFrameCapture()
+{
+    if(!m_pFrameCaptureWriter)
+        return;
+
+    //The event filter stays installed as derived classes may filter the canvas' events too. It does nothing without a writer.
+    delete m_pFrameCaptureWriter;
+    m_pFrameCaptureWriter = NULL;
+}
 
+cFrameCaptureWriter::cStats cQwtPlotWidgetBase::getFrameCaptureStats()
+{
+    if(!m_pFrameCaptureWriter)
+    {
+        cFrameCaptureWriter::cStats oStats;
+        memset(&oStats, 0, sizeof(oStats));
+
+        return oStats;
+    }
+
+    return m_pFrameCaptureWriter->getStats();
+}
+
+bool cQwtPlotWidgetBase::eventFilter(QObject *pObject, QEvent *pEvent)
+{
+    //The filter sees the paint event before the canvas paints, so the capture is queued to run once painting is done.
+    //Paints that arrive before it runs are captured together as they would only have shown for a moment.
+    if(m_pFrameCaptureWriter && !m_bFrameCapturePending && pObject == m_pUI->qwtPlot->canvas() && pEvent->type() == QEvent::Paint)
+    {
+        m_bFrameCapturePending = true;
+        QMetaObject::invokeMethod(this, "slotCaptureFrame", Qt::QueuedConnection);
+    }
+
+    return QMainWindow::eventFilter(pObject, pEvent);
+}
+
+void cQwtPlotWidgetBase::slotCaptureFrame()
+{
+    m_bFrameCapturePending = false;
+
+    if(!m_pFrameCaptureWriter)
+        return;
+
+    //The canvas keeps its last render in its backing store so capturing needs only a copy of that. Without one it is rendered again.
+    const QwtPlotCanvas *pCanvas = qobject_cast<const QwtPlotCanvas*>(m_pUI->qwtPlot->canvas());
+    const QPixmap *pBackingStore = NULL;
+
+    if(pCanvas)
+    {
+#if QWT_VERSION < 0x060100 //Account for Ubuntu's typically outdated package versions
+        pBackingStore = pCanvas->paintCache();
 #else
-    oRenderer.exportTo(m_pUI->qwtPlot, QString("%1").arg(m_pUI->qwtPlot->title().text()), QSizeF(297.0, 210.0), 300);
+        pBackingStore = pCanvas->backingStore();
 #endif
+    }
 
-
-    slotPause(false);
+    if(pBackingStore && !pBackingStore->isNull())
+        m_pFrameCaptureWriter->captureFrame(*pBackingStore);
+    else
+        m_pFrameCaptureWriter->captureFrame(m_pUI->qwtPlot->canvas()->grab());
 }
 
 void cQwtPlotWidgetBase::slotSetXScaleBase(int iBase)
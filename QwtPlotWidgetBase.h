@@ -20,15 +20,27 @@ typedef unsigned __int64 uint64_t;
 //Library includes
 #include <QMainWindow>
 #include <QString>
+#include <QStringList>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QPushButton>
 #include <QFont>
 #include <QTimer>
+#include <QSize>
+#include <QSizeF>
 #include <qwt_interval.h>
 #include <qwt_plot_marker.h>
 
 //Local includes
 #include "QwtPlotPositionPicker.h"
 #include "QwtPlotDistancePicker.h"
+#include "BlackBoxRecorder.h"
+#include "StreamRecorder.h"
+#include "HistorySnapshot.h"
+#include "PlotRenderer.h"
+#include "FrameCapture.h"
+#include "PlotDataExport.h"
 
 namespace Ui {
 class cQwtPlotWidgetBase;
@@ -64,6 +76,59 @@ public:
 
     void                                autoUpdateXScaleBase(uint32_t u32NBins); //Sets the X scale to base 2 ticks if the number of bins is a power of 2
 
+    //Many frames in one call. Also how cStreamReplayer passes frames on, with the channel list they were recorded with.
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList) = 0;
+
+    //Every frame subsequently passed to this widget is also passed to the recorder (see StreamRecorder.h). NULL stops recording.
+    void                                setRecorder(cStreamRecorder *pRecorder);
+
+    //Keeps the most recent input to this widget in the black box (see BlackBoxRecorder.h) and shows a button to dump it. NULL detaches.
+    //Call from the GUI thread.
+    void                                setBlackBox(cBlackBoxRecorder *pBlackBox);
+
+    //Periodically checkpoints the history of this widget to a snapshot file (see HistorySnapshot.h) for a warm start with restoreHistory().
+    //The ingest thread takes the snapshot with its next frame after each interval and it is written in the background.
+    //An empty filename or interval of 0 stops checkpoints. Supported by widgets with a scrolling history (scrolling, band power and waterfall).
+    void                                enableHistoryCheckpoints(const QString &qstrFilename, uint32_t u32Interval_s = 60);
+
+    //Loads the history from a snapshot file. Call once the widget is configured and before data is passed to it.
+    //Returns false, leaving the history empty, if the file is missing or does not match the widget's configuration.
+    bool                                restoreHistory(const QString &qstrFilename);
+
+    //Renders the plot on a background thread every u32Interval_ms at the given image size (see PlotRenderer.h). This also works with the widget
+    //hidden and without a display (QT_QPA_PLATFORM=offscreen). Each image is passed to the handler on the render thread and/or written to the file
+    //in the format of its suffix. A "%1" in the filename is replaced with the UTC time of the render for an image sequence, otherwise the file is
+    //replaced each time. A render is skipped if the previous one is still waiting. Call from the GUI thread.
+    void                                enablePeriodicRender(const QSize &oImageSize, uint32_t u32Interval_ms, cPlotImageHandler *pHandler,
+                                                         const QString &qstrFilename = QString());
+
+    //Returns once any render in progress has been handed to the handler
+    void                                disablePeriodicRender();
+
+    //Everything needed to render the plot as currently shown away from the GUI thread. Ownership passes to the caller. Call from the GUI thread.
+    cPlotRenderSnapshot*                takeRenderSnapshot();
+
+    //Exports the plot as currently shown to a page of the given size: a PDF or SVG document or an image, by the suffix of the filename.
+    //The plot is snapshotted immediately and rendered and written in the background, so it carries on updating meanwhile.
+    //Exports queue up in order. Progress and completion are reported by sigExportProgress() and sigExportFinished().
+    void                                exportPlot(const QString &qstrFilename, const QSizeF &oSize_mm = QSizeF(297.0, 210.0), uint32_t u32Resolution_dpi = 300);
+
+    //Captures every frame the plot canvas draws to a numbered image sequence (see FrameCapture.h), e.g. "capture/waterfall_%1.png" or ".raw".
+    //Each frame costs the GUI thread one copy of the canvas into a preallocated buffer. Frames are dropped, and counted, if the writer
+    //falls behind with all u32NBuffers buffers queued. Call from the GUI thread.
+    void                                enableFrameCapture(const QString &qstrFilenamePattern, uint32_t u32NBuffers = 8);
+
+    //Returns once the queued frames have been written
+    void                                disableFrameCapture();
+
+    cFrameCaptureWriter::cStats         getFrameCaptureStats();
+
+    //Writes the data behind the plot to a file: CSV for a "csv" suffix, otherwise the self-describing binary format of PlotDataExport.h.
+    //The ingest thread takes shallow copies of its buffers with its next frame and they are written in the background. If no frame arrives
+    //within DATA_EXPORT_TIMEOUT_MS (e.g. the stream has stopped) what is currently displayed is exported instead.
+    //Completion or failure is reported by sigDataExportFinished(). Call from the GUI thread.
+    void                                exportData(const QString &qstrFilename);
+
 protected:
     Ui::cQwtPlotWidgetBase              *m_pUI;
 
@@ -96,6 +161,43 @@ protected:
 
     QReadWriteLock                      m_oMutex;
 
+    //Flight recorder
+    QMutex                              m_oBlackBoxMutex;
+    cBlackBoxRecorder                   *m_pBlackBox;
+    QPushButton                         *m_pBlackBoxDumpButton;
+
+    //Input recording
+    QMutex                              m_oRecorderMutex;
+    cStreamRecorder                     *m_pRecorder;
+
+    //History checkpoints
+    QMutex                              m_oCheckpointMutex;
+    QString                             m_qstrCheckpointFilename;
+    QTimer                              m_oCheckpointTimer;
+    QAtomicInt                          m_oiCheckpointDue;
+    cHistorySnapshotWriter              *m_pHistorySnapshotWriter;
+
+    //Data export
+    static const uint32_t               DATA_EXPORT_TIMEOUT_MS = 1000;
+
+    QMutex                              m_oDataExportMutex;
+    QStringList                         m_qstrlPendingDataExports;
+    QAtomicInt                          m_oiDataExportDue;
+    QTimer                              m_oDataExportTimer;
+    cPlotDataExportWriter               *m_pDataExportWriter;
+
+    //Background rendering
+    QTimer                              m_oRenderTimer;
+    QSize                               m_oRenderImageSize;
+    cPlotImageHandler                   *m_pRenderImageHandler;
+    QString                             m_qstrRenderFilename;
+    cPlotRenderWorker                   *m_pRenderWorker;
+    cPlotRenderWorker                   *m_pExportWorker;
+
+    //Frame capture
+    cFrameCaptureWriter                 *m_pFrameCaptureWriter;
+    bool                                m_bFrameCapturePending;
+
     //Shared mouse position
     bool                                m_bMousePositionValid; //For sending
 
@@ -107,6 +209,45 @@ protected:
 
     void                                insertWidgetIntoControlFrame(QWidget* pNewWidget, uint32_t u32Index, bool bAddSpacerAfter = false);
 
+    //Pass input to the black box and the recorder if set
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList);
+
+    //Pass input to the black box if one is set
+    void                                recordToBlackBox(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                         const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    void                                recordToBlackBox(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                         const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
+    //Called by the ingest thread once its buffers are consistent. Takes and submits a snapshot if a checkpoint is due and the data
+    //for any requested data export.
+    void                                checkpointHistoryIfDue();
+    void                                exportDataIfDue();
+
+    //Snapshots the plot data for each file and passes it to the writer
+    void                                submitDataExports(const QStringList &qstrlFilenames);
+
+    //Add the history to the snapshot or restore it. Called on the ingest thread and the GUI thread (before ingest starts) respectively.
+    //The defaults return false for widgets without a history to keep.
+    virtual bool                        snapshotHistory(cHistorySnapshot &oSnapshot);
+    virtual bool                        restoreHistorySnapshot(const cHistorySnapshotReader &oReader);
+
+    //Adds the plot data to the export. Called on the ingest thread. The default returns false for widgets without data to export.
+    virtual bool                        snapshotData(cPlotDataExport &oExport);
+
+    //As snapshotData() from the data currently displayed, without touching the ingest buffers. Called on the GUI thread when no frame
+    //arrives to take an export. The default returns false.
+    virtual bool                        snapshotDisplayedData(cPlotDataExport &oExport);
+
+    //Adds copies of plot items that takeRenderSnapshot() cannot copy generically (curves, markers and grids are copied already)
+    virtual void                        addItemsToRenderSnapshot(cPlotRenderSnapshot &oSnapshot);
+
+    //Schedules a frame capture once the canvas has painted. Derived classes filtering events must pass them on to this.
+    virtual bool                        eventFilter(QObject *pObject, QEvent *pEvent);
+
 public slots:
     void                                slotPauseResume();
     void                                slotPause(bool bPause);
@@ -123,6 +264,13 @@ protected slots:
     virtual void                        slotUpdateScalesAndLabels();
     void                                slotSetXScaleBase(int iBase);
     void                                slotGrabFrame();
+    void                                slotDumpBlackBox();
+    void                                slotCheckpointDue();
+    void                                slotPeriodicRender();
+    void                                slotExportFinished(const QString &qstrFilename, bool bSuccess);
+    void                                slotCaptureFrame();
+    void                                slotDataExportFinished(const QString &qstrFilename, bool bSuccess);
+    void                                slotDataExportTimeout();
     virtual void                        slotScaleDivChanged();
     void                                slotMousePositionChanged(const QPointF &oPosition);
     void                                slotMousePositionValid(bool bValid);
@@ -134,6 +282,9 @@ signals:
     void                                sigStrobeAutoscale(unsigned int u32Delay_ms);
     void                                sigXScaleDivChanged(double dMin, double dMax);
     void                                sigSharedMousePositionChanged(const QPointF &oPosition, bool bValid);
+    void                                sigExportProgress(const QString &qstrFilename, unsigned int u32Percent);
+    void                                sigExportFinished(const QString &qstrFilename, bool bSuccess);
+    void                                sigDataExportFinished(const QString &qstrFilename, bool bSuccess);
 
 
 };
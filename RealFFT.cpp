@@ -0,0 +1,327 @@
+//System includes
+#include <cmath>
+#include <algorithm>
+
+//Library includes
+#include <QVarLengthArray>
+
+//Local includes
+#include "RealFFT.h"
+
+using namespace std;
+
+//M_PI is not standard C++ and needs _USE_MATH_DEFINES on MSVC
+static const double PI = 3.14159265358979323846;
+
+cRealFFT::cWorkspace::cWorkspace() :
+    m_u32NComplexSamples(0),
+    m_u32BufferLength_B(0)
+{
+}
+
+void cRealFFT::cWorkspace::resize(uint32_t u32NComplexSamples)
+{
+    if(m_u32NComplexSamples == u32NComplexSamples)
+        return;
+
+    //Round each buffer up to a whole number of cache lines so that the second is also aligned
+    m_u32NComplexSamples = u32NComplexSamples;
+    m_u32BufferLength_B = (u32NComplexSamples * sizeof(complex<float>) + ALIGNMENT_B - 1) / ALIGNMENT_B * ALIGNMENT_B;
+
+    //2 buffers plus slack to align the first
+    m_qvfStorage.resize((2 * m_u32BufferLength_B + ALIGNMENT_B) / sizeof(float));
+}
+
+complex<float>* cRealFFT::cWorkspace::getBuffer(uint32_t u32BufferNo)
+{
+    //The aligned address is derived on each call so that copying a workspace is harmless
+    uintptr_t upAddress = reinterpret_cast<uintptr_t>(m_qvfStorage.data());
+    upAddress = (upAddress + ALIGNMENT_B - 1) & ~(uintptr_t)(ALIGNMENT_B - 1);
+
+    return reinterpret_cast<complex<float>*>(upAddress + u32BufferNo * m_u32BufferLength_B);
+}
+
+cRealFFT::cRealFFT(uint32_t u32Length) :
+    m_u32Length(0),
+    m_u32NComplexSamples(0)
+{
+    setLength(u32Length);
+}
+
+void cRealFFT::setLength(uint32_t u32Length)
+{
+    m_u32Length = u32Length;
+    m_u32NComplexSamples = (u32Length % 2) ? u32Length : u32Length / 2;
+
+    //Factorise the complex length. Radix 4 first as it is the cheapest per sample.
+    m_qvu32Factors.clear();
+
+    uint32_t u32Remaining = m_u32NComplexSamples;
+
+    while(u32Remaining > 1 && u32Remaining % 4 == 0)
+    {
+        m_qvu32Factors.push_back(4);
+        u32Remaining /= 4;
+    }
+
+    for(uint32_t u32Factor = 2; u32Remaining > 1; )
+    {
+        if(u32Remaining % u32Factor == 0)
+        {
+            m_qvu32Factors.push_back(u32Factor);
+            u32Remaining /= u32Factor;
+            continue;
+        }
+
+        //Past sqrt the remainder is itself prime
+        if(u32Factor * u32Factor > u32Remaining)
+            u32Factor = u32Remaining;
+        else
+            u32Factor += (u32Factor == 2) ? 1 : 2;
+    }
+
+    //Precompute twiddles in double precision
+    m_qvcfStageTwiddles.clear();
+    m_qvcfRadixTwiddles.clear();
+
+    uint32_t u32N = m_u32NComplexSamples;
+
+    for(uint32_t u32StageNo = 0; u32StageNo < (uint32_t)m_qvu32Factors.size(); u32StageNo++)
+    {
+        uint32_t u32Radix = m_qvu32Factors[u32StageNo];
+        uint32_t u32M = u32N / u32Radix;
+
+        for(uint32_t u32P = 0; u32P < u32M; u32P++)
+        {
+            for(uint32_t u32J = 1; u32J < u32Radix; u32J++)
+            {
+                double dAngle = -2.0 * PI * (double)((uint64_t)u32P * u32J) / u32N;
+                m_qvcfStageTwiddles.push_back(complex<float>(cos(dAngle), sin(dAngle)));
+            }
+        }
+
+        if(u32Radix != 2 && u32Radix != 4)
+        {
+            for(uint32_t u32K = 0; u32K < u32Radix; u32K++)
+            {
+                double dAngle = -2.0 * PI * u32K / u32Radix;
+                m_qvcfRadixTwiddles.push_back(complex<float>(cos(dAngle), sin(dAngle)));
+            }
+        }
+
+        u32N = u32M;
+    }
+
+    m_qvcfSplitTwiddles.clear();
+
+    if(m_u32Length && m_u32Length % 2 == 0)
+    {
+        m_qvcfSplitTwiddles.resize(m_u32NComplexSamples + 1);
+
+        for(uint32_t u32K = 0; u32K <= m_u32NComplexSamples; u32K++)
+        {
+            double dAngle = -2.0 * PI * u32K / m_u32Length;
+            m_qvcfSplitTwiddles[u32K] = complex<float>(cos(dAngle), sin(dAngle));
+        }
+    }
+}
+
+void cRealFFT::powerSpectrum(const float *pfInput, uint32_t u32NInputSamples, const float *pfWindow, float *pfOutput, float fScale, cWorkspace &oWorkspace) const
+{
+    if(!m_u32Length)
+        return;
+
+    oWorkspace.resize(m_u32NComplexSamples);
+
+    complex<float> *pcfData = oWorkspace.getBuffer(0);
+    complex<float> *pcfScratch = oWorkspace.getBuffer(1);
+
+    //Window and pack the input. Even lengths pack consecutive pairs as (re, im).
+    float *pfData = reinterpret_cast<float*>(pcfData);
+    uint32_t u32NSamples = min(u32NInputSamples, m_u32Length);
+
+    if(m_u32Length % 2 == 0)
+    {
+        if(pfWindow)
+        {
+            for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+                pfData[u32SampleNo] = pfInput[u32SampleNo] * pfWindow[u32SampleNo];
+        }
+        else
+        {
+            copy(pfInput, pfInput + u32NSamples, pfData);
+        }
+
+        fill(pfData + u32NSamples, pfData + m_u32Length, 0.0f);
+    }
+    else
+    {
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+            pcfData[u32SampleNo] = complex<float>(pfWindow ? pfInput[u32SampleNo] * pfWindow[u32SampleNo] : pfInput[u32SampleNo], 0.0f);
+
+        fill(pcfData + u32NSamples, pcfData + m_u32Length, complex<float>(0.0f, 0.0f));
+    }
+
+    const complex<float> *pcfSpectrum = complexTransform(pcfData, pcfScratch);
+
+    uint32_t u32NBins = getNBins();
+
+    if(m_u32Length % 2)
+    {
+        for(uint32_t u32BinNo = 0; u32BinNo < u32NBins; u32BinNo++)
+            pfOutput[u32BinNo] = norm(pcfSpectrum[u32BinNo]) * fScale * (u32BinNo ? 2.0f : 1.0f);
+
+        return;
+    }
+
+    //Split step: separate the spectra of the even and odd samples and combine them
+    //X[k] = (Z[k] + Z*[M - k]) / 2 - i W_N^k (Z[k] - Z*[M - k]) / 2
+    uint32_t u32M = m_u32NComplexSamples;
+
+    for(uint32_t u32BinNo = 0; u32BinNo <= u32M; u32BinNo++)
+    {
+        complex<float> cfZ = pcfSpectrum[u32BinNo % u32M];
+        complex<float> cfZMirror = conj(pcfSpectrum[(u32M - u32BinNo) % u32M]);
+
+        complex<float> cfEven = 0.5f * (cfZ + cfZMirror);
+        complex<float> cfOdd = 0.5f * (cfZ - cfZMirror);
+        cfOdd = complex<float>(cfOdd.imag(), -cfOdd.real()); //Multiply by -i
+
+        complex<float> cfBin = cfEven + m_qvcfSplitTwiddles[u32BinNo] * cfOdd;
+
+        pfOutput[u32BinNo] = norm(cfBin) * fScale * ((u32BinNo && u32BinNo != u32M) ? 2.0f : 1.0f);
+    }
+}
+
+complex<float>* cRealFFT::complexTransform(complex<float> *pcfData, complex<float> *pcfScratch) const
+{
+    complex<float> *pcfInput = pcfData;
+    complex<float> *pcfOutput = pcfScratch;
+
+    const complex<float> *pcfTwiddles = m_qvcfStageTwiddles.constData();
+    const complex<float> *pcfRadixTwiddles = m_qvcfRadixTwiddles.constData();
+
+    uint32_t u32N = m_u32NComplexSamples;
+    uint32_t u32Stride = 1;
+
+    for(uint32_t u32StageNo = 0; u32StageNo < (uint32_t)m_qvu32Factors.size(); u32StageNo++)
+    {
+        uint32_t u32Radix = m_qvu32Factors[u32StageNo];
+        uint32_t u32M = u32N / u32Radix;
+
+        if(u32Radix == 4)
+        {
+            radix4Stage(pcfInput, pcfOutput, u32M, u32Stride, pcfTwiddles);
+        }
+        else if(u32Radix == 2)
+        {
+            radix2Stage(pcfInput, pcfOutput, u32M, u32Stride, pcfTwiddles);
+        }
+        else
+        {
+            genericStage(pcfInput, pcfOutput, u32Radix, u32M, u32Stride, pcfTwiddles, pcfRadixTwiddles);
+            pcfRadixTwiddles += u32Radix;
+        }
+
+        pcfTwiddles += u32M * (u32Radix - 1);
+
+        u32N = u32M;
+        u32Stride *= u32Radix;
+
+        swap(pcfInput, pcfOutput);
+    }
+
+    return pcfInput;
+}
+
+//Each stage of length n = radix * m and stride s computes, for p in [0, m) and q in [0, s):
+//y[q + s * (radix * p + j)] = W_n^(p * j) * sum_r x[q + s * (p + r * m)] * W_radix^(r * j)
+
+void cRealFFT::radix2Stage(const complex<float> *pcfInput, complex<float> *pcfOutput, uint32_t u32M, uint32_t u32Stride, const complex<float> *pcfTwiddles)
+{
+    for(uint32_t u32P = 0; u32P < u32M; u32P++)
+    {
+        complex<float> cfW = pcfTwiddles[u32P];
+
+        const complex<float> *pcfX0 = pcfInput + u32Stride * u32P;
+        const complex<float> *pcfX1 = pcfInput + u32Stride * (u32P + u32M);
+        complex<float> *pcfY0 = pcfOutput + u32Stride * (2 * u32P);
+        complex<float> *pcfY1 = pcfOutput + u32Stride * (2 * u32P + 1);
+
+        for(uint32_t u32Q = 0; u32Q < u32Stride; u32Q++)
+        {
+            complex<float> cfA = pcfX0[u32Q];
+            complex<float> cfB = pcfX1[u32Q];
+
+            pcfY0[u32Q] = cfA + cfB;
+            pcfY1[u32Q] = (cfA - cfB) * cfW;
+        }
+    }
+}
+
+void cRealFFT::radix4Stage(const complex<float> *pcfInput, complex<float> *pcfOutput, uint32_t u32M, uint32_t u32Stride, const complex<float> *pcfTwiddles)
+{
+    for(uint32_t u32P = 0; u32P < u32M; u32P++)
+    {
+        complex<float> cfW1 = pcfTwiddles[3 * u32P];
+        complex<float> cfW2 = pcfTwiddles[3 * u32P + 1];
+        complex<float> cfW3 = pcfTwiddles[3 * u32P + 2];
+
+        const complex<float> *pcfX0 = pcfInput + u32Stride * u32P;
+        const complex<float> *pcfX1 = pcfInput + u32Stride * (u32P + u32M);
+        const complex<float> *pcfX2 = pcfInput + u32Stride * (u32P + 2 * u32M);
+        const complex<float> *pcfX3 = pcfInput + u32Stride * (u32P + 3 * u32M);
+        complex<float> *pcfY = pcfOutput + u32Stride * (4 * u32P);
+
+        for(uint32_t u32Q = 0; u32Q < u32Stride; u32Q++)
+        {
+            complex<float> cfT0 = pcfX0[u32Q] + pcfX2[u32Q];
+            complex<float> cfT1 = pcfX0[u32Q] - pcfX2[u32Q];
+            complex<float> cfT2 = pcfX1[u32Q] + pcfX3[u32Q];
+            complex<float> cfT3 = pcfX1[u32Q] - pcfX3[u32Q];
+            cfT3 = complex<float>(cfT3.imag(), -cfT3.real()); //Multiply by -i
+
+            pcfY[u32Q] = cfT0 + cfT2;
+            pcfY[u32Q + u32Stride] = (cfT1 + cfT3) * cfW1;
+            pcfY[u32Q + 2 * u32Stride] = (cfT0 - cfT2) * cfW2;
+            pcfY[u32Q + 3 * u32Stride] = (cfT1 - cfT3) * cfW3;
+        }
+    }
+}
+
+void cRealFFT::genericStage(const complex<float> *pcfInput, complex<float> *pcfOutput, uint32_t u32Radix, uint32_t u32M, uint32_t u32Stride,
+                            const complex<float> *pcfTwiddles, const complex<float> *pcfRadixTwiddles)
+{
+    QVarLengthArray<complex<float>, 16> qvlacfInputs(u32Radix);
+
+    for(uint32_t u32P = 0; u32P < u32M; u32P++)
+    {
+        for(uint32_t u32Q = 0; u32Q < u32Stride; u32Q++)
+        {
+            for(uint32_t u32R = 0; u32R < u32Radix; u32R++)
+                qvlacfInputs[u32R] = pcfInput[u32Q + u32Stride * (u32P + u32R * u32M)];
+
+            for(uint32_t u32J = 0; u32J < u32Radix; u32J++)
+            {
+                //Direct DFT of the radix. The twiddle index (r * j) mod radix is advanced incrementally.
+                complex<float> cfSum = qvlacfInputs[0];
+                uint32_t u32TwiddleIndex = 0;
+
+                for(uint32_t u32R = 1; u32R < u32Radix; u32R++)
+                {
+                    u32TwiddleIndex += u32J;
+
+                    if(u32TwiddleIndex >= u32Radix)
+                        u32TwiddleIndex -= u32Radix;
+
+                    cfSum += qvlacfInputs[u32R] * pcfRadixTwiddles[u32TwiddleIndex];
+                }
+
+                if(u32J)
+                    cfSum *= pcfTwiddles[u32P * (u32Radix - 1) + u32J - 1];
+
+                pcfOutput[u32Q + u32Stride * (u32Radix * u32P + u32J)] = cfSum;
+            }
+        }
+    }
+}
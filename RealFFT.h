@@ -0,0 +1,93 @@
+//In-tree FFT of real valued data used to derive power spectra from time domain frames.
+//A real frame of even length N is transformed as a complex frame of length N / 2 followed by a split step, odd lengths
+//are transformed as complex frames of length N. The complex transform is a mixed radix (4, 2, 3, 5 and generic prime)
+//self-sorting Stockham FFT. All twiddle factors are precomputed when the length is set.
+//A plan is immutable once set up so any number of threads can transform with it concurrently, each with its own workspace.
+
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <complex>
+
+//Library includes
+#include <QVector>
+
+//Local includes
+
+class cRealFFT
+{
+public:
+    //Scratch buffers for one transform at a time. Buffers are aligned to cache lines for vectorised access.
+    class cWorkspace
+    {
+    public:
+        cWorkspace();
+
+        void                            resize(uint32_t u32NComplexSamples);
+
+        std::complex<float>*            getBuffer(uint32_t u32BufferNo);
+
+    private:
+        static const uint32_t           ALIGNMENT_B = 64;
+
+        QVector<float>                  m_qvfStorage;
+        uint32_t                        m_u32NComplexSamples;
+        uint32_t                        m_u32BufferLength_B;
+    };
+
+    explicit cRealFFT(uint32_t u32Length = 0);
+
+    void                                setLength(uint32_t u32Length);
+    uint32_t                            getLength() const {return m_u32Length;}
+
+    //Number of non-negative frequency bins, N / 2 + 1
+    uint32_t                            getNBins() const {return m_u32Length / 2 + 1;}
+
+    //One sided power spectrum, fScale * |X[k]|^2 with bins other than DC and Nyquist doubled, for k in [0, getNBins()).
+    //The input is multiplied by pfWindow (may be NULL) in the same pass. Input samples beyond u32NInputSamples are taken as 0.
+    void                                powerSpectrum(const float *pfInput, uint32_t u32NInputSamples, const float *pfWindow, float *pfOutput,
+                                                      float fScale, cWorkspace &oWorkspace) const;
+
+private:
+    uint32_t                            m_u32Length;
+    uint32_t                            m_u32NComplexSamples; //Length of the complex transform
+
+    QVector<uint32_t>                   m_qvu32Factors;
+
+    //W_n^(p * j) for each stage, p in [0, n / radix), j in [1, radix), concatenated in stage order
+    QVector<std::complex<float> >       m_qvcfStageTwiddles;
+
+    //W_radix^k, k in [0, radix) for each generic radix stage, concatenated in stage order
+    QVector<std::complex<float> >       m_qvcfRadixTwiddles;
+
+    //W_N^k, k in [0, N / 2] for the split step of even lengths
+    QVector<std::complex<float> >       m_qvcfSplitTwiddles;
+
+    //Returns a pointer to whichever of the 2 buffers holds the result
+    std::complex<float>*                complexTransform(std::complex<float> *pcfData, std::complex<float> *pcfScratch) const;
+
+    static void                         radix2Stage(const std::complex<float> *pcfInput, std::complex<float> *pcfOutput, uint32_t u32M, uint32_t u32Stride,
+                                                    const std::complex<float> *pcfTwiddles);
+    static void                         radix4Stage(const std::complex<float> *pcfInput, std::complex<float> *pcfOutput, uint32_t u32M, uint32_t u32Stride,
+                                                    const std::complex<float> *pcfTwiddles);
+    static void                         genericStage(const std::complex<float> *pcfInput, std::complex<float> *pcfOutput, uint32_t u32Radix, uint32_t u32M,
+                                                     uint32_t u32Stride, const std::complex<float> *pcfTwiddles, const std::complex<float> *pcfRadixTwiddles);
+};
+
+#endif // REAL_FFT_H
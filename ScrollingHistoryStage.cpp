@@ -0,0 +1,114 @@
+//System includes
+
+//Library includes
+
+//Local includes
+#include "ScrollingHistoryStage.h"
+
+using namespace std;
+
+void cScrollingHistoryStage::appendFrame(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, QVector<QVector<float> > &qvvfHistory)
+{
+    //If there is no channel list use all channels in the input frame. Otherwise use those specified in the list
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+
+    //Check that our output array has the right number of channels
+    if((uint32_t)qvvfHistory.size() != u32NChannels)
+    {
+        qvvfHistory.resize(u32NChannels);
+    }
+
+    if(qvu32ChannelList.empty())
+        appendFrame(oYData, cIdentityChannelSelection(), u32NChannels, qvvfHistory);
+    else
+        appendFrame(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels, qvvfHistory);
+}
+
+template<typename tChannelSelection>
+void cScrollingHistoryStage::appendFrame(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                         QVector<QVector<float> > &qvvfHistory)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        uint32_t u32InputChannelNo = oSelection.getInputChannelNo(u32ChannelNo);
+        uint32_t u32NSamples = oYData.getNBins(u32InputChannelNo);
+        uint32_t u32NExistingSamples = qvvfHistory[u32ChannelNo].size();
+
+        qvvfHistory[u32ChannelNo].resize(u32NExistingSamples + u32NSamples);
+
+        cPlotKernels::apply<cCopyOperation>(oYData.getChannel(u32InputChannelNo), qvvfHistory[u32ChannelNo].data() + u32NExistingSamples, u32NSamples);
+    }
+}
+
+void cScrollingHistoryStage::appendRawFrame(const cRawPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, float fDecibelFactor,
+                                            QVector<QVector<float> > &qvvfHistory)
+{
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oYData.getNChannels() : qvu32ChannelList.size();
+
+    if((uint32_t)qvvfHistory.size() != u32NChannels)
+    {
+        qvvfHistory.resize(u32NChannels);
+    }
+
+    if(qvu32ChannelList.empty())
+        appendRawFrame(oYData, cIdentityChannelSelection(), u32NChannels, fDecibelFactor, qvvfHistory);
+    else
+        appendRawFrame(oYData, cIndexedChannelSelection(qvu32ChannelList), u32NChannels, fDecibelFactor, qvvfHistory);
+}
+
+template<typename tChannelSelection>
+void cScrollingHistoryStage::appendRawFrame(const cRawPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                            float fDecibelFactor, QVector<QVector<float> > &qvvfHistory)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        uint32_t u32NExistingSamples = qvvfHistory[u32ChannelNo].size();
+
+        qvvfHistory[u32ChannelNo].resize(u32NExistingSamples + oYData.getNBins());
+
+        float *pfOutput = qvvfHistory[u32ChannelNo].data() + u32NExistingSamples;
+
+        if(fDecibelFactor != 0.0f)
+            oYData.convertChannelToDecibels(oSelection.getInputChannelNo(u32ChannelNo), pfOutput, fDecibelFactor);
+        else
+            oYData.convertChannel(oSelection.getInputChannelNo(u32ChannelNo), pfOutput);
+    }
+}
+
+void cScrollingHistoryStage::trim(QVector<QVector<float> > &qvvfHistory, uint32_t u32NSamples)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfHistory.size(); u32ChannelNo++)
+    {
+        if((uint32_t)qvvfHistory[u32ChannelNo].size() > u32NSamples)
+        {
+            qvvfHistory[u32ChannelNo].remove(0, qvvfHistory[u32ChannelNo].size() - u32NSamples);
+        }
+    }
+}
+
+uint32_t cScrollingHistoryStage::getNSamplesOutsideSpan(const QVector<double> &qvdXData, uint32_t u32FirstSample, double dSpan)
+{
+    if(u32FirstSample >= (uint32_t)qvdXData.size())
+        return 0;
+
+    uint32_t u32NSamples = 0;
+
+    while(qvdXData.last() - qvdXData[u32FirstSample + u32NSamples] > dSpan)
+    {
+        u32NSamples++;
+    }
+
+    return u32NSamples;
+}
+
+void cScrollingHistoryStage::toDecibels(QVector<QVector<float> > &qvvfHistory, uint32_t u32FirstSample, double dFactor)
+{
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfHistory.size(); u32ChannelNo++)
+    {
+        if(u32FirstSample >= (uint32_t)qvvfHistory[u32ChannelNo].size())
+            continue;
+
+        float *pfYData = qvvfHistory[u32ChannelNo].data() + u32FirstSample;
+        cPlotKernels::toDecibels(pfYData, pfYData, qvvfHistory[u32ChannelNo].size() - u32FirstSample, dFactor);
+    }
+}
@@ -0,0 +1,61 @@
+//Sample history of the scrolling line plots, free of any GUI dependency.
+//Each channel's history is a plain vector which frames are appended to and the oldest samples trimmed from. The X history and
+//its sampling mode stay with the widget. The functions here only need the number of X samples or the explicit X values.
+
+#ifndef SCROLLING_HISTORY_STAGE_H
+#define SCROLLING_HISTORY_STAGE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+
+//Local includes
+#include "PlotFrame.h"
+
+class cScrollingHistoryStage
+{
+public:
+    //Appends the selected channels (all if the list is empty) of a frame to the end of each channel's history.
+    //The history is resized to the number of selected channels first.
+    static void                         appendFrame(const cPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList,
+                                                    QVector<QVector<float> > &qvvfHistory);
+
+    //As appendFrame() for raw samples. These are converted to dB in the same pass if fDecibelFactor is not 0.
+    static void                         appendRawFrame(const cRawPlotFrameView &oYData, const QVector<uint32_t> &qvu32ChannelList, float fDecibelFactor,
+                                                       QVector<QVector<float> > &qvvfHistory);
+
+    //Drops the oldest samples of any channel longer than u32NSamples
+    static void                         trim(QVector<QVector<float> > &qvvfHistory, uint32_t u32NSamples);
+
+    //Number of the oldest samples of a monotonic X history, from u32FirstSample onwards, lying more than dSpan before the newest sample
+    static uint32_t                     getNSamplesOutsideSpan(const QVector<double> &qvdXData, uint32_t u32FirstSample, double dSpan);
+
+    //Converts each channel to dB from sample u32FirstSample onwards. The factor is 10 for power and 20 for voltage.
+    static void                         toDecibels(QVector<QVector<float> > &qvvfHistory, uint32_t u32FirstSample, double dFactor);
+
+private:
+    template<typename tChannelSelection>
+    static void                         appendFrame(const cPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                                    QVector<QVector<float> > &qvvfHistory);
+
+    template<typename tChannelSelection>
+    static void                         appendRawFrame(const cRawPlotFrameView &oYData, const tChannelSelection &oSelection, uint32_t u32NChannels,
+                                                       float fDecibelFactor, QVector<QVector<float> > &qvvfHistory);
+};
+
+#endif // SCROLLING_HISTORY_STAGE_H
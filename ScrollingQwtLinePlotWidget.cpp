@@ -2,12 +2,14 @@
 #include <cmath>
 #include <iostream>
 #include <cfloat>
+#include <cstring>
 
 //Library includes
 #include <QThread>
 
 //Local includes
 #include "ScrollingQwtLinePlotWidget.h"
+#include "ScrollingHistoryStage.h"
 #include "ui_QwtPlotWidgetBase.h"
 #include "AVNUtilLibs/Timestamp/Timestamp.h"
 
@@ -19,8 +21,15 @@ cScrollingQwtLinePlotWidget::cScrollingQwtLinePlotWidget(QWidget *pParent) :
     m_dSpanLengthScalingFactor(1.0),
     m_dPreviousLogConversionXIndex(-DBL_MAX),
     m_dPreviousOldestXSample(0.0),
-    m_dPreviousNewestXSample(0.0)
+    m_dPreviousNewestXSample(0.0),
+    m_bUniformXSampling(false),
+    m_dUniformXStep(1.0),
+    m_dUniformXOrigin(0.0),
+    m_u64NUniformXSamplesDropped(0)
 {
+    //Samples are appended in time order
+    m_bXIsMonotonic = true;
+
     //Add averaging control to GUI
     m_pSpanLengthLabel = new QLabel(QString("Span length"), this);
     m_pSpanLengthDoubleSpinBox = new QDoubleSpinBox(this);
@@ -37,90 +46,199 @@ cScrollingQwtLinePlotWidget::~cScrollingQwtLinePlotWidget()
 {
 }
 
-void cScrollingQwtLinePlotWidget::processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us)
+void cScrollingQwtLinePlotWidget::addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
 {
-    Q_UNUSED(i64Timestamp_us);
+    //Safety flag which can be set by other threads if data is known not to be interpretable
+    if(m_bRejectData || !oBatch.getNFrames())
+        return;
 
-    //Add the input data to plot array
-    for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvfXData.size(); u32SampleNo++)
-    {
-        m_qvdXDataToPlot.push_back(qvfXData[u32SampleNo]);
-    }
+    recordBatch(oBatch, qvu32ChannelList);
+
+    ingestDataBatch(oBatch, qvu32ChannelList);
+}
+
+void cScrollingQwtLinePlotWidget::ingestDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(m_bRejectData || !oBatch.getNFrames())
+        return;
+
+    //Append every frame then trim the history once
+    bool bUniformXSampling;
+    double dUniformXStep;
+    beginXData(bUniformXSampling, dUniformXStep);
 
-    //Pop old data until the X span is correct
-    while(m_qvdXDataToPlot.last() - m_qvdXDataToPlot.first() > m_dSpanLength * m_dSpanLengthScalingFactor)
+    for(uint32_t u32FrameNo = 0; u32FrameNo < oBatch.getNFrames(); u32FrameNo++)
     {
-        m_qvdXDataToPlot.pop_front();
+        appendXData(oBatch.getXData(u32FrameNo), oBatch.getNXSamples(u32FrameNo), bUniformXSampling, dUniformXStep);
+        cScrollingHistoryStage::appendFrame(oBatch.getFrame(u32FrameNo), qvu32ChannelList, m_qvvfYDataToPlot);
     }
+
+    trimXHistory(bUniformXSampling, dUniformXStep);
+    trimYHistory();
+
+    plotProcessedData(oBatch.getTimestamp_us(oBatch.getNFrames() - 1));
 }
 
-void cScrollingQwtLinePlotWidget::processYData(const QVector<QVector<float> > &qvvfYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+void cScrollingQwtLinePlotWidget::processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us)
 {
     Q_UNUSED(i64Timestamp_us);
 
-    if(qvu32ChannelList.empty())
+    bool bUniformXSampling;
+    double dUniformXStep;
+    beginXData(bUniformXSampling, dUniformXStep);
+
+    appendXData(pfXData, u32NSamples, bUniformXSampling, dUniformXStep);
+
+    trimXHistory(bUniformXSampling, dUniformXStep);
+}
+
+void cScrollingQwtLinePlotWidget::beginXData(bool &bUniformXSampling, double &dUniformXStep)
+{
+    m_oMutex.lockForRead(); //Ensure sampling mode doesn't change during this section
+    bUniformXSampling = m_bUniformXSampling;
+    dUniformXStep = m_dUniformXStep;
+    m_oMutex.unlock();
+
+    //Start again if the sampling mode has been changed
+    if(bUniformXSampling != m_bImplicitX || (bUniformXSampling && dUniformXStep != m_dImplicitXStep))
     {
-        //Check that our output array has the right number of channels
-        if(m_qvvdYDataToPlot.size() != qvvfYData.size())
-        {
-            m_qvvdYDataToPlot.resize(qvvfYData.size());
-        }
+        resetHistory();
+    }
+}
 
-        //Append new data
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfYData.size(); u32ChannelNo++)
-        {
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvvfYData[u32ChannelNo].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo].push_back(qvvfYData[u32ChannelNo][u32SampleNo]);
-            }
-        }
+void cScrollingQwtLinePlotWidget::appendXData(const float *pfXData, uint32_t u32NSamples, bool bUniformXSampling, double dUniformXStep)
+{
+    if(bUniformXSampling)
+    {
+        if(!u32NSamples)
+            return;
 
-        //Pop data until the Y vector is the length as the X
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfYData.size(); u32ChannelNo++)
+        //Only the first X value of a new history is used
+        if(!m_bImplicitX || !m_u32NImplicitXSamples)
         {
-            while(m_qvvdYDataToPlot[u32ChannelNo].size() > m_qvdXDataToPlot.size())
-            {
-                m_qvvdYDataToPlot[u32ChannelNo].pop_front();
-            }
+            m_dUniformXOrigin = pfXData[0];
+            m_u64NUniformXSamplesDropped = 0;
+            setImplicitXData(m_dUniformXOrigin, dUniformXStep, 0);
         }
 
+        m_u32NImplicitXSamples += u32NSamples;
+
+        return;
     }
-    else
+
+    m_bImplicitX = false;
+
+    //Add the input data to plot array
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
     {
-        //Check that our output array has the right number of channels
-        if(m_qvvdYDataToPlot.size() != qvu32ChannelList.size())
-        {
-            m_qvvdYDataToPlot.resize(qvu32ChannelList.size());
-        }
+        m_qvdXDataToPlot.push_back(pfXData[u32SampleNo]);
+    }
+}
 
-        //Append new data
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvu32ChannelList.size(); u32ChannelNo++)
-        {
-            for(uint32_t u32SampleNo = 0; u32SampleNo < (uint32_t)qvvfYData[qvu32ChannelList[u32ChannelNo]].size(); u32SampleNo++)
-            {
-                m_qvvdYDataToPlot[u32ChannelNo].push_back(qvvfYData[qvu32ChannelList[u32ChannelNo]][u32SampleNo]);
-            }
-        }
+void cScrollingQwtLinePlotWidget::trimXHistory(bool bUniformXSampling, double dUniformXStep)
+{
+    if(bUniformXSampling)
+    {
+        //Drop old samples until the X span is correct
+        trimUniformXHistory((uint32_t)floor(m_dSpanLength * m_dSpanLengthScalingFactor / dUniformXStep) + 1);
 
-        //Pop data until the Y vector is the length as the X
-        for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfYData.size(); u32ChannelNo++)
-        {
-            while(m_qvvdYDataToPlot[u32ChannelNo].size() > m_qvdXDataToPlot.size())
-            {
-                m_qvvdYDataToPlot[u32ChannelNo].pop_front();
-            }
-        }
+        return;
     }
-    //cout << "cScrollingQwtLinePlotWidget::processXData(): m_qvdYDataToPlot is " << m_qvvdYDataToPlot[0].size() << " samples long." << endl;
+
+    //Scroll old data out until the X span is correct. It is removed later by compactHistory().
+    m_u32HistoryStart += cScrollingHistoryStage::getNSamplesOutsideSpan(m_qvdXDataToPlot, m_u32HistoryStart, m_dSpanLength * m_dSpanLengthScalingFactor);
+}
+
+void cScrollingQwtLinePlotWidget::processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    Q_UNUSED(i64Timestamp_us);
+
+    cScrollingHistoryStage::appendFrame(oYData, qvu32ChannelList, m_qvvfYDataToPlot);
+
+    trimYHistory();
+    //cout << "cScrollingQwtLinePlotWidget::processXData(): m_qvdYDataToPlot is " << m_qvvfYDataToPlot[0].size() << " samples long." << endl;
+}
+
+bool cScrollingQwtLinePlotWidget::processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us, const QVector<uint32_t> &qvu32ChannelList)
+{
+    Q_UNUSED(i64Timestamp_us);
+
+    //Append converted data, applying the log conversion in the same pass if possible
+    float fDecibelFactor = getFusedDecibelFactor();
+
+    cScrollingHistoryStage::appendRawFrame(oYData, qvu32ChannelList, fDecibelFactor, m_qvvfYDataToPlot);
+
+    trimYHistory();
+
+    if(fDecibelFactor == 0.0f)
+        return false;
+
+    //Everything up to the newest sample is now converted
+    if(getNXSamples())
+        m_dPreviousLogConversionXIndex = getXSample(getNXSamples() - 1);
+
+    return true;
+}
+
+void cScrollingQwtLinePlotWidget::trimYHistory()
+{
+    //Pop data until the Y vector is the length as the X
+    cScrollingHistoryStage::trim(m_qvvfYDataToPlot, m_u32HistoryStart + getNXSamples());
+
+    //Each sample is shifted down at most once per history length rather than on every frame
+    if(m_u32HistoryStart > getNXSamples())
+        compactHistory();
+}
+
+void cScrollingQwtLinePlotWidget::compactHistory()
+{
+    if(!m_u32HistoryStart)
+        return;
+
+    cScrollingHistoryStage::trim(m_qvvfYDataToPlot, getNXSamples());
+
+    if(!m_bImplicitX)
+        m_qvdXDataToPlot.remove(0, m_u32HistoryStart);
+
+    m_u32HistoryStart = 0;
 }
 
 void cScrollingQwtLinePlotWidget::resetHistory()
 {
-    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)m_qvvfYDataToPlot.size(); u32ChannelNo++)
     {
-        m_qvvdYDataToPlot[u32ChannelNo].clear();
+        m_qvvfYDataToPlot[u32ChannelNo].clear();
     }
     m_qvdXDataToPlot.clear();
+    m_u32NImplicitXSamples = 0;
+    m_u32HistoryStart = 0;
+}
+
+void cScrollingQwtLinePlotWidget::enableUniformXSampling(bool bEnable, double dXStep)
+{
+    if(bEnable && dXStep <= 0.0)
+    {
+        cout << "cScrollingQwtLinePlotWidget::enableUniformXSampling(): Warning: X step must be positive, got " << dXStep << ". Ignoring." << endl;
+        return;
+    }
+
+    //The history is reset by the data thread on the next call to addData
+    QWriteLocker oWriteLock(&m_oMutex);
+
+    m_bUniformXSampling = bEnable;
+    m_dUniformXStep = dXStep;
+}
+
+void cScrollingQwtLinePlotWidget::trimUniformXHistory(uint32_t u32NSamplesToKeep)
+{
+    if(m_u32NImplicitXSamples > u32NSamplesToKeep)
+    {
+        m_u64NUniformXSamplesDropped += m_u32NImplicitXSamples - u32NSamplesToKeep;
+        m_u32HistoryStart += m_u32NImplicitXSamples - u32NSamplesToKeep;
+        m_u32NImplicitXSamples = u32NSamplesToKeep;
+    }
+
+    m_dImplicitXStart = m_dUniformXOrigin + m_u64NUniformXSamplesDropped * m_dImplicitXStep;
 }
 
 void cScrollingQwtLinePlotWidget::logConversion()
@@ -128,24 +246,16 @@ void cScrollingQwtLinePlotWidget::logConversion()
     //Here we have to keep track of values already converted to dB.
     //This is done with the X value and stored in a member variable
 
-    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+    uint32_t u32SampleNo = 0;
+    while(u32SampleNo < getNXSamples() && getXSample(u32SampleNo) <= m_dPreviousLogConversionXIndex)
     {
-        uint32_t u32SampleNo = 0;
-        for(; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-        {
-            if(m_qvdXDataToPlot[u32SampleNo] > m_dPreviousLogConversionXIndex)
-            {
-                break;
-            }
-        }
-
-        for(; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-        {
-            m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 10 * log10(m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] + 0.001);
-        }
+        u32SampleNo++;
     }
 
-    m_dPreviousLogConversionXIndex = m_qvdXDataToPlot.last();
+    cScrollingHistoryStage::toDecibels(m_qvvfYDataToPlot, m_u32HistoryStart + u32SampleNo, 10.0);
+
+    if(getNXSamples())
+        m_dPreviousLogConversionXIndex = getXSample(getNXSamples() - 1);
 }
 
 void cScrollingQwtLinePlotWidget::powerLogConversion()
@@ -153,24 +263,125 @@ void cScrollingQwtLinePlotWidget::powerLogConversion()
     //Here we have to keep track of values already converted to dB.
     //This is done with the X value and stored in a member variable
 
-    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (unsigned)m_qvvdYDataToPlot.size(); u32ChannelNo++)
+    uint32_t u32SampleNo = 0;
+    while(u32SampleNo < getNXSamples() && getXSample(u32SampleNo) < m_dPreviousLogConversionXIndex)
     {
-        uint32_t u32SampleNo = 0;
-        for(; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
-        {
-            if(m_qvdXDataToPlot[u32SampleNo] >= m_dPreviousLogConversionXIndex)
-            {
-                break;
-            }
-        }
+        u32SampleNo++;
+    }
 
-        for(; u32SampleNo <  (unsigned)m_qvvdYDataToPlot[u32ChannelNo].size(); u32SampleNo++)
+    cScrollingHistoryStage::toDecibels(m_qvvfYDataToPlot, m_u32HistoryStart + u32SampleNo, 20.0);
+
+    if(getNXSamples())
+        m_dPreviousLogConversionXIndex = getXSample(getNXSamples() - 1);
+}
+
+bool cScrollingQwtLinePlotWidget::snapshotData(cPlotDataExport &oExport)
+{
+    //Exported buffers must start with the first plotted sample
+    compactHistory();
+
+    return cBasicQwtLinePlotWidget::snapshotData(oExport);
+}
+
+bool cScrollingQwtLinePlotWidget::snapshotHistory(cHistorySnapshot &oSnapshot)
+{
+    compactHistory();
+
+    cScrollingSnapshotState oState;
+    memset(&oState, 0, sizeof(oState));
+
+    oState.m_dImplicitXStart = m_dImplicitXStart;
+    oState.m_dImplicitXStep = m_dImplicitXStep;
+    oState.m_dUniformXOrigin = m_dUniformXOrigin;
+    oState.m_dPreviousLogConversionXIndex = m_dPreviousLogConversionXIndex;
+    oState.m_u64NUniformXSamplesDropped = m_u64NUniformXSamplesDropped;
+    oState.m_i64PlotTimestamp_us = m_i64PlotTimestamp_us;
+    oState.m_u32NImplicitXSamples = m_u32NImplicitXSamples;
+    oState.m_u8ImplicitX = m_bImplicitX;
+
+    m_oMutex.lockForRead();
+    oState.m_u8LogConversion = m_bDoLogConversion;
+    oState.m_u8PowerLogConversion = m_bDoPowerLogConversion;
+    m_oMutex.unlock();
+
+    //Shallow copies. The buffers are only copied if ingest modifies them before the writer is done.
+    oSnapshot.addValue(SNAPSHOT_SCROLLING_STATE, oState);
+    oSnapshot.addVector(SNAPSHOT_SCROLLING_X_DATA, m_qvdXDataToPlot);
+    oSnapshot.addRows(SNAPSHOT_SCROLLING_Y_DATA, m_qvvfYDataToPlot);
+
+    return true;
+}
+
+bool cScrollingQwtLinePlotWidget::restoreHistorySnapshot(const cHistorySnapshotReader &oReader)
+{
+    cScrollingSnapshotState oState;
+    QVector<double> qvdXData;
+    QVector<QVector<float> > qvvfYData;
+
+    if(!oReader.getValue(SNAPSHOT_SCROLLING_STATE, oState) || !oReader.getVector(SNAPSHOT_SCROLLING_X_DATA, qvdXData)
+            || !oReader.getRows(SNAPSHOT_SCROLLING_Y_DATA, qvvfYData))
+    {
+        cout << "cScrollingQwtLinePlotWidget::restoreHistorySnapshot(): Warning: Snapshot is incomplete." << endl;
+        return false;
+    }
+
+    bool bUniformXSampling;
+    double dUniformXStep;
+
+    m_oMutex.lockForRead();
+    bUniformXSampling = m_bUniformXSampling;
+    dUniformXStep = m_dUniformXStep;
+    bool bSameLogConversion = (bool)oState.m_u8LogConversion == m_bDoLogConversion && (bool)oState.m_u8PowerLogConversion == m_bDoPowerLogConversion;
+    m_oMutex.unlock();
+
+    //The history would otherwise be discarded by the first frame or plotted with the wrong conversion
+    if((bool)oState.m_u8ImplicitX != bUniformXSampling || (bUniformXSampling && oState.m_dImplicitXStep != dUniformXStep))
+    {
+        cout << "cScrollingQwtLinePlotWidget::restoreHistorySnapshot(): Warning: Snapshot X sampling mode differs from the current setting." << endl;
+        return false;
+    }
+
+    if(!bSameLogConversion)
+    {
+        cout << "cScrollingQwtLinePlotWidget::restoreHistorySnapshot(): Warning: Snapshot log conversion differs from the current setting." << endl;
+        return false;
+    }
+
+    uint32_t u32NXSamples = oState.m_u8ImplicitX ? oState.m_u32NImplicitXSamples : qvdXData.size();
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < (uint32_t)qvvfYData.size(); u32ChannelNo++)
+    {
+        if((uint32_t)qvvfYData[u32ChannelNo].size() > u32NXSamples)
         {
-            m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] = 20 * log10(m_qvvdYDataToPlot[u32ChannelNo][u32SampleNo] + 0.001);
+            cout << "cScrollingQwtLinePlotWidget::restoreHistorySnapshot(): Warning: Snapshot Y data is longer than its X data." << endl;
+            return false;
         }
     }
 
-    m_dPreviousLogConversionXIndex = m_qvdXDataToPlot.last();
+    if(oState.m_u8ImplicitX)
+    {
+        setImplicitXData(oState.m_dImplicitXStart, oState.m_dImplicitXStep, oState.m_u32NImplicitXSamples);
+    }
+    else
+    {
+        m_bImplicitX = false;
+        m_qvdXDataToPlot.swap(qvdXData);
+    }
+
+    m_dUniformXOrigin = oState.m_dUniformXOrigin;
+    m_u64NUniformXSamplesDropped = oState.m_u64NUniformXSamplesDropped;
+    m_dPreviousLogConversionXIndex = oState.m_dPreviousLogConversionXIndex;
+    m_i64PlotTimestamp_us = oState.m_i64PlotTimestamp_us;
+    m_qvvfYDataToPlot.swap(qvvfYData);
+    m_u32HistoryStart = 0;
+
+    //The span may have been changed since
+    trimXHistory(bUniformXSampling, dUniformXStep);
+    trimYHistory();
+
+    sigUpdatePlotData();
+
+    return true;
 }
 
 void cScrollingQwtLinePlotWidget::showSpanLengthControl(bool bEnable)
@@ -218,7 +429,7 @@ void cScrollingQwtLinePlotWidget::slotUpdatePlotData()
     //Check that the curves match the source data
     updateCurves();
 
-    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)m_qvvdYDataToPlot.size(); u32CurveNo++)
+    for(uint32_t u32CurveNo = 0; u32CurveNo < (uint32_t)m_qvvfYDataToPlot.size(); u32CurveNo++)
     {
 
         if(u32CurveNo >= (unsigned int)m_qvpPlotCurves.size())
@@ -229,23 +440,26 @@ void cScrollingQwtLinePlotWidget::slotUpdatePlotData()
             return;
         }
 
-        m_qvpPlotCurves[u32CurveNo]->setSamples(m_qvdXDataToPlot, m_qvvdYDataToPlot[u32CurveNo]);
+        m_qvpPlotCurves[u32CurveNo]->setData(createSeriesData(u32CurveNo));
     }
 
 
     //This following block diviates from the the base implementation
-    if(!m_pPlotZoomer->isCurrentlyAnimating())
+    if(!m_pPlotZoomer->isCurrentlyAnimating() && getNXSamples())
     {
+        double dOldestXSample = getXSample(0);
+        double dNewestXSample = getXSample(getNXSamples() - 1);
+
         //Extents of the X scale before the new data and after the new data
         double dOldLength = m_dPreviousNewestXSample - m_dPreviousOldestXSample;
-        double dNewLength = m_qvdXDataToPlot.last() - m_qvdXDataToPlot.first();
+        double dNewLength = dNewestXSample - dOldestXSample;
 
         //Get the current zoom stack
         QStack< QRectF > oCurrentStack = m_pPlotZoomer->zoomStack();
 
         //Set the zoom base to new extend of the data
-        oCurrentStack[0].setLeft(m_qvdXDataToPlot.first());
-        oCurrentStack[0].setRight(m_qvdXDataToPlot.last());
+        oCurrentStack[0].setLeft(dOldestXSample);
+        oCurrentStack[0].setRight(dNewestXSample);
 
         //For the subsequent zoom frames shift them proportionaly to the overall extent update
         for(uint32_t i = 1; i < (uint32_t)oCurrentStack.size(); i++)
@@ -256,15 +470,15 @@ void cScrollingQwtLinePlotWidget::slotUpdatePlotData()
             double dRightRatio = (oCurrentStack[i].right() - m_dPreviousOldestXSample) / dOldLength;
 
             //Now use the same ratio to calculate new sides of the zoom rectangle based on the new X extent
-            oCurrentStack[i].setLeft(m_qvdXDataToPlot.first() + dNewLength * dLeftRatio);
-            oCurrentStack[i].setRight(m_qvdXDataToPlot.first() + dNewLength * dRightRatio);
+            oCurrentStack[i].setLeft(dOldestXSample + dNewLength * dLeftRatio);
+            oCurrentStack[i].setRight(dOldestXSample + dNewLength * dRightRatio);
         }
 
         m_pPlotZoomer->setZoomStack(oCurrentStack, m_pPlotZoomer->zoomRectIndex());
 
         //The set the new X extent as the old X extent for the next update
-        m_dPreviousOldestXSample = m_qvdXDataToPlot.first();
-        m_dPreviousNewestXSample = m_qvdXDataToPlot.last();
+        m_dPreviousOldestXSample = dOldestXSample;
+        m_dPreviousNewestXSample = dNewestXSample;
     }
 
     //Update timestamp in Title if needed
@@ -40,7 +40,37 @@ public:
 
     void                                resetHistory();
 
+    //For uniformly sampled data. Only the first X value of the history is stored, subsequent samples are assumed to be
+    //dXStep apart and any X values passed in are ignored. Enabling or disabling clears the history.
+    void                                enableUniformXSampling(bool bEnable, double dXStep = 1.0);
+
+    //All frames are appended before the history is trimmed once
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
 protected:
+    //History snapshot sections (see HistorySnapshot.h). Derived classes number theirs from 0x200.
+    static const uint32_t               SNAPSHOT_SCROLLING_STATE = 0x100;
+    static const uint32_t               SNAPSHOT_SCROLLING_X_DATA = 0x101;
+    static const uint32_t               SNAPSHOT_SCROLLING_Y_DATA = 0x102;
+
+    struct cScrollingSnapshotState
+    {
+        double                          m_dImplicitXStart;
+        double                          m_dImplicitXStep;
+        double                          m_dUniformXOrigin;
+        double                          m_dPreviousLogConversionXIndex;
+        uint64_t                        m_u64NUniformXSamplesDropped;
+        int64_t                         m_i64PlotTimestamp_us;
+        uint32_t                        m_u32NImplicitXSamples;
+        uint8_t                         m_u8ImplicitX;
+        uint8_t                         m_u8LogConversion;      //The Y data is stored after conversion
+        uint8_t                         m_u8PowerLogConversion;
+        uint8_t                         m_u8Padding;
+    };
+
+    //addDataBatch() without recording, for derived widgets passing on their own output
+    void                                ingestDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+
     //GUI Widgets
     QDoubleSpinBox                      *m_pSpanLengthDoubleSpinBox;
     QLabel                              *m_pSpanLengthLabel;
@@ -54,12 +84,40 @@ protected:
     double                              m_dPreviousOldestXSample;
     double                              m_dPreviousNewestXSample;
 
-    virtual void                        processXData(const QVector<float> &qvfXData, int64_t i64Timestamp_us = 0);
-    virtual void                        processYData(const QVector<QVector<float> > &qvvfXData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    //Uniform X sampling. The start of the implicit X is derived from the origin and the number of samples
+    //scrolled out so that it does not accumulate rounding error.
+    bool                                m_bUniformXSampling;
+    double                              m_dUniformXStep;
+    double                              m_dUniformXOrigin;
+    uint64_t                            m_u64NUniformXSamplesDropped;
+
+    void                                trimUniformXHistory(uint32_t u32NSamplesToKeep);
+
+    //processXData() in parts so that a batch of frames can be appended before trimming.
+    //beginXData() reads the sampling mode and resets the history if it has changed.
+    void                                beginXData(bool &bUniformXSampling, double &dUniformXStep);
+    void                                appendXData(const float *pfXData, uint32_t u32NSamples, bool bUniformXSampling, double dUniformXStep);
+    void                                trimXHistory(bool bUniformXSampling, double dUniformXStep);
+
+    //Drops the oldest Y samples so that each channel is as long as the X data, compacting the buffers when due
+    void                                trimYHistory();
+
+    //Removes the scrolled out samples from the front of the buffers (see m_u32HistoryStart)
+    void                                compactHistory();
+
+    virtual void                        processXData(const float *pfXData, uint32_t u32NSamples, int64_t i64Timestamp_us = 0);
+    virtual void                        processYData(const cPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
+    virtual bool                        processRawYData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us = 0, const QVector<uint32_t> &qvu32ChannelList = QVector<uint32_t>());
 
     virtual void                        logConversion();
     virtual void                        powerLogConversion();
 
+    virtual bool                        snapshotData(cPlotDataExport &oExport);
+
+    //The X and Y history. Restoring requires the same X sampling mode and log conversion as when the snapshot was taken.
+    virtual bool                        snapshotHistory(cHistorySnapshot &oSnapshot);
+    virtual bool                        restoreHistorySnapshot(const cHistorySnapshotReader &oReader);
+
 protected slots:
     virtual void                        slotUpdatePlotData();
     virtual void                        slotUpdateScalesAndLabels();
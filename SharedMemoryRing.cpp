@@ -0,0 +1,462 @@
+//System includes
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "SharedMemoryRing.h"
+#include "QwtPlotWidgetBase.h"
+
+using namespace std;
+
+cSharedMemoryRing::cSharedMemoryRing() :
+    m_bOwner(false),
+    m_pHeader(NULL),
+    m_u64MappingSize_B(0)
+{
+}
+
+cSharedMemoryRing::~cSharedMemoryRing()
+{
+    close();
+}
+
+bool cSharedMemoryRing::open(const QString &qstrName, bool bWrite, uint32_t u32NSlots, uint32_t u32NChannels, uint32_t u32NBins)
+{
+    close();
+
+#ifdef _WIN32
+    Q_UNUSED(qstrName);
+    Q_UNUSED(bWrite);
+    Q_UNUSED(u32NSlots);
+    Q_UNUSED(u32NChannels);
+    Q_UNUSED(u32NBins);
+
+    cout << "cSharedMemoryRing::open(): Error: POSIX shared memory is not available on this platform." << endl;
+    return false;
+#else
+    QByteArray qbaName = qstrName.toLocal8Bit();
+
+    int iFD = shm_open(qbaName.constData(), bWrite ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+
+    if(iFD < 0)
+    {
+        cout << "cSharedMemoryRing::open(): Error: Unable to open shared memory object " << qbaName.constData() << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    if(bWrite)
+    {
+        m_u64MappingSize_B = sizeof(cSharedMemoryRingHeader) + (uint64_t)u32NSlots * getSlotSize_B(u32NChannels, u32NBins);
+
+        if(ftruncate(iFD, m_u64MappingSize_B) < 0)
+        {
+            cout << "cSharedMemoryRing::open(): Error: Unable to size shared memory object " << qbaName.constData() << ": " << strerror(errno) << endl;
+            ::close(iFD);
+            shm_unlink(qbaName.constData());
+            return false;
+        }
+    }
+    else
+    {
+        struct stat oStat;
+
+        if(fstat(iFD, &oStat) < 0 || (uint64_t)oStat.st_size < sizeof(cSharedMemoryRingHeader))
+        {
+            cout << "cSharedMemoryRing::open(): Error: Shared memory object " << qbaName.constData() << " is too small for a ring header." << endl;
+            ::close(iFD);
+            return false;
+        }
+
+        m_u64MappingSize_B = oStat.st_size;
+    }
+
+    //The reader also maps read/write as the slot sequences are accessed atomically
+    void *pMapping = mmap(NULL, m_u64MappingSize_B, PROT_READ | PROT_WRITE, MAP_SHARED, iFD, 0);
+    ::close(iFD);
+
+    if(pMapping == MAP_FAILED)
+    {
+        cout << "cSharedMemoryRing::open(): Error: Unable to map shared memory object " << qbaName.constData() << ": " << strerror(errno) << endl;
+
+        if(bWrite)
+            shm_unlink(qbaName.constData());
+
+        return false;
+    }
+
+    m_pHeader = static_cast<cSharedMemoryRingHeader*>(pMapping);
+    m_qstrName = qstrName;
+    m_bOwner = bWrite;
+
+    if(bWrite)
+    {
+        memset(m_pHeader, 0, sizeof(cSharedMemoryRingHeader));
+        m_pHeader->m_u32HeaderSize_B = sizeof(cSharedMemoryRingHeader);
+        m_pHeader->m_u32NSlots = u32NSlots;
+        m_pHeader->m_u32SlotSize_B = getSlotSize_B(u32NChannels, u32NBins);
+        m_pHeader->m_u32NChannels = u32NChannels;
+        m_pHeader->m_u32NBins = u32NBins;
+        m_pHeader->m_u32Version = cSharedMemoryRingHeader::VERSION;
+
+        //Magic last so that a reader never sees a partially initialised header as valid
+        storeRelease(&m_pHeader->m_u32Magic, cSharedMemoryRingHeader::MAGIC);
+
+        return true;
+    }
+
+    //Validate the layout written by the other process
+    const cSharedMemoryRingHeader *pHeader = m_pHeader;
+
+    if(loadAcquire(&pHeader->m_u32Magic) != cSharedMemoryRingHeader::MAGIC || pHeader->m_u32Version != cSharedMemoryRingHeader::VERSION
+            || !pHeader->m_u32NSlots
+            || pHeader->m_u32SlotSize_B < getSlotSize_B(pHeader->m_u32NChannels, pHeader->m_u32NBins)
+            || pHeader->m_u32HeaderSize_B + (uint64_t)pHeader->m_u32NSlots * pHeader->m_u32SlotSize_B > m_u64MappingSize_B)
+    {
+        cout << "cSharedMemoryRing::open(): Error: Shared memory object " << qbaName.constData() << " does not contain a valid version "
+             << cSharedMemoryRingHeader::VERSION << " ring." << endl;
+        close();
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void cSharedMemoryRing::close()
+{
+#ifndef _WIN32
+    if(!m_pHeader)
+        return;
+
+    munmap(m_pHeader, m_u64MappingSize_B);
+
+    if(m_bOwner)
+        shm_unlink(m_qstrName.toLocal8Bit().constData());
+#endif
+
+    m_pHeader = NULL;
+    m_u64MappingSize_B = 0;
+    m_bOwner = false;
+}
+
+cSharedMemoryRingSlotHeader* cSharedMemoryRing::getSlot(uint64_t u64FrameNo) const
+{
+    uint8_t *pu8Base = reinterpret_cast<uint8_t*>(m_pHeader) + m_pHeader->m_u32HeaderSize_B;
+
+    return reinterpret_cast<cSharedMemoryRingSlotHeader*>(pu8Base + (u64FrameNo % m_pHeader->m_u32NSlots) * m_pHeader->m_u32SlotSize_B);
+}
+
+float* cSharedMemoryRing::getSlotData(cSharedMemoryRingSlotHeader *pSlot) const
+{
+    return reinterpret_cast<float*>(pSlot + 1);
+}
+
+//GCC and Clang (including MinGW) builtins, otherwise MSVC interlocked intrinsics, which are full barriers.
+//The 64 bit ones are atomic on 32 bit targets too.
+
+uint64_t cSharedMemoryRing::loadAcquire(const uint64_t *pu64Value)
+{
+#ifdef _MSC_VER
+    return _InterlockedCompareExchange64(reinterpret_cast<volatile __int64*>(const_cast<uint64_t*>(pu64Value)), 0, 0);
+#else
+    return __atomic_load_n(pu64Value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void cSharedMemoryRing::storeRelease(uint64_t *pu64Value, uint64_t u64Value)
+{
+#ifdef _MSC_VER
+    volatile __int64 *pi64Value = reinterpret_cast<volatile __int64*>(pu64Value);
+    __int64 i64Expected;
+
+    //No 64 bit exchange intrinsic on 32 bit targets
+    do
+    {
+        i64Expected = *pi64Value;
+    }
+    while(_InterlockedCompareExchange64(pi64Value, (__int64)u64Value, i64Expected) != i64Expected);
+#else
+    __atomic_store_n(pu64Value, u64Value, __ATOMIC_RELEASE);
+#endif
+}
+
+uint32_t cSharedMemoryRing::loadAcquire(const uint32_t *pu32Value)
+{
+#ifdef _MSC_VER
+    return _InterlockedCompareExchange(reinterpret_cast<volatile long*>(const_cast<uint32_t*>(pu32Value)), 0, 0);
+#else
+    return __atomic_load_n(pu32Value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void cSharedMemoryRing::storeRelease(uint32_t *pu32Value, uint32_t u32Value)
+{
+#ifdef _MSC_VER
+    _InterlockedExchange(reinterpret_cast<volatile long*>(pu32Value), (long)u32Value);
+#else
+    __atomic_store_n(pu32Value, u32Value, __ATOMIC_RELEASE);
+#endif
+}
+
+void cSharedMemoryRing::fenceAcquire()
+{
+#ifdef _MSC_VER
+    //Loads are not reordered with other loads on x86 so only the compiler needs holding back
+    _ReadWriteBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+uint32_t cSharedMemoryRing::getSlotSize_B(uint32_t u32NChannels, uint32_t u32NBins)
+{
+    uint64_t u64Size_B = sizeof(cSharedMemoryRingSlotHeader) + (uint64_t)u32NChannels * u32NBins * sizeof(float);
+
+    return (u64Size_B + 63) / 64 * 64;
+}
+
+cSharedMemoryRingWriter::cSharedMemoryRingWriter() :
+    m_u64NextFrameNo(0)
+{
+}
+
+bool cSharedMemoryRingWriter::create(const QString &qstrName, uint32_t u32NSlots, uint32_t u32NChannels, uint32_t u32NBins)
+{
+    m_u64NextFrameNo = 0;
+
+    return m_oRing.open(qstrName, true, u32NSlots, u32NChannels, u32NBins);
+}
+
+void cSharedMemoryRingWriter::destroy()
+{
+    m_oRing.close();
+}
+
+float* cSharedMemoryRingWriter::beginFrame()
+{
+    if(!m_oRing.isOpen())
+        return NULL;
+
+    cSharedMemoryRingSlotHeader *pSlot = m_oRing.getSlot(m_u64NextFrameNo);
+
+    cSharedMemoryRing::storeRelease(&pSlot->m_u64Sequence, 2 * m_u64NextFrameNo + 1);
+
+    return m_oRing.getSlotData(pSlot);
+}
+
+void cSharedMemoryRingWriter::commitFrame(int64_t i64Timestamp_us, uint32_t u32NChannels, uint32_t u32NBins)
+{
+    if(!m_oRing.isOpen())
+        return;
+
+    cSharedMemoryRingSlotHeader *pSlot = m_oRing.getSlot(m_u64NextFrameNo);
+
+    pSlot->m_i64Timestamp_us = i64Timestamp_us;
+    pSlot->m_u32NChannels = qMin(u32NChannels, m_oRing.getHeader()->m_u32NChannels);
+    pSlot->m_u32NBins = qMin(u32NBins, m_oRing.getHeader()->m_u32NBins);
+
+    cSharedMemoryRing::storeRelease(&pSlot->m_u64Sequence, 2 * m_u64NextFrameNo + 2);
+
+    m_u64NextFrameNo++;
+    cSharedMemoryRing::storeRelease(&m_oRing.getHeader()->m_u64WriteSequence, m_u64NextFrameNo);
+}
+
+void cSharedMemoryRingReader::cReaderThread::run()
+{
+    m_pReader->readerLoop();
+}
+
+cSharedMemoryRingReader::cSharedMemoryRingReader(uint32_t u32PollInterval_us, QObject *pParent) :
+    QObject(pParent),
+    m_u32PollInterval_us(u32PollInterval_us),
+    m_pReaderThread(NULL),
+    m_oiShutdown(0),
+    m_pTarget(NULL)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+}
+
+cSharedMemoryRingReader::~cSharedMemoryRingReader()
+{
+    detach();
+}
+
+bool cSharedMemoryRingReader::attach(const QString &qstrName)
+{
+    detach();
+
+    if(!m_oRing.open(qstrName, false))
+        return false;
+
+    const cSharedMemoryRingHeader *pHeader = m_oRing.getHeader();
+
+    cout << "cSharedMemoryRingReader::attach(): Attached to " << qstrName.toLocal8Bit().constData() << " with " << pHeader->m_u32NSlots << " slots of up to "
+         << pHeader->m_u32NChannels << " channels x " << pHeader->m_u32NBins << " bins." << endl;
+
+    m_oiShutdown.storeRelease(0);
+
+    m_pReaderThread = new cReaderThread(this);
+    m_pReaderThread->start();
+
+    return true;
+}
+
+void cSharedMemoryRingReader::detach()
+{
+    if(m_pReaderThread)
+    {
+        m_oiShutdown.storeRelease(1);
+
+        m_pReaderThread->wait();
+        delete m_pReaderThread;
+        m_pReaderThread = NULL;
+    }
+
+    m_oRing.close();
+}
+
+void cSharedMemoryRingReader::setTarget(cQwtPlotWidgetBase *pTarget)
+{
+    QMutexLocker oLock(&m_oTargetMutex);
+
+    m_pTarget = pTarget;
+}
+
+cSharedMemoryRingReader::cStats cSharedMemoryRingReader::getStats()
+{
+    QMutexLocker oLock(&m_oStatsMutex);
+
+    return m_oStats;
+}
+
+void cSharedMemoryRingReader::readerLoop()
+{
+    cSharedMemoryRingHeader *pHeader = m_oRing.getHeader();
+    uint32_t u32NSlots = pHeader->m_u32NSlots;
+
+    //Frames must fit the slot shape the ring was validated with
+    uint32_t u32MaxNChannels = pHeader->m_u32NChannels;
+    uint32_t u32MaxNBins = pHeader->m_u32NBins;
+    uint32_t u32SlotSize_B = pHeader->m_u32SlotSize_B;
+
+    //Batches are limited to half the ring so that the writer is unlikely to overwrite frames before they are copied
+    uint32_t u32MaxBatchFrames = qMax(u32NSlots / 2, (uint32_t)1);
+
+    uint64_t u64NextFrameNo = cSharedMemoryRing::loadAcquire(&pHeader->m_u64WriteSequence);
+
+    cPlotFrameBatch oBatch;
+    QVector<uint64_t> qvu64BatchFrameNos;
+
+    //Frames are copied out of the ring before use. One buffer per batch entry, reused from batch to batch.
+    QVector<QVector<float> > qvvfFrameCopies(u32MaxBatchFrames);
+
+    while(!m_oiShutdown.loadAcquire())
+    {
+        uint64_t u64WriteSequence = cSharedMemoryRing::loadAcquire(&pHeader->m_u64WriteSequence);
+
+        if(u64WriteSequence == u64NextFrameNo)
+        {
+            QThread::usleep(m_u32PollInterval_us);
+            continue;
+        }
+
+        uint64_t u64NOverrun = 0;
+
+        //The slot of the oldest retained frame may already be being rewritten with frame u64WriteSequence so start one after it
+        if(u64WriteSequence - u64NextFrameNo >= u32NSlots)
+        {
+            u64NOverrun = u64WriteSequence - u32NSlots + 1 - u64NextFrameNo;
+            u64NextFrameNo = u64WriteSequence - u32NSlots + 1;
+        }
+
+        uint64_t u64EndFrameNo = qMin(u64WriteSequence, u64NextFrameNo + u32MaxBatchFrames);
+        uint64_t u64NTorn = 0;
+        uint64_t u64NMalformed = 0;
+
+        oBatch.clear();
+        qvu64BatchFrameNos.resize(0);
+
+        for(uint64_t u64FrameNo = u64NextFrameNo; u64FrameNo < u64EndFrameNo; u64FrameNo++)
+        {
+            cSharedMemoryRingSlotHeader *pSlot = m_oRing.getSlot(u64FrameNo);
+
+            if(cSharedMemoryRing::loadAcquire(&pSlot->m_u64Sequence) != 2 * u64FrameNo + 2)
+            {
+                u64NTorn++;
+                continue;
+            }
+
+            //Read the shape once. It is written by the other process and must not be trusted beyond the bounds of the slot.
+            uint32_t u32NChannels = pSlot->m_u32NChannels;
+            uint32_t u32NBins = pSlot->m_u32NBins;
+
+            if(u32NChannels > u32MaxNChannels || u32NBins > u32MaxNBins || cSharedMemoryRing::getSlotSize_B(u32NChannels, u32NBins) > u32SlotSize_B)
+            {
+                u64NMalformed++;
+                continue;
+            }
+
+            QVector<float> &qvfFrameCopy = qvvfFrameCopies[qvu64BatchFrameNos.size()];
+            qvfFrameCopy.resize(u32NChannels * u32NBins);
+
+            int64_t i64Timestamp_us = pSlot->m_i64Timestamp_us;
+            memcpy(qvfFrameCopy.data(), m_oRing.getSlotData(pSlot), (size_t)u32NChannels * u32NBins * sizeof(float));
+
+            //Drop the copy if the writer has started on the slot again in the meantime
+            cSharedMemoryRing::fenceAcquire();
+
+            if(cSharedMemoryRing::loadAcquire(&pSlot->m_u64Sequence) != 2 * u64FrameNo + 2)
+            {
+                u64NTorn++;
+                continue;
+            }
+
+            oBatch.addFrame(cPlotFrameView(qvfFrameCopy.constData(), u32NChannels, u32NBins), i64Timestamp_us);
+            qvu64BatchFrameNos.push_back(u64FrameNo);
+        }
+
+        if(oBatch.getNFrames())
+        {
+            QMutexLocker oLock(&m_oTargetMutex);
+
+            if(m_pTarget)
+                m_pTarget->addDataBatch(oBatch, QVector<uint32_t>());
+        }
+
+        u64NextFrameNo = u64EndFrameNo;
+
+        {
+            QMutexLocker oLock(&m_oStatsMutex);
+
+            m_oStats.m_u64NFramesRead += qvu64BatchFrameNos.size();
+            m_oStats.m_u64NFramesOverrun += u64NOverrun;
+            m_oStats.m_u64NFramesTorn += u64NTorn;
+            m_oStats.m_u64NFramesMalformed += u64NMalformed;
+        }
+
+        if(u64NOverrun)
+        {
+            cout << "cSharedMemoryRingReader::readerLoop(): Warning: Reader overrun. Skipped " << u64NOverrun << " frames." << endl;
+        }
+
+        if(u64NMalformed)
+        {
+            cout << "cSharedMemoryRingReader::readerLoop(): Warning: Dropped " << u64NMalformed << " frames larger than the ring's slots." << endl;
+        }
+    }
+}
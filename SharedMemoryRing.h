@@ -0,0 +1,184 @@
+//Ingest of frames written by another process into a POSIX shared memory ring buffer.
+//
+//Layout of the shared memory object (native byte order, offsets in bytes):
+//
+//  0                   cSharedMemoryRingHeader (64 bytes)
+//  u32HeaderSize_B     slot 0
+//  + n * u32SlotSize_B slot n, for n in [0, u32NSlots)
+//
+//  Each slot is a cSharedMemoryRingSlotHeader (32 bytes) followed by u32NChannels * u32NBins float32 samples, channel-major.
+//  u32SlotSize_B is a multiple of 64 so that every slot's samples are cache line aligned.
+//
+//Protocol: frame n (counting from 0) is written to slot n % u32NSlots. The writer
+//  1. sets the slot's sequence to 2n + 1 (frame being written),
+//  2. writes the timestamp, shape and samples,
+//  3. sets the slot's sequence to 2n + 2 (frame complete), then
+//  4. sets the header's write sequence to n + 1.
+//Sequence stores are release stores and loads are acquire loads. The reader copies each frame out of its slot and rechecks the
+//slot's sequence before passing the copy to the widget, so a frame overwritten while being copied is dropped and counted as torn.
+//A reader that falls more than u32NSlots frames behind skips ahead and counts the skipped frames as overrun.
+//
+//cSharedMemoryRingWriter is a stand-in for the external acquisition process and the reference implementation of the writer side.
+
+#ifndef SHARED_MEMORY_RING_H
+#define SHARED_MEMORY_RING_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QString>
+
+//Local includes
+
+class cQwtPlotWidgetBase;
+
+struct cSharedMemoryRingHeader
+{
+    static const uint32_t               MAGIC = 0x42525051; //"QPRB" in little endian
+    static const uint32_t               VERSION = 1;
+
+    uint32_t                            m_u32Magic;
+    uint32_t                            m_u32Version;
+    uint32_t                            m_u32HeaderSize_B;
+    uint32_t                            m_u32NSlots;
+    uint32_t                            m_u32SlotSize_B;
+    uint32_t                            m_u32NChannels;     //Maximum per frame
+    uint32_t                            m_u32NBins;         //Maximum per channel
+    uint32_t                            m_u32Reserved;
+    uint64_t                            m_u64WriteSequence; //Number of frames committed
+    uint8_t                             m_au8Padding[24];
+};
+
+struct cSharedMemoryRingSlotHeader
+{
+    uint64_t                            m_u64Sequence;      //2n + 1 while frame n is being written, 2n + 2 once complete
+    int64_t                             m_i64Timestamp_us;
+    uint32_t                            m_u32NChannels;
+    uint32_t                            m_u32NBins;
+    uint8_t                             m_au8Padding[8];
+};
+
+class cSharedMemoryRing
+{
+public:
+    //Maps an existing (bWrite false) or new (bWrite true) shared memory object. Returns false on failure.
+    bool                                open(const QString &qstrName, bool bWrite, uint32_t u32NSlots = 0, uint32_t u32NChannels = 0, uint32_t u32NBins = 0);
+    void                                close();
+
+    cSharedMemoryRing();
+    ~cSharedMemoryRing();
+
+    bool                                isOpen() const {return m_pHeader != NULL;}
+
+    cSharedMemoryRingHeader*            getHeader() const {return m_pHeader;}
+    cSharedMemoryRingSlotHeader*        getSlot(uint64_t u64FrameNo) const;
+    float*                              getSlotData(cSharedMemoryRingSlotHeader *pSlot) const;
+
+    //Acquire / release access to the fields shared between processes
+    static uint64_t                     loadAcquire(const uint64_t *pu64Value);
+    static void                         storeRelease(uint64_t *pu64Value, uint64_t u64Value);
+    static uint32_t                     loadAcquire(const uint32_t *pu32Value);
+    static void                         storeRelease(uint32_t *pu32Value, uint32_t u32Value);
+
+    //Keeps the plain loads before it ahead of any load after it, as needed before rechecking a sequence
+    static void                         fenceAcquire();
+
+    static uint32_t                     getSlotSize_B(uint32_t u32NChannels, uint32_t u32NBins);
+
+private:
+    QString                             m_qstrName;
+    bool                                m_bOwner; //The writer creates and unlinks the object
+    cSharedMemoryRingHeader             *m_pHeader;
+    uint64_t                            m_u64MappingSize_B;
+};
+
+class cSharedMemoryRingWriter
+{
+public:
+    cSharedMemoryRingWriter();
+
+    bool                                create(const QString &qstrName, uint32_t u32NSlots, uint32_t u32NChannels, uint32_t u32NBins);
+    void                                destroy();
+
+    //Returns the sample buffer of the next slot to be filled in place (u32NChannels * u32NBins floats, channel-major)
+    float*                              beginFrame();
+    void                                commitFrame(int64_t i64Timestamp_us, uint32_t u32NChannels, uint32_t u32NBins);
+
+private:
+    cSharedMemoryRing                   m_oRing;
+    uint64_t                            m_u64NextFrameNo;
+};
+
+class cSharedMemoryRingReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NFramesRead;
+        uint64_t                        m_u64NFramesOverrun;    //Skipped because the reader fell too far behind
+        uint64_t                        m_u64NFramesTorn;       //Overwritten by the writer while being copied. Dropped.
+        uint64_t                        m_u64NFramesMalformed;  //Dropped for a shape exceeding the ring's channels, bins or slot size
+    };
+
+    //The reader polls the write sequence at u32PollInterval_us when idle. Frames available together are passed to the widget as one batch.
+    explicit cSharedMemoryRingReader(uint32_t u32PollInterval_us = 500, QObject *pParent = 0);
+    ~cSharedMemoryRingReader();
+
+    //Starts consuming from the newest frame of an existing ring
+    bool                                attach(const QString &qstrName);
+    void                                detach();
+
+    //Widget to pass frames to, called on the reader thread. Set to NULL before deleting the widget.
+    void                                setTarget(cQwtPlotWidgetBase *pTarget);
+
+    cStats                              getStats();
+
+private:
+    class cReaderThread : public QThread
+    {
+    public:
+        explicit cReaderThread(cSharedMemoryRingReader *pReader) : m_pReader(pReader) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cSharedMemoryRingReader         *m_pReader;
+    };
+
+    uint32_t                            m_u32PollInterval_us;
+
+    cSharedMemoryRing                   m_oRing;
+    cReaderThread                       *m_pReaderThread;
+    QAtomicInt                          m_oiShutdown;
+
+    QMutex                              m_oTargetMutex;
+    cQwtPlotWidgetBase                  *m_pTarget;
+
+    QMutex                              m_oStatsMutex;
+    cStats                              m_oStats;
+
+    void                                readerLoop();
+};
+
+#endif // SHARED_MEMORY_RING_H
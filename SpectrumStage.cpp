@@ -0,0 +1,155 @@
+//System includes
+#include <iostream>
+#include <cmath>
+
+//Library includes
+#include <QtConcurrentMap>
+
+//Local includes
+#include "SpectrumStage.h"
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+
+cSpectrumStage::cSpectrumStage() :
+    m_u32Window(WINDOW_HANN),
+    m_bWindowChanged(true),
+    m_fPowerScale(1.0f)
+{
+}
+
+void cSpectrumStage::setWindow(uint32_t u32Window)
+{
+    if(u32Window > WINDOW_BLACKMAN_HARRIS)
+    {
+        cout << "cSpectrumStage::setWindow(): Warning: Unknown window " << u32Window << ". Ignoring." << endl;
+        return;
+    }
+
+    QWriteLocker oLock(&m_oMutex);
+
+    m_u32Window = u32Window;
+    m_bWindowChanged = true;
+}
+
+uint32_t cSpectrumStage::getWindow()
+{
+    QReadLocker oLock(&m_oMutex);
+
+    return m_u32Window;
+}
+
+void cSpectrumStage::process(const cPlotFrameView &oTimeData, const QVector<uint32_t> &qvu32ChannelList, uint32_t u32NSamples, float *pfOutput)
+{
+    uint32_t u32NChannels = qvu32ChannelList.empty() ? oTimeData.getNChannels() : qvu32ChannelList.size();
+    uint32_t u32NBins = getNBins(u32NSamples);
+
+    //Replan only when the frame length or window changes
+    {
+        QWriteLocker oLock(&m_oMutex);
+
+        if(m_oFFT.getLength() != u32NSamples || m_bWindowChanged)
+        {
+            if(m_oFFT.getLength() != u32NSamples)
+                m_oFFT.setLength(u32NSamples);
+
+            updateWindow(m_u32Window, u32NSamples);
+            m_bWindowChanged = false;
+        }
+    }
+
+    if((uint32_t)m_qvoWorkspaces.size() < u32NChannels)
+        m_qvoWorkspaces.resize(u32NChannels);
+
+    m_qvoTasks.resize(u32NChannels);
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < u32NChannels; u32ChannelNo++)
+    {
+        uint32_t u32InputChannelNo = qvu32ChannelList.empty() ? u32ChannelNo : qvu32ChannelList[u32ChannelNo];
+
+        m_qvoTasks[u32ChannelNo].m_pStage = this;
+        m_qvoTasks[u32ChannelNo].m_pfInput = oTimeData.getChannel(u32InputChannelNo);
+        m_qvoTasks[u32ChannelNo].m_u32NInputSamples = oTimeData.getNBins(u32InputChannelNo);
+        m_qvoTasks[u32ChannelNo].m_pfOutput = pfOutput + (uint64_t)u32ChannelNo * u32NBins;
+        m_qvoTasks[u32ChannelNo].m_pWorkspace = &m_qvoWorkspaces[u32ChannelNo];
+    }
+
+    //Not worth the thread pool overhead for a single channel
+    if(u32NChannels == 1)
+        channelTask(m_qvoTasks[0]);
+    else
+        QtConcurrent::blockingMap(m_qvoTasks, &cSpectrumStage::channelTask);
+}
+
+void cSpectrumStage::channelTask(cChannelTask &oTask)
+{
+    const cSpectrumStage *pStage = oTask.m_pStage;
+
+    pStage->m_oFFT.powerSpectrum(oTask.m_pfInput, oTask.m_u32NInputSamples, pStage->m_qvfWindow.isEmpty() ? NULL : pStage->m_qvfWindow.constData(),
+                                 oTask.m_pfOutput, pStage->m_fPowerScale, *oTask.m_pWorkspace);
+}
+
+void cSpectrumStage::updateWindow(uint32_t u32Window, uint32_t u32NSamples)
+{
+    //Generalised cosine windows: w[n] = a0 - a1 cos(2 pi n / N) + a2 cos(4 pi n / N) - a3 cos(6 pi n / N) (periodic form for spectral analysis)
+    double dA0 = 1.0;
+    double dA1 = 0.0;
+    double dA2 = 0.0;
+    double dA3 = 0.0;
+
+    switch(u32Window)
+    {
+    case WINDOW_HANN:
+        dA0 = 0.5;
+        dA1 = 0.5;
+        break;
+
+    case WINDOW_HAMMING:
+        dA0 = 0.54;
+        dA1 = 0.46;
+        break;
+
+    case WINDOW_BLACKMAN:
+        dA0 = 0.42;
+        dA1 = 0.5;
+        dA2 = 0.08;
+        break;
+
+    case WINDOW_BLACKMAN_HARRIS:
+        dA0 = 0.35875;
+        dA1 = 0.48829;
+        dA2 = 0.14128;
+        dA3 = 0.01168;
+        break;
+
+    default:
+        break;
+    }
+
+    double dSum = 0.0;
+
+    if(u32Window == WINDOW_RECTANGULAR)
+    {
+        //No multiply needed
+        m_qvfWindow.clear();
+        dSum = u32NSamples;
+    }
+    else
+    {
+        m_qvfWindow.resize(u32NSamples);
+
+        for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+        {
+            double dPhase = 2.0 * PI * u32SampleNo / u32NSamples;
+
+            double dValue = dA0 - dA1 * cos(dPhase) + dA2 * cos(2.0 * dPhase) - dA3 * cos(3.0 * dPhase);
+
+            m_qvfWindow[u32SampleNo] = dValue;
+            dSum += dValue;
+        }
+    }
+
+    //Coherent gain normalisation
+    m_fPowerScale = dSum > 0.0 ? 1.0 / (dSum * dSum) : 1.0;
+}
@@ -0,0 +1,81 @@
+//Converts time domain frames to windowed power spectra for the framed plot widgets.
+//Channels are transformed in parallel on Qt's global thread pool, each with its own FFT workspace.
+
+#ifndef SPECTRUM_STAGE_H
+#define SPECTRUM_STAGE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+#include <QReadWriteLock>
+
+//Local includes
+#include "PlotFrame.h"
+#include "RealFFT.h"
+
+class cSpectrumStage
+{
+public:
+    //Window functions
+    static const uint32_t               WINDOW_RECTANGULAR = 0;
+    static const uint32_t               WINDOW_HANN = 1;
+    static const uint32_t               WINDOW_HAMMING = 2;
+    static const uint32_t               WINDOW_BLACKMAN = 3;
+    static const uint32_t               WINDOW_BLACKMAN_HARRIS = 4;
+
+    cSpectrumStage();
+
+    //Thread safe. Takes effect from the next frame.
+    void                                setWindow(uint32_t u32Window);
+    uint32_t                            getWindow();
+
+    //Number of spectral bins produced from frames of u32NSamples time domain samples
+    static uint32_t                     getNBins(uint32_t u32NSamples) {return u32NSamples / 2 + 1;}
+
+    //Writes the power spectra of the selected channels (all if the list is empty) channel-major to pfOutput, getNBins(u32NSamples) values per channel.
+    //Power is normalised by the window's coherent gain so that a sinusoid of amplitude A reads A^2 / 2 in its bin.
+    //Channels shorter than u32NSamples are zero padded.
+    void                                process(const cPlotFrameView &oTimeData, const QVector<uint32_t> &qvu32ChannelList, uint32_t u32NSamples, float *pfOutput);
+
+private:
+    struct cChannelTask
+    {
+        const cSpectrumStage            *m_pStage;
+        const float                     *m_pfInput;
+        uint32_t                        m_u32NInputSamples;
+        float                           *m_pfOutput;
+        cRealFFT::cWorkspace            *m_pWorkspace;
+    };
+
+    QReadWriteLock                      m_oMutex;
+    uint32_t                            m_u32Window;
+    bool                                m_bWindowChanged;
+
+    //Only accessed from the calling thread of process() and (read only) its tasks
+    cRealFFT                            m_oFFT;
+    QVector<float>                      m_qvfWindow;
+    float                               m_fPowerScale;
+    QVector<cRealFFT::cWorkspace>       m_qvoWorkspaces; //One per channel so that channels can be transformed concurrently
+    QVector<cChannelTask>               m_qvoTasks;
+
+    void                                updateWindow(uint32_t u32Window, uint32_t u32NSamples);
+
+    static void                         channelTask(cChannelTask &oTask);
+};
+
+#endif // SPECTRUM_STAGE_H
@@ -0,0 +1,131 @@
+//System includes
+#include <iostream>
+
+//Library includes
+
+//Local includes
+#include "StokesStage.h"
+
+using namespace std;
+
+cStokesStage::cStokesStage()
+{
+    m_qvu32Products.push_back(STOKES_I);
+    m_qvu32Products.push_back(STOKES_Q);
+    m_qvu32Products.push_back(STOKES_U);
+    m_qvu32Products.push_back(STOKES_V);
+}
+
+void cStokesStage::setProducts(const QVector<uint32_t> &qvu32Products)
+{
+    for(uint32_t u32ProductNo = 0; u32ProductNo < (uint32_t)qvu32Products.size(); u32ProductNo++)
+    {
+        if(qvu32Products[u32ProductNo] > POWER_AVERAGE)
+        {
+            cout << "cStokesStage::setProducts(): Warning: Unknown product " << qvu32Products[u32ProductNo] << ". Ignoring product list." << endl;
+            return;
+        }
+    }
+
+    QWriteLocker oLock(&m_oMutex);
+
+    m_qvu32Products = qvu32Products;
+}
+
+QVector<uint32_t> cStokesStage::getProducts()
+{
+    QReadLocker oLock(&m_oMutex);
+
+    return m_qvu32Products;
+}
+
+bool cStokesStage::isSigned(uint32_t u32Product)
+{
+    return u32Product == STOKES_Q || u32Product == STOKES_U || u32Product == STOKES_V;
+}
+
+void cStokesStage::process(const float *pfX, const float *pfY, uint32_t u32NBins, uint32_t u32BinStride, const QVector<uint32_t> &qvu32Products, float *pfOutput)
+{
+    //Auto and cross products for one block of bins
+    float afXX[BLOCK_SIZE];
+    float afYY[BLOCK_SIZE];
+    float afXYReal[BLOCK_SIZE];
+    float afXYImag[BLOCK_SIZE];
+
+    uint32_t u32Stride = 2 * u32BinStride;
+    uint32_t u32NProducts = qvu32Products.size();
+
+    for(uint32_t u32BlockStart = 0; u32BlockStart < u32NBins; u32BlockStart += BLOCK_SIZE)
+    {
+        uint32_t u32NBlockBins = u32NBins - u32BlockStart;
+
+        if(u32NBlockBins > BLOCK_SIZE)
+            u32NBlockBins = BLOCK_SIZE;
+
+        const float *pfXBlock = pfX + (uint64_t)u32BlockStart * u32Stride;
+        const float *pfYBlock = pfY + (uint64_t)u32BlockStart * u32Stride;
+
+        //Single pass over the input
+        for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+        {
+            float fXReal = pfXBlock[u32BinNo * u32Stride];
+            float fXImag = pfXBlock[u32BinNo * u32Stride + 1];
+            float fYReal = pfYBlock[u32BinNo * u32Stride];
+            float fYImag = pfYBlock[u32BinNo * u32Stride + 1];
+
+            afXX[u32BinNo] = fXReal * fXReal + fXImag * fXImag;
+            afYY[u32BinNo] = fYReal * fYReal + fYImag * fYImag;
+
+            //X Y*
+            afXYReal[u32BinNo] = fXReal * fYReal + fXImag * fYImag;
+            afXYImag[u32BinNo] = fXImag * fYReal - fXReal * fYImag;
+        }
+
+        //Each requested product directly into its output channel
+        for(uint32_t u32ProductNo = 0; u32ProductNo < u32NProducts; u32ProductNo++)
+        {
+            float *pfProduct = pfOutput + (uint64_t)u32ProductNo * u32NBins + u32BlockStart;
+
+            switch(qvu32Products[u32ProductNo])
+            {
+            case STOKES_I:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = afXX[u32BinNo] + afYY[u32BinNo];
+                break;
+
+            case STOKES_Q:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = afXX[u32BinNo] - afYY[u32BinNo];
+                break;
+
+            case STOKES_U:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = 2.0f * afXYReal[u32BinNo];
+                break;
+
+            case STOKES_V:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = -2.0f * afXYImag[u32BinNo];
+                break;
+
+            case POWER_XX:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = afXX[u32BinNo];
+                break;
+
+            case POWER_YY:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = afYY[u32BinNo];
+                break;
+
+            case POWER_AVERAGE:
+                for(uint32_t u32BinNo = 0; u32BinNo < u32NBlockBins; u32BinNo++)
+                    pfProduct[u32BinNo] = 0.5f * (afXX[u32BinNo] + afYY[u32BinNo]);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+}
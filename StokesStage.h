@@ -0,0 +1,66 @@
+//Computes Stokes parameters and polarisation powers from complex dual-polarisation (X, Y) spectra for the framed plot widgets.
+//The input is read once. Per bin auto and cross products are formed in small cache resident blocks from which each
+//requested product is written straight to its output channel.
+//Conventions: I = |X|^2 + |Y|^2, Q = |X|^2 - |Y|^2, U = 2 Re(X Y*), V = -2 Im(X Y*).
+//Q, U and V take either sign so have no dB value. The framed plots show them linear when log conversion is on.
+
+#ifndef STOKES_STAGE_H
+#define STOKES_STAGE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+#include <QReadWriteLock>
+
+//Local includes
+
+class cStokesStage
+{
+public:
+    //Products
+    static const uint32_t               STOKES_I = 0;
+    static const uint32_t               STOKES_Q = 1;
+    static const uint32_t               STOKES_U = 2;
+    static const uint32_t               STOKES_V = 3;
+    static const uint32_t               POWER_XX = 4;
+    static const uint32_t               POWER_YY = 5;
+    static const uint32_t               POWER_AVERAGE = 6; //(|X|^2 + |Y|^2) / 2
+
+    cStokesStage();
+
+    //Thread safe. Each product becomes one output channel in the order given. I, Q, U, V by default.
+    void                                setProducts(const QVector<uint32_t> &qvu32Products);
+    QVector<uint32_t>                   getProducts();
+
+    //pfX and pfY point to interleaved (re, im) spectra of u32NBins bins. Consecutive bins are u32BinStride complex values apart
+    //so that both separate polarisation arrays (stride 1) and per bin interleaved X, Y data (pfY = pfX + 2, stride 2) can be read in place.
+    //Output is channel-major, u32NBins values for each of qvu32Products.
+    static void                         process(const float *pfX, const float *pfY, uint32_t u32NBins, uint32_t u32BinStride,
+                                                const QVector<uint32_t> &qvu32Products, float *pfOutput);
+
+    //True for Q, U and V
+    static bool                         isSigned(uint32_t u32Product);
+
+private:
+    static const uint32_t               BLOCK_SIZE = 256;
+
+    QReadWriteLock                      m_oMutex;
+    QVector<uint32_t>                   m_qvu32Products;
+};
+
+#endif // STOKES_STAGE_H
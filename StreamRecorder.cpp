@@ -0,0 +1,452 @@
+//System includes
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "StreamRecorder.h"
+
+using namespace std;
+
+uint64_t cStreamRecorder::cPendingFrame::getSize_B() const
+{
+    return sizeof(cStreamRecordHeader) + ((uint64_t)m_qvu32ChannelList.size() + m_qvu32NBins.size() + m_qvfXData.size() + m_qvfYData.size()) * 4;
+}
+
+void cStreamRecorder::cWriterThread::run()
+{
+    m_pRecorder->writerLoop();
+}
+
+cStreamRecorder::cStreamRecorder(uint64_t u64MaxQueueSize_B, QObject *pParent) :
+    QObject(pParent),
+    m_u64MaxQueueSize_B(u64MaxQueueSize_B),
+    m_bCompress(false),
+    m_u32KeyFrameInterval(64),
+    m_bBlockWhenFull(false),
+    m_pWriterThread(NULL),
+    m_u64QueueSize_B(0),
+    m_u32FileNo(0),
+    m_bOpen(false),
+    m_bShutdown(false),
+    m_u32NFramesSinceKeyFrame(0)
+{
+    memset(&m_oStats, 0, sizeof(m_oStats));
+}
+
+cStreamRecorder::~cStreamRecorder()
+{
+    close();
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < (uint32_t)m_qvpSpareFrames.size(); u32FrameNo++)
+    {
+        delete m_qvpSpareFrames[u32FrameNo];
+    }
+}
+
+bool cStreamRecorder::open(const QString &qstrFilename, bool bCompress, uint32_t u32KeyFrameInterval, bool bBlockWhenFull)
+{
+    close();
+
+    m_oFile.setFileName(qstrFilename);
+
+    if(!m_oFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        cout << "cStreamRecorder::open(): Error: Unable to open " << qstrFilename.toStdString() << " for writing: "
+             << m_oFile.errorString().toStdString() << endl;
+        return false;
+    }
+
+    cStreamFileHeader oHeader;
+    memset(&oHeader, 0, sizeof(oHeader));
+    oHeader.m_u32Magic = cStreamFileHeader::MAGIC;
+    oHeader.m_u32Version = cStreamFileHeader::VERSION;
+    oHeader.m_u32HeaderSize_B = sizeof(cStreamFileHeader);
+    oHeader.m_u32RecordHeaderSize_B = sizeof(cStreamRecordHeader);
+
+    m_oFile.write(reinterpret_cast<const char*>(&oHeader), sizeof(oHeader));
+
+    m_bCompress = bCompress;
+    m_bBlockWhenFull = bBlockWhenFull;
+    m_u32KeyFrameInterval = qMax(u32KeyFrameInterval, (uint32_t)1);
+    m_u32NFramesSinceKeyFrame = m_u32KeyFrameInterval; //First frame is a key frame
+    m_qvu32PreviousYData.clear();
+
+    {
+        QMutexLocker oLock(&m_oQueueMutex);
+
+        //A frame being recorded as the last file closed may have been queued after its writer exited. It must not land in this file.
+        while(!m_qlpQueue.empty())
+        {
+            recycleFrame(m_qlpQueue.front());
+            m_qlpQueue.pop_front();
+        }
+
+        m_u64QueueSize_B = 0;
+        m_u32FileNo++;
+
+        memset(&m_oStats, 0, sizeof(m_oStats));
+        m_oStats.m_u64NBytesWritten = sizeof(oHeader);
+        m_bShutdown = false;
+        m_bOpen = true;
+    }
+
+    m_pWriterThread = new cWriterThread(this);
+    m_pWriterThread->start();
+
+    cout << "cStreamRecorder::open(): Recording to " << qstrFilename.toStdString() << (m_bCompress ? " with" : " without") << " compression." << endl;
+
+    return true;
+}
+
+void cStreamRecorder::close()
+{
+    if(!m_pWriterThread)
+        return;
+
+    {
+        QMutexLocker oLock(&m_oQueueMutex);
+
+        m_bOpen = false;
+        m_bShutdown = true;
+        m_oQueueCondition.wakeAll();
+        m_oQueueSpaceCondition.wakeAll();
+    }
+
+    //The writer drains the queue before exiting
+    m_pWriterThread->wait();
+    delete m_pWriterThread;
+    m_pWriterThread = NULL;
+
+    m_oFile.close();
+
+    cStats oStats = getStats();
+
+    cout << "cStreamRecorder::close(): Closed " << m_oFile.fileName().toStdString() << ". Recorded " << oStats.m_u64NFramesRecorded << " frames ("
+         << oStats.m_u64NBytesWritten << " bytes), dropped " << oStats.m_u64NFramesDropped << " frames." << endl;
+}
+
+bool cStreamRecorder::isOpen()
+{
+    QMutexLocker oLock(&m_oQueueMutex);
+
+    return m_bOpen;
+}
+
+cStreamRecorder::cPendingFrame* cStreamRecorder::takeSpareFrame(uint64_t u64Size_B)
+{
+    if(!m_bOpen)
+        return NULL;
+
+    if(m_bBlockWhenFull)
+    {
+        //A frame larger than the whole budget is still accepted once the queue has emptied
+        while(m_u64QueueSize_B && m_u64QueueSize_B + u64Size_B > m_u64MaxQueueSize_B)
+        {
+            m_oQueueSpaceCondition.wait(&m_oQueueMutex);
+
+            if(!m_bOpen)
+                return NULL;
+        }
+    }
+    else if(m_u64QueueSize_B + u64Size_B > m_u64MaxQueueSize_B)
+    {
+        m_oStats.m_u64NFramesDropped++;
+        return NULL;
+    }
+
+    m_u64QueueSize_B += u64Size_B;
+
+    if(m_qvpSpareFrames.empty())
+    {
+        cPendingFrame *pFrame = new cPendingFrame;
+        pFrame->m_u32FileNo = m_u32FileNo;
+
+        return pFrame;
+    }
+
+    cPendingFrame *pFrame = m_qvpSpareFrames.last();
+    m_qvpSpareFrames.pop_back();
+
+    pFrame->m_u32FileNo = m_u32FileNo;
+
+    return pFrame;
+}
+
+void cStreamRecorder::queueFrame(cPendingFrame *pFrame)
+{
+    QMutexLocker oLock(&m_oQueueMutex);
+
+    if(pFrame->m_u32FileNo != m_u32FileNo)
+    {
+        //Taken for an earlier file. Its space was already released when this one was opened.
+        recycleFrame(pFrame);
+        return;
+    }
+
+    if(!m_bOpen)
+    {
+        m_u64QueueSize_B -= pFrame->getSize_B();
+        m_oStats.m_u64NFramesDropped++;
+        recycleFrame(pFrame);
+        return;
+    }
+
+    m_qlpQueue.push_back(pFrame);
+    m_oQueueCondition.wakeOne();
+}
+
+void cStreamRecorder::recycleFrame(cPendingFrame *pFrame)
+{
+    //Keep a few frames' buffers for reuse
+    if(m_qvpSpareFrames.size() < 16)
+        m_qvpSpareFrames.push_back(pFrame);
+    else
+        delete pFrame;
+}
+
+void cStreamRecorder::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                  const QVector<uint32_t> &qvu32ChannelList)
+{
+    if(!pfXData)
+        u32NXSamples = 0;
+
+    uint32_t u32NYSamples = 0;
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < oYData.getNChannels(); u32ChannelNo++)
+    {
+        u32NYSamples += oYData.getNBins(u32ChannelNo);
+    }
+
+    cPendingFrame *pFrame;
+
+    {
+        QMutexLocker oLock(&m_oQueueMutex);
+
+        pFrame = takeSpareFrame(sizeof(cStreamRecordHeader) + ((uint64_t)qvu32ChannelList.size() + oYData.getNChannels() + u32NXSamples + u32NYSamples) * 4);
+    }
+
+    if(!pFrame)
+        return;
+
+    //The frame is owned by this thread until it is queued
+    pFrame->m_i64Timestamp_us = i64Timestamp_us;
+    pFrame->m_qvu32ChannelList = qvu32ChannelList;
+    pFrame->m_qvu32NBins.resize(oYData.getNChannels());
+    pFrame->m_qvfXData.resize(u32NXSamples);
+    pFrame->m_qvfYData.resize(u32NYSamples);
+
+    if(u32NXSamples)
+        copy(pfXData, pfXData + u32NXSamples, pFrame->m_qvfXData.data());
+
+    float *pfY = pFrame->m_qvfYData.data();
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < oYData.getNChannels(); u32ChannelNo++)
+    {
+        uint32_t u32NBins = oYData.getNBins(u32ChannelNo);
+
+        pFrame->m_qvu32NBins[u32ChannelNo] = u32NBins;
+        copy(oYData.getChannel(u32ChannelNo), oYData.getChannel(u32ChannelNo) + u32NBins, pfY);
+        pfY += u32NBins;
+    }
+
+    queueFrame(pFrame);
+}
+
+void cStreamRecorder::recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                  const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Raw samples are recorded as the converted (linear) values they produce
+    if(!pfXData)
+        u32NXSamples = 0;
+
+    uint32_t u32NYSamples = oYData.getNChannels() * oYData.getNBins();
+
+    cPendingFrame *pFrame;
+
+    {
+        QMutexLocker oLock(&m_oQueueMutex);
+
+        pFrame = takeSpareFrame(sizeof(cStreamRecordHeader) + ((uint64_t)qvu32ChannelList.size() + oYData.getNChannels() + u32NXSamples + u32NYSamples) * 4);
+    }
+
+    if(!pFrame)
+        return;
+
+    pFrame->m_i64Timestamp_us = i64Timestamp_us;
+    pFrame->m_qvu32ChannelList = qvu32ChannelList;
+    pFrame->m_qvu32NBins.fill(oYData.getNBins(), oYData.getNChannels());
+    pFrame->m_qvfXData.resize(u32NXSamples);
+    pFrame->m_qvfYData.resize(u32NYSamples);
+
+    if(u32NXSamples)
+        copy(pfXData, pfXData + u32NXSamples, pFrame->m_qvfXData.data());
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < oYData.getNChannels(); u32ChannelNo++)
+    {
+        oYData.convertChannel(u32ChannelNo, pFrame->m_qvfYData.data() + u32ChannelNo * oYData.getNBins());
+    }
+
+    queueFrame(pFrame);
+}
+
+void cStreamRecorder::recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    for(uint32_t u32FrameNo = 0; u32FrameNo < oBatch.getNFrames(); u32FrameNo++)
+    {
+        recordFrame(oBatch.getXData(u32FrameNo), oBatch.getNXSamples(u32FrameNo), oBatch.getFrame(u32FrameNo), oBatch.getTimestamp_us(u32FrameNo), qvu32ChannelList);
+    }
+}
+
+cStreamRecorder::cStats cStreamRecorder::getStats()
+{
+    QMutexLocker oLock(&m_oQueueMutex);
+
+    return m_oStats;
+}
+
+void cStreamRecorder::shuffle(const uint32_t *pu32Input, uint32_t u32NSamples, uint8_t *pu8Output)
+{
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+    {
+        uint32_t u32Value = pu32Input[u32SampleNo];
+
+        pu8Output[u32SampleNo] = u32Value & 0xff;
+        pu8Output[u32NSamples + u32SampleNo] = (u32Value >> 8) & 0xff;
+        pu8Output[2 * u32NSamples + u32SampleNo] = (u32Value >> 16) & 0xff;
+        pu8Output[3 * u32NSamples + u32SampleNo] = u32Value >> 24;
+    }
+}
+
+void cStreamRecorder::unshuffle(const uint8_t *pu8Input, uint32_t u32NSamples, uint32_t *pu32Output)
+{
+    for(uint32_t u32SampleNo = 0; u32SampleNo < u32NSamples; u32SampleNo++)
+    {
+        pu32Output[u32SampleNo] = (uint32_t)pu8Input[u32SampleNo]
+                | ((uint32_t)pu8Input[u32NSamples + u32SampleNo] << 8)
+                | ((uint32_t)pu8Input[2 * u32NSamples + u32SampleNo] << 16)
+                | ((uint32_t)pu8Input[3 * u32NSamples + u32SampleNo] << 24);
+    }
+}
+
+void cStreamRecorder::writerLoop()
+{
+    QMutexLocker oLock(&m_oQueueMutex);
+
+    while(true)
+    {
+        if(m_qlpQueue.empty())
+        {
+            if(m_bShutdown)
+                break;
+
+            m_oQueueCondition.wait(&m_oQueueMutex);
+            continue;
+        }
+
+        cPendingFrame *pFrame = m_qlpQueue.front();
+        m_qlpQueue.pop_front();
+
+        oLock.unlock();
+
+        writeFrame(*pFrame);
+
+        oLock.relock();
+
+        m_u64QueueSize_B -= pFrame->getSize_B();
+        m_oQueueSpaceCondition.wakeAll();
+        m_oStats.m_u64NFramesRecorded++;
+        m_oStats.m_u64NBytesWritten += m_qbaRecord.size();
+        m_oStats.m_u64NPayloadBytesIn += pFrame->m_qvfYData.size() * sizeof(float);
+
+        recycleFrame(pFrame);
+    }
+
+    oLock.unlock();
+
+    m_oFile.flush();
+}
+
+void cStreamRecorder::writeFrame(const cPendingFrame &oFrame)
+{
+    uint32_t u32NYSamples = oFrame.m_qvfYData.size();
+    const uint32_t *pu32YData = reinterpret_cast<const uint32_t*>(oFrame.m_qvfYData.constData());
+
+    cStreamRecordHeader oHeader;
+    memset(&oHeader, 0, sizeof(oHeader));
+    oHeader.m_u32Magic = cStreamRecordHeader::MAGIC;
+    oHeader.m_i64Timestamp_us = oFrame.m_i64Timestamp_us;
+    oHeader.m_u32NXSamples = oFrame.m_qvfXData.size();
+    oHeader.m_u32NChannelListEntries = oFrame.m_qvu32ChannelList.size();
+    oHeader.m_u32NChannels = oFrame.m_qvu32NBins.size();
+    oHeader.m_u32NYSamples = u32NYSamples;
+
+    QByteArray qbaCompressed;
+    const char *pcPayload;
+
+    if(m_bCompress)
+    {
+        //Delta against the previous frame unless a key frame is due or the frame size has changed
+        const uint32_t *pu32Source = pu32YData;
+
+        if(m_u32NFramesSinceKeyFrame < m_u32KeyFrameInterval && m_qvu32PreviousYData.size() == (int32_t)u32NYSamples)
+        {
+            m_qvu32DeltaYData.resize(u32NYSamples);
+
+            for(uint32_t u32SampleNo = 0; u32SampleNo < u32NYSamples; u32SampleNo++)
+            {
+                m_qvu32DeltaYData[u32SampleNo] = pu32YData[u32SampleNo] ^ m_qvu32PreviousYData[u32SampleNo];
+            }
+
+            pu32Source = m_qvu32DeltaYData.constData();
+            oHeader.m_u32Encoding = cStreamRecordHeader::ENCODING_DELTA_SHUFFLE_ZLIB;
+            m_u32NFramesSinceKeyFrame++;
+        }
+        else
+        {
+            oHeader.m_u32Encoding = cStreamRecordHeader::ENCODING_SHUFFLE_ZLIB;
+            m_u32NFramesSinceKeyFrame = 1;
+        }
+
+        m_qvu32PreviousYData.resize(u32NYSamples);
+        copy(pu32YData, pu32YData + u32NYSamples, m_qvu32PreviousYData.data());
+
+        m_qbaShuffled.resize(u32NYSamples * 4);
+        shuffle(pu32Source, u32NYSamples, reinterpret_cast<uint8_t*>(m_qbaShuffled.data()));
+
+        //Fastest level. The writer must keep up with ingest.
+        qbaCompressed = qCompress(m_qbaShuffled, 1);
+
+        pcPayload = qbaCompressed.constData();
+        oHeader.m_u32PayloadSize_B = qbaCompressed.size();
+    }
+    else
+    {
+        oHeader.m_u32Encoding = cStreamRecordHeader::ENCODING_RAW;
+        pcPayload = reinterpret_cast<const char*>(pu32YData);
+        oHeader.m_u32PayloadSize_B = u32NYSamples * 4;
+    }
+
+    uint32_t u32PaddedPayloadSize_B = (oHeader.m_u32PayloadSize_B + 3) / 4 * 4;
+
+    oHeader.m_u32RecordSize_B = sizeof(cStreamRecordHeader) + (oHeader.m_u32NChannelListEntries + oHeader.m_u32NChannels + oHeader.m_u32NXSamples) * 4
+            + u32PaddedPayloadSize_B;
+
+    //Assemble the record so that it is written with a single call
+    m_qbaRecord.resize(0);
+    m_qbaRecord.reserve(oHeader.m_u32RecordSize_B);
+    m_qbaRecord.append(reinterpret_cast<const char*>(&oHeader), sizeof(oHeader));
+    m_qbaRecord.append(reinterpret_cast<const char*>(oFrame.m_qvu32ChannelList.constData()), oHeader.m_u32NChannelListEntries * 4);
+    m_qbaRecord.append(reinterpret_cast<const char*>(oFrame.m_qvu32NBins.constData()), oHeader.m_u32NChannels * 4);
+    m_qbaRecord.append(reinterpret_cast<const char*>(oFrame.m_qvfXData.constData()), oHeader.m_u32NXSamples * 4);
+    m_qbaRecord.append(pcPayload, oHeader.m_u32PayloadSize_B);
+    m_qbaRecord.append(QByteArray(u32PaddedPayloadSize_B - oHeader.m_u32PayloadSize_B, '\0'));
+
+    if(m_oFile.write(m_qbaRecord) != m_qbaRecord.size())
+    {
+        cout << "cStreamRecorder::writeFrame(): Error: Write to " << m_oFile.fileName().toStdString() << " failed: " << m_oFile.errorString().toStdString() << endl;
+    }
+}
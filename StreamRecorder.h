@@ -0,0 +1,189 @@
+//Records every frame passed to a plot widget to an append-only binary file for later replay with cStreamReplayer.
+//The ingest thread only copies the frame into a pooled buffer and queues it. A writer thread encodes and writes it.
+//If the writer falls more than the queue budget behind, frames are dropped and counted rather than stalling ingest.
+//
+//File layout (native byte order, all sizes multiples of 4 bytes):
+//
+//  cStreamFileHeader (32 bytes)
+//  Any number of records, each:
+//      cStreamRecordHeader (48 bytes)
+//      u32 channel list [m_u32NChannelListEntries]
+//      u32 bins per channel [m_u32NChannels]
+//      float32 X data [m_u32NXSamples]
+//      Y payload [m_u32PayloadSize_B], zero padded to a multiple of 4 bytes
+//
+//The Y payload is the channels' float32 samples concatenated, either stored as is (ENCODING_RAW) or compressed losslessly:
+//the float bit patterns are XORed with those of the previous frame (ENCODING_DELTA_SHUFFLE_ZLIB, if it has the same number of
+//samples) or left as they are (ENCODING_SHUFFLE_ZLIB, key frames), byte shuffled (all first bytes, then all second bytes, ...)
+//and then zlib compressed with qCompress(). Slowly changing spectra compress well in this form.
+
+#ifndef STREAM_RECORDER_H
+#define STREAM_RECORDER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+
+//Local includes
+#include "PlotFrame.h"
+
+struct cStreamFileHeader
+{
+    static const uint32_t               MAGIC = 0x53525051; //"QPRS" in little endian
+    static const uint32_t               VERSION = 1;
+
+    uint32_t                            m_u32Magic;
+    uint32_t                            m_u32Version;
+    uint32_t                            m_u32HeaderSize_B;
+    uint32_t                            m_u32RecordHeaderSize_B;
+    uint8_t                             m_au8Padding[16];
+};
+
+struct cStreamRecordHeader
+{
+    static const uint32_t               MAGIC = 0x4D415246; //"FRAM" in little endian
+
+    static const uint32_t               ENCODING_RAW = 0;
+    static const uint32_t               ENCODING_SHUFFLE_ZLIB = 1;
+    static const uint32_t               ENCODING_DELTA_SHUFFLE_ZLIB = 2;
+
+    uint32_t                            m_u32Magic;
+    uint32_t                            m_u32RecordSize_B;          //Including this header
+    int64_t                             m_i64Timestamp_us;
+    uint32_t                            m_u32NXSamples;
+    uint32_t                            m_u32NChannelListEntries;
+    uint32_t                            m_u32NChannels;
+    uint32_t                            m_u32NYSamples;             //Summed over channels
+    uint32_t                            m_u32Encoding;
+    uint32_t                            m_u32PayloadSize_B;         //Without padding
+    uint8_t                             m_au8Padding[8];
+};
+
+class cStreamRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct cStats
+    {
+        uint64_t                        m_u64NFramesRecorded;
+        uint64_t                        m_u64NFramesDropped;    //Writer too far behind
+        uint64_t                        m_u64NBytesWritten;
+        uint64_t                        m_u64NPayloadBytesIn;   //Y data before compression
+    };
+
+    //Up to u64MaxQueueSize_B of frames may be waiting for the writer thread before frames are dropped
+    explicit cStreamRecorder(uint64_t u64MaxQueueSize_B = 64 * 1024 * 1024, QObject *pParent = 0);
+    ~cStreamRecorder();
+
+    //Truncates any existing file. A key frame is written every u32KeyFrameInterval frames when compressing.
+    //With bBlockWhenFull set, recording waits for the writer instead of dropping frames (for offline use such as dumps, not live ingest).
+    bool                                open(const QString &qstrFilename, bool bCompress = false, uint32_t u32KeyFrameInterval = 64, bool bBlockWhenFull = false);
+
+    //Writes any queued frames and closes the file
+    void                                close();
+
+    bool                                isOpen();
+
+    //Called by the widgets on their ingest thread
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordFrame(const float *pfXData, uint32_t u32NXSamples, const cRawPlotFrameView &oYData, int64_t i64Timestamp_us,
+                                                    const QVector<uint32_t> &qvu32ChannelList);
+    void                                recordBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList);
+
+    cStats                              getStats();
+
+    //Byte shuffling used by the compressed encodings, shared with the replayer
+    static void                         shuffle(const uint32_t *pu32Input, uint32_t u32NSamples, uint8_t *pu8Output);
+    static void                         unshuffle(const uint8_t *pu8Input, uint32_t u32NSamples, uint32_t *pu32Output);
+
+private:
+    class cWriterThread : public QThread
+    {
+    public:
+        explicit cWriterThread(cStreamRecorder *pRecorder) : m_pRecorder(pRecorder) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cStreamRecorder                 *m_pRecorder;
+    };
+
+    struct cPendingFrame
+    {
+        uint32_t                        m_u32FileNo; //Recording the frame was taken for
+        int64_t                         m_i64Timestamp_us;
+        QVector<uint32_t>               m_qvu32ChannelList;
+        QVector<uint32_t>               m_qvu32NBins;
+        QVector<float>                  m_qvfXData;
+        QVector<float>                  m_qvfYData; //Channels concatenated
+
+        uint64_t                        getSize_B() const;
+    };
+
+    uint64_t                            m_u64MaxQueueSize_B;
+
+    QFile                               m_oFile;
+    bool                                m_bCompress;
+    uint32_t                            m_u32KeyFrameInterval;
+    bool                                m_bBlockWhenFull;
+    cWriterThread                       *m_pWriterThread;
+
+    //Protected by m_oQueueMutex
+    QMutex                              m_oQueueMutex;
+    QWaitCondition                      m_oQueueCondition;
+    QWaitCondition                      m_oQueueSpaceCondition;
+    QList<cPendingFrame*>               m_qlpQueue;
+    QVector<cPendingFrame*>             m_qvpSpareFrames;
+    uint64_t                            m_u64QueueSize_B;
+    uint32_t                            m_u32FileNo; //Incremented by each open()
+    bool                                m_bOpen;
+    bool                                m_bShutdown;
+    cStats                              m_oStats;
+
+    //Writer thread only
+    QVector<uint32_t>                   m_qvu32PreviousYData;
+    QVector<uint32_t>                   m_qvu32DeltaYData;
+    QByteArray                          m_qbaShuffled;
+    QByteArray                          m_qbaRecord;
+    uint32_t                            m_u32NFramesSinceKeyFrame;
+
+    //Returns a frame to fill or NULL if the queue is full. Requires m_oQueueMutex.
+    cPendingFrame*                      takeSpareFrame(uint64_t u64Size_B);
+
+    //Drops the frame if the recording it was taken for has been closed in the meantime
+    void                                queueFrame(cPendingFrame *pFrame);
+
+    //Requires m_oQueueMutex
+    void                                recycleFrame(cPendingFrame *pFrame);
+
+    void                                writerLoop();
+    void                                writeFrame(const cPendingFrame &oFrame);
+};
+
+#endif // STREAM_RECORDER_H
@@ -0,0 +1,353 @@
+//System includes
+#include <iostream>
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+//Local includes
+#include "StreamReplayer.h"
+#include "QwtPlotWidgetBase.h"
+
+using namespace std;
+
+void cStreamReplayer::cReplayThread::run()
+{
+    m_pReplayer->replayLoop();
+}
+
+cStreamReplayer::cStreamReplayer(QObject *pParent) :
+    QObject(pParent),
+    m_pu8Mapping(NULL),
+    m_u64MappingSize_B(0),
+    m_pReplayThread(NULL),
+    m_dSpeed(1.0),
+    m_oiStop(0),
+    m_oiNFramesReplayed(0),
+    m_oiNFramesLate(0),
+    m_pTarget(NULL)
+{
+}
+
+cStreamReplayer::~cStreamReplayer()
+{
+    close();
+}
+
+bool cStreamReplayer::open(const QString &qstrFilename)
+{
+    close();
+
+    m_oFile.setFileName(qstrFilename);
+
+    if(!m_oFile.open(QIODevice::ReadOnly))
+    {
+        cout << "cStreamReplayer::open(): Error: Unable to open " << qstrFilename.toStdString() << ": " << m_oFile.errorString().toStdString() << endl;
+        return false;
+    }
+
+    m_u64MappingSize_B = m_oFile.size();
+
+    if(m_u64MappingSize_B < sizeof(cStreamFileHeader))
+    {
+        cout << "cStreamReplayer::open(): Error: " << qstrFilename.toStdString() << " is too short to be a recording." << endl;
+        close();
+        return false;
+    }
+
+    m_pu8Mapping = m_oFile.map(0, m_u64MappingSize_B);
+
+    if(!m_pu8Mapping)
+    {
+        cout << "cStreamReplayer::open(): Error: Unable to map " << qstrFilename.toStdString() << ": " << m_oFile.errorString().toStdString() << endl;
+        close();
+        return false;
+    }
+
+    const cStreamFileHeader *pFileHeader = reinterpret_cast<const cStreamFileHeader*>(m_pu8Mapping);
+
+    if(pFileHeader->m_u32Magic != cStreamFileHeader::MAGIC || pFileHeader->m_u32Version != cStreamFileHeader::VERSION
+            || pFileHeader->m_u32RecordHeaderSize_B != sizeof(cStreamRecordHeader))
+    {
+        cout << "cStreamReplayer::open(): Error: " << qstrFilename.toStdString() << " is not a version " << cStreamFileHeader::VERSION << " recording." << endl;
+        close();
+        return false;
+    }
+
+    //Index the records. Only the headers are read.
+    uint64_t u64Offset_B = pFileHeader->m_u32HeaderSize_B;
+
+    while(u64Offset_B + sizeof(cStreamRecordHeader) <= m_u64MappingSize_B)
+    {
+        const cStreamRecordHeader *pHeader = reinterpret_cast<const cStreamRecordHeader*>(m_pu8Mapping + u64Offset_B);
+
+        if(pHeader->m_u32Magic != cStreamRecordHeader::MAGIC || pHeader->m_u32RecordSize_B < sizeof(cStreamRecordHeader)
+                || pHeader->m_u32RecordSize_B % 4 || u64Offset_B + pHeader->m_u32RecordSize_B > m_u64MappingSize_B)
+            break;
+
+        m_qvu64RecordOffsets_B.push_back(u64Offset_B);
+        u64Offset_B += pHeader->m_u32RecordSize_B;
+    }
+
+    if(u64Offset_B != m_u64MappingSize_B)
+    {
+        //Typically the recorder did not close cleanly
+        cout << "cStreamReplayer::open(): Warning: Ignoring " << m_u64MappingSize_B - u64Offset_B << " bytes of incomplete or corrupt data at the end of "
+             << qstrFilename.toStdString() << endl;
+    }
+
+    cout << "cStreamReplayer::open(): Opened " << qstrFilename.toStdString() << " with " << m_qvu64RecordOffsets_B.size() << " frames spanning "
+         << getDuration_us() << " us." << endl;
+
+    return true;
+}
+
+void cStreamReplayer::close()
+{
+    stop();
+
+    if(m_pu8Mapping)
+        m_oFile.unmap(const_cast<uint8_t*>(m_pu8Mapping));
+
+    m_pu8Mapping = NULL;
+    m_u64MappingSize_B = 0;
+    m_oFile.close();
+
+    m_qvu64RecordOffsets_B.clear();
+}
+
+int64_t cStreamReplayer::getDuration_us() const
+{
+    if(m_qvu64RecordOffsets_B.empty())
+        return 0;
+
+    const cStreamRecordHeader *pFirst = reinterpret_cast<const cStreamRecordHeader*>(m_pu8Mapping + m_qvu64RecordOffsets_B.first());
+    const cStreamRecordHeader *pLast = reinterpret_cast<const cStreamRecordHeader*>(m_pu8Mapping + m_qvu64RecordOffsets_B.last());
+
+    return pLast->m_i64Timestamp_us - pFirst->m_i64Timestamp_us;
+}
+
+void cStreamReplayer::setTarget(cQwtPlotWidgetBase *pTarget)
+{
+    QMutexLocker oLock(&m_oTargetMutex);
+
+    m_pTarget = pTarget;
+}
+
+void cStreamReplayer::start(double dSpeed)
+{
+    stop();
+
+    if(m_qvu64RecordOffsets_B.empty())
+    {
+        cout << "cStreamReplayer::start(): Warning: No frames to replay." << endl;
+        return;
+    }
+
+    m_dSpeed = dSpeed;
+    m_oiStop.storeRelease(0);
+    m_oiNFramesReplayed.storeRelease(0);
+    m_oiNFramesLate.storeRelease(0);
+
+    m_pReplayThread = new cReplayThread(this);
+    m_pReplayThread->start();
+}
+
+void cStreamReplayer::stop()
+{
+    if(!m_pReplayThread)
+        return;
+
+    m_oiStop.storeRelease(1);
+
+    m_pReplayThread->wait();
+    delete m_pReplayThread;
+    m_pReplayThread = NULL;
+}
+
+bool cStreamReplayer::isRunning() const
+{
+    return m_pReplayThread && m_pReplayThread->isRunning();
+}
+
+uint32_t cStreamReplayer::getNFramesReplayed() const
+{
+    return m_oiNFramesReplayed.loadAcquire();
+}
+
+uint32_t cStreamReplayer::getNFramesLate() const
+{
+    return m_oiNFramesLate.loadAcquire();
+}
+
+void cStreamReplayer::replayLoop()
+{
+    int64_t i64FirstTimestamp_us = reinterpret_cast<const cStreamRecordHeader*>(m_pu8Mapping + m_qvu64RecordOffsets_B.first())->m_i64Timestamp_us;
+
+    cPlotFrameBatch oBatch;
+    QVector<uint32_t> qvu32ChannelList;
+
+    m_qvu32YData.clear();
+
+    QElapsedTimer oClock;
+    oClock.start();
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < (uint32_t)m_qvu64RecordOffsets_B.size(); u32FrameNo++)
+    {
+        if(m_oiStop.loadAcquire())
+            break;
+
+        const cStreamRecordHeader *pHeader = reinterpret_cast<const cStreamRecordHeader*>(m_pu8Mapping + m_qvu64RecordOffsets_B[u32FrameNo]);
+
+        if(m_dSpeed > 0.0)
+        {
+            int64_t i64Due_us = (pHeader->m_i64Timestamp_us - i64FirstTimestamp_us) / m_dSpeed;
+            int64_t i64Now_us = oClock.nsecsElapsed() / 1000;
+
+            //Sleep in short steps so that stop() is responsive
+            while(i64Now_us < i64Due_us && !m_oiStop.loadAcquire())
+            {
+                QThread::usleep(qMin(i64Due_us - i64Now_us, (int64_t)10000));
+                i64Now_us = oClock.nsecsElapsed() / 1000;
+            }
+
+            if(i64Now_us - i64Due_us > 10000)
+                m_oiNFramesLate.fetchAndAddRelaxed(1);
+        }
+
+        oBatch.clear();
+
+        if(!decodeRecord(m_qvu64RecordOffsets_B[u32FrameNo], oBatch, qvu32ChannelList))
+        {
+            cout << "cStreamReplayer::replayLoop(): Warning: Skipping corrupt frame " << u32FrameNo << endl;
+            continue;
+        }
+
+        {
+            QMutexLocker oLock(&m_oTargetMutex);
+
+            if(m_pTarget)
+                m_pTarget->addDataBatch(oBatch, qvu32ChannelList);
+        }
+
+        m_oiNFramesReplayed.fetchAndAddRelaxed(1);
+    }
+
+    sigReplayFinished();
+}
+
+bool cStreamReplayer::decodeRecord(uint64_t u64Offset_B, cPlotFrameBatch &oBatch, QVector<uint32_t> &qvu32ChannelList)
+{
+    const uint8_t *pu8Record = m_pu8Mapping + u64Offset_B;
+    const cStreamRecordHeader *pHeader = reinterpret_cast<const cStreamRecordHeader*>(pu8Record);
+
+    //Each count is widened before summing so that corrupt counts cannot wrap. Checking the offset against the record size also
+    //bounds the channel list, bin count and X arrays read below.
+    uint64_t u64PayloadOffset_B = sizeof(cStreamRecordHeader)
+            + ((uint64_t)pHeader->m_u32NChannelListEntries + (uint64_t)pHeader->m_u32NChannels + (uint64_t)pHeader->m_u32NXSamples) * 4;
+
+    if(u64PayloadOffset_B + pHeader->m_u32PayloadSize_B > pHeader->m_u32RecordSize_B)
+        return false;
+
+    //Everything in a record is 4 byte aligned so the arrays are used in place
+    const uint32_t *pu32ChannelList = reinterpret_cast<const uint32_t*>(pu8Record + sizeof(cStreamRecordHeader));
+    const uint32_t *pu32NBins = pu32ChannelList + pHeader->m_u32NChannelListEntries;
+    const float *pfXData = reinterpret_cast<const float*>(pu32NBins + pHeader->m_u32NChannels);
+    const uint8_t *pu8Payload = pu8Record + u64PayloadOffset_B;
+
+    uint64_t u64NYSamples = 0;
+    bool bEqualChannels = true;
+
+    for(uint32_t u32ChannelNo = 0; u32ChannelNo < pHeader->m_u32NChannels; u32ChannelNo++)
+    {
+        u64NYSamples += pu32NBins[u32ChannelNo];
+        bEqualChannels &= pu32NBins[u32ChannelNo] == pu32NBins[0];
+    }
+
+    if(u64NYSamples != pHeader->m_u32NYSamples)
+        return false;
+
+    uint32_t u32NYSamples = pHeader->m_u32NYSamples;
+    const float *pfYData;
+
+    switch(pHeader->m_u32Encoding)
+    {
+    case cStreamRecordHeader::ENCODING_RAW:
+    {
+        if(pHeader->m_u32PayloadSize_B != (uint64_t)u32NYSamples * 4)
+            return false;
+
+        pfYData = reinterpret_cast<const float*>(pu8Payload);
+        break;
+    }
+
+    case cStreamRecordHeader::ENCODING_SHUFFLE_ZLIB:
+    case cStreamRecordHeader::ENCODING_DELTA_SHUFFLE_ZLIB:
+    {
+        bool bDelta = pHeader->m_u32Encoding == cStreamRecordHeader::ENCODING_DELTA_SHUFFLE_ZLIB;
+
+        //A delta frame needs the preceding frame decoded (only not the case if replay started after a corrupt frame)
+        if(bDelta && m_qvu32YData.size() != (int32_t)u32NYSamples)
+            return false;
+
+        QByteArray qbaShuffled = qUncompress(pu8Payload, pHeader->m_u32PayloadSize_B);
+
+        if((uint64_t)qbaShuffled.size() != (uint64_t)u32NYSamples * 4)
+            return false;
+
+        const uint8_t *pu8Shuffled = reinterpret_cast<const uint8_t*>(qbaShuffled.constData());
+
+        if(bDelta)
+        {
+            uint32_t *pu32YData = m_qvu32YData.data();
+
+            for(uint32_t u32SampleNo = 0; u32SampleNo < u32NYSamples; u32SampleNo++)
+            {
+                pu32YData[u32SampleNo] ^= (uint32_t)pu8Shuffled[u32SampleNo]
+                        | ((uint32_t)pu8Shuffled[u32NYSamples + u32SampleNo] << 8)
+                        | ((uint32_t)pu8Shuffled[2 * u32NYSamples + u32SampleNo] << 16)
+                        | ((uint32_t)pu8Shuffled[3 * u32NYSamples + u32SampleNo] << 24);
+            }
+        }
+        else
+        {
+            m_qvu32YData.resize(u32NYSamples);
+            cStreamRecorder::unshuffle(pu8Shuffled, u32NYSamples, m_qvu32YData.data());
+        }
+
+        pfYData = reinterpret_cast<const float*>(m_qvu32YData.constData());
+        break;
+    }
+
+    default:
+        return false;
+    }
+
+    qvu32ChannelList.resize(pHeader->m_u32NChannelListEntries);
+    copy(pu32ChannelList, pu32ChannelList + pHeader->m_u32NChannelListEntries, qvu32ChannelList.data());
+
+    const float *pfX = pHeader->m_u32NXSamples ? pfXData : NULL;
+
+    if(bEqualChannels)
+    {
+        oBatch.addFrame(cPlotFrameView(pfYData, pHeader->m_u32NChannels, pHeader->m_u32NChannels ? pu32NBins[0] : 0), pHeader->m_i64Timestamp_us,
+                        pfX, pHeader->m_u32NXSamples);
+    }
+    else
+    {
+        //Channels of different lengths (from nested vector input) are rebuilt as nested vectors
+        m_qvvfUnequalChannels.resize(pHeader->m_u32NChannels);
+
+        for(uint32_t u32ChannelNo = 0; u32ChannelNo < pHeader->m_u32NChannels; u32ChannelNo++)
+        {
+            m_qvvfUnequalChannels[u32ChannelNo].resize(pu32NBins[u32ChannelNo]);
+            copy(pfYData, pfYData + pu32NBins[u32ChannelNo], m_qvvfUnequalChannels[u32ChannelNo].data());
+            pfYData += pu32NBins[u32ChannelNo];
+        }
+
+        oBatch.addFrame(cPlotFrameView(m_qvvfUnequalChannels), pHeader->m_i64Timestamp_us, pfX, pHeader->m_u32NXSamples);
+    }
+
+    return true;
+}
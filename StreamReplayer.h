@@ -0,0 +1,108 @@
+//Replays a file written by cStreamRecorder into a plot widget with the original timestamps.
+//The file is memory mapped and indexed by walking the record headers only, so opening is fast regardless of file size.
+//Uncompressed frames are passed to the widget straight from the mapping.
+//Frames are paced by their timestamps at a chosen speed (1 = real time) or passed on as fast as the widget accepts them (speed 0),
+//which makes recordings usable for reproducing performance problems and for regression runs.
+
+#ifndef STREAM_REPLAYER_H
+#define STREAM_REPLAYER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFile>
+#include <QVector>
+#include <QString>
+
+//Local includes
+#include "StreamRecorder.h"
+
+class cQwtPlotWidgetBase;
+
+class cStreamReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit cStreamReplayer(QObject *pParent = 0);
+    ~cStreamReplayer();
+
+    bool                                open(const QString &qstrFilename);
+    void                                close();
+
+    uint32_t                            getNFrames() const {return m_qvu64RecordOffsets_B.size();}
+    int64_t                             getDuration_us() const;
+
+    //Widget to pass frames to, called on the replay thread. Set to NULL before deleting the widget.
+    void                                setTarget(cQwtPlotWidgetBase *pTarget);
+
+    //Replays from the first frame. A speed of 0 or less replays as fast as possible.
+    void                                start(double dSpeed = 1.0);
+    void                                stop();
+
+    bool                                isRunning() const;
+    uint32_t                            getNFramesReplayed() const;
+
+    //Number of frames passed on later than their due time by more than 10 ms
+    uint32_t                            getNFramesLate() const;
+
+private:
+    class cReplayThread : public QThread
+    {
+    public:
+        explicit cReplayThread(cStreamReplayer *pReplayer) : m_pReplayer(pReplayer) {}
+
+    protected:
+        virtual void                    run();
+
+    private:
+        cStreamReplayer                 *m_pReplayer;
+    };
+
+    QFile                               m_oFile;
+    const uint8_t                       *m_pu8Mapping;
+    uint64_t                            m_u64MappingSize_B;
+
+    QVector<uint64_t>                   m_qvu64RecordOffsets_B;
+
+    cReplayThread                       *m_pReplayThread;
+    double                              m_dSpeed;
+    QAtomicInt                          m_oiStop;
+    QAtomicInt                          m_oiNFramesReplayed;
+    QAtomicInt                          m_oiNFramesLate;
+
+    QMutex                              m_oTargetMutex;
+    cQwtPlotWidgetBase                  *m_pTarget;
+
+    //Replay thread only
+    QVector<uint32_t>                   m_qvu32YData; //Decoded payload, also the reference for the next delta frame
+    QVector<QVector<float> >            m_qvvfUnequalChannels;
+
+    void                                replayLoop();
+
+    //Returns false if the record is corrupt
+    bool                                decodeRecord(uint64_t u64Offset_B, cPlotFrameBatch &oBatch, QVector<uint32_t> &qvu32ChannelList);
+
+signals:
+    void                                sigReplayFinished();
+};
+
+#endif // STREAM_REPLAYER_H
@@ -1,23 +1,19 @@
 //System includes
 #include <iostream>
-#include <cmath>
-#include <cfloat>
-#include <algorithm>
 
 //Library includes
 
 //Local includes
 #include "WaterfallPlotSpectromgramData.h"
+#include "PlotKernels.h"
 #include "AVNUtilLibs/Timestamp/Timestamp.h"
 
 using namespace std;
 
 cWaterfallPlotSpectromgramData::cWaterfallPlotSpectromgramData() :
-    m_u32NextFrameIndex(0),
-    m_u32NRows(0),
-    m_u32NColumns(0),
     m_bDoLogConversion(false),
-    m_bDoPowerLogConversion(false)
+    m_bDoPowerLogConversion(false),
+    m_oMutex(QReadWriteLock::Recursive) //addFrame() may resize via setDimensions() and setInterval()
 {
 }
 
@@ -28,6 +24,9 @@ double cWaterfallPlotSpectromgramData::value( double dX, double dY ) const
     const QwtInterval oXInterval = interval( Qt::XAxis );
     const QwtInterval oYInterval = interval( Qt::YAxis );
 
+    uint32_t u32NRows = m_oRowBuffer.getNRows();
+    uint32_t u32NColumns = m_oRowBuffer.getNColumns();
+
     //cout << "interval = " << (dY - oYInterval.minValue()) / m_dDeltaY << endl;
 
     uint32_t ui32Row = uint32_t( (dY - oYInterval.minValue() ) / m_dDeltaY ) + 1; //+1 Removes wrapped line at the top of waterfall plot which should be at the bottom
@@ -38,172 +37,161 @@ double cWaterfallPlotSpectromgramData::value( double dX, double dY ) const
     // maximum is requested. Instead we return the value
     // from the last row/col
 
-    if ( ui32Row >= m_u32NRows )
-        ui32Row = m_u32NRows - 1;
+    if ( ui32Row >= u32NRows )
+        ui32Row = u32NRows - 1;
+
+    if ( ui32Col >= u32NColumns )
+        ui32Col = u32NColumns - 1;
 
-    if ( ui32Col >= m_u32NColumns )
-        ui32Col = m_u32NColumns - 1;
+    //Rows of the buffer are chronological from the oldest. Undo the +1 above.
+    float fValue = m_oRowBuffer.getRow(ui32Row + u32NRows - 1)[ui32Col];
 
     if(m_bDoLogConversion)
-        return 10.0 * log10(m_qvvfCircularBuffer[unwrapCircularBufferIndex(ui32Row)][ui32Col] + 0.001);
+        return cPlotKernels::toDecibels(fValue, 10.0);
 
     if(m_bDoPowerLogConversion)
-        return 20.0 * log10(m_qvvfCircularBuffer[unwrapCircularBufferIndex(ui32Row)][ui32Col] + 0.001);
+        return cPlotKernels::toDecibels(fValue, 20.0);
 
-    return m_qvvfCircularBuffer[unwrapCircularBufferIndex(ui32Row)][ui32Col];
+    return fValue;
 }
 
 void cWaterfallPlotSpectromgramData::setInterval( Qt::Axis eAxis, const QwtInterval &oInterval)
 {
+    QWriteLocker oLock(&m_oMutex);
+
     QwtRasterData::setInterval( eAxis, oInterval );
     update();
 }
 
 void cWaterfallPlotSpectromgramData::addFrame(const QVector<float> &qvfNewFrame, int64_t i64Timestamp_us)
 {
-    //Check that the spectrogram is the right width. Update as necessary
-    if(qvfNewFrame.size() != m_qvvfCircularBuffer[0].size())
-    {
-        setDimensions(qvfNewFrame.size(), m_qvvfCircularBuffer.size());
-    }
+    QWriteLocker oLock(&m_oMutex);
 
-    //Copy the data into the next index
-    std::copy(qvfNewFrame.begin(), qvfNewFrame.end(), m_qvvfCircularBuffer[m_u32NextFrameIndex].begin());
+    m_oRowBuffer.addRow(qvfNewFrame, i64Timestamp_us);
 
-    //Copy the timestamp into the corresponding index
-    m_qvi64Timestamps[m_u32NextFrameIndex] = i64Timestamp_us;
+    setInterval(Qt::YAxis, getTimeInterval_s());
+}
 
-    //Increment the next
-    m_u32NextFrameIndex++;
+void cWaterfallPlotSpectromgramData::setDimensions(uint32_t u32X, uint32_t u32Y, int64_t i64LatestTime_us, int64_t i64Span_us)
+{
+    QWriteLocker oLock(&m_oMutex);
 
-    //Unwrap the next index as necessary
-    if(m_u32NextFrameIndex >= (uint32_t)m_qvvfCircularBuffer.size())
-    {
-        m_u32NextFrameIndex = 0;
-    }
+    m_oRowBuffer.setDimensions(u32X, u32Y, i64LatestTime_us, i64Span_us);
+}
 
-    setInterval(Qt::YAxis, QwtInterval(getMinTime_us() / 1e6, getMaxTime_us() / 1e6));
+uint32_t cWaterfallPlotSpectromgramData::getNColumns()
+{
+    return m_oRowBuffer.getNColumns();
 }
 
-void cWaterfallPlotSpectromgramData::setDimensions(uint32_t u32X, uint32_t u32Y, int64_t i64LatestTime_us, int64_t i64Span_us)
+uint32_t cWaterfallPlotSpectromgramData::getNRows()
 {
-    m_qvvfCircularBuffer.resize(u32Y);
+    QReadLocker oLock(&m_oMutex);
 
-    for(uint32_t ui = 0; ui < (uint32_t)m_qvvfCircularBuffer.size(); ui++)
-    {
-        m_qvvfCircularBuffer[ui].resize(u32X);
-    }
+    return m_oRowBuffer.getNRows();
+}
 
-    m_qvi64Timestamps.resize(u32Y);
+void cWaterfallPlotSpectromgramData::setNRows(uint32_t u32NRows)
+{
+    QWriteLocker oLock(&m_oMutex);
 
-    m_u32NColumns = u32X;
-    m_u32NRows = u32Y;
+    if(!u32NRows || u32NRows == m_oRowBuffer.getNRows() || !m_oRowBuffer.getNRows())
+        return;
 
-    //Optionally back-populate timestamps for a sensical plot timescale on plot initialisation
-    //This will create timestamps from (LatestTime - Span) to LatestTime
+    m_oRowBuffer.setNRows(u32NRows);
 
-    if(i64LatestTime_us)
-    {
-        for(uint32_t u32Index = 0; u32Index < (uint32_t)m_qvi64Timestamps.size(); u32Index++)
-        {
-            m_qvi64Timestamps[unwrapCircularBufferIndex(u32Index)] = i64LatestTime_us - (m_qvi64Timestamps.size() - 1 - u32Index) * i64Span_us / m_u32NRows;
-        }
-    }
+    setInterval(Qt::YAxis, getTimeInterval_s());
 }
 
-uint32_t cWaterfallPlotSpectromgramData::getNColumns()
+void cWaterfallPlotSpectromgramData::getHistory(QVector< QVector<float> > &qvvfRows, QVector<int64_t> &qvi64Timestamps_us) const
 {
-    return m_u32NColumns;
+    QReadLocker oLock(&m_oMutex);
+
+    m_oRowBuffer.getHistory(qvvfRows, qvi64Timestamps_us);
 }
 
-uint32_t cWaterfallPlotSpectromgramData::getNRows()
+void cWaterfallPlotSpectromgramData::setHistory(const QVector< QVector<float> > &qvvfRows, const QVector<int64_t> &qvi64Timestamps_us)
 {
-    return m_u32NRows;
+    QWriteLocker oLock(&m_oMutex);
+
+    if(qvvfRows.isEmpty() || qvvfRows.size() != qvi64Timestamps_us.size())
+        return;
+
+    m_oRowBuffer.setHistory(qvvfRows, qvi64Timestamps_us);
+
+    setInterval(Qt::YAxis, getTimeInterval_s());
 }
 
+cWaterfallPlotSpectromgramData* cWaterfallPlotSpectromgramData::clone() const
+{
+    QReadLocker oLock(&m_oMutex);
+
+    cWaterfallPlotSpectromgramData *pClone = new cWaterfallPlotSpectromgramData;
+
+    pClone->m_oRowBuffer = m_oRowBuffer;
+    pClone->m_bDoLogConversion = m_bDoLogConversion;
+    pClone->m_bDoPowerLogConversion = m_bDoPowerLogConversion;
+
+    pClone->setInterval(Qt::XAxis, interval(Qt::XAxis));
+    pClone->setInterval(Qt::YAxis, interval(Qt::YAxis));
+    pClone->setInterval(Qt::ZAxis, interval(Qt::ZAxis));
+
+    return pClone;
+}
 
 void cWaterfallPlotSpectromgramData::update()
 {
-    if(!m_qvvfCircularBuffer.size())
+    if(!m_oRowBuffer.getNRows())
         return;
 
     const QwtInterval oXInterval = interval( Qt::XAxis );
     const QwtInterval oYInterval = interval( Qt::YAxis );
 
     if ( oXInterval.isValid() )
-        m_dDeltaX = oXInterval.width() / m_u32NColumns;
+        m_dDeltaX = oXInterval.width() / m_oRowBuffer.getNColumns();
     if ( oYInterval.isValid() )
-        m_dDeltaY = oYInterval.width() / m_u32NRows;
+        m_dDeltaY = oYInterval.width() / m_oRowBuffer.getNRows();
 }
 
 int64_t cWaterfallPlotSpectromgramData::getMaxTime_us() const
 {
-    int32_t i32Index = m_u32NextFrameIndex - 1;
-
-    if(i32Index == -1)
-        i32Index = m_u32NRows - 1;
+    QReadLocker oLock(&m_oMutex);
 
-    return m_qvi64Timestamps[i32Index];
+    return m_oRowBuffer.getMaxTime_us();
 }
 
 int64_t cWaterfallPlotSpectromgramData::getMinTime_us() const
 {
-    return m_qvi64Timestamps[m_u32NextFrameIndex];
+    QReadLocker oLock(&m_oMutex);
+
+    return m_oRowBuffer.getMinTime_us();
 }
 
-uint32_t cWaterfallPlotSpectromgramData::unwrapCircularBufferIndex(uint32_t u32LinearIndex) const
+QwtInterval cWaterfallPlotSpectromgramData::getTimeInterval_s() const
 {
-    //Unwrap circular buffer:
-    int32_t i32ActualIndex = (int32_t)u32LinearIndex + (int32_t)m_u32NextFrameIndex - 1;
-
-    if(i32ActualIndex >= (int32_t)m_u32NRows)
-        i32ActualIndex -= m_u32NRows;
+    //Must not take the lock: Qt does not allow a read lock to be taken by a thread already holding the write lock.
 
-    if(i32ActualIndex < 0 )
-        i32ActualIndex += m_u32NRows;
-
-    return i32ActualIndex;
+    return QwtInterval(m_oRowBuffer.getMinTime_us() / 1e6, m_oRowBuffer.getMaxTime_us() / 1e6);
 }
 
 void cWaterfallPlotSpectromgramData::getZMinMaxValue(double &dZMin, double &dZMax) const
 {
-    double dZMaxTmp = -DBL_MAX;
-    double dZMinTmp = DBL_MAX;
-
-    for(uint32_t u32Y = 0; u32Y < (uint32_t)m_qvvfCircularBuffer.size(); u32Y++)
-    {
-        for(uint32_t u32X = 0; u32X < (uint32_t)m_qvvfCircularBuffer[u32Y].size(); u32X++)
-        {
-            if(m_qvvfCircularBuffer[u32Y][u32X] > dZMaxTmp)
-                dZMaxTmp = m_qvvfCircularBuffer[u32Y][u32X];
-
-            if(m_qvvfCircularBuffer[u32Y][u32X] < dZMinTmp)
-                dZMinTmp = m_qvvfCircularBuffer[u32Y][u32X];
-        }
-    }
+    QReadLocker oLock(&m_oMutex);
 
-    dZMax = dZMaxTmp;
-    dZMin = dZMinTmp;
+    m_oRowBuffer.getMinMaxValue(dZMin, dZMax);
 }
 
 double cWaterfallPlotSpectromgramData::getMedian() const
 {
-    //Create vector and copy all amplitudes into it
-    std::vector<float> vfAllAmplitudes(m_u32NRows * m_u32NColumns);
-
-    for(uint32_t u32Y = 0; u32Y < m_u32NRows; u32Y++)
-    {
-        memcpy(&vfAllAmplitudes[u32Y * m_u32NColumns], &m_qvvfCircularBuffer[u32Y][0], sizeof(float) * m_u32NColumns);
-    }
-
-    std::partial_sort(vfAllAmplitudes.begin(), vfAllAmplitudes.begin() + m_u32NRows * m_u32NColumns / 2 + 1, vfAllAmplitudes.end());
+    QReadLocker oLock(&m_oMutex);
 
-    //Return median as linear amplitude
-    return vfAllAmplitudes[m_u32NRows * m_u32NColumns / 2];
+    return m_oRowBuffer.getMedian();
 }
 
 void cWaterfallPlotSpectromgramData::enableLogConversion(bool bEnable)
 {
+    QWriteLocker oLock(&m_oMutex);
+
     m_bDoLogConversion = bEnable;
 
     if(m_bDoLogConversion)
@@ -212,9 +200,16 @@ void cWaterfallPlotSpectromgramData::enableLogConversion(bool bEnable)
 
 void cWaterfallPlotSpectromgramData::enablePowerLogConversion(bool bEnable)
 {
+    QWriteLocker oLock(&m_oMutex);
+
     m_bDoPowerLogConversion = bEnable;
 
     if(m_bDoPowerLogConversion)
         m_bDoLogConversion = false;
 }
 
+
+QReadWriteLock* cWaterfallPlotSpectromgramData::getMutex() const
+{
+    return &m_oMutex;
+}
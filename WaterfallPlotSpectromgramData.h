@@ -18,10 +18,13 @@ typedef unsigned __int64 uint64_t;
 #endif
 
 //Library includes
+#include <QReadWriteLock>
 #include <qwt_raster_data.h>
 
 //Local includes
+#include "WaterfallRowBuffer.h"
 
+//Qwt raster data over a cWaterfallRowBuffer. Adds the X and time axes, log conversion of values and locking for rendering from other threads.
 class cWaterfallPlotSpectromgramData : public QwtRasterData
 {
 public:
@@ -35,6 +38,17 @@ public:
     uint32_t                    getNColumns();
     uint32_t                    getNRows();
 
+    //Changes the number of rows while keeping the history. Rows are averaged together when shrinking and repeated when growing.
+    void                        setNRows(uint32_t u32NRows);
+
+    //History in chronological order for checkpoints. getHistory() returns shallow copies of the rows.
+    //setHistory() replaces the buffer and its dimensions. All rows must be the same length.
+    void                        getHistory(QVector< QVector<float> > &qvvfRows, QVector<int64_t> &qvi64Timestamps_us) const;
+    void                        setHistory(const QVector< QVector<float> > &qvvfRows, const QVector<int64_t> &qvi64Timestamps_us);
+
+    //A copy sharing the rows implicitly, for rendering on another thread while this one continues to take frames
+    cWaterfallPlotSpectromgramData* clone() const;
+
     int64_t                     getMinTime_us() const;
     int64_t                     getMaxTime_us() const;
 
@@ -44,14 +58,11 @@ public:
     void                        enableLogConversion(bool bEnable);
     void                        enablePowerLogConversion(bool bEnable);
 
-private:
-    QVector< QVector<float> >   m_qvvfCircularBuffer;
-    QVector<int64_t>            m_qvi64Timestamps;
+    //Held for read while rendering from another thread. All mutators lock for write.
+    QReadWriteLock*             getMutex() const;
 
-    uint32_t                    m_u32NextFrameIndex;
-
-    uint32_t                    m_u32NRows;
-    uint32_t                    m_u32NColumns;
+private:
+    cWaterfallRowBuffer         m_oRowBuffer;
 
     double                      m_dDeltaX;
     double                      m_dDeltaY;
@@ -59,9 +70,12 @@ private:
     bool                        m_bDoLogConversion;
     bool                        m_bDoPowerLogConversion;
 
+    mutable QReadWriteLock      m_oMutex;
+
     void                        update();
 
-    uint32_t                    unwrapCircularBufferIndex(uint32_t u32LinearIndex) const;
+    //Unlocked time range of the buffer in seconds for use by mutators already holding the write lock
+    QwtInterval                 getTimeInterval_s() const;
 };
 
 #endif // CWATERFALLPLOTSPECTROMGRAMDATA_H
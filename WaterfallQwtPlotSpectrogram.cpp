@@ -0,0 +1,34 @@
+//System includes
+
+//Library includes
+
+//Local includes
+#include "WaterfallQwtPlotSpectrogram.h"
+
+cWaterfallQwtPlotSpectrogram::cWaterfallQwtPlotSpectrogram(const QString &qstrTitle, uint32_t u32NRenderThreads) :
+    QwtPlotSpectrogram(qstrTitle),
+    m_pRasteriser(new cWaterfallTileRasteriser(u32NRenderThreads))
+{
+}
+
+cWaterfallQwtPlotSpectrogram::~cWaterfallQwtPlotSpectrogram()
+{
+    //Stops and joins the render threads. This must happen before the base class deletes the raster data.
+    delete m_pRasteriser;
+}
+
+cWaterfallTileRasteriser* cWaterfallQwtPlotSpectrogram::getRasteriser()
+{
+    return m_pRasteriser;
+}
+
+QImage cWaterfallQwtPlotSpectrogram::renderImage(const QwtScaleMap &oXMap, const QwtScaleMap &oYMap, const QRectF &oArea, const QSize &oImageSize) const
+{
+    const cWaterfallPlotSpectromgramData *pData = dynamic_cast<const cWaterfallPlotSpectromgramData*>(data());
+
+    //Only our own raster data type is thread safe for background rendering. Otherwise fall back to Qwt's implementation
+    if(!pData)
+        return QwtPlotSpectrogram::renderImage(oXMap, oYMap, oArea, oImageSize);
+
+    return m_pRasteriser->renderImage(pData, colorMap(), oXMap, oYMap, oArea, oImageSize);
+}
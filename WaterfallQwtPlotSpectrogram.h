@@ -0,0 +1,34 @@
+//A QwtPlotSpectrogram which delegates image rendering to cWaterfallTileRasteriser instead of
+//Qwt's per-paint QtConcurrent strip rendering.
+
+#ifndef WATERFALL_QWT_PLOT_SPECTROGRAM_H
+#define WATERFALL_QWT_PLOT_SPECTROGRAM_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <qwt_plot_spectrogram.h>
+
+//Local includes
+#include "WaterfallTileRasteriser.h"
+
+class cWaterfallQwtPlotSpectrogram : public QwtPlotSpectrogram
+{
+public:
+    explicit cWaterfallQwtPlotSpectrogram(const QString &qstrTitle = QString(), uint32_t u32NRenderThreads = 0);
+    virtual ~cWaterfallQwtPlotSpectrogram();
+
+    cWaterfallTileRasteriser*           getRasteriser();
+
+protected:
+    virtual QImage                      renderImage(const QwtScaleMap &oXMap, const QwtScaleMap &oYMap, const QRectF &oArea, const QSize &oImageSize) const;
+
+    cWaterfallTileRasteriser            *m_pRasteriser;
+};
+
+#endif // WATERFALL_QWT_PLOT_SPECTROGRAM_H
@@ -17,11 +17,15 @@ using namespace std;
 
 cWaterfallQwtPlotWidget::cWaterfallQwtPlotWidget(uint32_t u32ChannelNo, const QString &qstrChannelName, QWidget *pParent) :
     cQwtPlotWidgetBase(pParent),
-    m_u32AverageCount(0),
     m_pTimeScaleDraw(new cWallTimeQwtScaleDraw),
     m_u32ChannelNo(u32ChannelNo),
     m_qstrChannelName(qstrChannelName),
-    m_bAutoscaleValid(false)
+    m_qvu32ChannelList(1, u32ChannelNo),
+    m_qvu32RecordedChannelList(1, 0),
+    m_bAutoscaleValid(false),
+    m_bAdaptiveRowCount(false),
+    m_dRowsPerPixel(1.0),
+    m_i64RowInterval_us(0)
 {
     //Additional controls to the waterfall widget
     m_pIntensityFloorLabel = new QLabel(QString("Intensity floor"), this);
@@ -51,24 +55,15 @@ cWaterfallQwtPlotWidget::cWaterfallQwtPlotWidget(uint32_t u32ChannelNo, const QS
     insertWidgetIntoControlFrame(m_pTimeSpanSpinBox_s, 10, true);
 
     //Constructs for waterfall plots
-    m_pPlotSpectrogram = new QwtPlotSpectrogram;
+    //Rendering is done by a persistent pool of tile rendering threads (sized automatically to the available hardware)
+    m_pPlotSpectrogram = new cWaterfallQwtPlotSpectrogram;
     m_pSpectrogramData = new cWaterfallPlotSpectromgramData;
 
-    //Automatic assign plot rendering threads based on available hardware
-    m_pPlotSpectrogram->setRenderThreadCount(0);
-
     //Setup the colorMap for the spectrogram
-    QwtLinearColorMap *pColourMap = new QwtLinearColorMap(Qt::darkCyan, Qt::red);
-    pColourMap->addColorStop(0.25, Qt::cyan);
-    pColourMap->addColorStop(0.5, Qt::green);
-    pColourMap->addColorStop(0.75, Qt::yellow);
-    m_pPlotSpectrogram->setColorMap(pColourMap);
+    m_pPlotSpectrogram->setColorMap(createColourMap());
 
     //Setup the right axis (colour bar)
-    m_pColourMap = new QwtLinearColorMap(Qt::darkCyan, Qt::red);
-    m_pColourMap->addColorStop(0.25, Qt::cyan);
-    m_pColourMap->addColorStop(0.5, Qt::green);
-    m_pColourMap->addColorStop(0.75, Qt::yellow);
+    m_pColourMap = createColourMap();
 
     m_pUI->qwtPlot->enableAxis(QwtPlot::yRight);
     m_pUI->qwtPlot->axisWidget(QwtPlot::yRight)->setColorBarEnabled(true);
@@ -86,6 +81,7 @@ cWaterfallQwtPlotWidget::cWaterfallQwtPlotWidget(uint32_t u32ChannelNo, const QS
 
     //The last 2 arguments here back populate timestamps so that the plots starts up with logical values on the timescale
     m_pSpectrogramData->setDimensions(0, 200, AVN::getTimeNow_us(), m_pTimeSpanSpinBox_s->value() * 1000000);
+    updateRowInterval();
 
     //Offset width of colour bar in right hand plot spacing
     m_pUI->qwtPlot->axisScaleDraw(QwtPlot::yRight)->setMinimumExtent(m_pUI->qwtPlot->axisScaleDraw(QwtPlot::yRight)->minimumExtent()
@@ -96,8 +92,16 @@ cWaterfallQwtPlotWidget::cWaterfallQwtPlotWidget(uint32_t u32ChannelNo, const QS
     m_pUI->qwtPlot->setAxisScaleDraw(QwtPlot::yLeft, m_pTimeScaleDraw);
 
     QObject::connect(this, SIGNAL(sigUpdateData()), this, SLOT(slotUpdateData()), Qt::QueuedConnection);
+    QObject::connect(m_pPlotSpectrogram->getRasteriser(), SIGNAL(sigTilesAvailable()), this, SLOT(slotRasterTilesAvailable()), Qt::QueuedConnection);
     QObject::connect(m_pIntensityFloorSpinBox, SIGNAL(valueChanged(double)), this, SLOT(slotIntensityFloorChanged(double)) );
     QObject::connect(m_pIntensityCeilingSpinBox, SIGNAL(valueChanged(double)), this, SLOT(slotIntensityCeilingChanged(double)) );
+    QObject::connect(m_pTimeSpanSpinBox_s, SIGNAL(valueChanged(int)), this, SLOT(slotTimeSpanChanged(int)) );
+
+    //Watch the canvas for resizes for the adaptive row count
+    m_oRowCountTimer.setSingleShot(true);
+    m_oRowCountTimer.setInterval(200);
+    QObject::connect(&m_oRowCountTimer, SIGNAL(timeout()), this, SLOT(slotApplyAdaptiveRowCount()));
+    m_pUI->qwtPlot->canvas()->installEventFilter(this);
 
     strobeAutoscale();
 }
@@ -122,45 +126,141 @@ void cWaterfallQwtPlotWidget::setZUnit(const QString &qstrZUnit)
 
 void cWaterfallQwtPlotWidget::addData(const QVector<float> &qvfYData, int64_t i64Timestamp_us)
 {
-    if(m_qvfAverage.size() != qvfYData.size())
-    {
-        m_qvfAverage.resize(qvfYData.size());
+    addData(qvfYData.constData(), qvfYData.size(), i64Timestamp_us);
+}
 
-        //Reset the avarage if the vector length has changed
-        for(uint32_t ui = 0; ui < (uint32_t)m_qvfAverage.size(); ui++)
-        {
-            m_qvfAverage[ui] = 0.0f;
-        }
-        m_u32AverageCount = 0;
+void cWaterfallQwtPlotWidget::addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us)
+{
+    if(m_u32ChannelNo >= oYData.getNChannels())
+    {
+        cout << "cWaterfallQwtPlotWidget::addData(): Warning: Channel " << m_u32ChannelNo << " not present in frame of "
+             << oYData.getNChannels() << " channels. Ignoring." << endl;
+        return;
     }
 
-    //Accumulate
-    for(uint32_t ui = 0; ui < (uint32_t)m_qvfAverage.size(); ui++)
+    addData(oYData.getChannel(m_u32ChannelNo), oYData.getNBins(m_u32ChannelNo), i64Timestamp_us);
+}
+
+void cWaterfallQwtPlotWidget::addData(const float *pfYData, uint32_t u32NBins, int64_t i64Timestamp_us)
+{
+    recordFrame(NULL, 0, cPlotFrameView(pfYData, 1, u32NBins), i64Timestamp_us, m_qvu32RecordedChannelList);
+
+    accumulateFrame(pfYData, u32NBins);
+
+    addRowIfDue(i64Timestamp_us, u32NBins);
+}
+
+void cWaterfallQwtPlotWidget::addData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us)
+{
+    if(m_u32ChannelNo >= oYData.getNChannels())
     {
-        m_qvfAverage[ui] += qvfYData[ui];
+        cout << "cWaterfallQwtPlotWidget::addData(): Warning: Channel " << m_u32ChannelNo << " not present in frame of "
+             << oYData.getNChannels() << " channels. Ignoring." << endl;
+        return;
     }
-    m_u32AverageCount++;
+
+    //The whole frame is recorded as it cannot be split without converting it
+    recordFrame(NULL, 0, oYData, i64Timestamp_us, m_qvu32ChannelList);
+
+    m_oRowAveragingStage.accumulate(oYData, m_u32ChannelNo);
+
+    addRowIfDue(i64Timestamp_us, oYData.getNBins());
+}
+
+void cWaterfallQwtPlotWidget::addRowIfDue(int64_t i64Timestamp_us, uint32_t u32NBins)
+{
+    checkpointHistoryIfDue();
 
     //Use span as per set in the GUI to determine how long to average for before adding a new line.
     //Essentially number of rows * average time per row = span time
-    if( i64Timestamp_us - m_pSpectrogramData->getMaxTime_us() < (int64_t)m_pTimeSpanSpinBox_s->value() * 1000000 / m_pSpectrogramData->getNRows() )
+    if( i64Timestamp_us - m_pSpectrogramData->getMaxTime_us() < getRowInterval_us() )
     {
         return;
     }
 
-    //When it is time for a new line use the average
-    for(uint32_t ui = 0; ui < (uint32_t)m_qvfAverage.size(); ui++)
-    {
-        m_qvfAverage[ui] /= m_u32AverageCount;
-    }
-    m_pSpectrogramData->addFrame(m_qvfAverage, i64Timestamp_us);
+    addAveragedRow(i64Timestamp_us);
 
-    //Reset the average
-    for(uint32_t ui = 0; ui < (uint32_t)m_qvfAverage.size(); ui++)
+    rowsAdded(u32NBins);
+}
+
+void cWaterfallQwtPlotWidget::addDataBatch(const cPlotFrameBatch &oBatch)
+{
+    addDataBatch(oBatch, m_u32ChannelNo);
+}
+
+void cWaterfallQwtPlotWidget::addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList)
+{
+    //Frames recorded by a waterfall list the one channel it used. Those of line plots (normally none) are assumed to hold all channels.
+    addDataBatch(oBatch, qvu32ChannelList.empty() ? m_u32ChannelNo : qvu32ChannelList[0]);
+}
+
+void cWaterfallQwtPlotWidget::addDataBatch(const cPlotFrameBatch &oBatch, uint32_t u32InputChannelNo)
+{
+    //Rows due during the batch are added as they fall due but the render and GUI are only updated once at the end
+    int64_t i64RowInterval_us = getRowInterval_us();
+    uint32_t u32NBins = 0;
+    bool bRowsAdded = false;
+
+    for(uint32_t u32FrameNo = 0; u32FrameNo < oBatch.getNFrames(); u32FrameNo++)
     {
-        m_qvfAverage[ui] = 0.0f;
+        const cPlotFrameView &oFrame = oBatch.getFrame(u32FrameNo);
+
+        if(u32InputChannelNo >= oFrame.getNChannels())
+            continue;
+
+        u32NBins = oFrame.getNBins(u32InputChannelNo);
+
+        recordFrame(NULL, 0, cPlotFrameView(oFrame.getChannel(u32InputChannelNo), 1, u32NBins), oBatch.getTimestamp_us(u32FrameNo), m_qvu32RecordedChannelList);
+
+        accumulateFrame(oFrame.getChannel(u32InputChannelNo), u32NBins);
+
+        if(oBatch.getTimestamp_us(u32FrameNo) - m_pSpectrogramData->getMaxTime_us() < i64RowInterval_us)
+            continue;
+
+        addAveragedRow(oBatch.getTimestamp_us(u32FrameNo));
+        bRowsAdded = true;
     }
-    m_u32AverageCount = 0;
+
+    if(bRowsAdded)
+        rowsAdded(u32NBins);
+
+    checkpointHistoryIfDue();
+}
+
+int64_t cWaterfallQwtPlotWidget::getRowInterval_us()
+{
+    QReadLocker oLock(&m_oMutex);
+
+    return m_i64RowInterval_us;
+}
+
+void cWaterfallQwtPlotWidget::updateRowInterval()
+{
+    //The spin box may only be read on the GUI thread so ingest uses this copy
+    int64_t i64RowInterval_us = (int64_t)m_pTimeSpanSpinBox_s->value() * 1000000 / qMax(m_pSpectrogramData->getNRows(), (uint32_t)1);
+
+    QWriteLocker oLock(&m_oMutex);
+
+    m_i64RowInterval_us = i64RowInterval_us;
+}
+
+void cWaterfallQwtPlotWidget::accumulateFrame(const float *pfYData, uint32_t u32NBins)
+{
+    m_oRowAveragingStage.accumulate(pfYData, u32NBins);
+}
+
+void cWaterfallQwtPlotWidget::addAveragedRow(int64_t i64Timestamp_us)
+{
+    //When it is time for a new line use the average
+    m_oRowAveragingStage.takeAverage(m_qvfAveragedRow);
+
+    m_pSpectrogramData->addFrame(m_qvfAveragedRow, i64Timestamp_us);
+}
+
+void cWaterfallQwtPlotWidget::rowsAdded(uint32_t u32NBins)
+{
+    //Have the rasteriser pick up the new rows once its current job completes
+    m_pPlotSpectrogram->getRasteriser()->invalidate();
 
     //Calculate the min and max plotting range of the spectrogram data
     float fMedian = m_pSpectrogramData->getMedian();
@@ -208,14 +308,184 @@ void cWaterfallQwtPlotWidget::addData(const QVector<float> &qvfYData, int64_t i6
     {
         sigUpdateData();
 
-        autoUpdateXScaleBase( qvfYData.size() );
+        autoUpdateXScaleBase( u32NBins );
+    }
+}
+
+bool cWaterfallQwtPlotWidget::snapshotHistory(cHistorySnapshot &oSnapshot)
+{
+    QVector<QVector<float> > qvvfRows;
+    QVector<int64_t> qvi64Timestamps_us;
+
+    m_pSpectrogramData->getHistory(qvvfRows, qvi64Timestamps_us);
+
+    oSnapshot.addRows(SNAPSHOT_WATERFALL_ROWS, qvvfRows);
+    oSnapshot.addVector(SNAPSHOT_WATERFALL_TIMESTAMPS, qvi64Timestamps_us);
+    oSnapshot.addVector(SNAPSHOT_WATERFALL_AVERAGE, m_oRowAveragingStage.getSum());
+    oSnapshot.addValue(SNAPSHOT_WATERFALL_AVERAGE_COUNT, m_oRowAveragingStage.getNFrames());
+
+    return true;
+}
+
+bool cWaterfallQwtPlotWidget::snapshotData(cPlotDataExport &oExport)
+{
+    QVector<QVector<float> > qvvfRows;
+    QVector<int64_t> qvi64Timestamps_us;
+
+    //Oldest row first. Shallow copies of the rows.
+    m_pSpectrogramData->getHistory(qvvfRows, qvi64Timestamps_us);
+
+    if(qvvfRows.isEmpty())
+        return false;
+
+    //Bins span the X interval evenly. Each is labelled with its centre.
+    QwtInterval oXInterval = m_pSpectrogramData->interval(Qt::XAxis);
+    double dBinWidth = qvvfRows[0].isEmpty() ? 0.0 : oXInterval.width() / qvvfRows[0].size();
+
+    oExport.addAttribute(QString("x_label"), m_qstrXLabel);
+    oExport.addAttribute(QString("x_unit"), m_qstrXUnit);
+    oExport.addAttribute(QString("channel"), QString::number(m_u32ChannelNo));
+
+    oExport.addVector(QString("timestamp_us"), qvi64Timestamps_us);
+    oExport.addRows(QString("intensity"), qvvfRows, oXInterval.minValue() + dBinWidth / 2.0, dBinWidth);
+
+    return true;
+}
+
+bool cWaterfallQwtPlotWidget::snapshotDisplayedData(cPlotDataExport &oExport)
+{
+    //The row history is read under the spectrogram data's own lock so it may be taken on the GUI thread as well
+    return snapshotData(oExport);
+}
+
+bool cWaterfallQwtPlotWidget::restoreHistorySnapshot(const cHistorySnapshotReader &oReader)
+{
+    QVector<QVector<float> > qvvfRows;
+    QVector<int64_t> qvi64Timestamps_us;
+    QVector<float> qvfAverage;
+    uint32_t u32AverageCount;
+
+    if(!oReader.getRows(SNAPSHOT_WATERFALL_ROWS, qvvfRows) || !oReader.getVector(SNAPSHOT_WATERFALL_TIMESTAMPS, qvi64Timestamps_us)
+            || !oReader.getVector(SNAPSHOT_WATERFALL_AVERAGE, qvfAverage) || !oReader.getValue(SNAPSHOT_WATERFALL_AVERAGE_COUNT, u32AverageCount))
+    {
+        cout << "cWaterfallQwtPlotWidget::restoreHistorySnapshot(): Warning: Snapshot is incomplete." << endl;
+        return false;
     }
+
+    if(qvvfRows.isEmpty() || qvvfRows.size() != qvi64Timestamps_us.size())
+    {
+        cout << "cWaterfallQwtPlotWidget::restoreHistorySnapshot(): Warning: Snapshot has " << qvvfRows.size() << " rows and "
+             << qvi64Timestamps_us.size() << " timestamps." << endl;
+        return false;
+    }
+
+    for(uint32_t u32Row = 1; u32Row < (uint32_t)qvvfRows.size(); u32Row++)
+    {
+        if(qvvfRows[u32Row].size() != qvvfRows[0].size())
+        {
+            cout << "cWaterfallQwtPlotWidget::restoreHistorySnapshot(): Warning: Snapshot rows differ in length." << endl;
+            return false;
+        }
+    }
+
+    //Replaces the back populated timestamps of the empty plot. Keep the current row count so that the row interval is as configured.
+    uint32_t u32NRows = m_pSpectrogramData->getNRows();
+
+    m_pSpectrogramData->setHistory(qvvfRows, qvi64Timestamps_us);
+    m_pSpectrogramData->setNRows(u32NRows);
+
+    m_oRowAveragingStage.restore(qvfAverage, u32AverageCount);
+
+    //Z range, render and GUI update as for new rows
+    rowsAdded(m_pSpectrogramData->getNColumns());
+
+    return true;
+}
+
+void cWaterfallQwtPlotWidget::addItemsToRenderSnapshot(cPlotRenderSnapshot &oSnapshot)
+{
+    //Drawn by Qwt's own raster rendering as the tile rasteriser only keeps an image for the geometry on screen
+    QwtPlotSpectrogram *pSpectrogram = new QwtPlotSpectrogram(m_pPlotSpectrogram->title().text());
+    pSpectrogram->setColorMap(createColourMap());
+    pSpectrogram->setData(m_pSpectrogramData->clone());
+    pSpectrogram->setZ(m_pPlotSpectrogram->z());
+
+    oSnapshot.addItem(pSpectrogram);
+    oSnapshot.setColourBar(m_pSpectrogramData->interval(Qt::ZAxis), createColourMap());
+}
+
+QwtLinearColorMap* cWaterfallQwtPlotWidget::createColourMap()
+{
+    QwtLinearColorMap *pColourMap = new QwtLinearColorMap(Qt::darkCyan, Qt::red);
+    pColourMap->addColorStop(0.25, Qt::cyan);
+    pColourMap->addColorStop(0.5, Qt::green);
+    pColourMap->addColorStop(0.75, Qt::yellow);
+
+    return pColourMap;
 }
 
 void cWaterfallQwtPlotWidget::setXRange(double dX1, double dX2)
 {
     m_pUI->qwtPlot->setAxisScale(QwtPlot::xBottom, dX1, dX2);
     m_pSpectrogramData->setInterval(Qt::XAxis, QwtInterval(dX1, dX2));
+    m_pPlotSpectrogram->getRasteriser()->invalidate();
+}
+
+void cWaterfallQwtPlotWidget::enableAdaptiveRowCount(bool bEnable, double dRowsPerPixel)
+{
+    m_bAdaptiveRowCount = bEnable;
+
+    if(dRowsPerPixel <= 0.0)
+        dRowsPerPixel = 1.0;
+
+    m_dRowsPerPixel = dRowsPerPixel;
+
+    if(m_bAdaptiveRowCount)
+        slotApplyAdaptiveRowCount();
+}
+
+bool cWaterfallQwtPlotWidget::eventFilter(QObject *pObject, QEvent *pEvent)
+{
+    if(m_bAdaptiveRowCount && pObject == m_pUI->qwtPlot->canvas() && pEvent->type() == QEvent::Resize)
+    {
+        //Restart the timer so that a drag resize re-bins the history only once at the end
+        m_oRowCountTimer.start();
+    }
+
+    return cQwtPlotWidgetBase::eventFilter(pObject, pEvent);
+}
+
+void cWaterfallQwtPlotWidget::slotApplyAdaptiveRowCount()
+{
+    if(!m_bAdaptiveRowCount)
+        return;
+
+    int32_t i32CanvasHeight_px = m_pUI->qwtPlot->canvas()->height();
+
+    if(i32CanvasHeight_px < 1)
+        return;
+
+    uint32_t u32NRows = qMax((uint32_t)qRound(i32CanvasHeight_px * m_dRowsPerPixel), (uint32_t)1);
+
+    if(u32NRows == m_pSpectrogramData->getNRows())
+        return;
+
+    cout << "cWaterfallQwtPlotWidget::slotApplyAdaptiveRowCount(): Re-binning waterfall from " << m_pSpectrogramData->getNRows()
+         << " to " << u32NRows << " rows for a canvas height of " << i32CanvasHeight_px << " px." << endl;
+
+    //Averaging time per row is span / rows
+    m_pSpectrogramData->setNRows(u32NRows);
+    updateRowInterval();
+    m_pPlotSpectrogram->getRasteriser()->invalidate();
+
+    slotUpdateData();
+}
+
+void cWaterfallQwtPlotWidget::slotTimeSpanChanged(int iSpan_s)
+{
+    Q_UNUSED(iSpan_s);
+
+    updateRowInterval();
 }
 
 void cWaterfallQwtPlotWidget::slotUpdateData()
@@ -253,6 +523,13 @@ void cWaterfallQwtPlotWidget::slotUpdateData()
     m_pUI->qwtPlot->setAxisScale(QwtPlot::yLeft, m_pSpectrogramData->getMaxTime_us() / 1e6, m_pSpectrogramData->getMinTime_us() / 1e6);
 }
 
+void cWaterfallQwtPlotWidget::slotRasterTilesAvailable()
+{
+    //More tiles of the current render have been composited. Discard Qwt's cached image and repaint with the new composite.
+    m_pPlotSpectrogram->invalidateCache();
+    m_pUI->qwtPlot->replot();
+}
+
 void cWaterfallQwtPlotWidget::slotEnableAutoscale(bool bEnable)
 {
     m_bIsAutoscaleEnabled = bEnable;
@@ -336,6 +613,7 @@ void cWaterfallQwtPlotWidget::enableLogConversion(bool bEnable)
     cQwtPlotWidgetBase::enableLogConversion(bEnable);
 
     m_pSpectrogramData->enableLogConversion(bEnable);
+    m_pPlotSpectrogram->getRasteriser()->invalidate();
 }
 
 void cWaterfallQwtPlotWidget::enablePowerLogConversion(bool bEnable)
@@ -343,4 +621,5 @@ void cWaterfallQwtPlotWidget::enablePowerLogConversion(bool bEnable)
     cQwtPlotWidgetBase::enablePowerLogConversion(bEnable);
 
     m_pSpectrogramData->enablePowerLogConversion(bEnable);
+    m_pPlotSpectrogram->getRasteriser()->invalidate();
 }
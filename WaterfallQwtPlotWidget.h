@@ -22,6 +22,8 @@ typedef unsigned __int64 uint64_t;
 #include <QDoubleSpinBox>
 #include <QLabel>
 #include <QVector>
+#include <QTimer>
+#include <QEvent>
 #include <qwt_plot_spectrogram.h>
 #include <qwt_matrix_raster_data.h>
 #include <qwt_plot_panner.h>
@@ -30,7 +32,10 @@ typedef unsigned __int64 uint64_t;
 
 //Local includes
 #include "QwtPlotWidgetBase.h"
+#include "PlotFrame.h"
+#include "AveragingStage.h"
 #include "WaterfallPlotSpectromgramData.h"
+#include "WaterfallQwtPlotSpectrogram.h"
 #include "QwtPlotPositionPicker.h"
 #include "QwtPlotDistancePicker.h"
 #include "CursorCentredQwtPlotMagnifier.h"
@@ -52,17 +57,55 @@ public:
     QString                             getChannelName(){return m_qstrChannelName;}
     
     void                                addData(const QVector<float> &qvfYData, int64_t i64Timestamp_us);
+    void                                addData(const float *pfYData, uint32_t u32NBins, int64_t i64Timestamp_us);
+
+    //Uses the channel of the frame given by getChannelNo()
+    void                                addData(const cPlotFrameView &oYData, int64_t i64Timestamp_us);
+
+    //Raw digitiser samples of the channel given by getChannelNo(), converted to power straight into the row average (see PlotFrame.h)
+    void                                addData(const cRawPlotFrameView &oYData, int64_t i64Timestamp_us);
+
+    //Many frames in one call. The render is restarted and the GUI notified at most once per batch.
+    //The first form uses the channel given by getChannelNo(), the second the given channel of each frame.
+    //The third is used for replay (see StreamReplayer.h) and takes the first listed channel or, if none, getChannelNo().
+    void                                addDataBatch(const cPlotFrameBatch &oBatch);
+    void                                addDataBatch(const cPlotFrameBatch &oBatch, uint32_t u32InputChannelNo);
+    virtual void                        addDataBatch(const cPlotFrameBatch &oBatch, const QVector<uint32_t> &qvu32ChannelList);
 
     void                                setXRange(double dX1, double dX2);
 
     void                                enableLogConversion(bool bEnable);
     void                                enablePowerLogConversion(bool bEnable);
-    
+
+    //When enabled the number of rows follows the canvas height: dRowsPerPixel times the height in pixels, e.g. 2 to keep detail for
+    //zooming in or 0.5 for rows two pixels high. History is re-binned on resize and the averaging time per row follows from span / rows.
+    void                                enableAdaptiveRowCount(bool bEnable, double dRowsPerPixel = 1.0);
+
+protected:
+    virtual bool                        eventFilter(QObject *pObject, QEvent *pEvent);
+
+    //The waterfall rows, their timestamps and the average in progress. Restored rows are re-binned to the current number of rows.
+    virtual bool                        snapshotHistory(cHistorySnapshot &oSnapshot);
+    virtual bool                        restoreHistorySnapshot(const cHistorySnapshotReader &oReader);
+
+    //A line per waterfall row: its timestamp then its values, with the X value of each bin as the axis
+    virtual bool                        snapshotData(cPlotDataExport &oExport);
+    virtual bool                        snapshotDisplayedData(cPlotDataExport &oExport);
+
+    //The spectrogram over a copy of the waterfall buffer, and the colour bar
+    virtual void                        addItemsToRenderSnapshot(cPlotRenderSnapshot &oSnapshot);
+
 private:
-    QwtPlotSpectrogram                  *m_pPlotSpectrogram;
+    //History snapshot sections (see HistorySnapshot.h)
+    static const uint32_t               SNAPSHOT_WATERFALL_ROWS = 0x100;            //Oldest first
+    static const uint32_t               SNAPSHOT_WATERFALL_TIMESTAMPS = 0x101;
+    static const uint32_t               SNAPSHOT_WATERFALL_AVERAGE = 0x102;         //Sum of the frames since the last row
+    static const uint32_t               SNAPSHOT_WATERFALL_AVERAGE_COUNT = 0x103;
+
+    cWaterfallQwtPlotSpectrogram        *m_pPlotSpectrogram;
     cWaterfallPlotSpectromgramData      *m_pSpectrogramData;
-    QVector<float>                      m_qvfAverage;
-    uint32_t                            m_u32AverageCount;
+    cBlockAveragingStage                m_oRowAveragingStage;
+    QVector<float>                      m_qvfAveragedRow; //Reused between rows
 
     //Addition plot settings
     QString                             m_qstrZLabel;
@@ -87,12 +130,35 @@ private:
     uint32_t                            m_u32ChannelNo;
     QString                             m_qstrChannelName;
 
+    //Channel lists recorded with input frames (see setRecorder()): this channel for whole frames and the first for the single channel ones
+    QVector<uint32_t>                   m_qvu32ChannelList;
+    QVector<uint32_t>                   m_qvu32RecordedChannelList;
+
     double                              m_dZScaleMin;
     double                              m_dZScaleMax;
 
     bool                                m_bAutoscaleValid;
 
+    //Adaptive row count
+    bool                                m_bAdaptiveRowCount;
+    double                              m_dRowsPerPixel;
+    QTimer                              m_oRowCountTimer; //Coalesces resize events so history is only re-binned once a resize settles
+
+    //Averaging time per row, span / rows. Protected by m_oMutex: updated on the GUI thread and read on ingest.
+    int64_t                             m_i64RowInterval_us;
+
     void                                setZRange(double dZMin, double dZMax);
+
+    static QwtLinearColorMap*           createColourMap();
+
+    //addData() in parts: accumulate the frame into the running average, add the average as a row when one is due
+    //and, once per call, restart the render, update the Z scale and notify the GUI thread.
+    int64_t                             getRowInterval_us();
+    void                                updateRowInterval();
+    void                                accumulateFrame(const float *pfYData, uint32_t u32NBins);
+    void                                addRowIfDue(int64_t i64Timestamp_us, uint32_t u32NBins);
+    void                                addAveragedRow(int64_t i64Timestamp_us);
+    void                                rowsAdded(uint32_t u32NBins);
     
 signals:
     void                                sigUpdateData();
@@ -104,9 +170,12 @@ public slots:
 protected slots:
     virtual void                        slotUpdateScalesAndLabels();
     void                                slotUpdateData();
+    void                                slotRasterTilesAvailable();
     void                                slotIntensityFloorChanged(double dValue);
     void                                slotIntensityCeilingChanged(double dValue);
     void                                slotDisableAutoscaleOnSuccess();
+    void                                slotApplyAdaptiveRowCount();
+    void                                slotTimeSpanChanged(int iSpan_s);
 
 };
 
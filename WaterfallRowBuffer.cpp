@@ -0,0 +1,215 @@
+//System includes
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+//Library includes
+#include <QtGlobal>
+
+//Local includes
+#include "WaterfallRowBuffer.h"
+
+using namespace std;
+
+cWaterfallRowBuffer::cWaterfallRowBuffer() :
+    m_u32NextRowIndex(0),
+    m_u32NRows(0),
+    m_u32NColumns(0)
+{
+}
+
+void cWaterfallRowBuffer::addRow(const QVector<float> &qvfRow, int64_t i64Timestamp_us)
+{
+    //Check that the buffer is the right width. Update as necessary
+    if((uint32_t)qvfRow.size() != m_u32NColumns)
+    {
+        setDimensions(qvfRow.size(), m_u32NRows);
+    }
+
+    //Copy the data and timestamp into the next index
+    std::copy(qvfRow.begin(), qvfRow.end(), m_qvvfRows[m_u32NextRowIndex].begin());
+    m_qvi64Timestamps_us[m_u32NextRowIndex] = i64Timestamp_us;
+
+    //Increment the next, unwrapping as necessary
+    m_u32NextRowIndex++;
+
+    if(m_u32NextRowIndex >= m_u32NRows)
+    {
+        m_u32NextRowIndex = 0;
+    }
+}
+
+void cWaterfallRowBuffer::setDimensions(uint32_t u32NColumns, uint32_t u32NRows, int64_t i64LatestTime_us, int64_t i64Span_us)
+{
+    m_qvvfRows.resize(u32NRows);
+
+    for(uint32_t u32Row = 0; u32Row < u32NRows; u32Row++)
+    {
+        m_qvvfRows[u32Row].resize(u32NColumns);
+    }
+
+    m_qvi64Timestamps_us.resize(u32NRows);
+
+    m_u32NColumns = u32NColumns;
+    m_u32NRows = u32NRows;
+
+    if(m_u32NextRowIndex >= m_u32NRows)
+        m_u32NextRowIndex = 0;
+
+    if(i64LatestTime_us)
+    {
+        for(uint32_t u32Row = 0; u32Row < m_u32NRows; u32Row++)
+        {
+            m_qvi64Timestamps_us[(u32Row + m_u32NextRowIndex) % m_u32NRows] = i64LatestTime_us - (int64_t)(m_u32NRows - 1 - u32Row) * i64Span_us / m_u32NRows;
+        }
+    }
+}
+
+uint32_t cWaterfallRowBuffer::getNColumns() const
+{
+    return m_u32NColumns;
+}
+
+uint32_t cWaterfallRowBuffer::getNRows() const
+{
+    return m_u32NRows;
+}
+
+void cWaterfallRowBuffer::setNRows(uint32_t u32NRows)
+{
+    if(!u32NRows || u32NRows == m_u32NRows || !m_u32NRows)
+        return;
+
+    //Each new row covers the span of old rows [u32NewRow * NOld / NNew, (u32NewRow + 1) * NOld / NNew) in chronological order.
+    //When shrinking the covered old rows are averaged. When growing each new row repeats the old row it falls in.
+
+    QVector< QVector<float> > qvvfNewRows(u32NRows, QVector<float>(m_u32NColumns, 0.0f));
+    QVector<int64_t> qvi64NewTimestamps_us(u32NRows);
+
+    for(uint32_t u32NewRow = 0; u32NewRow < u32NRows; u32NewRow++)
+    {
+        uint32_t u32Start = (uint64_t)u32NewRow * m_u32NRows / u32NRows;
+        uint32_t u32Stop = (uint64_t)(u32NewRow + 1) * m_u32NRows / u32NRows;
+
+        if(u32Stop <= u32Start)
+            u32Stop = u32Start + 1;
+
+        for(uint32_t u32OldRow = u32Start; u32OldRow < u32Stop; u32OldRow++)
+        {
+            const float *pfOldRow = getRow(u32OldRow);
+
+            for(uint32_t u32Col = 0; u32Col < m_u32NColumns; u32Col++)
+            {
+                qvvfNewRows[u32NewRow][u32Col] += pfOldRow[u32Col];
+            }
+        }
+
+        for(uint32_t u32Col = 0; u32Col < m_u32NColumns; u32Col++)
+        {
+            qvvfNewRows[u32NewRow][u32Col] /= (u32Stop - u32Start);
+        }
+
+        //A row is stamped with the time at which its last contribution ended.
+        //Interpolate between the old timestamps so that repeated rows still form a monotonic time axis.
+        double dPosition = (double)(u32NewRow + 1) * m_u32NRows / u32NRows - 1.0;
+        if(dPosition < 0.0)
+            dPosition = 0.0;
+
+        uint32_t u32Lower = (uint32_t)dPosition;
+        uint32_t u32Upper = qMin(u32Lower + 1, m_u32NRows - 1);
+        double dFraction = dPosition - u32Lower;
+
+        int64_t i64LowerTime_us = m_qvi64Timestamps_us[(u32Lower + m_u32NextRowIndex) % m_u32NRows];
+        int64_t i64UpperTime_us = m_qvi64Timestamps_us[(u32Upper + m_u32NextRowIndex) % m_u32NRows];
+
+        qvi64NewTimestamps_us[u32NewRow] = i64LowerTime_us + (int64_t)(dFraction * (i64UpperTime_us - i64LowerTime_us));
+    }
+
+    //The new buffer is in chronological order so the oldest row (and next to be overwritten) is at index 0
+    m_qvvfRows.swap(qvvfNewRows);
+    m_qvi64Timestamps_us.swap(qvi64NewTimestamps_us);
+    m_u32NRows = u32NRows;
+    m_u32NextRowIndex = 0;
+}
+
+void cWaterfallRowBuffer::getHistory(QVector< QVector<float> > &qvvfRows, QVector<int64_t> &qvi64Timestamps_us) const
+{
+    qvvfRows.resize(m_u32NRows);
+    qvi64Timestamps_us.resize(m_u32NRows);
+
+    for(uint32_t u32Row = 0; u32Row < m_u32NRows; u32Row++)
+    {
+        qvvfRows[u32Row] = m_qvvfRows[(u32Row + m_u32NextRowIndex) % m_u32NRows];
+        qvi64Timestamps_us[u32Row] = m_qvi64Timestamps_us[(u32Row + m_u32NextRowIndex) % m_u32NRows];
+    }
+}
+
+void cWaterfallRowBuffer::setHistory(const QVector< QVector<float> > &qvvfRows, const QVector<int64_t> &qvi64Timestamps_us)
+{
+    if(qvvfRows.isEmpty() || qvvfRows.size() != qvi64Timestamps_us.size())
+        return;
+
+    m_qvvfRows = qvvfRows;
+    m_qvi64Timestamps_us = qvi64Timestamps_us;
+    m_u32NRows = qvvfRows.size();
+    m_u32NColumns = qvvfRows[0].size();
+    m_u32NextRowIndex = 0;
+}
+
+const float* cWaterfallRowBuffer::getRow(uint32_t u32Row) const
+{
+    return m_qvvfRows[(u32Row + m_u32NextRowIndex) % m_u32NRows].constData();
+}
+
+int64_t cWaterfallRowBuffer::getMinTime_us() const
+{
+    return m_qvi64Timestamps_us[m_u32NextRowIndex];
+}
+
+int64_t cWaterfallRowBuffer::getMaxTime_us() const
+{
+    return m_qvi64Timestamps_us[m_u32NextRowIndex ? m_u32NextRowIndex - 1 : m_u32NRows - 1];
+}
+
+void cWaterfallRowBuffer::getMinMaxValue(double &dMin, double &dMax) const
+{
+    double dMaxTmp = -DBL_MAX;
+    double dMinTmp = DBL_MAX;
+
+    for(uint32_t u32Row = 0; u32Row < m_u32NRows; u32Row++)
+    {
+        const float *pfRow = m_qvvfRows[u32Row].constData();
+
+        for(uint32_t u32Col = 0; u32Col < m_u32NColumns; u32Col++)
+        {
+            if(pfRow[u32Col] > dMaxTmp)
+                dMaxTmp = pfRow[u32Col];
+
+            if(pfRow[u32Col] < dMinTmp)
+                dMinTmp = pfRow[u32Col];
+        }
+    }
+
+    dMax = dMaxTmp;
+    dMin = dMinTmp;
+}
+
+double cWaterfallRowBuffer::getMedian() const
+{
+    //Create vector and copy all amplitudes into it
+    std::vector<float> vfAllAmplitudes((uint64_t)m_u32NRows * m_u32NColumns);
+
+    if(vfAllAmplitudes.empty())
+        return 0.0;
+
+    for(uint32_t u32Row = 0; u32Row < m_u32NRows; u32Row++)
+    {
+        memcpy(&vfAllAmplitudes[(uint64_t)u32Row * m_u32NColumns], m_qvvfRows[u32Row].constData(), sizeof(float) * m_u32NColumns);
+    }
+
+    std::nth_element(vfAllAmplitudes.begin(), vfAllAmplitudes.begin() + vfAllAmplitudes.size() / 2, vfAllAmplitudes.end());
+
+    //Return median as linear amplitude
+    return vfAllAmplitudes[vfAllAmplitudes.size() / 2];
+}
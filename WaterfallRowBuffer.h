@@ -0,0 +1,68 @@
+//Circular buffer of timestamped waterfall rows, free of any GUI dependency. The newest row overwrites the oldest.
+//Rows are indexed chronologically, oldest first. Not thread safe: cWaterfallPlotSpectromgramData adapts it for Qwt and does the locking.
+
+#ifndef WATERFALL_ROW_BUFFER_H
+#define WATERFALL_ROW_BUFFER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QVector>
+
+//Local includes
+
+class cWaterfallRowBuffer
+{
+public:
+    cWaterfallRowBuffer();
+
+    //Overwrites the oldest row. A row of a different length changes the number of columns first.
+    void                        addRow(const QVector<float> &qvfRow, int64_t i64Timestamp_us);
+
+    //Existing rows are kept, truncated or zero padded. Optionally back-populates the timestamps from (LatestTime - Span) to LatestTime
+    //for a sensical time scale before any rows have been added.
+    void                        setDimensions(uint32_t u32NColumns, uint32_t u32NRows, int64_t i64LatestTime_us = 0, int64_t i64Span_us = 0);
+
+    uint32_t                    getNColumns() const;
+    uint32_t                    getNRows() const;
+
+    //Changes the number of rows while keeping the history. Rows are averaged together when shrinking and repeated when growing.
+    void                        setNRows(uint32_t u32NRows);
+
+    //Shallow copies of the rows. setHistory() replaces the buffer and its dimensions. All rows must be the same length.
+    void                        getHistory(QVector< QVector<float> > &qvvfRows, QVector<int64_t> &qvi64Timestamps_us) const;
+    void                        setHistory(const QVector< QVector<float> > &qvvfRows, const QVector<int64_t> &qvi64Timestamps_us);
+
+    const float*                getRow(uint32_t u32Row) const;
+
+    int64_t                     getMinTime_us() const;
+    int64_t                     getMaxTime_us() const;
+
+    void                        getMinMaxValue(double &dMin, double &dMax) const;
+    double                      getMedian() const;
+
+private:
+    QVector< QVector<float> >   m_qvvfRows;
+    QVector<int64_t>            m_qvi64Timestamps_us;
+
+    uint32_t                    m_u32NextRowIndex; //Also the index of the oldest row
+
+    uint32_t                    m_u32NRows;
+    uint32_t                    m_u32NColumns;
+};
+
+#endif // WATERFALL_ROW_BUFFER_H
@@ -0,0 +1,311 @@
+//System includes
+#include <cstring>
+
+//Library includes
+#include <QMutexLocker>
+
+//Local includes
+#include "WaterfallTileRasteriser.h"
+
+using namespace std;
+
+void cWaterfallTileRasteriser::cWorkerThread::run()
+{
+    m_pRasteriser->workerLoop();
+}
+
+cWaterfallTileRasteriser::cWaterfallTileRasteriser(uint32_t u32NThreads, uint32_t u32TileSize_px, QObject *pParent) :
+    QObject(pParent),
+    m_u32TileSize_px(u32TileSize_px),
+    m_bJobValid(false),
+    m_u32NTilesInFlight(0),
+    m_bShutdown(false),
+    m_oiGeneration(0),
+    m_oiDataChanged(0),
+    m_oiUpdatePending(0),
+    m_bCompositeChanged(false)
+{
+    //Automatically assign threads based on available hardware if not specified
+    if(!u32NThreads)
+    {
+        int iIdealThreadCount = QThread::idealThreadCount();
+
+        if(iIdealThreadCount < 1)
+            iIdealThreadCount = 1;
+
+        u32NThreads = iIdealThreadCount;
+    }
+
+    if(!m_u32TileSize_px)
+        m_u32TileSize_px = 64;
+
+    m_oJob.m_pData = NULL;
+    m_oJob.m_iGeneration = -1;
+
+    //Workers live for the lifetime of the rasteriser and sleep on the job condition when idle
+    for(uint32_t u32ThreadNo = 0; u32ThreadNo < u32NThreads; u32ThreadNo++)
+    {
+        m_qvpWorkers.push_back(new cWorkerThread(this));
+        m_qvpWorkers.last()->start();
+    }
+}
+
+cWaterfallTileRasteriser::~cWaterfallTileRasteriser()
+{
+    {
+        QMutexLocker oLock(&m_oJobMutex);
+
+        m_bShutdown = true;
+        m_qvoPendingTiles.clear();
+    }
+
+    //Abort anything in flight and wake all sleeping workers so that they can exit
+    m_oiGeneration.fetchAndAddOrdered(1);
+    m_oJobCondition.wakeAll();
+
+    for(uint32_t u32ThreadNo = 0; u32ThreadNo < (uint32_t)m_qvpWorkers.size(); u32ThreadNo++)
+    {
+        m_qvpWorkers[u32ThreadNo]->wait();
+        delete m_qvpWorkers[u32ThreadNo];
+    }
+}
+
+QImage cWaterfallTileRasteriser::renderImage(const cWaterfallPlotSpectromgramData *pData, const QwtColorMap *pColourMap,
+                                             const QwtScaleMap &oXMap, const QwtScaleMap &oYMap,
+                                             const QRectF &oArea, const QSize &oImageSize)
+{
+    //This is called from the GUI thread during painting. It never waits for rendering to complete.
+
+    if(oImageSize.isEmpty() || !pData || !pColourMap)
+        return QImage();
+
+    const QwtInterval oZInterval = pData->interval(Qt::ZAxis);
+
+    if(!oZInterval.isValid())
+        return QImage();
+
+    //Sample the colour map on this thread. The widget may replace or delete it while tiles are still being rendered.
+    QVector<QRgb> qvColourTable(COLOUR_TABLE_SIZE);
+
+    for(uint32_t u32EntryNo = 0; u32EntryNo < COLOUR_TABLE_SIZE; u32EntryNo++)
+    {
+        qvColourTable[u32EntryNo] = pColourMap->rgb(oZInterval, oZInterval.minValue() + oZInterval.width() * u32EntryNo / (COLOUR_TABLE_SIZE - 1));
+    }
+
+    //We are about to hand the current composite to the GUI so any pending notification is consumed here.
+    //(Clear before taking the image so that a tile finishing in between is never missed)
+    m_oiUpdatePending.fetchAndStoreOrdered(0);
+
+    {
+        QMutexLocker oJobLock(&m_oJobMutex);
+
+        bool bGeometryChanged = m_oJob.m_oArea != oArea || !scaleMapsEqual(m_oJob.m_oYMap, oYMap);
+
+        //A zoom, resize or new colour scale makes the current job useless. Abandon it straight away.
+        bool bRestart = !m_bJobValid
+                || m_oJob.m_pData != pData
+                || m_oJob.m_qvColourTable != qvColourTable
+                || m_oJob.m_oImageSize != oImageSize
+                || m_oJob.m_oZInterval != oZInterval
+                || !scaleMapsEqual(m_oJob.m_oXMap, oXMap)
+                || (bGeometryChanged && !isScroll(m_oJob.m_oYMap, m_oJob.m_oArea, oYMap, oArea));
+
+        //New rows and the time axis scrolling with them are coalesced. Let the current job finish so that every tile
+        //is eventually refreshed, then start one new job covering everything published in the meantime.
+        //The last tile of the current job signals the GUI thread so this is called again once the workers are idle.
+        bool bJobBusy = !m_qvoPendingTiles.isEmpty() || m_u32NTilesInFlight;
+
+        if(!bRestart && !bJobBusy)
+            bRestart = bGeometryChanged || m_oiDataChanged.load();
+
+        if(bRestart)
+        {
+            //Abort any tiles still being rendered for the old job
+            m_oJob.m_iGeneration = m_oiGeneration.fetchAndAddOrdered(1) + 1;
+            m_oiDataChanged.fetchAndStoreOrdered(0);
+
+            m_oJob.m_pData = pData;
+            m_oJob.m_qvColourTable = qvColourTable;
+            m_oJob.m_oXMap = oXMap;
+            m_oJob.m_oYMap = oYMap;
+            m_oJob.m_oArea = oArea;
+            m_oJob.m_oImageSize = oImageSize;
+            m_oJob.m_oZInterval = oZInterval;
+            m_bJobValid = true;
+
+            //If the image dimensions have changed the previous composite is of no use. Otherwise keep it
+            //and let new tiles progressively overwrite it. This avoids flicker during zoom animations.
+            {
+                QMutexLocker oImageLock(&m_oImageMutex);
+
+                if(m_oCompositeImage.size() != oImageSize)
+                {
+                    m_oCompositeImage = QImage(oImageSize, QImage::Format_ARGB32);
+                    m_oCompositeImage.fill(Qt::transparent);
+                    m_bCompositeChanged = true;
+                }
+            }
+
+            //Queue tiles. The stack is popped from the back so push bottom tiles first.
+            //The top of the waterfall (newest data) is then rendered first.
+            m_qvoPendingTiles.clear();
+
+            for(int32_t i32Top = ((oImageSize.height() - 1) / (int32_t)m_u32TileSize_px) * (int32_t)m_u32TileSize_px; i32Top >= 0; i32Top -= m_u32TileSize_px)
+            {
+                for(int32_t i32Left = 0; i32Left < oImageSize.width(); i32Left += m_u32TileSize_px)
+                {
+                    m_qvoPendingTiles.push_back( QRect(i32Left, i32Top,
+                                                       qMin((int32_t)m_u32TileSize_px, oImageSize.width() - i32Left),
+                                                       qMin((int32_t)m_u32TileSize_px, oImageSize.height() - i32Top)) );
+                }
+            }
+
+            m_oJobCondition.wakeAll();
+        }
+    }
+
+    QMutexLocker oImageLock(&m_oImageMutex);
+
+    if(m_bCompositeChanged)
+    {
+        m_oPublishedImage = m_oCompositeImage.copy();
+        m_bCompositeChanged = false;
+    }
+
+    return m_oPublishedImage;
+}
+
+void cWaterfallTileRasteriser::invalidate()
+{
+    //Newer data has been published. Don't abort anything: the job in progress still refreshes the image and
+    //renderImage() starts a fresh job once it has completed.
+
+    m_oiDataChanged.fetchAndStoreOrdered(1);
+}
+
+uint32_t cWaterfallTileRasteriser::getNThreads() const
+{
+    return m_qvpWorkers.size();
+}
+
+void cWaterfallTileRasteriser::workerLoop()
+{
+    //Tile buffer is reused between tiles to avoid per-tile allocations
+    QImage oTileImage(m_u32TileSize_px, m_u32TileSize_px, QImage::Format_ARGB32);
+
+    while(true)
+    {
+        cRenderJob oJob;
+        QRect oTile;
+
+        {
+            QMutexLocker oLock(&m_oJobMutex);
+
+            while(!m_bShutdown && m_qvoPendingTiles.isEmpty())
+            {
+                m_oJobCondition.wait(&m_oJobMutex);
+            }
+
+            if(m_bShutdown)
+                return;
+
+            oTile = m_qvoPendingTiles.last();
+            m_qvoPendingTiles.removeLast();
+            m_u32NTilesInFlight++;
+
+            oJob = m_oJob;
+        }
+
+        bool bRendered = renderTile(oJob, oTile, oTileImage);
+
+        if(bRendered)
+            compositeTile(oJob, oTile, oTileImage);
+
+        //Must be counted off before notifying so that the GUI thread sees an idle job when the last tile completes
+        {
+            QMutexLocker oLock(&m_oJobMutex);
+            m_u32NTilesInFlight--;
+        }
+
+        if(!bRendered)
+            continue; //Stale. A new job has already been queued
+
+        //Notify the GUI thread only once until it has collected the composite
+        if(!m_oiUpdatePending.fetchAndStoreOrdered(1))
+            sigTilesAvailable();
+    }
+}
+
+bool cWaterfallTileRasteriser::renderTile(const cRenderJob &oJob, const QRect &oTile, QImage &oTileImage)
+{
+    //Adapted from QwtPlotSpectrogram::renderTile() with the addition of an abort check per scanline.
+    //The tile is rendered into the top left corner of the tile buffer.
+
+    const QRgb *pColourTable = oJob.m_qvColourTable.constData();
+    const double dZMinimum = oJob.m_oZInterval.minValue();
+    const double dZScale = oJob.m_oZInterval.width() > 0.0 ? (COLOUR_TABLE_SIZE - 1) / oJob.m_oZInterval.width() : 0.0;
+
+    //Hold off writers for the duration of the tile. Tiles are small so ingest is never blocked for long.
+    QReadLocker oDataLock(oJob.m_pData->getMutex());
+
+    for(int32_t i32Y = 0; i32Y < oTile.height(); i32Y++)
+    {
+        if(m_oiGeneration.load() != oJob.m_iGeneration)
+            return false;
+
+        const double dY = oJob.m_oYMap.invTransform(oTile.top() + i32Y);
+
+        QRgb *pLine = reinterpret_cast<QRgb*>(oTileImage.scanLine(i32Y));
+
+        for(int32_t i32X = 0; i32X < oTile.width(); i32X++)
+        {
+            const double dX = oJob.m_oXMap.invTransform(oTile.left() + i32X);
+
+            //Clamp to the ends of the colour scale as QwtLinearColorMap does. NaN falls through to the first entry.
+            const double dIndex = (oJob.m_pData->value(dX, dY) - dZMinimum) * dZScale;
+            uint32_t u32Index = 0;
+
+            if(dIndex >= COLOUR_TABLE_SIZE - 1)
+                u32Index = COLOUR_TABLE_SIZE - 1;
+            else if(dIndex > 0.0)
+                u32Index = (uint32_t)(dIndex + 0.5);
+
+            *pLine++ = pColourTable[u32Index];
+        }
+    }
+
+    return true;
+}
+
+void cWaterfallTileRasteriser::compositeTile(const cRenderJob &oJob, const QRect &oTile, const QImage &oTileImage)
+{
+    QMutexLocker oLock(&m_oImageMutex);
+
+    //Final check under the image lock so that a stale tile never lands in a newer composite
+    if(m_oiGeneration.load() != oJob.m_iGeneration || m_oCompositeImage.size() != oJob.m_oImageSize)
+        return;
+
+    for(int32_t i32Y = 0; i32Y < oTile.height(); i32Y++)
+    {
+        memcpy(m_oCompositeImage.scanLine(oTile.top() + i32Y) + oTile.left() * sizeof(QRgb), oTileImage.constScanLine(i32Y), oTile.width() * sizeof(QRgb));
+    }
+
+    m_bCompositeChanged = true;
+}
+
+bool cWaterfallTileRasteriser::scaleMapsEqual(const QwtScaleMap &oMap1, const QwtScaleMap &oMap2)
+{
+    return oMap1.s1() == oMap2.s1() && oMap1.s2() == oMap2.s2() && oMap1.p1() == oMap2.p1() && oMap1.p2() == oMap2.p2();
+}
+
+bool cWaterfallTileRasteriser::isScroll(const QwtScaleMap &oMap1, const QRectF &oArea1, const QwtScaleMap &oMap2, const QRectF &oArea2)
+{
+    //True if only the position of the time axis has moved, as it does with every new row. The spans are derived from
+    //timestamps so allow for rounding.
+    const double dTolerance = 1e-9 * qAbs(oMap1.s2() - oMap1.s1());
+
+    return oMap1.p1() == oMap2.p1() && oMap1.p2() == oMap2.p2()
+            && qAbs((oMap1.s2() - oMap1.s1()) - (oMap2.s2() - oMap2.s1())) <= dTolerance
+            && oArea1.left() == oArea2.left() && oArea1.width() == oArea2.width()
+            && qAbs(oArea1.height() - oArea2.height()) <= dTolerance;
+}
@@ -0,0 +1,131 @@
+//Renders the waterfall spectrogram image with a persistent pool of worker threads.
+//The image is split into small square tiles which are handed out to the workers. A new zoom rectangle or colour scale abandons
+//the current job immediately. New rows and scrolling are coalesced instead: the current job runs to completion and a single
+//new job picks up everything published meanwhile, so that a fast stream can never starve the render.
+//Finished tiles are composited progressively and the GUI thread is handed a copy of the composite, so it never waits for a full render.
+
+#ifndef WATERFALL_TILE_RASTERISER_H
+#define WATERFALL_TILE_RASTERISER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QImage>
+#include <QVector>
+#include <QRect>
+#include <qwt_scale_map.h>
+#include <qwt_color_map.h>
+#include <qwt_interval.h>
+
+//Local includes
+#include "WaterfallPlotSpectromgramData.h"
+
+class cWaterfallTileRasteriser : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit cWaterfallTileRasteriser(uint32_t u32NThreads = 0, uint32_t u32TileSize_px = 64, QObject *pParent = 0);
+    ~cWaterfallTileRasteriser();
+
+    //Returns the most recently composited image for the requested geometry immediately.
+    //If the geometry or data have changed since the last call a new render job is started in the background.
+    //The colour map is sampled into a table here so it need not outlive the call.
+    QImage                                  renderImage(const cWaterfallPlotSpectromgramData *pData, const QwtColorMap *pColourMap,
+                                                        const QwtScaleMap &oXMap, const QwtScaleMap &oYMap,
+                                                        const QRectF &oArea, const QSize &oImageSize);
+
+    //Marks the data as changed. The next renderImage() after the current job completes starts a new one. Safe to call from any thread.
+    void                                    invalidate();
+
+    uint32_t                                getNThreads() const;
+
+private:
+    class cWorkerThread : public QThread
+    {
+    public:
+        explicit cWorkerThread(cWaterfallTileRasteriser *pRasteriser) : m_pRasteriser(pRasteriser) {}
+
+    protected:
+        virtual void                        run();
+
+    private:
+        cWaterfallTileRasteriser            *m_pRasteriser;
+    };
+
+    //Number of entries the colour map is sampled to over the Z interval
+    static const uint32_t                   COLOUR_TABLE_SIZE = 1024;
+
+    //Everything a worker needs to render a tile. Copied by each worker as it takes a tile
+    struct cRenderJob
+    {
+        const cWaterfallPlotSpectromgramData *m_pData;
+        QVector<QRgb>                       m_qvColourTable;
+        QwtScaleMap                         m_oXMap;
+        QwtScaleMap                         m_oYMap;
+        QRectF                              m_oArea;
+        QSize                               m_oImageSize;
+        QwtInterval                         m_oZInterval;
+        int                                 m_iGeneration;
+    };
+
+    QVector<cWorkerThread*>                 m_qvpWorkers;
+    uint32_t                                m_u32TileSize_px;
+
+    //Job queue
+    QMutex                                  m_oJobMutex;
+    QWaitCondition                          m_oJobCondition;
+    cRenderJob                              m_oJob;
+    bool                                    m_bJobValid;
+    QVector<QRect>                          m_qvoPendingTiles; //Used as a stack. Last entry is rendered first
+    uint32_t                                m_u32NTilesInFlight;
+    bool                                    m_bShutdown;
+
+    //Incremented whenever outstanding work becomes stale
+    QAtomicInt                              m_oiGeneration;
+
+    //Set by invalidate() until the next job is started
+    QAtomicInt                              m_oiDataChanged;
+
+    //Set when finished tiles have been composited but not yet collected by the GUI thread
+    QAtomicInt                              m_oiUpdatePending;
+
+    //Tiles are composited into an image that is never handed out, so writing to it never detaches. The GUI thread is given
+    //a copy, taken only when tiles have landed since the last one.
+    QMutex                                  m_oImageMutex;
+    QImage                                  m_oCompositeImage;
+    QImage                                  m_oPublishedImage;
+    bool                                    m_bCompositeChanged;
+
+    void                                    workerLoop();
+    bool                                    renderTile(const cRenderJob &oJob, const QRect &oTile, QImage &oTileImage);
+    void                                    compositeTile(const cRenderJob &oJob, const QRect &oTile, const QImage &oTileImage);
+
+    static bool                             scaleMapsEqual(const QwtScaleMap &oMap1, const QwtScaleMap &oMap2);
+    static bool                             isScroll(const QwtScaleMap &oMap1, const QRectF &oArea1, const QwtScaleMap &oMap2, const QRectF &oArea2);
+
+signals:
+    void                                    sigTilesAvailable();
+
+};
+
+#endif // WATERFALL_TILE_RASTERISER_H
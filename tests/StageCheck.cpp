@@ -0,0 +1,266 @@
+//Checks of the GUI-free processing stages. Depends only on QtCore so it runs on a headless node.
+//Build and run from this directory with qmake (see StageCheck.pro):
+//
+//  qmake StageCheck.pro && make && ./StageCheck
+//
+//or without qmake (as a single command):
+//
+//  g++ -std=c++11 -fPIC -I.. $(pkg-config --cflags Qt5Core) -o StageCheck StageCheck.cpp ../AveragingStage.cpp ../BandIntegrationStage.cpp
+//      ../ScrollingHistoryStage.cpp ../WaterfallRowBuffer.cpp ../PlotFrame.cpp $(pkg-config --libs Qt5Core)
+//
+//Returns 0 if all checks pass. Each failure is printed.
+
+//System includes
+#include <iostream>
+#include <cmath>
+#include <limits>
+
+//Library includes
+#include <QVector>
+
+//Local includes
+#include "../AveragingStage.h"
+#include "../BandIntegrationStage.h"
+#include "../ScrollingHistoryStage.h"
+#include "../WaterfallRowBuffer.h"
+
+using namespace std;
+
+static uint32_t g_u32NFailures = 0;
+
+static void check(bool bCondition, const char *cpDescription)
+{
+    if(bCondition)
+        return;
+
+    cout << "FAILED: " << cpDescription << endl;
+    g_u32NFailures++;
+}
+
+static bool isClose(double dValue, double dExpected)
+{
+    return fabs(dValue - dExpected) <= 1e-5 * (1.0 + fabs(dExpected));
+}
+
+static void checkAveragingStage()
+{
+    cAveragingStage oStage;
+
+    //2 channels of 4 bins. Frame N holds N + bin + 10 * channel.
+    for(uint32_t u32FrameNo = 0; u32FrameNo < 3; u32FrameNo++)
+    {
+        QVector<float> qvfData(8);
+
+        for(uint32_t u32SampleNo = 0; u32SampleNo < 8; u32SampleNo++)
+        {
+            qvfData[u32SampleNo] = u32FrameNo + u32SampleNo % 4 + 10 * (u32SampleNo / 4);
+        }
+
+        cAveragingStage::cHistoryEntry &oEntry = oStage.nextEntry(2, 4, 2);
+        oEntry.m_oFrame = cSharedPlotFrame(qvfData, 2, 4);
+        oEntry.m_qvu32ChannelList.clear();
+    }
+
+    //Only frames 1 and 2 are in a history of 2 so the mean is bin + 10 * channel + 1.5
+    QVector<cAveragingStage::cBinRange> qvoRanges(1);
+    qvoRanges[0].m_u32Begin = 0;
+    qvoRanges[0].m_u32End = 4;
+    qvoRanges[0].m_u32Stride = 1;
+
+    QVector<QVector<float> > qvvfOutput;
+    oStage.process(qvoRanges, 2, 4, qvvfOutput);
+
+    check(qvvfOutput.size() == 2 && qvvfOutput[0].size() == 4, "cAveragingStage output shape");
+    check(isClose(qvvfOutput[0][0], 1.5) && isClose(qvvfOutput[0][3], 4.5), "cAveragingStage mean of channel 0");
+    check(isClose(qvvfOutput[1][2], 13.5), "cAveragingStage mean of channel 1");
+
+    //A strided range max pools each block into its first bin and leaves the bins in between untouched
+    qvvfOutput[0].fill(-1.0f);
+    qvoRanges[0].m_u32Stride = 2;
+    oStage.process(qvoRanges, 2, 4, qvvfOutput);
+
+    check(isClose(qvvfOutput[0][0], 2.5) && isClose(qvvfOutput[0][2], 4.5) && qvvfOutput[0][1] == -1.0f, "cAveragingStage strided range");
+
+    //A block cut short by the end of the range pools only the bins in the range
+    qvoRanges[0].m_u32End = 3;
+    oStage.process(qvoRanges, 2, 4, qvvfOutput);
+
+    check(isClose(qvvfOutput[0][2], 3.5), "cAveragingStage partial block");
+
+    //A change of shape clears the history
+    oStage.nextEntry(1, 4, 2);
+    check(!oStage.isEmpty() && oStage.getNewestEntry().m_oFrame.getNBins() == 0, "cAveragingStage restart on shape change");
+}
+
+static void checkBlockAveragingStage()
+{
+    cBlockAveragingStage oStage;
+
+    float afFrame1[] = {1.0f, 2.0f, 3.0f};
+    float afFrame2[] = {3.0f, 4.0f, 5.0f};
+
+    oStage.accumulate(afFrame1, 3);
+    oStage.accumulate(afFrame2, 3);
+
+    check(oStage.getNFrames() == 2, "cBlockAveragingStage frame count");
+
+    QVector<float> qvfAverage;
+    oStage.takeAverage(qvfAverage);
+
+    check(qvfAverage.size() == 3 && isClose(qvfAverage[0], 2.0) && isClose(qvfAverage[2], 4.0), "cBlockAveragingStage average");
+    check(oStage.getNFrames() == 0 && oStage.getSum()[1] == 0.0f, "cBlockAveragingStage reset after average");
+}
+
+static void checkBandIntegrationStage()
+{
+    //One channel of 8 bins with alternating signs. The prefix sums are of |x|.
+    QVector<QVector<float> > qvvfFrame(1, QVector<float>(8));
+
+    for(uint32_t u32BinNo = 0; u32BinNo < 8; u32BinNo++)
+    {
+        qvvfFrame[0][u32BinNo] = (u32BinNo % 2) ? -(float)u32BinNo : (float)u32BinNo;
+    }
+
+    QVector<QVector<double> > qvvdPrefixSums;
+    cBandIntegrationStage::computePrefixSums(cPlotFrameView(qvvfFrame), QVector<uint32_t>(), qvvdPrefixSums);
+
+    check(qvvdPrefixSums.size() == 1 && qvvdPrefixSums[0].size() == 9, "cBandIntegrationStage prefix sum shape");
+    check(qvvdPrefixSums[0][0] == 0.0 && isClose(qvvdPrefixSums[0][8], 28.0), "cBandIntegrationStage prefix sum of |x|");
+
+    //Integration adds successive frames and restarts on request
+    QVector<QVector<double> > qvvdIntegrated;
+    cBandIntegrationStage::integratePrefixSums(qvvdPrefixSums, qvvdIntegrated, true);
+    cBandIntegrationStage::integratePrefixSums(qvvdPrefixSums, qvvdIntegrated, false);
+
+    check(isClose(qvvdIntegrated[0][8], 56.0), "cBandIntegrationStage integration");
+
+    //The spectrum spans [0, 8) so band edges in X are bins
+    cBandIntegrationStage::cBandBins oBins = cBandIntegrationStage::getBandBins(2.0, 5.0, 0.0, 8.0, 8);
+    check(oBins.m_u32StartIndex == 2 && oBins.m_u32StopIndex == 5 && oBins.m_dWidth == 3.0, "cBandIntegrationStage band edges");
+
+    oBins = cBandIntegrationStage::getBandBins(-100.0, 1e300, 0.0, 8.0, 8);
+    check(oBins.m_u32StartIndex == 0 && oBins.m_u32StopIndex == 8, "cBandIntegrationStage band edges clamped");
+
+    oBins = cBandIntegrationStage::getBandBins(1.0, 1.0, 4.0, 4.0, 8);
+    check(oBins.m_u32StartIndex == 0 && oBins.m_u32StopIndex == 0 && oBins.m_dWidth == 1.0, "cBandIntegrationStage degenerate span");
+
+    oBins = cBandIntegrationStage::getBandBins(numeric_limits<double>::quiet_NaN(), 2.0, 0.0, 8.0, 8);
+    check(oBins.m_u32StartIndex == 0 && oBins.m_u32StopIndex == 2, "cBandIntegrationStage NaN band edge");
+
+    //Band [2, 5] inclusive is |2| + |-3| + |4| + |-5| = 14 divided by a width of 3
+    QVector<cBandIntegrationStage::cBandBins> qvoBands(1, cBandIntegrationStage::getBandBins(2.0, 5.0, 0.0, 8.0, 8));
+    QVector<float> qvfBandPowers;
+    cBandIntegrationStage::computeBandPowers(qvvdPrefixSums, 8, 1, qvoBands, qvfBandPowers);
+
+    check(qvfBandPowers.size() == 1 && isClose(qvfBandPowers[0], 14.0 / 3.0), "cBandIntegrationStage band power");
+}
+
+static void checkScrollingHistoryStage()
+{
+    QVector<QVector<float> > qvvfFrame(2, QVector<float>(3, 10.0f));
+    qvvfFrame[1].fill(100.0f);
+
+    //Select channel 1 only
+    QVector<uint32_t> qvu32ChannelList(1, 1);
+    QVector<QVector<float> > qvvfHistory;
+
+    cScrollingHistoryStage::appendFrame(cPlotFrameView(qvvfFrame), qvu32ChannelList, qvvfHistory);
+    cScrollingHistoryStage::appendFrame(cPlotFrameView(qvvfFrame), qvu32ChannelList, qvvfHistory);
+
+    check(qvvfHistory.size() == 1 && qvvfHistory[0].size() == 6 && qvvfHistory[0][5] == 100.0f, "cScrollingHistoryStage append");
+
+    cScrollingHistoryStage::trim(qvvfHistory, 4);
+    check(qvvfHistory[0].size() == 4, "cScrollingHistoryStage trim");
+
+    //Convert only the newest 2 samples
+    cScrollingHistoryStage::toDecibels(qvvfHistory, 2, 10.0);
+    check(qvvfHistory[0][1] == 100.0f && isClose(qvvfHistory[0][3], 20.0), "cScrollingHistoryStage partial log conversion");
+
+    QVector<double> qvdXData;
+
+    for(uint32_t u32SampleNo = 0; u32SampleNo < 10; u32SampleNo++)
+    {
+        qvdXData.push_back(u32SampleNo);
+    }
+
+    check(cScrollingHistoryStage::getNSamplesOutsideSpan(qvdXData, 0, 4.0) == 5, "cScrollingHistoryStage span");
+    check(cScrollingHistoryStage::getNSamplesOutsideSpan(qvdXData, 3, 4.0) == 2, "cScrollingHistoryStage span after scrolled out samples");
+    check(cScrollingHistoryStage::getNSamplesOutsideSpan(QVector<double>(), 0, 4.0) == 0, "cScrollingHistoryStage empty span");
+}
+
+static void checkWaterfallRowBuffer()
+{
+    cWaterfallRowBuffer oBuffer;
+
+    //Back populated timestamps give a time scale before any rows arrive
+    oBuffer.setDimensions(2, 4, 4000, 4000);
+    check(oBuffer.getMinTime_us() == 1000 && oBuffer.getMaxTime_us() == 4000, "cWaterfallRowBuffer back populated timestamps");
+
+    //Row N holds {N, -N}. 6 rows into 4 wraps so that rows 3 to 6 remain, oldest first.
+    for(uint32_t u32RowNo = 1; u32RowNo <= 6; u32RowNo++)
+    {
+        QVector<float> qvfRow(2);
+        qvfRow[0] = u32RowNo;
+        qvfRow[1] = -(float)u32RowNo;
+
+        oBuffer.addRow(qvfRow, u32RowNo * 10000);
+    }
+
+    check(oBuffer.getRow(0)[0] == 3.0f && oBuffer.getRow(3)[0] == 6.0f, "cWaterfallRowBuffer addRow wrap");
+    check(oBuffer.getMinTime_us() == 30000 && oBuffer.getMaxTime_us() == 60000, "cWaterfallRowBuffer timestamps after wrap");
+
+    //Shrinking averages rows 3 and 4, and 5 and 6. Each new row takes the time of the last old row it covers.
+    oBuffer.setNRows(2);
+
+    check(oBuffer.getNRows() == 2 && isClose(oBuffer.getRow(0)[0], 3.5) && isClose(oBuffer.getRow(1)[1], -5.5), "cWaterfallRowBuffer setNRows average");
+    check(oBuffer.getMinTime_us() == 40000 && oBuffer.getMaxTime_us() == 60000, "cWaterfallRowBuffer setNRows timestamps");
+
+    double dMin;
+    double dMax;
+    oBuffer.getMinMaxValue(dMin, dMax);
+
+    check(isClose(dMin, -5.5) && isClose(dMax, 5.5), "cWaterfallRowBuffer min max");
+
+    //Of -5.5, -3.5, 3.5 and 5.5 the upper median is taken
+    check(isClose(oBuffer.getMedian(), 3.5), "cWaterfallRowBuffer median");
+
+    //Growing repeats each row
+    oBuffer.setNRows(4);
+
+    check(isClose(oBuffer.getRow(1)[0], 3.5) && isClose(oBuffer.getRow(2)[0], 5.5), "cWaterfallRowBuffer setNRows repeat");
+
+    QVector<QVector<float> > qvvfRows;
+    QVector<int64_t> qvi64Timestamps_us;
+    oBuffer.getHistory(qvvfRows, qvi64Timestamps_us);
+
+    bool bMonotonic = true;
+
+    for(uint32_t u32RowNo = 1; u32RowNo < (uint32_t)qvi64Timestamps_us.size(); u32RowNo++)
+    {
+        bMonotonic &= qvi64Timestamps_us[u32RowNo] >= qvi64Timestamps_us[u32RowNo - 1];
+    }
+
+    check(bMonotonic && qvi64Timestamps_us.last() == 60000, "cWaterfallRowBuffer setNRows timestamps after growing");
+
+    //A row of a different length changes the number of columns
+    oBuffer.addRow(QVector<float>(3, 1.0f), 70000);
+    check(oBuffer.getNColumns() == 3 && oBuffer.getMaxTime_us() == 70000, "cWaterfallRowBuffer column change");
+}
+
+int main()
+{
+    checkAveragingStage();
+    checkBlockAveragingStage();
+    checkBandIntegrationStage();
+    checkScrollingHistoryStage();
+    checkWaterfallRowBuffer();
+
+    if(g_u32NFailures)
+    {
+        cout << g_u32NFailures << " check(s) failed." << endl;
+        return 1;
+    }
+
+    cout << "All checks passed." << endl;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#Builds the GUI-free stage checks only (see StageCheck.cpp). QtCore is the only dependency.
+
+QT -= gui
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = StageCheck
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += StageCheck.cpp \
+    ../AveragingStage.cpp \
+    ../BandIntegrationStage.cpp \
+    ../ScrollingHistoryStage.cpp \
+    ../WaterfallRowBuffer.cpp \
+    ../PlotFrame.cpp
+
+HEADERS += ../AveragingStage.h \
+    ../BandIntegrationStage.h \
+    ../ScrollingHistoryStage.h \
+    ../WaterfallRowBuffer.h \
+    ../PlotFrame.h